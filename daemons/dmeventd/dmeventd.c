@@ -21,6 +21,8 @@
 #include "dmeventd.h"
 
 #include "libdm/misc/dm-logging.h"
+#include "libdm/misc/dm-ioctl.h"
+#include "libdm/misc/kdev_t.h"
 #include "base/memory/zalloc.h"
 
 #include "libdaemon/server/daemon-stray.h"
@@ -34,6 +36,7 @@
 #include <arpa/inet.h>		/* for htonl, ntohl */
 #include <fcntl.h>		/* for musl libc */
 #include <poll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 #include <syslog.h>
 #include <sys/utsname.h>
@@ -98,6 +101,14 @@ static const time_t DMEVENTD_IDLE_EXIT_TIMEOUT = 60 * 60;
 /* Default grace period for thread cleanup 10 seconds */
 #define DMEVENTD_DEFAULT_GRACE_PERIOD 10
 
+/*
+ * Worker threads running the DSO calls with multiplexed monitoring.
+ * More are started while all are busy, e.g. waiting for lvm commands,
+ * so one slow device does not hold back the events of the others.
+ */
+#define DMEVENTD_WORKER_THREADS 4
+#define DMEVENTD_MAX_WORKER_THREADS 64
+
 /* Sanity limit for client message size */
 #define DM_EVENT_MAX_MSG_SIZE (16 * 1024 * 1024)
 static int _grace_period = DMEVENTD_DEFAULT_GRACE_PERIOD;
@@ -201,6 +212,19 @@ struct dso_data {
 	 */
 	int (*unregister_device)(const char *device, const char *uuid,
 				 int major, int minor, void **user);
+
+	/*
+	 * Optional.  Called once when the DSO is loaded and only when
+	 * the kernel supports the shared worker threads (see _mux_init).
+	 * A DSO returning non-zero has its devices monitored by them and
+	 * may remember that for register_device().  Its functions are then called for one device from
+	 * different threads, so they must not leave state in the calling
+	 * thread, e.g. a changed signal mask or a child process that is
+	 * reaped when a signal interrupts the wait for the next event.
+	 * Other DSOs keep a monitoring thread for each device.
+	 */
+	int (*use_shared_threads)(void);
+	int shared_threads;
 };
 static DM_LIST_INIT(_dso_registry);
 
@@ -230,12 +254,16 @@ enum {
  *
  * One thread per mapped device which can block on it until an event
  * occurs and the event processing function of the DSO gets called.
+ * With multiplexed monitoring (see _mux_init) there is no such thread,
+ * the same states are then driven by the worker threads.
  *
  * LOCKING PROTOCOL:
  * - _global_mutex: Protects registry lists, prevents thread from being freed
  * - thread->mutex: Protects mutable per-thread state fields
  * - _timeout_mutex: Protects timeout registry linkage
- * - Lock ordering: _global_mutex FIRST, then thread->mutex (never reversed)
+ * - _mux_mutex: Protects the worker queue and _mux_relist
+ * - Lock ordering: _global_mutex FIRST, then thread->mutex (never reversed),
+ *   _mux_mutex is taken last
  *
  * REGISTRIES:
  * - _thread_registry: Active threads (REGISTERING, RUNNING, GRACE_PERIOD)
@@ -247,6 +275,9 @@ struct thread_status {
 	/* === Fields protected by _timeout_mutex === */
 	struct dm_list timeout_list;	/* Timeout registry linkage */
 
+	/* === Fields protected by _mux_mutex === */
+	struct dm_list queue_list;	/* Worker queue linkage */
+
 	/* === Fields NOT requiring locks (immutable or special purpose) === */
 	pthread_t thread;		/* Thread ID, set once at creation */
 	pthread_cond_t grace_cond;	/* Condition variable for grace period */
@@ -270,6 +301,10 @@ struct thread_status {
 	int processing;			/* Event processing in progress flag */
 	time_t next_time;		/* Next timeout timestamp */
 	unsigned timeout;		/* Timeout interval in seconds */
+	uint32_t event_nr;		/* Last seen device event number */
+	int queued;			/* Queued or taken by a worker */
+	int mux;			/* Monitored by the workers, set once */
+	time_t grace_time;		/* End of grace period for workers */
 };
 
 static DM_LIST_INIT(_thread_registry);		/* Active threads (REGISTERING, RUNNING, GRACE_PERIOD) */
@@ -280,6 +315,20 @@ static DM_LIST_INIT(_timeout_registry);
 static pthread_mutex_t _timeout_mutex;
 static pthread_cond_t _timeout_cond;
 
+static int _mux = 0;			/* Multiplexed monitoring in use */
+static int _mux_exit = 0;		/* Workers and poll thread exit */
+static int _mux_control_fd = -1;	/* Control node armed for poll */
+static int _mux_wakeup_fd[2] = { -1, -1 };
+static pthread_t _mux_poll_thread_id;
+static pthread_t _mux_worker_ids[DMEVENTD_MAX_WORKER_THREADS];
+static unsigned _mux_workers = 0;
+static unsigned _mux_idle = 0;		/* Workers waiting for the queue */
+static unsigned _mux_queued = 0;	/* Threads in the queue */
+static int _mux_relist = 0;		/* List devices on next wakeup */
+static DM_LIST_INIT(_mux_queue);	/* Threads waiting for a worker */
+static pthread_mutex_t _mux_mutex;
+static pthread_cond_t _mux_cond;
+
 /*
  * Get current time for timeout and elapsed-time computation.
  *
@@ -399,12 +448,20 @@ static int _lookup_symbol(void *dl, void **symbol, const char *name)
 
 static int _lookup_symbols(void *dl, struct dso_data *data)
 {
-	return _lookup_symbol(dl, (void *) &data->process_event,
-			      "process_event") &&
-		_lookup_symbol(dl, (void *) &data->register_device,
-			       "register_device") &&
-		_lookup_symbol(dl, (void *) &data->unregister_device,
-			       "unregister_device");
+	if (!_lookup_symbol(dl, (void *) &data->process_event,
+			    "process_event") ||
+	    !_lookup_symbol(dl, (void *) &data->register_device,
+			    "register_device") ||
+	    !_lookup_symbol(dl, (void *) &data->unregister_device,
+			    "unregister_device"))
+		return 0;
+
+	/* Optional */
+	*(void **) &data->use_shared_threads = dlsym(dl, "use_shared_threads");
+	data->shared_threads = _mux && data->use_shared_threads &&
+		data->use_shared_threads();
+
+	return 1;
 }
 
 /* Load an application specific DSO. */
@@ -493,11 +550,16 @@ static struct thread_status *_alloc_thread_status(const struct message_data *dat
 	_lib_get(dso_data);
 	thread->dso_data = dso_data;
 
-	if (!(thread->wait_task = dm_task_create(DM_DEVICE_WAITEVENT)))
-		goto_out;
+	thread->mux = _mux && dso_data->shared_threads;
 
-	if (!dm_task_set_uuid(thread->wait_task, data->device_uuid))
-		goto_out;
+	/* Multiplexed monitoring reads the status when an event is seen */
+	if (!thread->mux) {
+		if (!(thread->wait_task = dm_task_create(DM_DEVICE_WAITEVENT)))
+			goto_out;
+
+		if (!dm_task_set_uuid(thread->wait_task, data->device_uuid))
+			goto_out;
+	}
 
 	if (!(thread->device.uuid = strdup(data->device_uuid)))
 		goto_out;
@@ -524,6 +586,7 @@ static struct thread_status *_alloc_thread_status(const struct message_data *dat
 	thread->events = data->events_field;
 	thread->pending = DM_EVENT_REGISTRATION_PENDING;
 	dm_list_init(&thread->timeout_list);
+	dm_list_init(&thread->queue_list);
 
 	return thread;
 
@@ -727,7 +790,9 @@ static int _fill_device_data(struct thread_status *ts)
 
 	ts->device.major = dmi.major;
 	ts->device.minor = dmi.minor;
-	dm_task_set_event_nr(ts->wait_task, dmi.event_nr);
+	ts->event_nr = dmi.event_nr;
+	if (ts->wait_task)
+		dm_task_set_event_nr(ts->wait_task, dmi.event_nr);
 
 	ret = 1;
 fail:
@@ -980,6 +1045,54 @@ static int _thread_wakeup_signal(struct thread_status *thread)
 	return ret;
 }
 
+/* Wake up the poll thread to look at the devices again. */
+static void _mux_wakeup(void)
+{
+	static const char c = 0;
+
+	/* Pipe is non-blocking, when it is full the wakeup is pending anyway */
+	if ((write(_mux_wakeup_fd[1], &c, 1) < 0) && (errno != EAGAIN))
+		log_sys_debug("write", "wakeup pipe");
+}
+
+static void *_mux_worker_thread(void *unused);
+
+/* Start one more worker.  Caller must hold _mux_mutex. */
+static int _mux_start_worker(void)
+{
+	if (_mux_exit || (_mux_workers >= DMEVENTD_MAX_WORKER_THREADS))
+		return 0;
+
+	if (_pthread_create_smallstack(&_mux_worker_ids[_mux_workers],
+				       _mux_worker_thread, NULL))
+		return_0;
+
+	_mux_workers++;
+
+	return 1;
+}
+
+/*
+ * Hand a thread to the workers.
+ * Only one worker at a time takes a thread, a thread already queued
+ * or taken sees the new events when the worker is done with it.
+ * When no worker is free to take it, another one is started.
+ * Caller must hold thread->mutex.
+ */
+static void _mux_queue_thread(struct thread_status *thread)
+{
+	if (thread->queued)
+		return;
+
+	thread->queued = 1;
+	pthread_mutex_lock(&_mux_mutex);
+	dm_list_add(&_mux_queue, &thread->queue_list);
+	if ((++_mux_queued > _mux_idle) && _mux_start_worker())
+		DEBUGLOG("Started worker thread %u.", _mux_workers);
+	pthread_cond_signal(&_mux_cond);
+	pthread_mutex_unlock(&_mux_mutex);
+}
+
 /* Wake up monitor threads every so often. */
 static void *_timeout_thread(void *unused __attribute__((unused)))
 {
@@ -1007,6 +1120,9 @@ static void *_timeout_thread(void *unused __attribute__((unused)))
 						 "extending next_time to %ld.",
 						 (int) thread->thread,
 						 (long)thread->next_time);
+				} else if (thread->mux) {
+					thread->current_events |= DM_EVENT_TIMEOUT;
+					_mux_queue_thread(thread);
 				} else {
 					DEBUGLOG("Sending SIGALRM to Thr %x for timeout.",
 						 (int) thread->thread);
@@ -1222,8 +1338,8 @@ static void _do_process_event(struct thread_status *thread)
 
 	thread->current_events = 0; /* Clear events before processing */
 
-	/* NOTE: timeout event gets status */
-	task = (current_events & DM_EVENT_TIMEOUT)
+	/* NOTE: timeout event and multiplexed monitoring get status */
+	task = ((current_events & DM_EVENT_TIMEOUT) || !thread->wait_task)
 		? _get_device_status(thread) : thread->wait_task;
 
 	if (!task)
@@ -1463,6 +1579,429 @@ static int _create_thread(struct thread_status *thread)
 	return _pthread_create_smallstack(&thread->thread, _monitor_thread, thread);
 }
 
+/*
+ * Multiplexed monitoring.
+ *
+ * Since dm ioctl 4.37 a poll() on the control node armed with
+ * DM_DEV_ARM_POLL reports an event of any device, and the device
+ * list carries the event number of each device.  One poll thread
+ * then compares the event numbers of all monitored devices and queues
+ * those that changed to a few worker threads, which register the devices
+ * with their DSO and call process_event().  This replaces the thread
+ * blocked in DM_DEVICE_WAITEVENT for each device, which is still used
+ * with older kernels.
+ *
+ * Timeouts are queued by the timeout thread, and the end of a grace
+ * period by the poll thread.
+ */
+
+/* Arm the control node, poll() reports any later event. */
+static int _mux_arm_poll(void)
+{
+	struct dm_ioctl dmi = {
+		.version = { DM_VERSION_MAJOR, 37, 0 },
+		.data_size = sizeof(dmi),
+	};
+
+	if (ioctl(_mux_control_fd, DM_DEV_ARM_POLL, &dmi) < 0) {
+		log_sys_error("ioctl", "DM_DEV_ARM_POLL");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * List devices with their event numbers, the list lives in the task.
+ * Kernels listing no event numbers cannot be monitored this way.
+ */
+static struct dm_task *_mux_list_devices(struct dm_list **devs)
+{
+	struct dm_task *dmt;
+	unsigned features = 0;
+
+	if (!(dmt = dm_task_create(DM_DEVICE_LIST)))
+		return_NULL;
+
+	if (!dm_task_run(dmt) ||
+	    !dm_task_get_device_list(dmt, devs, &features)) {
+		log_error("Failed to list devices for events.");
+		goto bad;
+	}
+
+	if (!(features & DM_DEVICE_LIST_HAS_EVENT_NR)) {
+		log_error("Kernel driver lists devices without event numbers.");
+		goto bad;
+	}
+
+	return dmt;
+bad:
+	dm_device_list_destroy(devs);
+	dm_task_destroy(dmt);
+
+	return NULL;
+}
+
+/*
+ * Queue threads whose grace period is over and, when the devices are
+ * listed, threads of devices whose event number changed or that are gone.
+ * Returns the poll() timeout until the next grace period ends,
+ * or 0 when listing failed and has to be retried.
+ */
+static int _mux_scan(int list_devices)
+{
+	struct dm_task *dmt = NULL;
+	struct dm_list *devs = NULL;
+	struct dm_active_device *dev;
+	struct dm_hash_table *devnos = NULL;
+	struct thread_status *thread;
+	time_t now, next = 0;
+	dev_t devno;
+	int timeout_ms = 0;
+
+	if (list_devices) {
+		if (!(dmt = _mux_list_devices(&devs)))
+			return 0;
+
+		if (!(devnos = dm_hash_create(dm_list_size(devs) + 1)))
+			goto_out;
+
+		dm_list_iterate_items(dev, devs)
+			if (!dm_hash_insert_binary(devnos, &dev->devno, sizeof(dev->devno), dev))
+				goto_out;
+	}
+
+	now = _get_curr_time();
+
+	_lock_mutex();
+	dm_list_iterate_items(thread, &_thread_registry) {
+		if (!thread->mux)
+			continue; /* Has its own monitoring thread */
+		_lock_thread(thread);
+		switch (thread->status) {
+		case DM_THREAD_RUNNING:
+			if (!devnos)
+				break;
+			devno = MKDEV(thread->device.major, thread->device.minor);
+			if (!(dev = dm_hash_lookup_binary(devnos, &devno, sizeof(devno))) ||
+			    (dev->event_nr != thread->event_nr)) {
+				DEBUGLOG("Queueing event for %s.", thread->device.name);
+				thread->current_events |= DM_EVENT_DEVICE_ERROR;
+				_mux_queue_thread(thread);
+			}
+			break;
+		case DM_THREAD_GRACE_PERIOD:
+			if (thread->grace_time <= now)
+				_mux_queue_thread(thread);
+			else if (!next || (thread->grace_time < next))
+				next = thread->grace_time;
+			break;
+		}
+		_unlock_thread(thread);
+	}
+	_unlock_mutex();
+
+	timeout_ms = next ? (int) (next - now) * 1000 : -1;
+out:
+	if (devnos)
+		dm_hash_destroy(devnos);
+	if (dmt) {
+		dm_device_list_destroy(&devs);
+		dm_task_destroy(dmt);
+	}
+
+	return timeout_ms;
+}
+
+/* Take the request to list devices again, set by a registered device. */
+static int _mux_take_relist(void)
+{
+	int relist;
+
+	pthread_mutex_lock(&_mux_mutex);
+	relist = _mux_relist;
+	_mux_relist = 0;
+	pthread_mutex_unlock(&_mux_mutex);
+
+	return relist;
+}
+
+/*
+ * Devices are listed only when the armed control node reports an event
+ * or a device was registered.  Wakeups for a grace period only walk
+ * the registry, so a thousand devices are not listed for each.
+ */
+static void *_mux_poll_thread(void *unused __attribute__((unused)))
+{
+	struct pollfd fds[2] = {
+		{ .fd = _mux_control_fd, .events = POLLIN },
+		{ .fd = _mux_wakeup_fd[0], .events = POLLIN },
+	};
+	char buf[64];
+	int armed = 0, list_devices = 1, timeout_ms;
+
+	DEBUGLOG("Poll thread starting.");
+
+	while (!_mux_exit) {
+		/* Arm before listing, so no event is missed in between */
+		if (list_devices)
+			armed = _mux_arm_poll();
+		if (!(timeout_ms = _mux_scan(list_devices)))
+			armed = 0; /* Retry listing */
+		if (!armed && ((timeout_ms < 0) || (timeout_ms > 1000)))
+			timeout_ms = 1000;
+
+		fds[0].revents = fds[1].revents = 0;
+		if ((poll(fds, 2, timeout_ms) < 0) && (errno != EINTR))
+			log_sys_debug("poll", "control");
+
+		if (fds[1].revents & POLLIN)
+			while (read(_mux_wakeup_fd[0], buf, sizeof(buf)) > 0)
+				/* Drain */;
+
+		list_devices = !armed || (fds[0].revents & POLLIN) || _mux_take_relist();
+	}
+
+	DEBUGLOG("Poll thread finished.");
+
+	return NULL;
+}
+
+/*
+ * Run the next step of a queued thread, as the monitoring thread
+ * does in _monitor_thread().
+ * Called with thread->mutex LOCKED, returns with thread->mutex UNLOCKED.
+ */
+static void _mux_process(struct thread_status *thread)
+{
+	sigset_t pendmask;
+
+	switch (thread->status) {
+	case DM_THREAD_REGISTERING:
+		if (!_fill_device_data(thread)) {
+			log_error("Failed to fill device data for %s.", thread->device.uuid);
+			goto unregister;
+		}
+
+		thread->inode = _get_device_inode(thread);
+
+		if (!_do_register_device(thread)) {
+			log_error("Failed to register device %s.", thread->device.name);
+			goto unregister;
+		}
+
+		DEBUGLOG("Monitoring %s (events: %x).", thread->device.name, thread->events);
+
+		thread->status = DM_THREAD_RUNNING;
+		thread->pending = 0;
+		thread->processing = 0;
+		thread->used++;
+		/* Event may have come while registering, list devices again */
+		pthread_mutex_lock(&_mux_mutex);
+		_mux_relist = 1;
+		pthread_mutex_unlock(&_mux_mutex);
+		_mux_wakeup();
+		break;
+	case DM_THREAD_RUNNING:
+		if (thread->current_events & DM_EVENT_DEVICE_ERROR) {
+			/* Recheck device info whether is still exists */
+			if (!_fill_device_data(thread)) {
+				log_error("%s disappeared, detaching.", thread->device.name);
+				goto unregister;
+			}
+			thread->current_events &= thread->events;
+		}
+
+		if (thread->events & thread->current_events) {
+			thread->processing = 1;  /* Cannot be removed/signaled */
+
+			_do_process_event(thread);
+
+			thread->processing = 0;
+
+			/* DSO can drop its device via SIGALRM, as with monitoring thread */
+			if (sigpending(&pendmask) < 0)
+				log_sys_error("sigpending", "");
+			else if (sigismember(&pendmask, SIGALRM)) {
+				if (!_reset_pending_signal(SIGALRM))
+					stack;
+				goto unregister;
+			}
+		}
+
+		if (!thread->events) {
+			if (!_grace_period || _exit_now)
+				goto unregister;
+
+			DEBUGLOG("Gracing %s (used: %d).", thread->device.name, thread->used);
+
+			thread->current_events = 0;
+			thread->processing = 1; /* No signaling */
+			thread->status = DM_THREAD_GRACE_PERIOD;
+			thread->grace_time = _get_curr_time() + _grace_period;
+			/* Poll thread waits for the end of grace period */
+			_mux_wakeup();
+		}
+		break;
+	case DM_THREAD_GRACE_PERIOD:
+		if (_exit_now || (thread->grace_time <= _get_curr_time()))
+			goto unregister;
+		break;
+	}
+
+	thread->queued = 0;
+
+	/* Events or unregistration seen while the thread was taken */
+	if ((thread->status == DM_THREAD_RUNNING) &&
+	    (!thread->events || (thread->events & thread->current_events)))
+		_mux_queue_thread(thread);
+
+	_unlock_thread(thread);
+
+	return;
+
+unregister:
+	thread->queued = 0;
+	/* Thread may be freed once unlocked there */
+	_monitor_unregister(thread);
+}
+
+static void *_mux_worker_thread(void *unused __attribute__((unused)))
+{
+	struct thread_status *thread;
+	struct dm_list *l;
+
+	pthread_mutex_lock(&_mux_mutex);
+
+	while (!_mux_exit) {
+		if (!(l = dm_list_first(&_mux_queue))) {
+			_mux_idle++;
+			pthread_cond_wait(&_mux_cond, &_mux_mutex);
+			_mux_idle--;
+			continue;
+		}
+
+		/* Queued thread is not freed until a worker is done with it */
+		dm_list_del(l);
+		_mux_queued--;
+		pthread_mutex_unlock(&_mux_mutex);
+
+		thread = dm_list_struct_base(l, struct thread_status, queue_list);
+		_lock_thread(thread);
+		_mux_process(thread);
+
+		pthread_mutex_lock(&_mux_mutex);
+	}
+
+	pthread_mutex_unlock(&_mux_mutex);
+
+	return NULL;
+}
+
+static void _mux_exit_threads(void)
+{
+	unsigned i;
+
+	if (_mux_poll_thread_id || _mux_workers) {
+		pthread_mutex_lock(&_mux_mutex);
+		_mux_exit = 1;
+		pthread_cond_broadcast(&_mux_cond);
+		pthread_mutex_unlock(&_mux_mutex);
+	}
+
+	if (_mux_poll_thread_id) {
+		_mux_wakeup();
+		if (pthread_join(_mux_poll_thread_id, NULL))
+			log_sys_debug("pthread_join", "poll thread");
+		_mux_poll_thread_id = 0;
+	}
+
+	for (i = 0; i < _mux_workers; ++i)
+		if (pthread_join(_mux_worker_ids[i], NULL))
+			log_sys_debug("pthread_join", "worker thread");
+	_mux_workers = _mux_idle = _mux_queued = 0;
+
+	for (i = 0; i < 2; ++i)
+		if ((_mux_wakeup_fd[i] >= 0) && close(_mux_wakeup_fd[i]))
+			log_sys_debug("close", "wakeup pipe");
+
+	if ((_mux_control_fd >= 0) && close(_mux_control_fd))
+		log_sys_debug("close", DM_CONTROL_NODE);
+
+	_mux_wakeup_fd[0] = _mux_wakeup_fd[1] = _mux_control_fd = -1;
+	_mux = 0;
+}
+
+/* Use multiplexed monitoring when the kernel supports it. */
+static int _mux_init(void)
+{
+	struct dm_task *dmt;
+	struct dm_list *devs = NULL;
+	char control[PATH_MAX];
+	char version[64];
+	unsigned major, minor;
+	int i;
+
+	if (!dm_driver_version(version, sizeof(version)) ||
+	    (sscanf(version, "%u.%u", &major, &minor) != 2) ||
+	    (major != DM_VERSION_MAJOR) || (minor < 37)) {
+		log_debug("Kernel driver %s cannot poll for events.", version);
+		return 0;
+	}
+
+	if (dm_snprintf(control, sizeof(control), "%s/%s", dm_dir(), DM_CONTROL_NODE) < 0)
+		return_0;
+
+	if ((_mux_control_fd = open(control, O_RDWR | O_CLOEXEC)) < 0) {
+		log_sys_error("open", control);
+		return 0;
+	}
+
+	if (pipe(_mux_wakeup_fd)) {
+		log_sys_error("pipe", "wakeup");
+		goto bad;
+	}
+
+	for (i = 0; i < 2; ++i)
+		if ((fcntl(_mux_wakeup_fd[i], F_SETFD, FD_CLOEXEC) < 0) ||
+		    (fcntl(_mux_wakeup_fd[i], F_SETFL, O_NONBLOCK) < 0)) {
+			log_sys_error("fcntl", "wakeup pipe");
+			goto bad;
+		}
+
+	if (!_mux_arm_poll())
+		goto_bad;
+
+	/* Poll thread compares the listed event numbers */
+	if (!(dmt = _mux_list_devices(&devs)))
+		goto_bad;
+	dm_device_list_destroy(&devs);
+	dm_task_destroy(dmt);
+
+	_mux = 1;
+
+	pthread_mutex_lock(&_mux_mutex);
+	while (_mux_workers < DMEVENTD_WORKER_THREADS)
+		if (!_mux_start_worker())
+			break;
+	pthread_mutex_unlock(&_mux_mutex);
+
+	if (_mux_workers < DMEVENTD_WORKER_THREADS)
+		goto_bad;
+
+	if (_pthread_create_smallstack(&_mux_poll_thread_id, _mux_poll_thread, NULL))
+		goto_bad;
+
+	log_debug("Monitoring devices with %u worker threads.", _mux_workers);
+
+	return 1;
+bad:
+	_mux_exit_threads();
+	_mux_exit = 0;
+
+	return 0;
+}
+
 /*
  * Set timeout interval and next timeout timestamp for a thread.
  * Should be called when enabling timeout events.
@@ -1512,6 +2051,23 @@ static int _update_events(struct thread_status *thread)
 
 	thread->pending = DM_EVENT_REGISTRATION_PENDING;
 
+	if (thread->mux) {
+		if (thread->status == DM_THREAD_GRACE_PERIOD) {
+			if (thread->events) {
+				/* Reused by a new registration, nothing waits on it */
+				thread->status = DM_THREAD_RUNNING;
+				thread->processing = 0;
+			} else if (_exit_now)
+				_mux_queue_thread(thread);
+		} else if (!thread->events && (thread->status == DM_THREAD_RUNNING))
+			_mux_queue_thread(thread); /* Worker moves it to grace period */
+
+		if (thread->status != DM_THREAD_REGISTERING)
+			thread->pending = 0;
+
+		return 0;
+	}
+
 	/* Wake up thread waiting in grace period for new registration or exit */
 	if ((thread->events || _exit_now) && (thread->status == DM_THREAD_GRACE_PERIOD)) {
 		DEBUGLOG("Waking up thread %x waiting in grace period (events=%x).",
@@ -1607,8 +2163,12 @@ static void _unregister_threads(unsigned only_grace)
 			thread->events = 0;
 			_update_events(thread);
 		}
-		if (thread->status == DM_THREAD_GRACE_PERIOD)
-			pthread_cond_signal(&thread->grace_cond);
+		if (thread->status == DM_THREAD_GRACE_PERIOD) {
+			if (thread->mux)
+				_mux_queue_thread(thread);
+			else
+				pthread_cond_signal(&thread->grace_cond);
+		}
 		_unlock_thread(thread);
 	}
 
@@ -1695,15 +2255,24 @@ static int _register_for_event(struct message_data *message_data)
 		/* Set next timeout for new thread before it starts */
 		_set_timeout_to_thread(thread, message_data->timeout_secs);
 
-		if ((ret = _create_thread(thread))) {
-			stack;
-			_free_thread_status(thread);
-			return -ret;
-		}
+		if (thread->mux) {
+			_lock_mutex();
+			LINK_THREAD(thread);
+			/* Registration with the DSO runs in a worker */
+			_lock_thread(thread);
+			_mux_queue_thread(thread);
+			_unlock_thread(thread);
+		} else {
+			if ((ret = _create_thread(thread))) {
+				stack;
+				_free_thread_status(thread);
+				return -ret;
+			}
 
-		_lock_mutex();
-		/* Note: same uuid can't be added in parallel */
-		LINK_THREAD(thread);
+			_lock_mutex();
+			/* Note: same uuid can't be added in parallel */
+			LINK_THREAD(thread);
+		}
 	}
 
 	_unlock_mutex();
@@ -2252,7 +2821,7 @@ static void _cleanup_unused_threads(void)
 		_lock_thread(thread);
 
 		if (thread->status != DM_THREAD_DONE) {
-			if (thread->processing) {
+			if (thread->processing || thread->mux) {
 				_unlock_thread(thread);
 				break; /* cleanup on the next round */
 			}
@@ -2272,7 +2841,7 @@ static void _cleanup_unused_threads(void)
 
 		DEBUGLOG("Destroying Thr %x.", (int)thread->thread);
 
-		if (pthread_join(thread->thread, NULL))
+		if (!thread->mux && pthread_join(thread->thread, NULL))
 			log_sys_debug("pthread_join", "");
 
 		_free_thread_status(thread);
@@ -2914,9 +3483,14 @@ int main(int argc, char *argv[])
 
 	if (pthread_mutex_init(&_global_mutex, NULL) ||
 	    pthread_mutex_init(&_timeout_mutex, NULL) ||
-	    _pthread_cond_init(&_timeout_cond))
+	    _pthread_cond_init(&_timeout_cond) ||
+	    pthread_mutex_init(&_mux_mutex, NULL) ||
+	    pthread_cond_init(&_mux_cond, NULL))
 		exit(EXIT_FAILURE);
 
+	if (!_mux_init())
+		log_debug("Monitoring devices with a thread per device.");
+
 	if (!_systemd_activation && !_open_fifos(&fifos))
 		exit(EXIT_FIFO_FAILURE);
 
@@ -2979,6 +3553,8 @@ int main(int argc, char *argv[])
 		_cleanup_unused_threads();
 	}
 
+	_mux_exit_threads();
+
 	/* Terminate timeout thread if it exists */
 	pthread_mutex_lock(&_timeout_mutex);
 	if (!_timeout_thread_id)
@@ -2994,6 +3570,8 @@ int main(int argc, char *argv[])
 
 	pthread_cond_destroy(&_timeout_cond);
 	pthread_mutex_destroy(&_timeout_mutex);
+	pthread_cond_destroy(&_mux_cond);
+	pthread_mutex_destroy(&_mux_mutex);
 	pthread_mutex_destroy(&_global_mutex);
 
 	log_notice("dmeventd shutting down.");
@@ -16,9 +16,13 @@
 #include "dmeventd_lvm.h"
 #include "daemons/dmeventd/libdevmapper-event.h"
 #include "lib/metadata/metadata-exported.h" /* MIRROR_SYNC_LAYER */
+#include "lib/misc/lvm-string.h" /* NAME_LEN */
 #include "tools/lvm2cmd.h"
 
+#include <ctype.h>
 #include <pthread.h>
+#include <time.h>
+#include <sys/wait.h>
 
 /*
  * register_device() is called first and performs initialisation.
@@ -49,20 +53,275 @@ static void _lvm2_print_log(int level, const char *file, int line,
 }
 
 /*
- * Currently only one event can be processed at a time.
+ * The in-process lvm2 instance runs one command at a time.
+ *
+ * liblvm2cmd keeps its device cache, label scanning, lvmcache and
+ * memory locking in process globals, so a second instance cannot run
+ * in dmeventd.  While it is busy, a command for another VG runs in
+ * a forked lvm process instead, up to DMEVENTD_LVM2_MAX_FORKED of them.
+ * Commands for one VG run one at a time.  Waiting commands are ordered
+ * by priority, so a pool closer to full is extended first, and the time
+ * spent waiting is reported.
  */
+#define DMEVENTD_LVM2_MAX_FORKED 8
+#define DMEVENTD_LVM2_MAX_ARGS 64	/* As lvm2_run() */
+
+struct event_waiter {
+	struct dm_list list;
+	int priority;
+	const char *vgname;	/* NULL needs the in-process instance */
+	int forked;		/* Granted a forked lvm process */
+};
+
 static pthread_mutex_t _event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _event_cond = PTHREAD_COND_INITIALIZER;
+static int _event_busy = 0;		/* In-process instance running */
+static const char *_event_vgname = NULL; /* VG of in-process command */
+static unsigned _event_forked = 0;
+static DM_LIST_INIT(_event_forked_list);	/* Running forked commands */
+static DM_LIST_INIT(_event_waiters);	/* Sorted by priority */
+
+static struct {
+	unsigned runs;
+	unsigned forks;
+	unsigned waits;
+	double wait_total;
+	double wait_max;
+} _event_stats;
+
+static double _event_time(void)
+{
+	struct timespec ts;
 
-void dmeventd_lvm2_lock(void)
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0.;
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Called with _event_mutex held. */
+static int _event_vg_running(const char *vgname)
 {
+	struct event_waiter *w;
+
+	if (!vgname)
+		return 0;
+
+	if (_event_busy && _event_vgname && !strcmp(_event_vgname, vgname))
+		return 1;
+
+	dm_list_iterate_items(w, &_event_forked_list)
+		if (!strcmp(w->vgname, vgname))
+			return 1;
+
+	return 0;
+}
+
+/* Called with _event_mutex held. */
+static int _event_can_run(const struct event_waiter *waiter)
+{
+	if (_event_vg_running(waiter->vgname))
+		return 0;
+
+	return !_event_busy ||
+		(waiter->vgname && (_event_forked < DMEVENTD_LVM2_MAX_FORKED));
+}
+
+/*
+ * Wait until the waiter may run, either in-process or forked.
+ * An earlier waiter that can run goes first.
+ */
+static void _event_lock(struct event_waiter *waiter)
+{
+	struct event_waiter *w;
+	struct dm_list *pos = &_event_waiters;
+	double start, wait;
+	unsigned queued;
+	int first;
+
 	pthread_mutex_lock(&_event_mutex);
+
+	_event_stats.runs++;
+
+	if (!dm_list_empty(&_event_waiters) || !_event_can_run(waiter)) {
+		start = _event_time();
+		queued = dm_list_size(&_event_waiters);
+
+		/* Run after waiters with the same or higher priority */
+		dm_list_iterate_items(w, &_event_waiters)
+			if (w->priority < waiter->priority) {
+				pos = &w->list;
+				break;
+			}
+		dm_list_add(pos, &waiter->list);
+
+		for (;;) {
+			first = 1;
+			dm_list_iterate_items(w, &_event_waiters) {
+				if (w == waiter)
+					break;
+				if (_event_can_run(w)) {
+					first = 0;
+					break;
+				}
+			}
+			if (first && _event_can_run(waiter))
+				break;
+			pthread_cond_wait(&_event_cond, &_event_mutex);
+		}
+
+		dm_list_del(&waiter->list);
+
+		wait = _event_time() - start;
+		_event_stats.waits++;
+		_event_stats.wait_total += wait;
+		if (wait > _event_stats.wait_max)
+			_event_stats.wait_max = wait;
+
+		log_verbose("Waited %.3f seconds to run lvm command (priority %d, %u queued).",
+			    wait, waiter->priority, queued);
+
+		/* Others may run alongside */
+		if (!dm_list_empty(&_event_waiters))
+			pthread_cond_broadcast(&_event_cond);
+	}
+
+	if (!_event_busy) {
+		waiter->forked = 0;
+		_event_busy = 1;
+		_event_vgname = waiter->vgname;
+	} else {
+		waiter->forked = 1;
+		_event_forked++;
+		_event_stats.forks++;
+		dm_list_add(&_event_forked_list, &waiter->list);
+	}
+
+	pthread_mutex_unlock(&_event_mutex);
+}
+
+void dmeventd_lvm2_lock_prio(int priority)
+{
+	struct event_waiter waiter = { .priority = priority };
+
+	_event_lock(&waiter);
+}
+
+void dmeventd_lvm2_lock(void)
+{
+	dmeventd_lvm2_lock_prio(DMEVENTD_LVM2_PRIO_DEFAULT);
 }
 
 void dmeventd_lvm2_unlock(void)
 {
+	pthread_mutex_lock(&_event_mutex);
+	_event_busy = 0;
+	_event_vgname = NULL;
+	if (!dm_list_empty(&_event_waiters))
+		pthread_cond_broadcast(&_event_cond);
 	pthread_mutex_unlock(&_event_mutex);
 }
 
+/* Run the command in a forked lvm binary and wait for it. */
+static int _run_forked(const char *cmdline)
+{
+	char *args[DMEVENTD_LVM2_MAX_ARGS + 2], *cmdcopy, *b, *e;
+	const char *lvm_binary = getenv("LVM_BINARY") ? : LVM_PATH;
+	char quote;
+	int argc = 0, status = 0, r = 0, i;
+	pid_t pid;
+
+	if (!(cmdcopy = strdup(cmdline))) {
+		log_error("Cmdline copy failed.");
+		return 0;
+	}
+
+	/* Split as lvm2_run() does */
+	args[argc++] = (char *) lvm_binary;
+	for (b = cmdcopy; *b && (argc <= DMEVENTD_LVM2_MAX_ARGS); b = e) {
+		while (*b && isspace(*b))
+			b++;
+		if (!*b)
+			break;
+		quote = 0;
+		if ((*b == '\'') || (*b == '"'))
+			quote = *b++;
+		e = b;
+		while (*e && (quote ? (*e != quote) : !isspace(*e)))
+			e++;
+		args[argc++] = b;
+		if (*e)
+			*e++ = '\0';
+	}
+	args[argc] = NULL;
+
+	log_verbose("Executing %s %s.", lvm_binary, cmdline);
+
+	if (!(pid = fork())) {
+		/* child */
+		(void) close(0);
+		for (i = 3; i < 255; ++i) (void) close(i);
+		execv(lvm_binary, args);
+		_exit(errno);
+	} else if (pid == -1) {
+		log_sys_error("fork", lvm_binary);
+		goto out;
+	}
+
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR) {
+			log_sys_error("waitpid", lvm_binary);
+			goto out;
+		}
+
+	if (WIFEXITED(status) && !WEXITSTATUS(status))
+		r = 1;
+	else if (WIFEXITED(status))
+		log_verbose("Child %d exited with status %d.", pid, WEXITSTATUS(status));
+	else if (WIFSIGNALED(status))
+		log_verbose("Child %d was terminated with signal %d.", pid, WTERMSIG(status));
+out:
+	free(cmdcopy);
+
+	return r;
+}
+
+int dmeventd_lvm2_run_with_lock_prio(const char *cmdline, int priority)
+{
+	struct event_waiter waiter = { .priority = priority };
+	char vgname[NAME_LEN];
+	const char *vg, *slash;
+	int r;
+
+	/* Commands end with vg/lv, see dmeventd_lvm2_command() */
+	vg = (vg = strrchr(cmdline, ' ')) ? vg + 1 : cmdline;
+	if ((slash = strchr(vg, '/')) && (slash > vg) &&
+	    ((size_t) (slash - vg) < sizeof(vgname))) {
+		memcpy(vgname, vg, slash - vg);
+		vgname[slash - vg] = '\0';
+		waiter.vgname = vgname;
+	}
+
+	_event_lock(&waiter);
+
+	if (!waiter.forked) {
+		r = dmeventd_lvm2_run(cmdline);
+		dmeventd_lvm2_unlock();
+		return r;
+	}
+
+	r = _run_forked(cmdline);
+
+	pthread_mutex_lock(&_event_mutex);
+	dm_list_del(&waiter.list);
+	_event_forked--;
+	if (!dm_list_empty(&_event_waiters))
+		pthread_cond_broadcast(&_event_cond);
+	pthread_mutex_unlock(&_event_mutex);
+
+	return r;
+}
+
 int dmeventd_lvm2_init(void)
 {
 	int r = 0;
@@ -86,6 +345,8 @@ int dmeventd_lvm2_init(void)
 		}
 
 		lvm2_disable_dmeventd_monitoring(_lvm_handle);
+		/* Forked lvm commands do not monitor through dmeventd either */
+		(void) setenv("LVM_RUN_BY_DMEVENTD", "1", 1);
 		/* FIXME Temporary: move to dmeventd core */
 		lvm2_run(_lvm_handle, "_memlock_inc");
 		log_debug("lvm plugin initialized.");
@@ -105,6 +366,14 @@ void dmeventd_lvm2_exit(void)
 
 	if (!--_register_count) {
 		log_debug("lvm plugin shutting down.");
+		pthread_mutex_lock(&_event_mutex);
+		if (_event_stats.waits)
+			log_verbose("Ran %u lvm command(s), %u forked, %u waited %.3f seconds on average, %.3f at most.",
+				    _event_stats.runs, _event_stats.forks, _event_stats.waits,
+				    _event_stats.wait_total / _event_stats.waits,
+				    _event_stats.wait_max);
+		memset(&_event_stats, 0, sizeof(_event_stats));
+		pthread_mutex_unlock(&_event_mutex);
 		lvm2_run(_lvm_handle, "_memlock_dec");
 		dm_pool_destroy(_mem_pool);
 		_mem_pool = NULL;
@@ -33,7 +33,19 @@ int dmeventd_lvm2_init(void);
 void dmeventd_lvm2_exit(void);
 int dmeventd_lvm2_run(const char *cmdline);
 
+/*
+ * Commands share one lvm2 instance and run one at a time.
+ * Waiting commands run in order of priority, thin and vdo pools
+ * and snapshots pass how full they are (dm_percent_t).
+ * dmeventd_lvm2_run_with_lock_prio() runs a command for another VG
+ * in a forked lvm process while the instance is busy, commands for
+ * one VG run one at a time.
+ */
+#define DMEVENTD_LVM2_PRIO_DEFAULT	0
+#define DMEVENTD_LVM2_PRIO_REPAIR	(DM_PERCENT_100 + DM_PERCENT_1)
+
 void dmeventd_lvm2_lock(void);
+void dmeventd_lvm2_lock_prio(int priority);
 void dmeventd_lvm2_unlock(void);
 
 struct dm_pool *dmeventd_lvm2_pool(void);
@@ -41,14 +53,10 @@ struct dm_pool *dmeventd_lvm2_pool(void);
 int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
 			  const char *cmd, const char *device);
 
+int dmeventd_lvm2_run_with_lock_prio(const char *cmdline, int priority);
+
 #define dmeventd_lvm2_run_with_lock(cmdline) \
-	({\
-		int rc;\
-		dmeventd_lvm2_lock();\
-		rc = dmeventd_lvm2_run(cmdline);\
-		dmeventd_lvm2_unlock();\
-		rc;\
-	})
+	dmeventd_lvm2_run_with_lock_prio(cmdline, DMEVENTD_LVM2_PRIO_DEFAULT)
 
 #define dmeventd_lvm2_init_with_pool(name, st) \
 	({\
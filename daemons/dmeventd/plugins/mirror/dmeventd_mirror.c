@@ -101,7 +101,7 @@ static int _get_mirror_event(struct dso_state *state, char *params)
 static int _remove_failed_devices(const char *cmd_lvconvert, const char *device)
 {
 	/* if repair goes OK, report success even if lvscan has failed */
-	if (!dmeventd_lvm2_run_with_lock(cmd_lvconvert)) {
+	if (!dmeventd_lvm2_run_with_lock_prio(cmd_lvconvert, DMEVENTD_LVM2_PRIO_REPAIR)) {
 		log_error("Repair of mirrored device %s failed.", device);
 		return 0;
 	}
@@ -209,3 +209,9 @@ int unregister_device(const char *device,
 
 	return 1;
 }
+
+/* Repairs run lvconvert in the calling thread and leave nothing behind. */
+int use_shared_threads(void)
+{
+	return 1;
+}
@@ -95,7 +95,8 @@ static int _process_raid_event(struct dso_state *state, char *params, const char
 		state->failed = 1;
 
 		/* if repair goes OK, report success even if lvscan has failed */
-		if (!dmeventd_lvm2_run_with_lock(state->cmd_lvconvert)) {
+		if (!dmeventd_lvm2_run_with_lock_prio(state->cmd_lvconvert,
+						      DMEVENTD_LVM2_PRIO_REPAIR)) {
 			log_error("Repair of RAID device %s failed.", device);
 			r = 0;
 		}
@@ -187,3 +188,9 @@ int unregister_device(const char *device,
 
 	return 1;
 }
+
+/* Any worker thread may process events for a RAID device. */
+int use_shared_threads(void)
+{
+	return 1;
+}
@@ -80,10 +80,10 @@ static int _run(const char *cmd, ...)
         return 1; /* all good */
 }
 
-static int _extend(const char *cmd)
+static int _extend(const char *cmd, dm_percent_t percent)
 {
 	log_debug("Extending snapshot via %s.", cmd);
-	return dmeventd_lvm2_run_with_lock(cmd);
+	return dmeventd_lvm2_run_with_lock_prio(cmd, percent);
 }
 
 #ifdef SNAPSHOT_REMOVE
@@ -237,7 +237,7 @@ void process_event(struct dm_task *dmt,
 				 device, dm_percent_to_round_float(percent, 2));
 
 		/* Try to extend the snapshot, in accord with user-set policies */
-		if (!_extend(state->cmd_lvextend))
+		if (!_extend(state->cmd_lvextend, percent))
 			log_error("Failed to extend snapshot %s.", device);
 	}
 out:
@@ -288,3 +288,9 @@ int unregister_device(const char *device,
 
 	return 1;
 }
+
+/* SIGALRM sent to self above is picked up by the same worker call. */
+int use_shared_threads(void)
+{
+	return 1;
+}
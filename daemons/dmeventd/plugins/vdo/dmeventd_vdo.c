@@ -45,6 +45,9 @@ struct dso_state {
 	const char *name;
 };
 
+/* Devices are monitored by the shared worker threads of dmeventd */
+static int _shared_threads = 0;
+
 DM_EVENT_LOG_FN("vdo")
 
 static int _run_command(struct dso_state *state)
@@ -96,7 +99,8 @@ static int _use_policy(struct dm_task *dmt, struct dso_state *state)
 	if (state->argv[0])
 		return _run_command(state);
 
-	if (!dmeventd_lvm2_run_with_lock(state->cmd_str)) {
+	/* Pool closer to full runs first */
+	if (!dmeventd_lvm2_run_with_lock_prio(state->cmd_str, state->percent)) {
 		log_error("Failed command for %s.", dm_task_get_name(dmt));
 		state->fails = 1;
 		return 0;
@@ -342,7 +346,12 @@ int register_device(const char *device,
 		}
 
 		state->argv[1] = str + 1;  /* 1 argument - vg/lv */
-		_init_thread_signals(state);
+		/*
+		 * A worker has no monitoring thread to interrupt,
+		 * the child is reaped on the next event or timeout.
+		 */
+		if (!_shared_threads)
+			_init_thread_signals(state);
 	} else if (cmd[0] == 0) {
 		name = "volume"; /* What to use with 'others?' */
 	} else/* Unsupported command format */
@@ -403,3 +412,15 @@ int unregister_device(const char *device,
 
 	return 1;
 }
+
+/*
+ * Any worker thread may process events for the pool.  The signal mask
+ * is then left alone, as it would be changed in one worker and restored
+ * in another, and the vdo_command child is reaped by _wait_for_pid().
+ */
+int use_shared_threads(void)
+{
+	_shared_threads = 1;
+
+	return 1;
+}
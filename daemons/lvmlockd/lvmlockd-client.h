@@ -18,6 +18,15 @@
 
 #define LVMLOCKD_USE_SANLOCK_LVB 0
 
+/*
+ * Max number of lvs in one lock_lv request.  A lock_lv request with
+ * lv_count gives the first lv in the usual fields and the others as
+ * lv_name_N, lv_uuid_N, lv_lock_args_N.  The reply returns lv_count
+ * and lv_result_N.  An lvmlockd that does not reply with lv_count has
+ * only locked the first lv.
+ */
+#define LVMLOCKD_LOCK_LV_BATCH_MAX 64
+
 /* Wrappers to open/close connection */
 
 static inline __attribute__((always_inline))
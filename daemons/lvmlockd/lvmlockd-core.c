@@ -1313,6 +1313,28 @@ static int lm_unlock(struct lockspace *ls, struct resource *r, struct action *ac
 	return rv;
 }
 
+/*
+ * Returns the number of lv workers that may call the lock manager at
+ * once for the lockspace.  libdlm_lt is not thread safe, so dlm (like
+ * idm) lockspaces make all lock requests from the lockspace thread.
+ */
+static int lm_add_workers(struct lockspace *ls, int count)
+{
+	if (ls->lm_type == LD_LM_SANLOCK)
+		return lm_add_workers_sanlock(ls, count);
+
+	return 0;
+}
+
+static int lm_lock_batch(struct lockspace *ls, struct resource **r, int *mode,
+			 int count, int *acquired)
+{
+	if (ls->lm_type == LD_LM_SANLOCK)
+		return lm_lock_batch_sanlock(ls, r, mode, count, acquired);
+
+	return 0;
+}
+
 static int lm_hosts(struct lockspace *ls, int notify, int *hosts_unknown)
 {
 	if (ls->lm_type == LD_LM_DLM)
@@ -1443,10 +1465,17 @@ static int res_lock(struct lockspace *ls, struct resource *r, struct action *act
 	if (r->type == LD_RT_LV && act->lv_args[0])
 		memcpy(r->lv_args, act->lv_args, MAX_ARGS);
 
-	rv = lm_lock(ls, r, act->mode, act, &vb, retry, owner,
-		     act->flags & LD_AF_ADOPT_ONLY ? 1 : 0,
-		     act->flags & LD_AF_ADOPT ? 1 : 0,
-		     act->flags & LD_AF_REPAIR ? 1 : 0);
+	if (r->batch_mode && (r->batch_mode == act->mode)) {
+		/* acquired by lock_batch() */
+		r->batch_mode = 0;
+		act->lm_rv = 0;
+		rv = 0;
+	} else {
+		rv = lm_lock(ls, r, act->mode, act, &vb, retry, owner,
+			     act->flags & LD_AF_ADOPT_ONLY ? 1 : 0,
+			     act->flags & LD_AF_ADOPT ? 1 : 0,
+			     act->flags & LD_AF_REPAIR ? 1 : 0);
+	}
 
 	if (rv && r->use_vb)
 		log_debug("%s:%s res_lock rv %d read vb %x %x %u",
@@ -2036,6 +2065,68 @@ out:
 	return rv;
 }
 
+/*
+ * The lv locks requested by one batch lock_lv request (e.g. activating
+ * the lvs in a vg) can be acquired from the lock manager together, which
+ * for sanlock saves an acquire call and round of lease i/o for each lv.
+ * An lv is included when the next res_process() would acquire its lock
+ * in res_lock() for the first action, and res_lock() then finds the lock
+ * already acquired.  A lock that res_process() does not use after all,
+ * e.g. the client exited, is released again by res_process().
+ */
+
+static int lock_batch_ok(struct resource *r)
+{
+	struct action *act;
+
+	if (r->type != LD_RT_LV || r->mode != LD_LK_UN || r->batch_mode)
+		return 0;
+
+	if (!list_empty(&r->locks) || list_empty(&r->actions))
+		return 0;
+
+	if (r->test_remote_ex || r->test_remote_sh)
+		return 0;
+
+	act = list_first_entry(&r->actions, struct action, list);
+
+	if ((act->op != LD_OP_LOCK) || !(act->flags & LD_AF_BATCH) || !act->lv_args[0])
+		return 0;
+
+	if ((act->mode != LD_LK_SH) && (act->mode != LD_LK_EX))
+		return 0;
+
+	if (act->flags & (LD_AF_ADOPT | LD_AF_ADOPT_ONLY | LD_AF_REPAIR))
+		return 0;
+
+	return 1;
+}
+
+static void lock_batch(struct lockspace *ls, struct resource **r, int count)
+{
+	struct action *act;
+	int mode[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	int acquired[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	int i;
+
+	if (count < 2)
+		return;
+
+	for (i = 0; i < count; i++) {
+		act = list_first_entry(&r[i]->actions, struct action, list);
+		memcpy(r[i]->lv_args, act->lv_args, MAX_ARGS);
+		mode[i] = act->mode;
+	}
+
+	if (lm_lock_batch(ls, r, mode, count, acquired) <= 0)
+		return;
+
+	for (i = 0; i < count; i++) {
+		if (acquired[i])
+			r[i]->batch_mode = mode[i];
+	}
+}
+
 /*
  * Go through queued actions, and make lock/unlock calls on the resource
  * based on the actions and the existing lock state.
@@ -2058,9 +2149,17 @@ out:
  *
  * retry_out: set to 1 if the lock manager said we should retry,
  * meaning we should call res_process() again in a short while to retry.
+ *
+ * The return value tells the caller to keep r, to move it to ls->dispose,
+ * or to free it.  res_process() itself does not change the lockspace
+ * lists, so lv workers can process different resources at once.
  */
 
-static void res_process(struct lockspace *ls, struct resource *r,
+#define RES_KEEP    0
+#define RES_DISPOSE 1
+#define RES_FREE    2
+
+static int res_process(struct lockspace *ls, struct resource *r,
 			struct list_head *act_close_list,
 			struct list_head *act_fence_done,
 			int *retry_out)
@@ -2390,7 +2489,21 @@ static void res_process(struct lockspace *ls, struct resource *r,
 	}
 
 	if (r->mode == LD_LK_EX)
-		return;
+		return RES_KEEP;
+
+	/*
+	 * A lock from lock_batch() is used by res_lock() for the first action.
+	 * Release it if that action is gone, e.g. canceled for a closed client.
+	 */
+
+	if (r->batch_mode) {
+		act = list_empty(&r->actions) ? NULL : list_first_entry(&r->actions, struct action, list);
+		if (!act || (act->op != LD_OP_LOCK) || (act->mode != r->batch_mode)) {
+			log_debug("%s:%s res_process release unused batch lock", ls->name, r->name);
+			lm_unlock(ls, r, NULL, 0, 0);
+			r->batch_mode = 0;
+		}
+	}
 
 	/*
 	 * r mode is SH or UN, pass lock-sh actions to lm
@@ -2450,7 +2563,7 @@ static void res_process(struct lockspace *ls, struct resource *r,
 	 */
 
 	if (r->mode == LD_LK_SH)
-		return;
+		return RES_KEEP;
 
 	/*
 	 * r mode is UN, pass lock-ex action to lm
@@ -2527,7 +2640,7 @@ static void res_process(struct lockspace *ls, struct resource *r,
 		 */
 		if (r->test_remote_ex || r->test_remote_sh) {
 			log_debug("%s:%s skip dispose test_remote", ls->name, r->name);
-			return;
+			return RES_KEEP;
 		}
 
 		/* An implicit unlock of a transient lock. */
@@ -2535,12 +2648,11 @@ static void res_process(struct lockspace *ls, struct resource *r,
 			goto r_free;
 
 		log_debug("%s:%s will dispose for %u", ls->name, r->name, unlock_by_client_id);
-		list_del(&r->list);
 		r->dispose_client_id = unlock_by_client_id;
-		list_add(&r->list, &ls->dispose);
+		return RES_DISPOSE;
 	}
 
-	return;
+	return RES_KEEP;
 
 r_free:
 	/* For the EUNATCH case it may be possible there are queued actions? */
@@ -2553,8 +2665,324 @@ r_free:
 	}
 	log_debug("%s:%s res_process free_resource", ls->name, r->name);
 	lm_rem_resource(ls, r);
+	return RES_FREE;
+}
+
+/*
+ * ls->res_hash indexes ls->resources by type and name so that
+ * find_resource_act() does not need to search a list of every lv
+ * lock in the vg.  It exists while the lockspace thread runs.
+ */
+
+static void res_hash_key(char *key, int8_t type, const char *name)
+{
+	key[0] = '0' + type;
+	dm_strncpy(key + 1, name, MAX_NAME + 1);
+}
+
+static int add_ls_resource(struct lockspace *ls, struct resource *r)
+{
+	char key[MAX_NAME + 2];
+
+	if (ls->res_hash) {
+		res_hash_key(key, r->type, r->name);
+		if (!dm_hash_insert(ls->res_hash, key, r)) {
+			log_error("%s:%s no memory for resource hash", ls->name, r->name);
+			return -ENOMEM;
+		}
+	}
+
+	list_add_tail(&r->list, &ls->resources);
+	return 0;
+}
+
+static void rem_ls_resource(struct lockspace *ls, struct resource *r)
+{
+	char key[MAX_NAME + 2];
+
+	if (ls->res_hash) {
+		res_hash_key(key, r->type, r->name);
+		if (dm_hash_lookup(ls->res_hash, key) == r)
+			dm_hash_remove(ls->res_hash, key);
+	}
+
 	list_del(&r->list);
-	free_resource(r);
+}
+
+static int setup_res_hash(struct lockspace *ls)
+{
+	struct resource *r;
+	char key[MAX_NAME + 2];
+
+	if (!(ls->res_hash = dm_hash_create(1024))) {
+		log_error("S %s no memory for resource hash", ls->name);
+		return -ENOMEM;
+	}
+
+	list_for_each_entry(r, &ls->resources, list) {
+		res_hash_key(key, r->type, r->name);
+		if (!dm_hash_insert(ls->res_hash, key, r)) {
+			log_error("S %s no memory for resource hash", ls->name);
+			dm_hash_destroy(ls->res_hash);
+			ls->res_hash = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void free_res_hash(struct lockspace *ls)
+{
+	if (ls->res_hash) {
+		dm_hash_destroy(ls->res_hash);
+		ls->res_hash = NULL;
+	}
+}
+
+/* Apply the res_process() result for r to the lockspace lists. */
+
+static void res_finish(struct lockspace *ls, struct resource *r, int result)
+{
+	if (result == RES_DISPOSE) {
+		rem_ls_resource(ls, r);
+		list_add(&r->list, &ls->dispose);
+	} else if (result == RES_FREE) {
+		rem_ls_resource(ls, r);
+		free_resource(r);
+	}
+}
+
+/*
+ * lv workers let a lockspace wait on the lock manager for many lv locks
+ * at once, e.g. sanlock lease i/o when activating all lvs in a vg.
+ * An lv resource is always given to the same worker, so its actions are
+ * still processed in order.  The lockspace thread queues a batch of lv
+ * resources, processes gl/vg resources itself, then waits for the batch
+ * to complete before applying the results and taking new actions.
+ */
+
+struct lv_worker {
+	struct lv_workers *lw;
+	pthread_t thread;
+	struct list_head resources;	/* resource.work */
+};
+
+struct lv_workers {
+	struct lockspace *ls;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;		/* work queued or stop */
+	pthread_cond_t done_cond;	/* pending is zero */
+	struct list_head *act_close;
+	struct list_head *act_fence;
+	int pending;			/* resources queued or in res_process */
+	int retry;
+	int stop;
+	int count;
+	struct lv_worker worker[];
+};
+
+static void *lv_worker_main(void *arg_in)
+{
+	struct lv_worker *w = arg_in;
+	struct lv_workers *lw = w->lw;
+	struct resource *rs[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	struct resource *batch[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	struct resource *r;
+	int retry, any_retry;
+	int i, count, batch_count;
+
+	pthread_mutex_lock(&lw->mutex);
+	while (1) {
+		while (!lw->stop && list_empty(&w->resources))
+			pthread_cond_wait(&lw->cond, &lw->mutex);
+
+		if (list_empty(&w->resources))
+			break;
+
+		count = 0;
+		while (!list_empty(&w->resources) && (count < LVMLOCKD_LOCK_LV_BATCH_MAX)) {
+			r = list_first_entry(&w->resources, struct resource, work);
+			list_del(&r->work);
+			rs[count++] = r;
+		}
+		pthread_mutex_unlock(&lw->mutex);
+
+		batch_count = 0;
+		for (i = 0; i < count; i++) {
+			if (lock_batch_ok(rs[i]))
+				batch[batch_count++] = rs[i];
+		}
+		lock_batch(lw->ls, batch, batch_count);
+
+		any_retry = 0;
+		for (i = 0; i < count; i++) {
+			retry = 0;
+			rs[i]->work_result = res_process(lw->ls, rs[i], lw->act_close, lw->act_fence, &retry);
+			if (retry)
+				any_retry = 1;
+		}
+
+		pthread_mutex_lock(&lw->mutex);
+		if (any_retry)
+			lw->retry = 1;
+		lw->pending -= count;
+		if (!lw->pending)
+			pthread_cond_signal(&lw->done_cond);
+	}
+	pthread_mutex_unlock(&lw->mutex);
+
+	return NULL;
+}
+
+static void stop_lv_workers(struct lockspace *ls)
+{
+	struct lv_workers *lw = ls->lv_workers;
+	int i;
+
+	if (!lw)
+		return;
+
+	pthread_mutex_lock(&lw->mutex);
+	lw->stop = 1;
+	pthread_cond_broadcast(&lw->cond);
+	pthread_mutex_unlock(&lw->mutex);
+
+	for (i = 0; i < lw->count; i++)
+		pthread_join(lw->worker[i].thread, NULL);
+
+	pthread_cond_destroy(&lw->done_cond);
+	pthread_cond_destroy(&lw->cond);
+	pthread_mutex_destroy(&lw->mutex);
+	free(lw);
+	ls->lv_workers = NULL;
+}
+
+static void start_lv_workers(struct lockspace *ls, int count)
+{
+	struct lv_workers *lw;
+	int i, rv;
+
+	if ((count = lm_add_workers(ls, count)) <= 0)
+		return;
+
+	if (!(lw = zalloc(sizeof(struct lv_workers) + count * sizeof(struct lv_worker)))) {
+		log_error("S %s no memory for lv workers", ls->name);
+		return;
+	}
+
+	lw->ls = ls;
+	pthread_mutex_init(&lw->mutex, NULL);
+	pthread_cond_init(&lw->cond, NULL);
+	pthread_cond_init(&lw->done_cond, NULL);
+	ls->lv_workers = lw;
+
+	for (i = 0; i < count; i++) {
+		lw->worker[i].lw = lw;
+		INIT_LIST_HEAD(&lw->worker[i].resources);
+		if ((rv = pthread_create(&lw->worker[i].thread, NULL, lv_worker_main, &lw->worker[i]))) {
+			log_error("S %s lv worker create error %d", ls->name, rv);
+			break;
+		}
+		lw->count++;
+	}
+
+	if (!lw->count)
+		stop_lv_workers(ls);
+	else
+		log_debug("S %s started %d lv workers", ls->name, lw->count);
+}
+
+/* The same lv is always processed by the same worker. */
+
+static int lv_worker_num(struct lv_workers *lw, struct resource *r)
+{
+	const unsigned char *p;
+	uint32_t h = 0;
+
+	for (p = (const unsigned char *)r->name; *p; p++)
+		h = h * 31 + *p;
+
+	return (h % lw->count) + 1;
+}
+
+/*
+ * Call res_process() for every resource in the lockspace.
+ *
+ * Without lv workers this is done in sequence by the lockspace thread.
+ * Otherwise lv resources with something to do are queued for workers.
+ * When no client has closed and no fencing completed, an lv resource
+ * without actions only needs the dispose check, done here.  lv locks
+ * from batch requests are first acquired together with lock_batch(),
+ * by the lockspace thread or by each worker for the lvs it was given.
+ */
+
+static void process_resources(struct lockspace *ls,
+			      struct list_head *act_close,
+			      struct list_head *act_fence,
+			      int *retry)
+{
+	struct lv_workers *lw = ls->lv_workers;
+	struct resource *batch[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	struct resource *r, *r2;
+	int all_lvs = !list_empty(act_close) || !list_empty(act_fence);
+	int batch_count = 0;
+
+	if (!lw) {
+		list_for_each_entry(r, &ls->resources, list) {
+			if (!lock_batch_ok(r))
+				continue;
+			batch[batch_count++] = r;
+			if (batch_count == LVMLOCKD_LOCK_LV_BATCH_MAX) {
+				lock_batch(ls, batch, batch_count);
+				batch_count = 0;
+			}
+		}
+		lock_batch(ls, batch, batch_count);
+
+		list_for_each_entry_safe(r, r2, &ls->resources, list)
+			res_finish(ls, r, res_process(ls, r, act_close, act_fence, retry));
+		return;
+	}
+
+	pthread_mutex_lock(&lw->mutex);
+	lw->act_close = act_close;
+	lw->act_fence = act_fence;
+	lw->retry = 0;
+	list_for_each_entry(r, &ls->resources, list) {
+		if (r->type != LD_RT_LV)
+			continue;
+		if (!all_lvs && list_empty(&r->actions))
+			continue;
+		if (!r->worker)
+			r->worker = lv_worker_num(lw, r);
+		r->work_queued = 1;
+		list_add_tail(&r->work, &lw->worker[r->worker - 1].resources);
+		lw->pending++;
+	}
+	if (lw->pending)
+		pthread_cond_broadcast(&lw->cond);
+	pthread_mutex_unlock(&lw->mutex);
+
+	/* Workers do not touch ls->resources, only the queued r. */
+	list_for_each_entry_safe(r, r2, &ls->resources, list) {
+		if (!r->work_queued)
+			res_finish(ls, r, res_process(ls, r, act_close, act_fence, retry));
+	}
+
+	pthread_mutex_lock(&lw->mutex);
+	while (lw->pending)
+		pthread_cond_wait(&lw->done_cond, &lw->mutex);
+	if (lw->retry)
+		*retry = 1;
+	pthread_mutex_unlock(&lw->mutex);
+
+	list_for_each_entry_safe(r, r2, &ls->resources, list) {
+		if (r->work_queued) {
+			r->work_queued = 0;
+			res_finish(ls, r, r->work_result);
+		}
+	}
 }
 
 #define LOCKS_EXIST_ANY 1
@@ -2660,7 +3088,7 @@ static void clear_locks(struct lockspace *ls, int free_vg, int drop_vg)
  r_free:
 		log_debug("%s:%s clear_locks free_resource", ls->name, r->name);
 		lm_rem_resource(ls, r);
-		list_del(&r->list);
+		rem_ls_resource(ls, r);
 		free_resource(r);
 	}
 }
@@ -2692,21 +3120,17 @@ static struct resource *find_resource_act(struct lockspace *ls,
 					  int nocreate)
 {
 	struct resource *r;
+	char key[MAX_NAME + 2];
 
-	list_for_each_entry(r, &ls->resources, list) {
-		if (r->type != act->rt)
-			continue;
-
-		if (r->type == LD_RT_GL && act->rt == LD_RT_GL)
-			return r;
-
-		if (r->type == LD_RT_VG && act->rt == LD_RT_VG)
-			return r;
+	if (act->rt == LD_RT_GL)
+		res_hash_key(key, act->rt, R_NAME_GL);
+	else if (act->rt == LD_RT_VG)
+		res_hash_key(key, act->rt, R_NAME_VG);
+	else
+		res_hash_key(key, act->rt, act->lv_uuid);
 
-		if (r->type == LD_RT_LV && act->rt == LD_RT_LV &&
-		    !strcmp(r->name, act->lv_uuid))
-			return r;
-	}
+	if ((r = dm_hash_lookup(ls->res_hash, key)))
+		return r;
 
 	if (nocreate)
 		return NULL;
@@ -2728,7 +3152,10 @@ static struct resource *find_resource_act(struct lockspace *ls,
 		r->use_vb = 0;
 	}
 
-	list_add_tail(&r->list, &ls->resources);
+	if (add_ls_resource(ls, r) < 0) {
+		free_resource(r);
+		return NULL;
+	}
 
 	return r;
 }
@@ -2739,7 +3166,7 @@ static void free_ls_resources(struct lockspace *ls)
 
 	list_for_each_entry_safe(r, r_safe, &ls->resources, list) {
 		lm_rem_resource(ls, r);
-		list_del(&r->list);
+		rem_ls_resource(ls, r);
 		free_resource(r);
 	}
 }
@@ -2915,7 +3342,9 @@ static void *lockspace_thread_main(void *arg_in)
 	 * The prepare step does not wait for anything and is quick;
 	 * it tells us if the parameters are valid and the lm is running.
 	 */
-	error = lm_prepare_lockspace(ls, add_act, repair);
+	error = setup_res_hash(ls);
+	if (!error)
+		error = lm_prepare_lockspace(ls, add_act, repair);
 
 	if (add_act && (!wait_flag || error)) {
 		/* send initial join result back to client */
@@ -2955,6 +3384,9 @@ static void *lockspace_thread_main(void *arg_in)
 	if (error)
 		goto out_act;
 
+	if (lv_workers_opt)
+		start_lv_workers(ls, lv_workers_opt);
+
  restart:
 
 	while (1) {
@@ -3301,8 +3733,7 @@ static void *lockspace_thread_main(void *arg_in)
 
 		retry = 0;
 
-		list_for_each_entry_safe(r, r2, &ls->resources, list)
-			res_process(ls, r, &act_close, &act_fence, &retry);
+		process_resources(ls, &act_close, &act_fence, &retry);
 
 		list_for_each_entry_safe(act, safe, &act_close, list) {
 			list_del(&act->list);
@@ -3404,6 +3835,9 @@ out_rem:
 		log_debug("S %s rem_lockspace done", ls->name);
 
 out_act:
+	stop_lv_workers(ls);
+	free_res_hash(ls);
+
 	/*
 	 * Move remaining actions to results, this will usually (always?)
 	 * be the act processed above which resulted in the lockspace thread
@@ -5037,6 +5471,67 @@ static int client_send_result(struct client *cl, struct action *act)
 	return rv;
 }
 
+/*
+ * One reply for all the lv locks of a batch lock_lv request, with
+ * lv_result_N for each lv.  op_result is the first error, if any,
+ * and the command repeats a failed lv as a single lock_lv request to
+ * get the complete error details.
+ */
+
+static int client_send_batch_result(struct client *cl)
+{
+	struct action *act;
+	response res;
+	char key[32];
+	int result = 0;
+	int count = 0;
+	int rv = 0;
+
+	if (cl->dead) {
+		log_debug("send cl %u skip dead", cl->id);
+		return -1;
+	}
+
+	list_for_each_entry(act, &cl->batch_results, list) {
+		if (act->result && !result)
+			result = act->result;
+		count++;
+	}
+
+	act = list_first_entry(&cl->batch_results, struct action, list);
+
+	log_debug("send %s[%d][%u] %s%s%s batch %d result %d",
+		  cl->name[0] ? cl->name : "client", cl->pid, cl->id,
+		  op_mode_str(act->op, act->mode), act->rt ? "_" : "", rt_str(act->rt),
+		  count, result);
+
+	res = daemon_reply_simple("OK",
+				  "op = " FMTd64, (int64_t) act->op,
+				  "lock_type = %s", lm_str(act->lm_type),
+				  "op_result = " FMTd64, (int64_t) result,
+				  "lv_count = " FMTd64, (int64_t) count,
+				  NULL);
+
+	list_for_each_entry(act, &cl->batch_results, list) {
+		snprintf(key, sizeof(key), "lv_result_%d = %%" PRId64, act->batch_idx);
+		if (!buffer_append_f(&res.buffer, key, (int64_t) act->result, NULL))
+			res.error = ENOMEM;
+	}
+
+	if (res.error || !buffer_write(cl->fd, &res.buffer)) {
+		rv = -errno;
+		if (rv >= 0)
+			rv = -1;
+		log_debug("send cl %u fd %d error %d", cl->id, cl->fd, rv);
+	}
+
+	buffer_destroy(&res.buffer);
+
+	client_resume(cl);
+
+	return rv;
+}
+
 /* called from client_thread */
 static void client_purge(struct client *cl)
 {
@@ -5794,6 +6289,63 @@ out:
 }
 
 /* called from client_thread, cl->mutex is held */
+/*
+ * Make a copy of act for each additional lv in a batch lock_lv request.
+ * The lvs are lv_name_N, lv_uuid_N, lv_lock_args_N, and the first is
+ * also given in the usual fields used by act.  The client thread sends
+ * one reply when the results for all the actions have returned.
+ */
+
+static int client_recv_batch(request req, struct action *act,
+			     struct action **batch, int lv_count)
+{
+	struct action *b;
+	const char *str;
+	char key[32];
+	int i;
+
+	act->flags |= LD_AF_BATCH;
+	act->batch_idx = 0;
+	batch[0] = act;
+
+	for (i = 1; i < lv_count; i++) {
+		snprintf(key, sizeof(key), "lv_name_%d", i);
+		if (!(str = daemon_request_str(req, key, NULL)))
+			break;
+
+		if (!(b = alloc_action()))
+			break;
+
+		memcpy(b, act, sizeof(struct action));
+		b->path = NULL;
+		b->batch_idx = i;
+		memset(b->lv_name, 0, sizeof(b->lv_name));
+		memset(b->lv_uuid, 0, sizeof(b->lv_uuid));
+		memset(b->lv_args, 0, sizeof(b->lv_args));
+
+		strncpy(b->lv_name, str, MAX_NAME);
+
+		snprintf(key, sizeof(key), "lv_uuid_%d", i);
+		str = daemon_request_str(req, key, NULL);
+		if (str && strcmp(str, "none"))
+			strncpy(b->lv_uuid, str, MAX_NAME);
+
+		snprintf(key, sizeof(key), "lv_lock_args_%d", i);
+		str = daemon_request_str(req, key, NULL);
+		if (str && strcmp(str, "none"))
+			strncpy(b->lv_args, str, MAX_ARGS);
+
+		batch[i] = b;
+	}
+
+	if (i == 1) {
+		act->flags &= ~LD_AF_BATCH;
+		return 0;
+	}
+
+	return i;
+}
+
 static void client_recv_action(struct client *cl)
 {
 	request req;
@@ -5805,10 +6357,12 @@ static void client_recv_action(struct client *cl)
 	const char *path;
 	const char *str;
 	struct pvs pvs;
+	struct action *batch[LVMLOCKD_LOCK_LV_BATCH_MAX];
 	char buf[18];	/* "path[%d]\0", %d outputs signed integer so max to 10 bytes */
 	int64_t val;
 	uint32_t opts = 0;
 	int result = 0;
+	int batch_count = 0;
 	int cl_pid;
 	int op, rt, lm, mode;
 	int rv, i;
@@ -6009,6 +6563,13 @@ static void client_recv_action(struct client *cl)
 skip_pvs_path:
 	act->max_retries = daemon_request_int(req, "max_retries", DEFAULT_MAX_RETRIES);
 
+	/* A lock_lv request for many lvs becomes a lock action for each lv. */
+	if ((op == LD_OP_LOCK) && (rt == LD_RT_LV) && (lm != LD_LM_IDM)) {
+		val = daemon_request_int(req, "lv_count", 0);
+		if ((val > 1) && (val <= LVMLOCKD_LOCK_LV_BATCH_MAX))
+			batch_count = client_recv_batch(req, act, batch, (int)val);
+	}
+
 	dm_config_destroy(req.cft);
 	buffer_destroy(&req.buffer);
 
@@ -6044,6 +6605,17 @@ skip_pvs_path:
 	if (act->op == LD_OP_LOCK && act->mode != LD_LK_UN)
 		cl->lock_ops = 1;
 
+	if (batch_count) {
+		cl->batch_count = batch_count;
+		for (i = 0; i < batch_count; i++) {
+			if ((rv = add_lock_action(batch[i])) < 0) {
+				batch[i]->result = rv;
+				add_client_result(batch[i]);
+			}
+		}
+		return;
+	}
+
 	switch (act->op) {
 	case LD_OP_START:
 		rv = add_lockspace(act);
@@ -6091,14 +6663,46 @@ out:
 	if (rv < 0) {
 		act->result = rv;
 		add_client_result(act);
+
+		if (batch_count) {
+			cl->batch_count = batch_count;
+			for (i = 1; i < batch_count; i++) {
+				batch[i]->result = rv;
+				add_client_result(batch[i]);
+			}
+		}
+	}
+}
+
+/*
+ * The client failed after we acquired an LV lock for
+ * it, but before getting this reply saying it's done.
+ * So the lv will not be active and we should release
+ * the lv lock it requested.
+ */
+
+static void client_auto_unlock(struct action *act)
+{
+	struct action *act_un;
+
+	if (!(act->flags & LD_AF_LV_LOCK))
+		return;
+
+	log_debug("auto unlock lv for failed client %u", act->client_id);
+	if ((act_un = alloc_action())) {
+		memcpy(act_un, act, sizeof(struct action));
+		act_un->mode = LD_LK_UN;
+		act_un->flags |= LD_AF_LV_UNLOCK;
+		act_un->flags &= ~(LD_AF_LV_LOCK | LD_AF_BATCH);
+		add_lock_action(act_un);
 	}
 }
 
 static void *client_thread_main(void *arg_in)
 {
 	struct client *cl;
-	struct action *act;
-	struct action *act_un;
+	struct action *act, *act_safe;
+	struct list_head batch_done;
 	uint32_t lock_acquire_count = 0, lock_acquire_written = 0;
 	int rv;
 
@@ -6122,6 +6726,34 @@ static void *client_thread_main(void *arg_in)
 			cl = find_client_id(act->client_id);
 			pthread_mutex_unlock(&client_mutex);
 
+			if (cl && (act->flags & LD_AF_BATCH)) {
+				/*
+				 * Results for a batch are kept until the last
+				 * one arrives, then all are sent in one reply.
+				 */
+				INIT_LIST_HEAD(&batch_done);
+				pthread_mutex_lock(&cl->mutex);
+				list_add_tail(&act->list, &cl->batch_results);
+				if (!--cl->batch_count) {
+					rv = client_send_batch_result(cl);
+					list_for_each_entry_safe(act, act_safe, &cl->batch_results, list) {
+						list_del(&act->list);
+						list_add_tail(&act->list, &batch_done);
+					}
+				}
+				pthread_mutex_unlock(&cl->mutex);
+
+				list_for_each_entry_safe(act, act_safe, &batch_done, list) {
+					list_del(&act->list);
+					if (act->flags & LD_AF_LV_LOCK)
+						lock_acquire_count++;
+					if (rv < 0)
+						client_auto_unlock(act);
+					free_action(act);
+				}
+				continue;
+			}
+
 			if (cl) {
 				pthread_mutex_lock(&cl->mutex);
 				rv = client_send_result(cl, act);
@@ -6134,22 +6766,8 @@ static void *client_thread_main(void *arg_in)
 			if (act->flags & LD_AF_LV_LOCK)
 				lock_acquire_count++;
 
-			/*
-			 * The client failed after we acquired an LV lock for
-			 * it, but before getting this reply saying it's done.
-			 * So the lv will not be active and we should release
-			 * the lv lock it requested.
-			 */
-			if ((rv < 0) && (act->flags & LD_AF_LV_LOCK)) {
-				log_debug("auto unlock lv for failed client %u", act->client_id);
-				if ((act_un = alloc_action())) {
-					memcpy(act_un, act, sizeof(struct action));
-					act_un->mode = LD_LK_UN;
-					act_un->flags |= LD_AF_LV_UNLOCK;
-					act_un->flags &= ~LD_AF_LV_LOCK;
-					add_lock_action(act_un);
-				}
-			}
+			if (rv < 0)
+				client_auto_unlock(act);
 
 			free_action(act);
 			continue;
@@ -6223,6 +6841,13 @@ static void *client_thread_main(void *arg_in)
 				list_del(&cl->list);
 				pthread_mutex_unlock(&client_mutex);
 
+				/* Results from an unfinished batch. */
+				list_for_each_entry_safe(act, act_safe, &cl->batch_results, list) {
+					list_del(&act->list);
+					client_auto_unlock(act);
+					free_action(act);
+				}
+
 				client_purge(cl);
 
 				free_client(cl);
@@ -7083,6 +7708,7 @@ static void process_listener(int poll_fd)
 	cl->pid = get_peer_pid(fd);
 
 	pthread_mutex_init(&cl->mutex, NULL);
+	INIT_LIST_HEAD(&cl->batch_results);
 
 	pthread_mutex_lock(&client_mutex);
 	client_ids++;
@@ -7687,6 +8313,8 @@ static void usage(char *prog, FILE *file)
 	fprintf(file, "        A file containing the local sanlock host_id.\n");
 	fprintf(file, "  --sanlock-timeout | -o <seconds>\n");
 	fprintf(file, "        Set the sanlock lockspace I/O timeout.\n");
+	fprintf(file, "  --lv-workers | -w <num>\n");
+	fprintf(file, "        Number of threads per sanlock lockspace making LV lock requests. [0]\n");
 	fprintf(file, "  --adopt | -A 0|1\n");
 	fprintf(file, "        Adopt locks from a previous instance of lvmlockd.\n");
 }
@@ -7719,6 +8347,7 @@ int main(int argc, char *argv[])
 		{"adopt",           required_argument, 0, 'A' },
 		{"syslog-priority", required_argument, 0, 'S' },
 		{"sanlock-timeout", required_argument, 0, 'o' },
+		{"lv-workers",      required_argument, 0, 'w' },
 		{0, 0, 0, 0 }
 	};
 
@@ -7729,7 +8358,7 @@ int main(int argc, char *argv[])
 		int lm;
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "hVTfDp:s:l:g:S:I:A:o:",
+		c = getopt_long(argc, argv, "hVTfDp:s:l:g:S:I:A:o:w:",
 				long_options, &option_index);
 		if (c == -1)
 			break;
@@ -7792,6 +8421,13 @@ int main(int argc, char *argv[])
 		case 'o':
 			sanlock_io_timeout = atoi(optarg);
 			break;
+		case 'w':
+			lv_workers_opt = atoi(optarg);
+			if (lv_workers_opt < 0 || lv_workers_opt > LV_WORKERS_MAX) {
+				fprintf(stderr, "invalid lv-workers option, 0-%d\n", LV_WORKERS_MAX);
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'A':
 			adopt_opt = atoi(optarg);
 			break;
@@ -101,6 +101,8 @@ struct client {
 	unsigned int dead : 1;
 	unsigned int poll_ignore : 1;
 	unsigned int lock_ops : 1;
+	int batch_count;		/* results not yet returned for a batch */
+	struct list_head batch_results;	/* action.list, results from a batch */
 	char name[MAX_NAME+1];
 };
 
@@ -126,6 +128,7 @@ struct client {
 #define LD_AF_REPAIR		   0x00800000
 #define LD_AF_NO_TIMEOUT	   0x01000000
 #define LD_AF_HOSTS_UNKNOWN	   0x02000000
+#define LD_AF_BATCH		   0x04000000 /* lv lock from a lock_lv request with lv_count */
 
 /*
  * Number of times to repeat a lock request after
@@ -134,6 +137,12 @@ struct client {
  */
 #define DEFAULT_MAX_RETRIES 4
 
+/*
+ * Limit on the number of threads per lockspace that
+ * process lv lock requests concurrently (--lv-workers).
+ */
+#define LV_WORKERS_MAX 64
+
 struct pvs {
 	char **path;
 	int num;
@@ -196,6 +205,7 @@ struct action {
 	int result;
 	int lm_rv;			/* return value from lm_ function */
 	int align_mb;
+	int batch_idx;			/* lv number in a batch lock_lv request */
 	char *path;
 	char vg_uuid[64];
 	char vg_name[MAX_NAME+1];
@@ -224,6 +234,13 @@ struct resource {
 	unsigned int use_vb : 1;
 	unsigned int test_remote_ex : 1;	/* daemon_test: remote node holds EX lock */
 	unsigned int test_remote_sh : 1;	/* daemon_test: remote node holds SH lock */
+	int8_t work_queued;		/* on an lv worker queue, not a bit field
+					   since the worker sets the bits above */
+	int8_t work_result;		/* res_process result from the lv worker */
+	int8_t batch_mode;		/* lm lock acquired by lm_lock_batch() for
+					   the next res_lock() */
+	uint16_t worker;		/* lv worker number + 1, 0 for the lockspace thread */
+	struct list_head work;		/* lv_worker.resources */
 	struct list_head locks;
 	struct list_head actions;
 	struct list_head fence_wait_actions;
@@ -273,6 +290,8 @@ struct lockspace {
 
 	struct list_head actions;	/* new client actions */
 	struct list_head resources;	/* resource/lock state for gl/vg/lv */
+	struct dm_hash_table *res_hash;	/* resources by type and name */
+	struct lv_workers *lv_workers;	/* threads processing lv resources */
 	struct list_head dispose;	/* resources to free */
 	struct list_head fence_history;	/* internally created actions for fencing */
 };
@@ -411,6 +430,7 @@ EXTERN int daemon_debug;
 EXTERN int daemon_host_id;
 EXTERN const char *daemon_host_id_file;
 EXTERN int sanlock_io_timeout;
+EXTERN int lv_workers_opt; /* threads per lockspace processing lv locks */
 
 /*
  * This flag is set to 1 if we see multiple vgs with the global
@@ -623,6 +643,9 @@ int lm_able_gl_sanlock(struct lockspace *ls, int enable);
 int lm_ex_disable_gl_sanlock(struct lockspace *ls);
 int lm_hosts_sanlock(struct lockspace *ls, int notify, int *hosts_unknown);
 int lm_rem_resource_sanlock(struct lockspace *ls, struct resource *r);
+int lm_add_workers_sanlock(struct lockspace *ls, int count);
+int lm_lock_batch_sanlock(struct lockspace *ls, struct resource **r, int *ld_mode,
+			  int count, int *acquired);
 int lm_gl_is_enabled(struct lockspace *ls);
 int lm_get_lockspaces_sanlock(struct list_head *ls_rejoin);
 int lm_data_size_sanlock(void);
@@ -699,6 +722,17 @@ static inline int lm_unlock_sanlock(struct lockspace *ls, struct resource *r,
 	return -1;
 }
 
+static inline int lm_add_workers_sanlock(struct lockspace *ls, int count)
+{
+	return 0;
+}
+
+static inline int lm_lock_batch_sanlock(struct lockspace *ls, struct resource **r, int *ld_mode,
+					int count, int *acquired)
+{
+	return 0;
+}
+
 static inline int lm_able_gl_sanlock(struct lockspace *ls, int enable)
 {
 	return -1;
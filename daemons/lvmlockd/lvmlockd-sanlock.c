@@ -163,6 +163,8 @@ struct lm_sanlock {
 	int align_size;
 	int using_caw;
 	int sock; /* sanlock daemon connection */
+	int worker_sock[LV_WORKERS_MAX]; /* connections for lv workers */
+	int worker_count;
 	uint32_t ss_flags; /* sector and align flags for lockspace */
 	uint32_t rs_flags; /* sector and align flags for resource */
 };
@@ -2103,7 +2105,7 @@ fail:
 int lm_rem_lockspace_sanlock(struct lockspace *ls, int free_vg)
 {
 	struct lm_sanlock *lms = (struct lm_sanlock *)ls->lm_data;
-	int rv;
+	int i, rv;
 
 	if (daemon_test)
 		goto out;
@@ -2132,6 +2134,8 @@ int lm_rem_lockspace_sanlock(struct lockspace *ls, int free_vg)
 		remove_info_file(ls);
 	}
 
+	for (i = 0; i < lms->worker_count; i++)
+		_close(lms->worker_sock[i]);
 	_close(lms->sock);
 out:
 	free(lms);
@@ -2145,6 +2149,65 @@ out:
 	return 0;
 }
 
+/*
+ * The sanlock daemon handles one request at a time from a client, so
+ * each lv worker of the lockspace registers a connection of its own.
+ * A lease belongs to the connection that acquired it, so an lv resource
+ * is always processed by the same worker (r->worker), and _lease_sock()
+ * gives the connection to use for it.
+ */
+int lm_add_workers_sanlock(struct lockspace *ls, int count)
+{
+	struct lm_sanlock *lms = (struct lm_sanlock *)ls->lm_data;
+	char killpath[SANLK_PATH_LEN];
+	char killargs[SANLK_PATH_LEN];
+	int sock;
+	int rv;
+
+	if (count > LV_WORKERS_MAX)
+		count = LV_WORKERS_MAX;
+
+	if (daemon_test)
+		return count;
+
+	memset(killpath, 0, sizeof(killpath));
+	snprintf(killpath, SANLK_PATH_LEN, "%slockctl", LVM_PATH);
+
+	memset(killargs, 0, sizeof(killargs));
+	snprintf(killargs, SANLK_PATH_LEN, "--kill %s", ls->vg_name);
+
+	while (lms->worker_count < count) {
+		sock = sanlock_register();
+		if (sock < 0) {
+			log_error("S %s add_workers_san register error %d", ls->name, sock);
+			break;
+		}
+
+		rv = sanlock_killpath(sock, 0, killpath, killargs);
+		if (!rv)
+			rv = sanlock_restrict(sock, SANLK_RESTRICT_SIGKILL);
+		if (rv < 0) {
+			log_error("S %s add_workers_san killpath error %d", ls->name, rv);
+			_close(sock);
+			break;
+		}
+
+		lms->worker_sock[lms->worker_count++] = sock;
+	}
+
+	log_debug("S %s add_workers_san %d", ls->name, lms->worker_count);
+
+	return lms->worker_count;
+}
+
+static int _lease_sock(struct lm_sanlock *lms, struct resource *r)
+{
+	if (r->worker && (r->worker <= lms->worker_count))
+		return lms->worker_sock[r->worker - 1];
+
+	return lms->sock;
+}
+
 int lm_add_resource_sanlock(struct lockspace *ls, struct resource *r)
 {
 	struct lm_sanlock *lms = (struct lm_sanlock *)ls->lm_data;
@@ -2329,9 +2392,9 @@ int lm_lock_sanlock(struct lockspace *ls, struct resource *r, int ld_mode,
  repair_retry:
 
 #if LOCKDSANLOCK_SUPPORT >= 400
-	rv = sanlock_acquire2(lms->sock, -1, flags, rs, &opt, &owner_host, &owner_name);
+	rv = sanlock_acquire2(_lease_sock(lms, r), -1, flags, rs, &opt, &owner_host, &owner_name);
 #else
-	rv = sanlock_acquire(lms->sock, -1, flags, 1, &rs, &opt);
+	rv = sanlock_acquire(_lease_sock(lms, r), -1, flags, 1, &rs, &opt);
 #endif
 
 	/*
@@ -2541,6 +2604,100 @@ out:
 	return rv;
 }
 
+static int _lock_batch_chunk(struct lockspace *ls, int sock, struct sanlk_resource **rs,
+			     int *idx, int n, int *acquired)
+{
+	struct sanlk_options opt;
+	int i, rv;
+
+	if (!n)
+		return 0;
+
+	memset(&opt, 0, sizeof(opt));
+	snprintf(opt.owner_name, sizeof(opt.owner_name), "%s", "lvmlockd");
+
+	if (daemon_test)
+		rv = 0;
+	else
+		rv = sanlock_acquire(sock, -1, SANLK_ACQUIRE_OWNER_NOWAIT, n, rs, &opt);
+
+	if (rv < 0) {
+		log_debug("S %s lock_batch_san %d leases error %d", ls->name, n, rv);
+		return 0;
+	}
+
+	for (i = 0; i < n; i++)
+		acquired[idx[i]] = 1;
+
+	log_debug("S %s lock_batch_san acquired %d leases", ls->name, n);
+	return n;
+}
+
+/*
+ * Acquire the leases of many lvs with one sanlock_acquire call per
+ * SANLK_MAX_RESOURCES leases, instead of one call (and one round of
+ * lease i/o) for each lv.  sanlock acquires all the leases passed in
+ * a call or none of them.  The lvs in a chunk that fails are not
+ * acquired here and are left for lm_lock_sanlock(), which reports
+ * the error (and owner) of the specific lv.  All r use the same
+ * sanlock connection, i.e. are processed by the same lv worker.
+ */
+
+int lm_lock_batch_sanlock(struct lockspace *ls, struct resource **r, int *ld_mode,
+			  int count, int *acquired)
+{
+	struct lm_sanlock *lms = (struct lm_sanlock *)ls->lm_data;
+	struct sanlk_resource *rs[SANLK_MAX_RESOURCES];
+	int idx[SANLK_MAX_RESOURCES];
+	struct rd_sanlock *rds;
+	uint64_t lock_lv_offset;
+	int done = 0;
+	int i, n = 0;
+
+	for (i = 0; i < count; i++) {
+		acquired[i] = 0;
+
+		if (r[i]->type != LD_RT_LV)
+			continue;
+
+		if (!r[i]->lm_init) {
+			if (lm_add_resource_sanlock(ls, r[i]) < 0)
+				continue;
+			r[i]->lm_init = 1;
+		}
+
+		if ((check_args_version(r[i]->lv_args, LV_LOCK_ARGS_MAJOR) < 0) ||
+		    (lock_lv_offset_from_args(r[i]->lv_args, &lock_lv_offset) < 0))
+			continue;
+
+		rds = (struct rd_sanlock *)r[i]->lm_data;
+		rds->rs.disks[0].offset = lock_lv_offset;
+
+		if (ld_mode[i] == LD_LK_SH)
+			rds->rs.flags |= SANLK_RES_SHARED;
+		else
+			rds->rs.flags &= ~SANLK_RES_SHARED;
+		rds->rs.flags |= SANLK_RES_PERSISTENT;
+
+		log_debug("%s:%s lock_batch_san %s at %s:%llu",
+			  ls->name, r[i]->name, mode_str(ld_mode[i]), rds->rs.disks[0].path,
+			  (unsigned long long)rds->rs.disks[0].offset);
+
+		rs[n] = &rds->rs;
+		idx[n] = i;
+
+		if (++n == SANLK_MAX_RESOURCES) {
+			done += _lock_batch_chunk(ls, _lease_sock(lms, r[0]), rs, idx, n, acquired);
+			n = 0;
+		}
+	}
+
+	if (count)
+		done += _lock_batch_chunk(ls, _lease_sock(lms, r[0]), rs, idx, n, acquired);
+
+	return done;
+}
+
 int lm_convert_sanlock(struct lockspace *ls, struct resource *r,
 		       int ld_mode, uint32_t r_version)
 {
@@ -2596,7 +2753,7 @@ int lm_convert_sanlock(struct lockspace *ls, struct resource *r,
 	 */
 	flags |= SANLK_ACQUIRE_OWNER_NOWAIT;
 
-	rv = sanlock_convert(lms->sock, -1, flags, rs);
+	rv = sanlock_convert(_lease_sock(lms, r), -1, flags, rs);
 	if (!rv)
 		return 0;
 
@@ -2724,7 +2881,7 @@ int lm_unlock_sanlock(struct lockspace *ls, struct resource *r,
 		return release_rename(ls, r);
 	}
 
-	rv = sanlock_release(lms->sock, -1, 0, 1, &rs);
+	rv = sanlock_release(_lease_sock(lms, r), -1, 0, 1, &rs);
 	if (rv < 0)
 		log_error("%s:%s unlock_san release error %d", ls->name, r->name, rv);
 
@@ -244,6 +244,13 @@ int lv_info_with_seg_status(struct cmd_context *cmd,
 {
 	return 0;
 }
+int lv_status_prefetch(struct cmd_context *cmd, const struct volume_group *vg)
+{
+	return 1;
+}
+void lv_status_prefetch_release(void)
+{
+}
 int lv_cache_status(const struct logical_volume *cache_lv,
 		    struct lv_status_cache **status)
 {
@@ -835,6 +842,19 @@ int lv_info_with_name_check(struct cmd_context *cmd, const struct logical_volume
  *
  * TODO: further improve with more statuses (i.e. snapshot's origin/merge)
  */
+int lv_status_prefetch(struct cmd_context *cmd, const struct volume_group *vg)
+{
+	if (!activation())
+		return 1;
+
+	return dev_manager_status_prefetch(cmd, vg);
+}
+
+void lv_status_prefetch_release(void)
+{
+	dev_manager_status_prefetch_release();
+}
+
 int lv_info_with_seg_status(struct cmd_context *cmd,
 			    const struct lv_segment *lv_seg,
 			    struct lv_with_info_and_seg_status *status,
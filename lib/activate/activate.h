@@ -170,6 +170,15 @@ int lv_info_with_seg_status(struct cmd_context *cmd,
 			    struct lv_with_info_and_seg_status *status,
 			    int with_open_count, int with_read_ahead);
 
+/*
+ * Called before lv_info or lv_info_with_seg_status for each LV that is
+ * reported.  Once a report has asked for enough LVs of the VG, the info
+ * and status of all active LVs in the VG are read together and later
+ * calls for LVs in the VG use them.  Release at the end of the report.
+ */
+int lv_status_prefetch(struct cmd_context *cmd, const struct volume_group *vg);
+void lv_status_prefetch_release(void);
+
 int lv_check_not_in_use(const struct logical_volume *lv, int error_if_used);
 
 /*
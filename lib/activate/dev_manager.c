@@ -14,6 +14,7 @@
  */
 
 #include "lib/misc/lib.h"
+#include "base/memory/zalloc.h"
 #include "dev_manager.h"
 #include "lib/misc/lvm-string.h"
 #include "fs.h"
@@ -27,9 +28,11 @@
 #include "lib/misc/lvm-exec.h"
 #include "lib/datastruct/str_list.h"
 #include "lib/misc/lvm-signal.h"
+#include "lib/device/dev-cache.h"
 
 #include <limits.h>
 #include <dirent.h>
+#include <pthread.h>
 
 #define MAX_TARGET_PARAMSIZE 50000
 #define LVM_UDEV_NOSCAN_FLAG DM_SUBSYSTEM_UDEV_FLAG0
@@ -321,6 +324,366 @@ static uint32_t _seg_len(const struct lv_segment *seg)
 	return seg->len - reshape_len;
 }
 
+/*
+ * Does the table line at target_start with target_length belong
+ * to the segment whose status is requested?
+ */
+static int _is_seg_target(const struct lv_segment *seg,
+			  uint64_t target_start, uint64_t target_length)
+{
+	uint64_t start, extent_size, length, length_crop = 0;
+
+	extent_size = length = seg->lv->vg->extent_size;
+	start = extent_size * seg->le;
+	length *= _seg_len(seg);
+
+	/* Uses max DM_THIN_MAX_METADATA_SIZE sectors for metadata device */
+	if (lv_is_thin_pool_metadata(seg->lv) &&
+	    (length > DM_THIN_MAX_METADATA_SIZE))
+		length_crop = DM_THIN_MAX_METADATA_SIZE;
+
+	/* Uses virtual size with headers for VDO pool device */
+	if (lv_is_vdo_pool(seg->lv))
+		length = get_vdo_pool_virtual_size(seg);
+
+	if (lv_is_integrity(seg->lv))
+		length = seg->integrity_data_sectors;
+
+	return ((start == target_start) &&
+		((length == target_length) ||
+		 ((lv_is_vdo_pool(seg->lv)) && /* should fit within extent size */
+		  (length < target_length) && ((length + extent_size) > target_length)) ||
+		 (length_crop && (length_crop == target_length))));
+}
+
+/*
+ * Status prefetch.
+ *
+ * Reports that include many LVs of a VG read the status of all active
+ * LVs of the VG at once, before they are reported.  The active devices
+ * of the VG are taken from the dm_devs_cache list, so inactive LVs cost
+ * nothing, and up to report/status_workers threads run the STATUS
+ * ioctls.  _info_run() then serves both info and status requests for
+ * these devices from the copies kept here, instead of running an ioctl
+ * for every LV and layer as it is reported.
+ *
+ * The threads only call libdm to run their task and copy the result.
+ * libdm logs through the lvm logging code, which is not thread safe,
+ * so libdm logging is switched off while the threads run.  A device
+ * whose task fails is left out, and _info_run() queries it as usual
+ * later, reporting any error.
+ */
+
+/* Fewer requests are served with one ioctl each. */
+#define STATUS_PREFETCH_MIN_LVS		16
+/* Devices per thread worth starting another thread for. */
+#define STATUS_PREFETCH_DEVS_PER_WORKER	16
+/* Upper limit for report/status_workers. */
+#define STATUS_WORKERS_MAX		64
+
+struct prefetched_target {
+	uint64_t start;
+	uint64_t length;
+	const char *type;
+	const char *params;
+};
+
+struct prefetched_status {
+	struct dm_info info;
+	uint32_t read_ahead;
+	int read_ahead_ok;
+	const char *name;
+	unsigned target_count;
+	struct prefetched_target targets[];
+};
+
+struct status_prefetch_job {
+	const char *uuid;
+	struct prefetched_status *ps;
+};
+
+struct status_prefetch_pool {
+	pthread_mutex_t lock;
+	struct status_prefetch_job *jobs;
+	unsigned count;
+	unsigned next;
+	int enable_checks;
+};
+
+static struct {
+	char vgid[ID_LEN + 1];
+	unsigned requests;
+	int done;
+	struct dm_hash_table *hash;
+} _status_prefetch;
+
+static const struct prefetched_status *_status_prefetched(const char *dlid)
+{
+	if (!_status_prefetch.hash)
+		return NULL;
+
+	return dm_hash_lookup(_status_prefetch.hash, dlid);
+}
+
+static int _info_prefetched(const struct prefetched_status *ps,
+			    struct dm_info *dminfo, uint32_t *read_ahead,
+			    struct lv_seg_status *seg_status,
+			    const char *name_check, int with_read_ahead)
+{
+	const char *target_name = NULL, *target_params = NULL;
+	unsigned i;
+
+	*dminfo = ps->info;
+
+	if (name_check && strcmp(name_check, ps->name))
+		dminfo->exists = 0;	/* mismatching name -> device does not exist */
+
+	if (read_ahead)
+		*read_ahead = (with_read_ahead && dminfo->exists) ?
+			ps->read_ahead : DM_READ_AHEAD_NONE;
+
+	if (seg_status && dminfo->exists) {
+		for (i = 0; i < ps->target_count; i++) {
+			target_name = ps->targets[i].type;
+			target_params = ps->targets[i].params;
+
+			if (_is_seg_target(seg_status->seg, ps->targets[i].start,
+					   ps->targets[i].length))
+				break;
+
+			target_params = NULL;
+		}
+
+		if (!target_name ||
+		    !_get_segment_status_from_target_params(target_name, target_params, dminfo, seg_status))
+			stack;
+	}
+
+	return 1;
+}
+
+/* Runs in a worker thread: no logging and no lvm state. */
+static void _prefetch_status_one(struct status_prefetch_pool *pool,
+				 struct status_prefetch_job *job)
+{
+	struct prefetched_status *ps;
+	struct dm_task *dmt;
+	struct dm_info info;
+	void *target = NULL;
+	uint64_t start, length;
+	char *type, *params, *p;
+	const char *name;
+	unsigned count = 0;
+	size_t size;
+
+	if (!(dmt = dm_task_create(DM_DEVICE_STATUS)))
+		return;
+
+	if (!dm_task_set_uuid(dmt, job->uuid) ||
+	    (pool->enable_checks && !dm_task_enable_checks(dmt)) ||
+	    !dm_task_no_flush(dmt) ||
+	    !dm_task_run(dmt) ||
+	    !dm_task_get_info(dmt, &info) ||
+	    !info.exists ||
+	    !(name = dm_task_get_name(dmt)))
+		goto out;
+
+	size = sizeof(*ps) + strlen(name) + 1;
+	do {
+		target = dm_get_next_target(dmt, target, &start, &length, &type, &params);
+		if (!type)
+			continue;
+		size += sizeof(ps->targets[0]) + strlen(type) + strlen(params ? : "") + 2;
+		count++;
+	} while (target);
+
+	if (!(ps = zalloc(size)))
+		goto out;
+
+	ps->info = info;
+	ps->read_ahead_ok = dm_task_get_read_ahead(dmt, &ps->read_ahead) ? 1 : 0;
+
+	p = (char *) &ps->targets[count];
+	ps->name = strcpy(p, name);
+	p += strlen(name) + 1;
+
+	do {
+		target = dm_get_next_target(dmt, target, &start, &length, &type, &params);
+		if (!type || ps->target_count == count)
+			continue;
+		ps->targets[ps->target_count].start = start;
+		ps->targets[ps->target_count].length = length;
+		ps->targets[ps->target_count].type = strcpy(p, type);
+		p += strlen(type) + 1;
+		ps->targets[ps->target_count].params = strcpy(p, params ? : "");
+		p += strlen(p) + 1;
+		ps->target_count++;
+	} while (target);
+
+	job->ps = ps;
+out:
+	dm_task_destroy(dmt);
+}
+
+static void *_prefetch_status_worker(void *arg)
+{
+	struct status_prefetch_pool *pool = arg;
+	unsigned i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->count)
+			break;
+
+		_prefetch_status_one(pool, &pool->jobs[i]);
+	}
+
+	return NULL;
+}
+
+static void _prefetch_no_log(int level, const char *file, int line,
+			     int dm_errno_or_class, const char *f, ...)
+{
+}
+
+static int _prefetch_status(struct cmd_context *cmd, const char *vgid)
+{
+	pthread_t threads[STATUS_WORKERS_MAX];
+	struct status_prefetch_pool pool = {
+		.enable_checks = activation_checks(),
+	};
+	char prefix[sizeof(UUID_PREFIX) + ID_LEN];
+	const struct dm_list *devs;
+	const struct dm_active_device *dm_dev;
+	unsigned started = 0, cached = 0;
+	unsigned workers, i;
+	int silenced = 0;
+	int r = 0;
+
+	if (!(devs = dm_devs_cache_get_devs()))
+		return 1;
+
+	workers = find_config_tree_int(cmd, report_status_workers_CFG, NULL);
+	if (!workers)
+		return 1;
+	if (workers > STATUS_WORKERS_MAX)
+		workers = STATUS_WORKERS_MAX;
+
+	(void) dm_snprintf(prefix, sizeof(prefix), UUID_PREFIX "%s", vgid);
+
+	if (!(pool.jobs = zalloc(dm_list_size(devs) * sizeof(*pool.jobs))))
+		return_0;
+
+	dm_list_iterate_items(dm_dev, devs)
+		if (dm_dev->uuid && !strncmp(dm_dev->uuid, prefix, sizeof(prefix) - 1))
+			pool.jobs[pool.count++].uuid = dm_dev->uuid;
+
+	if (!pool.count) {
+		r = 1;
+		goto out;
+	}
+
+	if (!(_status_prefetch.hash = dm_hash_create(pool.count)))
+		goto_out;
+
+	/*
+	 * The first device is done here before any threads are started,
+	 * so libdm has its control fd open and driver version checked.
+	 */
+	_prefetch_status_one(&pool, &pool.jobs[0]);
+	pool.next = 1;
+
+	if (workers > (pool.count - 1) / STATUS_PREFETCH_DEVS_PER_WORKER + 1)
+		workers = (pool.count - 1) / STATUS_PREFETCH_DEVS_PER_WORKER + 1;
+
+	/*
+	 * With debug logging the ioctls are traced, so keep them in one
+	 * thread.  The same when libdm does not log through lvm, since
+	 * its own log function could not be put back.
+	 */
+	if ((workers > 1) &&
+	    (verbose_level() >= _LOG_DEBUG || !cmd->libdm_log))
+		workers = 1;
+
+	if (pthread_mutex_init(&pool.lock, NULL))
+		goto_out;
+
+	if (workers > 1) {
+		dm_log_with_errno_init(_prefetch_no_log);
+		silenced = 1;
+	}
+
+	/* The calling thread is one of the workers. */
+	for (i = 1; i < workers; i++) {
+		if (pthread_create(&threads[started], NULL, _prefetch_status_worker, &pool))
+			break;
+		started++;
+	}
+
+	(void) _prefetch_status_worker(&pool);
+
+	for (i = 0; i < started; i++)
+		(void) pthread_join(threads[i], NULL);
+
+	if (silenced)
+		dm_log_with_errno_init(print_log_libdm);
+
+	(void) pthread_mutex_destroy(&pool.lock);
+
+	for (i = 0; i < pool.count; i++) {
+		if (!pool.jobs[i].ps)
+			continue;
+		if (!dm_hash_insert(_status_prefetch.hash, pool.jobs[i].uuid, pool.jobs[i].ps)) {
+			free(pool.jobs[i].ps);
+			continue;
+		}
+		pool.jobs[i].ps = NULL;
+		cached++;
+	}
+
+	log_debug_activation("Prefetched status of %u of %u active devices in VG %s with %u threads.",
+			     cached, pool.count, vgid, started + 1);
+	r = 1;
+out:
+	for (i = 0; i < pool.count; i++)
+		free(pool.jobs[i].ps);
+	free(pool.jobs);
+
+	return r;
+}
+
+void dev_manager_status_prefetch_release(void)
+{
+	struct dm_hash_node *n;
+
+	if (_status_prefetch.hash) {
+		dm_hash_iterate(n, _status_prefetch.hash)
+			free(dm_hash_get_data(_status_prefetch.hash, n));
+		dm_hash_destroy(_status_prefetch.hash);
+	}
+
+	memset(&_status_prefetch, 0, sizeof(_status_prefetch));
+}
+
+int dev_manager_status_prefetch(struct cmd_context *cmd, const struct volume_group *vg)
+{
+	if (memcmp(_status_prefetch.vgid, &vg->id, ID_LEN)) {
+		dev_manager_status_prefetch_release();
+		memcpy(_status_prefetch.vgid, &vg->id, ID_LEN);
+	}
+
+	if (_status_prefetch.done ||
+	    (++_status_prefetch.requests < STATUS_PREFETCH_MIN_LVS))
+		return 1;
+
+	_status_prefetch.done = 1;
+
+	return _prefetch_status(cmd, _status_prefetch.vgid);
+}
+
 static int _info_run(const char *dlid, struct dm_info *dminfo,
 		     uint32_t *read_ahead,
 		     struct lv_seg_status *seg_status,
@@ -333,9 +696,15 @@ static int _info_run(const char *dlid, struct dm_info *dminfo,
 	int dmtask;
 	int with_flush; /* TODO: arg for _info_run */
 	void *target = NULL;
-	uint64_t target_start, target_length, start, extent_size, length, length_crop = 0;
+	uint64_t target_start, target_length;
 	char *target_name, *target_params;
 	const char *devname;
+	const struct prefetched_status *ps;
+
+	if (dlid && !major && !minor && (ps = _status_prefetched(dlid)) &&
+	    (!with_read_ahead || !read_ahead || ps->read_ahead_ok))
+		return _info_prefetched(ps, dminfo, read_ahead, seg_status, name_check,
+					with_read_ahead);
 
 	if (seg_status) {
 		dmtask = DM_DEVICE_STATUS;
@@ -362,31 +731,11 @@ static int _info_run(const char *dlid, struct dm_info *dminfo,
 
 	/* Query status only for active device */
 	if (seg_status && dminfo->exists) {
-		extent_size = length = seg_status->seg->lv->vg->extent_size;
-		start = extent_size * seg_status->seg->le;
-		length *= _seg_len(seg_status->seg);
-
-		/* Uses max DM_THIN_MAX_METADATA_SIZE sectors for metadata device */
-		if (lv_is_thin_pool_metadata(seg_status->seg->lv) &&
-		    (length > DM_THIN_MAX_METADATA_SIZE))
-			length_crop = DM_THIN_MAX_METADATA_SIZE;
-
-		/* Uses virtual size with headers for VDO pool device */
-		if (lv_is_vdo_pool(seg_status->seg->lv))
-			length = get_vdo_pool_virtual_size(seg_status->seg);
-
-		if (lv_is_integrity(seg_status->seg->lv))
-			length = seg_status->seg->integrity_data_sectors;
-
 		do {
 			target = dm_get_next_target(dmt, target, &target_start,
 						    &target_length, &target_name, &target_params);
 
-			if ((start == target_start) &&
-			    ((length == target_length) ||
-			     ((lv_is_vdo_pool(seg_status->seg->lv)) && /* should fit within extent size */
-			      (length < target_length) && ((length + extent_size) > target_length)) ||
-			     (length_crop && (length_crop == target_length))))
+			if (_is_seg_target(seg_status->seg, target_start, target_length))
 				break; /* Keep target_params when matching segment is found */
 
 			target_params = NULL; /* Marking this target_params unusable */
@@ -1607,6 +1956,7 @@ void dev_manager_release(void)
 
 void dev_manager_exit(void)
 {
+	dev_manager_status_prefetch_release();
 	dm_lib_exit();
 }
 
@@ -3865,7 +4215,21 @@ static int _create_lv_symlinks(struct dev_manager *dm, struct dm_tree_node *root
 	/* Nothing to do if udev fallback is disabled. */
 	if (!_udev_fallback(dm->cmd)) {
 		fs_set_create();
-		return 1;
+		/* Unless udev is given limited time to create the links */
+		if (!udev_sync_timeout())
+			return 1;
+
+		while ((child = dm_tree_next_child(&handle, root, 0))) {
+			if (!(lvlayer = dm_tree_node_get_context(child)) ||
+			    !(_lv_has_mknode(lvlayer->lv) || lvlayer->visible_component))
+				continue;
+			if (!(name = dm_build_dm_name(dm->mem, lvlayer->lv->vg->name,
+						      lvlayer->lv->name, NULL)) ||
+			    !fs_add_lv_on_udev_timeout(lvlayer->lv, name))
+				r = 0;
+		}
+
+		return r;
 	}
 
 	while ((child = dm_tree_next_child(&handle, root, 0))) {
@@ -54,6 +54,14 @@ int dev_manager_info(struct cmd_context *cmd, const struct logical_volume *lv,
 		     struct dm_info *dminfo, uint32_t *read_ahead,
 		     struct lv_seg_status *seg_status);
 
+/*
+ * Read the status of all active LVs of the VG at once, for reports that
+ * include many of them.  dev_manager_info() uses it until it's released
+ * or the status of an LV from another VG is prefetched.
+ */
+int dev_manager_status_prefetch(struct cmd_context *cmd, const struct volume_group *vg);
+void dev_manager_status_prefetch_release(void);
+
 int dev_manager_snapshot_percent(struct dev_manager *dm,
 				 const struct logical_volume *lv,
 				 dm_percent_t *percent);
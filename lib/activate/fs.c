@@ -302,6 +302,8 @@ static int _do_fs_op(fs_op_t type, const char *dev_dir, const char *vg_name,
 }
 
 static DM_LIST_INIT(_fs_ops);
+/* Links left to udev, created only if udev does not finish in time */
+static DM_LIST_INIT(_fs_timeout_ops);
 /*
  * Count number of stacked fs_op_t operations to allow to skip dm_list search.
  * FIXME: handling of FS_RENAME
@@ -427,7 +429,76 @@ static int _stack_fs_op(fs_op_t type, const char *dev_dir, const char *vg_name,
 	return 1;
 }
 
-static void _pop_fs_ops(void)
+/*
+ * Create a link udev did not create in time, unless udev got to it
+ * meanwhile or the device has gone again.
+ */
+static int _mk_missing_link(const char *dev_dir, const char *vg_name,
+			    const char *lv_name, const char *dev,
+			    const char **vg_dir_done, int *created)
+{
+	char lv_path[PATH_MAX], link_path[PATH_MAX];
+	struct stat buf, buf_lp;
+
+	if ((dm_snprintf(lv_path, sizeof(lv_path), "%s%s/%s",
+			 dev_dir, vg_name, lv_name) == -1) ||
+	    (dm_snprintf(link_path, sizeof(link_path), "%s/%s",
+			 dm_dir(), dev) == -1)) {
+		log_error("Couldn't create pathnames for logical volume link %s.",
+			  lv_name);
+		return 0;
+	}
+
+	if (stat(link_path, &buf_lp)) {
+		log_debug_activation("Skipping link %s, %s is not present.",
+				     lv_path, link_path);
+		return 1;
+	}
+
+	if (!stat(lv_path, &buf) && (buf.st_rdev == buf_lp.st_rdev))
+		return 1;
+
+	/* Ops are stacked per LV activation, mostly one VG after another */
+	if (!*vg_dir_done || strcmp(*vg_dir_done, vg_name)) {
+		if (!_mk_dir(dev_dir, vg_name))
+			return_0;
+		*vg_dir_done = vg_name;
+	}
+
+	if (!_mk_link(dev_dir, vg_name, lv_name, dev, 0))
+		return_0;
+
+	(*created)++;
+
+	return 1;
+}
+
+static void _pop_fs_timeout_ops(int udev_timed_out)
+{
+	struct dm_list *fsph, *fspht;
+	struct fs_op_parms *fsp;
+	const char *vg_dir_done = NULL;
+	int created = 0;
+
+	if (udev_timed_out) {
+		dm_list_iterate_items(fsp, &_fs_timeout_ops)
+			if (!_mk_missing_link(fsp->dev_dir, fsp->vg_name, fsp->lv_name,
+					      fsp->dev, &vg_dir_done, &created))
+				stack;
+
+		if (created)
+			log_verbose("Created %d logical volume links not created by udev in time.",
+				    created);
+	}
+
+	dm_list_iterate_safe(fsph, fspht, &_fs_timeout_ops) {
+		fsp = dm_list_item(fsph, struct fs_op_parms);
+		dm_list_del(&fsp->list);
+		free(fsp);
+	}
+}
+
+static void _pop_fs_ops(int udev_timed_out)
 {
 	struct dm_list *fsph, *fspht;
 	struct fs_op_parms *fsp;
@@ -439,6 +510,8 @@ static void _pop_fs_ops(void)
 		_del_fs_op(fsp);
 	}
 
+	_pop_fs_timeout_ops(udev_timed_out);
+
 	_fs_create = 0;
 }
 
@@ -463,6 +536,38 @@ int fs_add_lv(const struct logical_volume *lv, const char *dev)
 		      dev, "", lv->vg->cmd->current_settings.udev_rules);
 }
 
+/*
+ * Remember the link udev is going to create, so it can be created
+ * directly when udev does not finish within udev_sync_timeout.
+ */
+int fs_add_lv_on_udev_timeout(const struct logical_volume *lv, const char *dev)
+{
+	const char *dev_dir = lv->vg->cmd->dev_dir;
+	struct fs_op_parms *fsp;
+	size_t len = strlen(dev_dir) + strlen(lv->vg->name) + strlen(lv->name) +
+	    strlen(dev) + 5;
+	char *pos;
+
+	if (!(fsp = malloc(sizeof(*fsp) + len))) {
+		log_error("No space to stack fs operation");
+		return 0;
+	}
+
+	pos = fsp->names;
+	fsp->type = FS_ADD;
+	fsp->check_udev = 0;
+
+	_store_str(&pos, &fsp->dev_dir, dev_dir);
+	_store_str(&pos, &fsp->vg_name, lv->vg->name);
+	_store_str(&pos, &fsp->lv_name, lv->name);
+	_store_str(&pos, &fsp->dev, dev);
+	_store_str(&pos, &fsp->old_lv_name, "");
+
+	dm_list_add(&_fs_timeout_ops, &fsp->list);
+
+	return 1;
+}
+
 int fs_del_lv(const struct logical_volume *lv)
 {
 	return _fs_op(FS_DEL, lv->vg->cmd->dev_dir, lv->vg->name, lv->name,
@@ -492,6 +597,9 @@ int fs_rename_lv(const struct logical_volume *lv, const char *dev,
 
 void fs_unlock(void)
 {
+	unsigned timeout = udev_sync_timeout();
+	int ready = 1;
+
 	/* Do not allow syncing device name with suspended devices */
 	if (!dm_get_suspended_counter()) {
 		if (!dm_udev_get_sync_support())
@@ -500,11 +608,17 @@ void fs_unlock(void)
 		else
 			log_debug_activation("Syncing device names");
 		/* Wait for all processed udev devices */
-		if (!dm_udev_wait(_fs_cookie))
+		if (!timeout) {
+			if (!dm_udev_wait(_fs_cookie))
+				stack;
+		} else if (!dm_udev_wait_timeout(_fs_cookie, timeout * 1000, &ready))
 			stack;
+		else if (!ready)
+			log_warn("WARNING: udev did not finish processing devices in %u seconds, "
+				 "creating missing device nodes and links directly.", timeout);
 		_fs_cookie = DM_COOKIE_AUTO_CREATE; /* Reset cookie */
 		dm_lib_release();
-		_pop_fs_ops();
+		_pop_fs_ops(!ready);
 	}
 }
 
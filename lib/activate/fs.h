@@ -24,6 +24,7 @@
  * symbolic links to the dm device.
  */
 int fs_add_lv(const struct logical_volume *lv, const char *dev);
+int fs_add_lv_on_udev_timeout(const struct logical_volume *lv, const char *dev);
 int fs_del_lv(const struct logical_volume *lv);
 int fs_del_lv_byname(const char *dev_dir, const char *vg_name,
 		     const char *lv_name, int check_udev);
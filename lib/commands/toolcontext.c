@@ -452,8 +452,10 @@ static void _init_logging(struct cmd_context *cmd)
 
 	/* Tell device-mapper about our logging */
 #ifdef DEVMAPPER_SUPPORT
-	if (!dm_log_is_non_default())
+	if (!dm_log_is_non_default()) {
 		dm_log_with_errno_init(print_log_libdm);
+		cmd->libdm_log = 1;
+	}
 #endif
 	reset_log_duplicated();
 	reset_lvm_errno(1);
@@ -776,6 +778,9 @@ static int _process_config(struct cmd_context *cmd)
 	cmd->default_settings.udev_sync = udev_disabled ? 0 :
 		find_config_tree_bool(cmd, activation_udev_sync_CFG, NULL);
 
+	cmd->udev_sync_batch = find_config_tree_bool(cmd, activation_udev_sync_batch_CFG, NULL);
+	init_udev_sync_timeout(find_config_tree_int(cmd, activation_udev_sync_timeout_CFG, NULL));
+
 	/*
 	 * Set udev_fallback lazily on first use since it requires
 	 * checking DM driver version which is an extra ioctl!
@@ -1786,6 +1791,7 @@ struct cmd_context *create_toolcontext(unsigned is_clvmd,
 		goto_out;
 
 	init_use_aio(find_config_tree_bool(cmd, global_use_aio_CFG, NULL));
+	init_use_io_uring(find_config_tree_bool(cmd, global_use_io_uring_CFG, NULL));
 
 	if (!_init_dev_cache(cmd))
 		goto_out;
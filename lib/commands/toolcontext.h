@@ -140,7 +140,7 @@ struct cmd_context {
 	/*
 	 * Switches.
 	 */
-	unsigned is_long_lived:1;		/* optimises persistent_filter handling */
+	unsigned is_long_lived:1;		/* lvm shell, liblvm2cmd: dev-cache kept between commands */
 	unsigned is_interactive:1;
 	unsigned running_on_valgrind:1;
 	unsigned check_pv_dev_sizes:1;
@@ -208,10 +208,12 @@ struct cmd_context {
 	unsigned filter_regex_skip:1;		/* don't use filter-regex */
 	unsigned filter_regex_with_devices_file:1; /* use filter-regex even when devices file is enabled */
 	unsigned filter_nodata_only:1;          /* only use filters that do not require data from the dev */
+	unsigned filter_data_only:1;		/* only use filters that require data from the dev */
 	unsigned run_by_dmeventd:1;		/* command is being run by dmeventd */
 	unsigned sysinit:1;			/* --sysinit is used */
 	unsigned ignorelockingfailure:1;	/* --ignorelockingfailure is used */
 	unsigned check_devs_used:1;		/* check devs used by LVs */
+	unsigned libdm_log:1;			/* libdm logs through print_log_libdm() */
 	unsigned print_device_id_not_found:1;	/* print devices file entries not found */
 	unsigned ignore_device_name_mismatch:1; /* skip updating devices file names */
 	unsigned backup_disabled:1;		/* skip repeated debug message */
@@ -228,12 +230,14 @@ struct cmd_context {
 	unsigned get_vgname_from_options:1;     /* used by lvconvert */
 	unsigned vg_write_validates_vg:1;
 	unsigned disable_pr_required:1;
+	unsigned udev_sync_batch:1;		/* wait for udev once after activating all VGs */
 
 	/*
 	 * Devices and filtering.
 	 */
 	struct dev_filter *filter;
 	struct dm_list use_devices;		/* struct dev_use for each entry in devices file */
+	struct dev_use_index *use_devices_index; /* lookups into use_devices */
 	const char *md_component_checks;
 	const char *search_for_devnames;	/* config file setting */
 	struct dm_list device_ids_check_serial;
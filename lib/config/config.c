@@ -481,33 +481,22 @@ int override_config_tree_from_profile(struct cmd_context *cmd,
 }
 
 /*
- * When checksum_only is set, the checksum of buffer is only matched
- * and function avoids parsing of mda into config tree which
- * remains unmodified and should not be used.
+ * Read the text at offset (and offset2) into a buffer with an extra '\0'
+ * after it, checking it against the checksum when checksum_fn is set.
  */
-int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_reason_t reason,
-			off_t offset, size_t size, off_t offset2, size_t size2,
-			checksum_fn_t checksum_fn, uint32_t checksum,
-			int checksum_only, int no_dup_node_check, int only_pv_summary)
+static char *_read_fd_text(struct device *dev, dev_io_reason_t reason,
+			   off_t offset, size_t size, off_t offset2, size_t size2,
+			   checksum_fn_t checksum_fn, uint32_t checksum)
 {
 	char namebuf[NAME_LEN + 1] __attribute__((aligned(8)));
 	int namelen = 0;
 	int bad_name = 0;
-	char *fb, *fe;
-	int r = 0;
+	char *fb;
 	ssize_t sz;
 	int use_plain_read = 1;
 	char *buf = NULL;
-	struct config_source *cs = dm_config_get_custom(cft);
 	size_t rsize;
 
-	if (!_is_file_based_config_source(cs->type)) {
-		log_error(INTERNAL_ERROR "config_file_read_fd: expected file, special file "
-					 "or profile config source, found %s config source.",
-					 _config_source_names[cs->type]);
-		return 0;
-	}
-
 	/* Only use plain read with regular files */
 	if (!(dev->flags & DEV_REGULAR) || size2)
 		use_plain_read = 0;
@@ -515,14 +504,14 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	if (size + size2 < size) {
 		log_error("Metadata buffer size overflow %zu + %zu on %s.",
 			  size, size2, dev_name(dev));
-		return 0;
+		return NULL;
 	}
 
 	/* Ensure there is extra '\0' after end of buffer since we pass
 	 * buffer to functions like strtoll() */
 	if (!(buf = zalloc(size + size2 + 1))) {
 		log_error("Failed to allocate circular buffer.");
-		return 0;
+		return NULL;
 	}
 
 	if (use_plain_read) {
@@ -535,16 +524,16 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 
 			if (sz <= 0) {
 				log_sys_error("read", dev_name(dev));
-				goto out;
+				goto bad;
 			}
 		}
 	} else {
 		if (!dev_read_bytes(dev, offset, size, buf))
-			goto out;
+			goto bad;
 
 		if (size2) {
 			if (!dev_read_bytes(dev, offset2, size2, buf + size))
-				goto out;
+				goto bad;
 		}
 	}
 
@@ -577,11 +566,47 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	    (checksum_fn(checksum_fn(INITIAL_CRC, (const uint8_t *)fb, size),
 			 (const uint8_t *)(fb + size), size2))) {
 		log_warn("WARNING: Checksum error on %s at offset %llu.", dev_name(dev), (unsigned long long)offset);
-		goto out;
+		goto bad;
 	}
 
 	if (bad_name)
-		goto out;
+		goto bad;
+
+	return buf;
+
+      bad:
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * When checksum_only is set, the checksum of buffer is only matched
+ * and function avoids parsing of mda into config tree which
+ * remains unmodified and should not be used.
+ */
+int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_reason_t reason,
+			off_t offset, size_t size, off_t offset2, size_t size2,
+			checksum_fn_t checksum_fn, uint32_t checksum,
+			int checksum_only, int no_dup_node_check, int only_pv_summary)
+{
+	char *fb, *fe;
+	int r = 0;
+	char *buf;
+	struct config_source *cs = dm_config_get_custom(cft);
+
+	if (!_is_file_based_config_source(cs->type)) {
+		log_error(INTERNAL_ERROR "config_file_read_fd: expected file, special file "
+					 "or profile config source, found %s config source.",
+					 _config_source_names[cs->type]);
+		return 0;
+	}
+
+	if (!(buf = _read_fd_text(dev, reason, offset, size, offset2, size2,
+				  checksum_fn, checksum)))
+		return 0;
+
+	fb = buf;
 
 	if (!checksum_only) {
 		fe = fb + size + size2;
@@ -605,6 +630,18 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	return r;
 }
 
+/*
+ * Read metadata text like config_file_read_fd() without parsing it.
+ * The caller frees the returned text.
+ */
+char *config_file_read_fd_text(struct device *dev, dev_io_reason_t reason,
+			       off_t offset, size_t size, off_t offset2, size_t size2,
+			       checksum_fn_t checksum_fn, uint32_t checksum)
+{
+	return _read_fd_text(dev, reason, offset, size, offset2, size2,
+			     checksum_fn, checksum);
+}
+
 int config_file_read_from_file(struct dm_config_tree *cft)
 {
 	const char *filename = NULL;
@@ -245,6 +245,9 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 			off_t offset, size_t size, off_t offset2, size_t size2,
 			checksum_fn_t checksum_fn, uint32_t checksum,
 			int checksum_only, int no_dup_node_check, int only_pv_summary);
+char *config_file_read_fd_text(struct device *dev, dev_io_reason_t reason,
+			       off_t offset, size_t size, off_t offset2, size_t size2,
+			       checksum_fn_t checksum_fn, uint32_t checksum);
 int config_file_read_from_file(struct dm_config_tree *cft);
 struct dm_config_tree *config_file_open_and_read(const char *config_file, config_source_t source,
 						 struct cmd_context *cmd);
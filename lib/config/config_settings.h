@@ -250,6 +250,17 @@ cfg(devices_obtain_device_list_from_udev_CFG, "obtain_device_list_from_udev", de
 	"directories will be scanned fully. LVM needs to be compiled with\n"
 	"udev support for this setting to apply.\n")
 
+cfg(devices_update_device_list_from_events_CFG, "update_device_list_from_events", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_UPDATE_DEVICE_LIST_FROM_EVENTS, vsn(2, 3, 40), NULL, 0, NULL,
+	"Keep the list of devices up to date from uevents in long running\n"
+	"processes such as the lvm shell and users of liblvm2cmd.\n"
+	"After the first command has built the list of devices, later\n"
+	"commands in the process apply the devices added, changed or\n"
+	"removed since then instead of scanning the device directories\n"
+	"again. If obtain_device_list_from_udev is used, the events come\n"
+	"from udev. Otherwise they come from the kernel, which does not\n"
+	"report all names of a new device, so a new device causes the\n"
+	"next command to scan the directories again.\n")
+
 cfg(devices_external_device_info_source_CFG, "external_device_info_source", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_EXTERNAL_DEVICE_INFO_SOURCE, vsn(2, 2, 116), NULL, 0, NULL,
 	"Enable device information from udev.\n"
 	"If set to \"udev\", lvm will supplement its own native device information\n"
@@ -382,6 +393,14 @@ cfg_array(devices_global_filter_CFG, "global_filter", devices_CFG_SECTION, CFG_D
 	"The syntax is the same as devices/filter. Devices rejected by\n"
 	"global_filter are not opened by LVM.\n")
 
+cfg(devices_filter_cache_CFG, "filter_cache", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_FILTER_CACHE, vsn(2, 3, 40), NULL, 0, NULL,
+	"Save the results of the device filters that do not read the device\n"
+	"(e.g. filter, global_filter, the devices file, sysfs and multipath\n"
+	"component checks) in a file under the run directory. Later commands\n"
+	"use the saved result for a device when the settings and the device\n"
+	"properties the result depends on have not changed, instead of\n"
+	"checking those filters again. dm devices are always checked.\n")
+
 cfg_runtime(devices_cache_CFG, "cache", devices_CFG_SECTION, 0, CFG_TYPE_STRING, vsn(1, 0, 0), vsn(1, 2, 19), NULL,
 	NULL)
 
@@ -416,6 +435,29 @@ cfg(devices_scan_lvs_CFG, "scan_lvs", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED
 	"devices file or the filter. This option does not enable autoactivation\n"
 	"of layered VGs, which requires editing LVM udev rules (see LVM_PVSCAN_ON_LVS).\n")
 
+cfg(devices_scan_label_first_CFG, "scan_label_first", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_SCAN_LABEL_FIRST, vsn(2, 3, 40), NULL, 0, NULL,
+	"Scan devices in two passes. The first pass reads only the first\n"
+	"4KiB of each device, which contains the LVM label. The larger block\n"
+	"holding the PV metadata is read in the second pass, only from the\n"
+	"devices that have an LVM label. This reduces the amount of data\n"
+	"read when most of the scanned devices are not PVs.\n"
+	"Disabled by default, set to 1 to enable it.\n")
+
+cfg(devices_scan_cache_CFG, "scan_cache", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_SCAN_CACHE, vsn(2, 3, 40), NULL, 0, NULL,
+	"Save the VG summary read from the metadata of each PV in a file\n"
+	"under the run directory. A later device scan that finds the same\n"
+	"metadata location and checksum in the mda_header uses the saved\n"
+	"summary instead of reading and parsing the metadata text. The\n"
+	"metadata text is still fully read when the VG is read.\n"
+	"Disabled by default, set to 1 to enable it.\n")
+
+cfg(devices_scan_workers_CFG, "scan_workers", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_SCAN_WORKERS, vsn(2, 3, 40), NULL, 0, NULL,
+	"The number of threads used to read and parse PV metadata during\n"
+	"a device scan. Other scan processing is done by a single thread.\n"
+	"Using more threads can reduce scan time on systems with many VGs\n"
+	"with large metadata. A value of 0 or 1 disables the threads.\n"
+	"The maximum is 64.\n")
+
 cfg(devices_multipath_component_detection_CFG, "multipath_component_detection", devices_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_MULTIPATH_COMPONENT_DETECTION, vsn(2, 2, 89), NULL, 0, NULL,
 	"Ignore devices that are components of DM multipath devices.\n")
 
@@ -1185,6 +1227,17 @@ cfg(global_event_activation_CFG, "event_activation", global_CFG_SECTION, CFG_DEF
 	"services (via the lvm2-activation-generator), but the autoactivation\n"
 	"services and generator have been removed.\n")
 
+cfg(global_event_activation_coalesce_CFG, "event_activation_coalesce", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_EVENT_ACTIVATION_COALESCE, vsn(2, 3, 40), NULL, 0, NULL,
+	"Milliseconds that event activation pvscans wait for each other.\n"
+	"When many devices appear together, e.g. at boot, a pvscan is run for\n"
+	"each of them. With a non-zero value, the pvscans queue their devices,\n"
+	"and one of them waits this long for more devices to be queued, then\n"
+	"scans all the queued devices and autoactivates the complete VGs once.\n"
+	"The other pvscans exit without scanning. A value of 0 disables this.\n"
+	"This applies to pvscan --cache -aay, and to the pvscan run by the lvm\n"
+	"udev rule, which then reports all the VGs it completed to the rule\n"
+	"so that they are activated by one vgchange.\n")
+
 cfg(global_use_lvmetad_CFG, "use_lvmetad", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, 0, vsn(2, 2, 93), 0, vsn(2, 3, 0), NULL,
 	NULL)
 
@@ -1194,6 +1247,13 @@ cfg(global_lvmetad_update_wait_time_CFG, "lvmetad_update_wait_time", global_CFG_
 cfg(global_use_aio_CFG, "use_aio", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_USE_AIO, vsn(2, 2, 183), NULL, 0, NULL,
 	"Use async I/O when reading and writing devices.\n")
 
+cfg(global_use_io_uring_CFG, "use_io_uring", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_USE_IO_URING, vsn(2, 3, 40), NULL, 0, NULL,
+	"Use io_uring when reading and writing devices.\n"
+	"Submissions are batched and the io buffers and device file\n"
+	"descriptors are registered with the kernel, which reduces the\n"
+	"cost of scanning many devices. If io_uring is not available,\n"
+	"async I/O is used according to use_aio.\n")
+
 cfg(global_use_lvmlockd_CFG, "use_lvmlockd", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, 0, vsn(2, 2, 124), NULL, 0, NULL,
 	"Use lvmlockd for locking among hosts using LVM on shared storage.\n"
 	"Applicable only if LVM is compiled with lockd support in which\n"
@@ -1408,12 +1468,11 @@ cfg(global_notify_dbus_CFG, "notify_dbus", global_CFG_SECTION, CFG_DEFAULT_COMME
 	"or changes the activation state of an LV will send a notification.\n")
 
 cfg(global_io_memory_size_CFG, "io_memory_size", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_IO_MEMORY_SIZE_KB, vsn(2, 3, 2), NULL, 0, NULL,
-	"The amount of memory in KiB that LVM allocates to perform disk io.\n"
-	"LVM performance may benefit from more io memory when there are many\n"
-	"disks or VG metadata is large. Increasing this size may be necessary\n"
-	"when a single copy of VG metadata is larger than the current setting.\n"
-	"This value should usually not be decreased from the default; setting\n"
-	"it too low can result in lvm failing to read VGs.\n")
+	"The amount of memory in KiB that LVM initially allocates to perform\n"
+	"disk io. The io memory grows as needed, up to 512 MiB, while many\n"
+	"disks are scanned or when VG metadata is larger than this setting,\n"
+	"and memory only needed for scanning is released after the scan.\n"
+	"This value should usually not be decreased from the default.\n")
 
 cfg(activation_udev_sync_CFG, "udev_sync", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_UDEV_SYNC, vsn(2, 2, 51), NULL, 0, NULL,
 	"Use udev notifications to synchronize udev and LVM.\n"
@@ -1425,6 +1484,22 @@ cfg(activation_udev_sync_CFG, "udev_sync", activation_CFG_SECTION, CFG_DEFAULT_C
 	"running, and LVM processes are waiting for udev, run the command\n"
 	"'dmsetup udevcomplete_all' to wake them up.\n")
 
+cfg(activation_udev_sync_batch_CFG, "udev_sync_batch", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_UDEV_SYNC_BATCH, vsn(2, 3, 40), NULL, 0, NULL,
+	"Wait for udev once per command when activating LVs in several VGs.\n"
+	"When enabled, vgchange and pvscan autoactivation keep adding the\n"
+	"devices of each VG to one udev transaction and wait for udev to\n"
+	"finish processing them when all VGs are activated. When disabled,\n"
+	"the command waits for udev after activating the LVs in each VG.\n")
+
+cfg(activation_udev_sync_timeout_CFG, "udev_sync_timeout", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_UDEV_SYNC_TIMEOUT, vsn(2, 3, 40), NULL, 0, NULL,
+	"Time in seconds to wait for udev to finish processing LV devices.\n"
+	"If udev has not finished in this time, LVM stops waiting and\n"
+	"creates the device nodes and the LV symlinks that are missing\n"
+	"itself, as it does when udev_rules is disabled. udev may still\n"
+	"process the devices afterwards. Its udev cookie is then left in\n"
+	"place, 'dmsetup udevcomplete_all' removes it.\n"
+	"Set to 0 to wait without a limit.\n")
+
 cfg(activation_udev_rules_CFG, "udev_rules", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_UDEV_RULES, vsn(2, 2, 57), NULL, 0, NULL,
 	"Use udev rules to manage LV device nodes and symlinks.\n"
 	"When disabled, LVM will manage the device nodes and symlinks for\n"
@@ -1821,6 +1896,14 @@ cfg(metadata_lvs_history_retention_time_CFG, "lvs_history_retention_time", metad
 	"historical logical volume is automatically destroyed.\n"
 	"A value of 0 disables this feature.\n")
 
+cfg(metadata_binary_cache_CFG, "binary_cache", metadata_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_METADATA_BINARY_CACHE, vsn(2, 3, 40), NULL, 0, NULL,
+	"Save a binary copy of the parsed metadata of each VG in a file\n"
+	"under the run directory. When a VG is read and the metadata on\n"
+	"disk has the checksum and size the copy was saved from, the copy\n"
+	"is loaded instead of parsing the metadata text. The text is still\n"
+	"read and checked against its checksum, and remains authoritative.\n"
+	"This helps hosts that frequently report VGs with large metadata.\n")
+
 cfg(metadata_pvmetadatacopies_CFG, "pvmetadatacopies", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_PVMETADATACOPIES, vsn(1, 0, 0), NULL, 0, NULL,
 	"Number of copies of metadata to store on each PV.\n"
 	"The --pvmetadatacopies option overrides this setting.\n"
@@ -2206,6 +2289,14 @@ cfg(report_two_word_unknown_device_CFG, "two_word_unknown_device", report_CFG_SE
 	"Use the two words 'unknown device' in place of '[unknown]'.\n"
 	"This is displayed when the device for a PV is not known.\n")
 
+cfg(report_status_workers_CFG, "status_workers", report_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_REP_STATUS_WORKERS, vsn(2, 3, 40), NULL, 0, NULL,
+	"The number of threads used to read the status of active LVs when\n"
+	"a report includes many LVs of a VG. The status of all active LVs\n"
+	"in the VG is then read together before the LVs are reported.\n"
+	"A value of 0 disables this, and each LV is queried when it is\n"
+	"reported. A value of 1 reads the status without extra threads.\n"
+	"The maximum is 64.\n")
+
 cfg(dmeventd_mirror_library_CFG, "mirror_library", dmeventd_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_DMEVENTD_MIRROR_LIB, vsn(1, 2, 3), NULL, 0, NULL,
 	"The library dmeventd uses when monitoring a mirror device.\n"
 	"libdevmapper-event-lvm2mirror.so attempts to recover from\n"
@@ -2232,7 +2323,11 @@ cfg(dmeventd_thin_command_CFG, "thin_command", dmeventd_CFG_SECTION, CFG_DEFAULT
 	"or metadata volume gets above 50%.\n"
 	"Command which starts with 'lvm ' prefix is internal lvm command.\n"
 	"You can write your own handler to customise behaviour in more details.\n"
-	"User handler is specified with the full path starting with '/'.\n")
+	"User handler is specified with the full path starting with '/'.\n"
+	"Internal lvm commands for one VG run one at a time, the pool\n"
+	"closest to full first. Commands for different VGs can run at the\n"
+	"same time, in a forked lvm process while dmeventd's own lvm\n"
+	"instance is busy. A user handler runs in its own process.\n")
 	/* TODO: systemd service handler */
 
 cfg(dmeventd_vdo_library_CFG, "vdo_library", dmeventd_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_DMEVENTD_VDO_LIB, VDO_1ST_VSN, NULL, 0, NULL,
@@ -2246,7 +2341,11 @@ cfg(dmeventd_vdo_command_CFG, "vdo_command", dmeventd_CFG_SECTION, CFG_DEFAULT_C
 	"gets above 50%.\n"
 	"Command which starts with 'lvm ' prefix is internal lvm command.\n"
 	"You can write your own handler to customise behaviour in more details.\n"
-	"User handler is specified with the full path starting with '/'.\n")
+	"User handler is specified with the full path starting with '/'.\n"
+	"Internal lvm commands for one VG run one at a time, the pool\n"
+	"closest to full first. Commands for different VGs can run at the\n"
+	"same time, in a forked lvm process while dmeventd's own lvm\n"
+	"instance is busy. A user handler runs in its own process.\n")
 	/* TODO: systemd service handler */
 
 cfg(dmeventd_executable_CFG, "executable", dmeventd_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_DMEVENTD_PATH, vsn(2, 2, 73), "@DMEVENTD_PATH@", 0, NULL,
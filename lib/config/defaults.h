@@ -41,6 +41,7 @@
 #define DEFAULT_DEV_DIR "/dev"
 #define DEFAULT_SYSTEM_ID_SOURCE "none"
 #define DEFAULT_OBTAIN_DEVICE_LIST_FROM_UDEV 0
+#define DEFAULT_UPDATE_DEVICE_LIST_FROM_EVENTS 0
 #define DEFAULT_EXTERNAL_DEVICE_INFO_SOURCE "none"
 #define DEFAULT_SYSFS_SCAN 1
 #define DEFAULT_MD_COMPONENT_DETECTION 1
@@ -69,6 +70,8 @@
 #define DEFAULT_LVDISPLAY_SHOWS_FULL_DEVICE_PATH 0
 #define DEFAULT_UNKNOWN_DEVICE_NAME "[unknown]"
 #define DEFAULT_USE_AIO 1
+#define DEFAULT_EVENT_ACTIVATION_COALESCE 0
+#define DEFAULT_USE_IO_URING 0
 
 #define DEFAULT_SANLOCK_LV_EXTEND_MB 256
 #define DEFAULT_SANLOCK_ALIGN_SIZE 8 /* in MiB, applies to 4K disks only */
@@ -201,6 +204,7 @@
 #define DEFAULT_STRIPESIZE 64	/* KB */
 #define DEFAULT_RECORD_LVS_HISTORY 0
 #define DEFAULT_LVS_HISTORY_RETENTION_TIME 0
+#define DEFAULT_METADATA_BINARY_CACHE 0
 #define DEFAULT_PVMETADATAIGNORE 0
 #define DEFAULT_PVMETADATACOPIES 1
 #define DEFAULT_VGMETADATACOPIES 0
@@ -208,6 +212,8 @@
 #define DEFAULT_READ_AHEAD "auto"
 #define DEFAULT_UDEV_RULES 1
 #define DEFAULT_UDEV_SYNC 1
+#define DEFAULT_UDEV_SYNC_BATCH 0
+#define DEFAULT_UDEV_SYNC_TIMEOUT 0
 #define DEFAULT_NOTIFY_DBUS 1
 #define DEFAULT_VERIFY_UDEV_OPERATIONS 0
 #define DEFAULT_RETRY_DEACTIVATION 1
@@ -271,6 +277,7 @@
 #define DEFAULT_REP_QUOTED 1
 #define DEFAULT_REP_SEPARATOR " "
 #define DEFAULT_REP_LIST_ITEM_SEPARATOR ","
+#define DEFAULT_REP_STATUS_WORKERS 4
 #define DEFAULT_TIME_FORMAT "%Y-%m-%d %T %z"
 
 #define DEFAULT_REP_OUTPUT_FORMAT "basic"
@@ -323,6 +330,10 @@
 #define DEFAULT_VDO_POOL_AUTOEXTEND_PERCENT 20
 
 #define DEFAULT_SCAN_LVS 0
+#define DEFAULT_SCAN_LABEL_FIRST 0
+#define DEFAULT_SCAN_CACHE 0
+#define DEFAULT_FILTER_CACHE 0
+#define DEFAULT_SCAN_WORKERS 0
 
 #define DEFAULT_HINTS "all"
 
@@ -339,6 +350,9 @@
 #define PVS_ONLINE_DIR DEFAULT_RUN_DIR "/pvs_online"
 #define VGS_ONLINE_DIR DEFAULT_RUN_DIR "/vgs_online"
 #define PVS_LOOKUP_DIR DEFAULT_RUN_DIR "/pvs_lookup"
+#define PVS_QUEUE_DIR DEFAULT_RUN_DIR "/pvs_queue"
+#define PVS_ONLINE_TABLE DEFAULT_RUN_DIR "/pvs_online_table"
+#define METADATA_CACHE_DIR DEFAULT_RUN_DIR "/metadata_cache"
 
 #define DEVICES_IMPORT_PATH DEFAULT_RUN_DIR "/lvm-devices-import"
 
@@ -14,6 +14,7 @@
 
 #include "lib/device/bcache.h"
 
+#include "base/memory/zalloc.h"
 #include "lib/datastruct/radix-tree.h"
 #include "lib/log/lvm-logging.h"
 #include "lib/log/log.h"
@@ -32,11 +33,19 @@
 #include <linux/fs.h>
 #include <sys/user.h>
 
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
 #define SECTOR_SHIFT 9L
 
 #define FD_TABLE_INC 1024
 static int _fd_table_size = 0;
 static int *_fd_table = NULL;
+static int _fd_table_users = 0; /* caches sharing the fd table */
 
 
 //----------------------------------------------------------------
@@ -166,9 +175,136 @@ static void _async_destroy(struct io_engine *ioe)
 	free(e);
 }
 
-static int _last_byte_di;
-static uint64_t _last_byte_offset;
-static int _last_byte_sector_size;
+/*
+ * Where lvm wants writes to a device to end.  There is normally one
+ * limit, but writes queued for several metadata areas before one flush
+ * keep one limit per area, and a block uses the nearest limit at or
+ * after its offset.
+ */
+struct last_byte {
+	int di;
+	int sector_size;
+	uint64_t offset;
+};
+
+static struct last_byte *_last_bytes;
+static unsigned _last_bytes_count;
+static unsigned _last_bytes_size;
+
+static const struct last_byte *_find_last_byte(int di, uint64_t offset)
+{
+	const struct last_byte *lb, *found = NULL, *any = NULL;
+	unsigned i;
+
+	for (i = 0; i < _last_bytes_count; i++) {
+		lb = &_last_bytes[i];
+		if (lb->di != di)
+			continue;
+		any = lb;
+		if ((lb->offset >= offset) && (!found || (lb->offset < found->offset)))
+			found = lb;
+	}
+
+	/* A write beyond all limits is refused using any of them. */
+	return found ? : any;
+}
+
+/*
+ * If bcache block goes past where lvm wants to write, then clamp it.
+ * Shared by all io engines.  Returns false if the write must not be
+ * issued at all.
+ */
+static bool _limit_write(int di, uint64_t offset, uint64_t *nbytes_p)
+{
+	const struct last_byte *lb;
+	uint64_t nbytes = *nbytes_p;
+	uint64_t limit_nbytes;
+	uint64_t orig_nbytes;
+	uint64_t extra_nbytes = 0;
+
+	if (!(lb = _find_last_byte(di, offset)))
+		return true;
+
+	if (offset > lb->offset) {
+		log_error("Limit write at %llu len %llu beyond last byte %llu",
+			  (unsigned long long)offset,
+			  (unsigned long long)nbytes,
+			  (unsigned long long)lb->offset);
+		return false;
+	}
+
+	/*
+	 * If the bcache block offset+len goes beyond where lvm is
+	 * intending to write, then reduce the len being written
+	 * (which is the bcache block size) so we don't write past
+	 * the limit set by lvm.  If after applying the limit, the
+	 * resulting size is not a multiple of the sector size (512
+	 * or 4096) then extend the reduced size to be a multiple of
+	 * the sector size (we don't want to write partial sectors.)
+	 */
+	if (offset + nbytes <= lb->offset)
+		return true;
+
+	limit_nbytes = lb->offset - offset;
+
+	if (limit_nbytes % lb->sector_size) {
+		extra_nbytes = lb->sector_size - (limit_nbytes % lb->sector_size);
+
+		/*
+		 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
+		 * should make the final write size a multiple of the
+		 * sector size.  This should never result in a final size
+		 * larger than the bcache block size (as long as the bcache
+		 * block size is a multiple of the sector size).
+		 */
+		if (limit_nbytes + extra_nbytes > nbytes) {
+			log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
+				 (unsigned long long)offset,
+				 (unsigned long long)nbytes,
+				 (unsigned long long)limit_nbytes,
+				 (unsigned long long)extra_nbytes,
+				 (unsigned long long)lb->sector_size);
+			extra_nbytes = 0;
+		}
+	}
+
+	orig_nbytes = nbytes;
+
+	if (extra_nbytes) {
+		log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
+			  (unsigned long long)offset,
+			  (unsigned long long)nbytes,
+			  (unsigned long long)limit_nbytes,
+			  (unsigned long long)(limit_nbytes + extra_nbytes));
+		nbytes = limit_nbytes + extra_nbytes;
+	} else {
+		log_debug("Limit write at %llu len %llu to len %llu",
+			  (unsigned long long)offset,
+			  (unsigned long long)nbytes,
+			  (unsigned long long)limit_nbytes);
+		nbytes = limit_nbytes;
+	}
+
+	/*
+	 * This shouldn't happen, the reduced+extended
+	 * nbytes value should never be larger than the
+	 * bcache block size.
+	 */
+	if (nbytes > orig_nbytes) {
+		log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
+			  (unsigned long long)offset,
+			  (unsigned long long)orig_nbytes,
+			  (unsigned long long)nbytes,
+			  (unsigned long long)limit_nbytes,
+			  (unsigned long long)extra_nbytes,
+			  (unsigned long long)lb->sector_size);
+		return false;
+	}
+
+	*nbytes_p = nbytes;
+
+	return true;
+}
 
 static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 			 sector_t sb, sector_t se, void *data, void *context)
@@ -179,9 +315,6 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	struct async_engine *e = _to_async(ioe);
 	sector_t offset;
 	sector_t nbytes;
-	sector_t limit_nbytes;
-	sector_t orig_nbytes;
-	sector_t extra_nbytes = 0;
 
 	if (((uintptr_t) data) & e->page_mask) {
 		log_warn("misaligned data buffer");
@@ -191,85 +324,8 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	offset = sb << SECTOR_SHIFT;
 	nbytes = (se - sb) << SECTOR_SHIFT;
 
-	/*
-	 * If bcache block goes past where lvm wants to write, then clamp it.
-	 */
-	if ((d == DIR_WRITE) && _last_byte_offset && (di == _last_byte_di)) {
-		if (offset > _last_byte_offset) {
-			log_error("Limit write at %llu len %llu beyond last byte %llu",
-				  (unsigned long long)offset,
-				  (unsigned long long)nbytes,
-				  (unsigned long long)_last_byte_offset);
-			return false;
-		}
-
-		/*
-		 * If the bcache block offset+len goes beyond where lvm is
-		 * intending to write, then reduce the len being written
-		 * (which is the bcache block size) so we don't write past
-		 * the limit set by lvm.  If after applying the limit, the
-		 * resulting size is not a multiple of the sector size (512
-		 * or 4096) then extend the reduced size to be a multiple of
-		 * the sector size (we don't want to write partial sectors.)
-		 */
-		if (offset + nbytes > _last_byte_offset) {
-			limit_nbytes = _last_byte_offset - offset;
-
-			if (limit_nbytes % _last_byte_sector_size) {
-				extra_nbytes = _last_byte_sector_size - (limit_nbytes % _last_byte_sector_size);
-
-				/*
-				 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
-				 * should make the final write size a multiple of the
-				 * sector size.  This should never result in a final size
-				 * larger than the bcache block size (as long as the bcache
-				 * block size is a multiple of the sector size).
-				 */
-				if (limit_nbytes + extra_nbytes > nbytes) {
-					log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
-						 (unsigned long long)offset,
-						 (unsigned long long)nbytes,
-						 (unsigned long long)limit_nbytes,
-						 (unsigned long long)extra_nbytes,
-						 (unsigned long long)_last_byte_sector_size);
-					extra_nbytes = 0;
-				}
-			}
-
-			orig_nbytes = nbytes;
-
-			if (extra_nbytes) {
-				log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)(limit_nbytes + extra_nbytes));
-				nbytes = limit_nbytes + extra_nbytes;
-			} else {
-				log_debug("Limit write at %llu len %llu to len %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes);
-				nbytes = limit_nbytes;
-			}
-
-			/*
-			 * This shouldn't happen, the reduced+extended
-			 * nbytes value should never be larger than the
-			 * bcache block size.
-			 */
-			if (nbytes > orig_nbytes) {
-				log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)orig_nbytes,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)extra_nbytes,
-					  (unsigned long long)_last_byte_sector_size);
-				return false;
-			}
-		}
-	}
+	if ((d == DIR_WRITE) && !_limit_write(di, offset, &nbytes))
+		return false;
 
 	cb = _cb_alloc(e->cbs, context);
 	if (!cb) {
@@ -469,86 +525,9 @@ static bool _sync_issue(struct io_engine *ioe, enum dir d, int di,
 		return false;
 	}
 
-	/*
-	 * If bcache block goes past where lvm wants to write, then clamp it.
-	 */
-	if ((d == DIR_WRITE) && _last_byte_offset && (di == _last_byte_di)) {
-		uint64_t offset = where;
-		uint64_t nbytes = len;
-		sector_t limit_nbytes = 0;
-		sector_t extra_nbytes = 0;
-		sector_t orig_nbytes = 0;
-
-		if (offset > _last_byte_offset) {
-			log_error("Limit write at %llu len %llu beyond last byte %llu",
-				  (unsigned long long)offset,
-				  (unsigned long long)nbytes,
-				  (unsigned long long)_last_byte_offset);
-			free(io);
-			return false;
-		}
-
-		if (offset + nbytes > _last_byte_offset) {
-			limit_nbytes = _last_byte_offset - offset;
-
-			if (limit_nbytes % _last_byte_sector_size) {
-				extra_nbytes = _last_byte_sector_size - (limit_nbytes % _last_byte_sector_size);
-
-				/*
-				 * adding extra_nbytes to the reduced nbytes (limit_nbytes)
-				 * should make the final write size a multiple of the
-				 * sector size.  This should never result in a final size
-				 * larger than the bcache block size (as long as the bcache
-				 * block size is a multiple of the sector size).
-				 */
-				if (limit_nbytes + extra_nbytes > nbytes) {
-					log_warn("Skip extending write at %llu len %llu limit %llu extra %llu sector_size %llu",
-						 (unsigned long long)offset,
-						 (unsigned long long)nbytes,
-						 (unsigned long long)limit_nbytes,
-						 (unsigned long long)extra_nbytes,
-						 (unsigned long long)_last_byte_sector_size);
-					extra_nbytes = 0;
-				}
-			}
-
-			orig_nbytes = nbytes;
-
-			if (extra_nbytes) {
-				log_debug("Limit write at %llu len %llu to len %llu rounded to %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)(limit_nbytes + extra_nbytes));
-				nbytes = limit_nbytes + extra_nbytes;
-			} else {
-				log_debug("Limit write at %llu len %llu to len %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes);
-				nbytes = limit_nbytes;
-			}
-
-			/*
-			 * This shouldn't happen, the reduced+extended
-			 * nbytes value should never be larger than the
-			 * bcache block size.
-			 */
-			if (nbytes > orig_nbytes) {
-				log_error("Invalid adjusted write at %llu len %llu adjusted %llu limit %llu extra %llu sector_size %llu",
-					  (unsigned long long)offset,
-					  (unsigned long long)orig_nbytes,
-					  (unsigned long long)nbytes,
-					  (unsigned long long)limit_nbytes,
-					  (unsigned long long)extra_nbytes,
-					  (unsigned long long)_last_byte_sector_size);
-				free(io);
-				return false;
-			}
-		}
-
-		where = offset;
-		len = nbytes;
+	if ((d == DIR_WRITE) && !_limit_write(di, where, &len)) {
+		free(io);
+		return false;
 	}
 
 	while (pos < len) {
@@ -636,6 +615,516 @@ struct io_engine *create_sync_io_engine(void)
 
 //----------------------------------------------------------------
 
+#ifdef HAVE_LINUX_IO_URING_H
+
+/*
+ * The io_uring engine queues io on the submission ring in issue() and
+ * submits the whole batch in the same io_uring_enter() call that waits
+ * for completions, so prefetching block 0 of N devices costs a few
+ * syscalls instead of N io_submit() calls.
+ *
+ * The bcache block pool is registered once as a fixed buffer, so the
+ * kernel does not pin and unpin the pages for every io, and the
+ * bcache fd table is mirrored into the ring's registered file table.
+ * Registration of new fds is batched with the submission; a slot is
+ * released as soon as bcache_clear_fd() is called so the ring never
+ * keeps a closed device open.
+ */
+
+#define URING_FIXED_FILES FD_TABLE_INC
+
+struct uring_io {
+	struct dm_list list;
+	void *context;
+	uint64_t nbytes;
+	struct iovec iov;
+};
+
+struct uring_engine {
+	struct io_engine e;
+	int ring_fd;
+	pid_t ring_pid; /* PID that created the ring */
+	unsigned page_mask;
+
+	void *sq_ptr;
+	size_t sq_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	unsigned sq_queued;	/* written to the ring, not yet submitted */
+
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ptr;
+	size_t cq_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct dm_list free_ios;
+	struct uring_io ios[MAX_IO];
+
+	/* Registered bcache block pool, NULL if not registered. */
+	char *fixed_buf;
+	size_t fixed_buf_len;
+
+	/* Registered file table, NULL if not supported by the kernel. */
+	int *fixed_fds;
+	int fixed_lo;		/* range of slots needing update */
+	int fixed_hi;
+};
+
+/* The engine owning the registered file table mirrored from _fd_table. */
+static struct uring_engine *_uring_files_owner;
+
+static struct uring_engine *_to_uring(struct io_engine *e)
+{
+	return container_of(e, struct uring_engine, e);
+}
+
+static int _io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int _io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+			   unsigned flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			     flags, NULL, 0);
+}
+
+static int _io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static bool _uring_update_files(struct uring_engine *e, int lo, int hi)
+{
+	struct io_uring_files_update up = {
+		.offset = lo,
+		.fds = (uintptr_t) (e->fixed_fds + lo),
+	};
+	int r;
+
+	/* The kernel stops at the first bad fd and returns the count done. */
+	if ((r = _io_uring_register(e->ring_fd, IORING_REGISTER_FILES_UPDATE,
+				    &up, hi - lo + 1)) != hi - lo + 1) {
+		log_debug_devs("io_uring file update %d-%d failed %d.", lo, hi,
+			       (r < 0) ? errno : 0);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Stop using the registered file table: sqes queued with a slot
+ * index get the plain fd back and later ios use plain fds.
+ */
+static void _uring_drop_files(struct uring_engine *e)
+{
+	struct io_uring_sqe *sqe;
+	unsigned i, tail = *e->sq_tail;
+
+	for (i = tail - e->sq_queued; i != tail; i++) {
+		sqe = e->sqes + (e->sq_array[i & *e->sq_mask]);
+		if (sqe->flags & IOSQE_FIXED_FILE) {
+			sqe->flags &= ~IOSQE_FIXED_FILE;
+			sqe->fd = _fd_table[sqe->fd];
+		}
+	}
+
+	(void) _io_uring_register(e->ring_fd, IORING_UNREGISTER_FILES, NULL, 0);
+
+	free(e->fixed_fds);
+	e->fixed_fds = NULL;
+
+	if (_uring_files_owner == e)
+		_uring_files_owner = NULL;
+}
+
+static void _uring_flush_files(struct uring_engine *e)
+{
+	if (!e->fixed_fds || (e->fixed_lo > e->fixed_hi))
+		return;
+
+	if (!_uring_update_files(e, e->fixed_lo, e->fixed_hi)) {
+		log_debug_devs("Not using io_uring registered files.");
+		_uring_drop_files(e);
+	}
+
+	e->fixed_lo = URING_FIXED_FILES;
+	e->fixed_hi = -1;
+}
+
+/*
+ * Called from bcache_clear_fd()/bcache_change_fd() before the caller
+ * closes the fd, all io on the di has already completed.
+ */
+static void _uring_release_fd(int di)
+{
+	struct uring_engine *e = _uring_files_owner;
+
+	if (!e || !e->fixed_fds || (di < 0) || (di >= URING_FIXED_FILES) ||
+	    (e->fixed_fds[di] == -1))
+		return;
+
+	if (e->ring_pid != getpid())
+		return;
+
+	e->fixed_fds[di] = -1;
+
+	if ((di >= e->fixed_lo) && (di <= e->fixed_hi))
+		return; /* never reached the kernel */
+
+	(void) _uring_update_files(e, di, di);
+}
+
+static void _uring_destroy(struct io_engine *ioe)
+{
+	struct uring_engine *e = _to_uring(ioe);
+
+	if (_uring_files_owner == e)
+		_uring_files_owner = NULL;
+
+	if (e->sq_queued || (dm_list_size(&e->free_ios) != MAX_IO))
+		log_warn("WARNING: io_uring io still in flight.");
+
+	/*
+	 * After fork() the child only drops its reference to the ring,
+	 * the ring itself with its registrations stays with the parent.
+	 */
+	if (e->ring_pid != getpid())
+		log_debug_devs("Skipping io_uring unregister for different pid.");
+
+	if (e->sqes)
+		(void) munmap(e->sqes, e->sqes_size);
+	if (e->cq_ptr && (e->cq_ptr != e->sq_ptr))
+		(void) munmap(e->cq_ptr, e->cq_size);
+	if (e->sq_ptr)
+		(void) munmap(e->sq_ptr, e->sq_size);
+	if ((e->ring_fd >= 0) && close(e->ring_fd))
+		log_sys_warn("close", errno);
+
+	free(e->fixed_fds);
+	free(e);
+}
+
+static bool _uring_issue(struct io_engine *ioe, enum dir d, int di,
+			 sector_t sb, sector_t se, void *data, void *context)
+{
+	struct uring_engine *e = _to_uring(ioe);
+	struct io_uring_sqe *sqe;
+	struct uring_io *io;
+	unsigned tail, idx;
+	uint64_t offset = sb << SECTOR_SHIFT;
+	uint64_t nbytes = (se - sb) << SECTOR_SHIFT;
+	int fd = _fd_table[di];
+
+	if (((uintptr_t) data) & e->page_mask) {
+		log_warn("misaligned data buffer");
+		return false;
+	}
+
+	if ((d == DIR_WRITE) && !_limit_write(di, offset, &nbytes))
+		return false;
+
+	/* ios are limited to MAX_IO == sq_entries, so the ring cannot be full */
+	if (dm_list_empty(&e->free_ios)) {
+		log_warn("couldn't allocate io_uring io");
+		return false;
+	}
+
+	io = dm_list_item(_list_pop(&e->free_ios), struct uring_io);
+	io->context = context;
+	io->nbytes = nbytes;
+
+	tail = *e->sq_tail;
+	idx = tail & *e->sq_mask;
+	sqe = e->sqes + idx;
+	memset(sqe, 0, sizeof(*sqe));
+
+	sqe->off = offset;
+	sqe->user_data = (uint64_t) (io - e->ios);
+
+	if (e->fixed_buf && ((char *) data >= e->fixed_buf) &&
+	    ((char *) data + nbytes <= e->fixed_buf + e->fixed_buf_len)) {
+		sqe->opcode = (d == DIR_READ) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+		sqe->addr = (uintptr_t) data;
+		sqe->len = nbytes;
+		sqe->buf_index = 0;
+	} else {
+		io->iov.iov_base = data;
+		io->iov.iov_len = nbytes;
+		sqe->opcode = (d == DIR_READ) ? IORING_OP_READV : IORING_OP_WRITEV;
+		sqe->addr = (uintptr_t) &io->iov;
+		sqe->len = 1;
+	}
+
+	if (e->fixed_fds && (di < URING_FIXED_FILES)) {
+		if (e->fixed_fds[di] != fd) {
+			e->fixed_fds[di] = fd;
+			if (di < e->fixed_lo)
+				e->fixed_lo = di;
+			if (di > e->fixed_hi)
+				e->fixed_hi = di;
+		}
+		sqe->fd = di;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	} else
+		sqe->fd = fd;
+
+	e->sq_array[idx] = idx;
+	__atomic_store_n(e->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	e->sq_queued++;
+
+	return true;
+}
+
+static bool _uring_wait(struct io_engine *ioe, io_complete_fn fn)
+{
+	struct uring_engine *e = _to_uring(ioe);
+	struct io_uring_cqe *cqe;
+	struct uring_io *io;
+	unsigned head, tail;
+	int r;
+
+	if (e->sq_queued)
+		_uring_flush_files(e);
+
+	head = *e->cq_head;
+
+	/*
+	 * Submit everything queued since the last wait and wait for at
+	 * least one completion.  Retry on EINTR from stray signals, but
+	 * stop if an LVM interrupt signal has been caught.
+	 */
+	while (e->sq_queued || (head == __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE))) {
+		r = _io_uring_enter(e->ring_fd, e->sq_queued, 1, IORING_ENTER_GETEVENTS);
+		if (r < 0) {
+			if (errno == EINTR) {
+				if (!sigint_caught())
+					continue;
+				stack;
+			} else
+				log_sys_warn("io_uring_enter", errno);
+			return false;
+		}
+		e->sq_queued -= (unsigned) r;
+	}
+
+	tail = __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		cqe = e->cqes + (head & *e->cq_mask);
+		io = e->ios + cqe->user_data;
+
+		if ((cqe->res >= 0) && ((uint64_t) cqe->res == io->nbytes))
+			fn(io->context, 0);
+
+		else if (cqe->res < 0)
+			fn(io->context, cqe->res);
+
+		/* minimum acceptable read is 1 sector, same as async engine */
+		else if (cqe->res >= (1 << SECTOR_SHIFT))
+			fn(io->context, 0);
+
+		else
+			fn(io->context, -ENODATA);
+
+		dm_list_add_h(&e->free_ios, &io->list);
+	}
+
+	__atomic_store_n(e->cq_head, head, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static unsigned _uring_max_io(struct io_engine *e)
+{
+	return MAX_IO;
+}
+
+static bool _uring_map_rings(struct uring_engine *e, struct io_uring_params *p)
+{
+	e->sq_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+	e->cq_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP) {
+		if (e->cq_size > e->sq_size)
+			e->sq_size = e->cq_size;
+		e->cq_size = e->sq_size;
+	}
+
+	e->sq_ptr = mmap(NULL, e->sq_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQ_RING);
+	if (e->sq_ptr == MAP_FAILED) {
+		e->sq_ptr = NULL;
+		return false;
+	}
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+		e->cq_ptr = e->sq_ptr;
+	else {
+		e->cq_ptr = mmap(NULL, e->cq_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_CQ_RING);
+		if (e->cq_ptr == MAP_FAILED) {
+			e->cq_ptr = NULL;
+			return false;
+		}
+	}
+
+	e->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	e->sqes = mmap(NULL, e->sqes_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQES);
+	if (e->sqes == MAP_FAILED) {
+		e->sqes = NULL;
+		return false;
+	}
+
+	e->sq_head = (unsigned *) ((char *) e->sq_ptr + p->sq_off.head);
+	e->sq_tail = (unsigned *) ((char *) e->sq_ptr + p->sq_off.tail);
+	e->sq_mask = (unsigned *) ((char *) e->sq_ptr + p->sq_off.ring_mask);
+	e->sq_array = (unsigned *) ((char *) e->sq_ptr + p->sq_off.array);
+	e->sq_entries = p->sq_entries;
+
+	e->cq_head = (unsigned *) ((char *) e->cq_ptr + p->cq_off.head);
+	e->cq_tail = (unsigned *) ((char *) e->cq_ptr + p->cq_off.tail);
+	e->cq_mask = (unsigned *) ((char *) e->cq_ptr + p->cq_off.ring_mask);
+	e->cqes = (struct io_uring_cqe *) ((char *) e->cq_ptr + p->cq_off.cqes);
+
+	return true;
+}
+
+static void _uring_register_files(struct uring_engine *e)
+{
+	int i;
+
+	/* Only one engine can mirror the global fd table. */
+	if (_uring_files_owner)
+		return;
+
+	if (!(e->fixed_fds = malloc(sizeof(int) * URING_FIXED_FILES)))
+		return;
+
+	for (i = 0; i < URING_FIXED_FILES; i++)
+		e->fixed_fds[i] = -1;
+
+	/* Sparse (-1) file tables need kernel 5.5 or newer. */
+	if (_io_uring_register(e->ring_fd, IORING_REGISTER_FILES,
+			       e->fixed_fds, URING_FIXED_FILES) < 0) {
+		log_debug_devs("io_uring file registration failed %d.", errno);
+		free(e->fixed_fds);
+		e->fixed_fds = NULL;
+		return;
+	}
+
+	_uring_files_owner = e;
+}
+
+/*
+ * Called by bcache_create() once the block pool is allocated.
+ * Pinning may fail with a low RLIMIT_MEMLOCK, plain reads are
+ * used then.
+ */
+static void _uring_register_pool(struct io_engine *ioe, void *data, size_t len)
+{
+	struct uring_engine *e;
+	struct iovec iov = { .iov_base = data, .iov_len = len };
+
+	if (ioe->issue != _uring_issue)
+		return;
+
+	e = _to_uring(ioe);
+
+	if (e->fixed_buf &&
+	    (_io_uring_register(e->ring_fd, IORING_UNREGISTER_BUFFERS, NULL, 0) < 0))
+		return;
+
+	e->fixed_buf = NULL;
+	e->fixed_buf_len = 0;
+
+	if (_io_uring_register(e->ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+		log_debug_devs("io_uring buffer registration failed %d.", errno);
+		return;
+	}
+
+	e->fixed_buf = data;
+	e->fixed_buf_len = len;
+}
+
+struct io_engine *create_io_uring_engine(void)
+{
+	static int _pagesize = 0;
+	struct io_uring_params p = { 0 };
+	struct uring_engine *e;
+	unsigned i;
+
+	if ((_pagesize <= 0) && (_pagesize = sysconf(_SC_PAGESIZE)) < 0) {
+		log_warn("_SC_PAGESIZE returns negative value.");
+		return NULL;
+	}
+
+	if (!(e = zalloc(sizeof(*e))))
+		return NULL;
+
+	e->e.destroy = _uring_destroy;
+	e->e.issue = _uring_issue;
+	e->e.wait = _uring_wait;
+	e->e.max_io = _uring_max_io;
+
+	e->ring_pid = getpid();
+	e->page_mask = (unsigned) _pagesize - 1;
+	e->fixed_lo = URING_FIXED_FILES;
+	e->fixed_hi = -1;
+
+	dm_list_init(&e->free_ios);
+	for (i = 0; i < MAX_IO; i++)
+		dm_list_add(&e->free_ios, &e->ios[i].list);
+
+	if ((e->ring_fd = _io_uring_setup(MAX_IO, &p)) < 0) {
+		log_debug_devs("io_uring_setup failed %d.", errno);
+		free(e);
+		return NULL;
+	}
+
+	if (!_uring_map_rings(e, &p)) {
+		log_debug_devs("io_uring ring mmap failed %d.", errno);
+		_uring_destroy(&e->e);
+		return NULL;
+	}
+
+	_uring_register_files(e);
+
+	/* coverity[leaked_storage] 'e' is not leaking */
+	return &e->e;
+}
+
+#else /* HAVE_LINUX_IO_URING_H */
+
+static void _uring_release_fd(int di)
+{
+}
+
+static void _uring_register_pool(struct io_engine *ioe, void *data, size_t len)
+{
+}
+
+struct io_engine *create_io_uring_engine(void)
+{
+	log_debug_devs("io_uring support is not compiled in.");
+	return NULL;
+}
+
+#endif /* HAVE_LINUX_IO_URING_H */
+
+//----------------------------------------------------------------
+
 #define MIN_BLOCKS 16
 #define WRITEBACK_LOW_THRESHOLD_PERCENT 33
 #define WRITEBACK_HIGH_THRESHOLD_PERCENT 66
@@ -676,16 +1165,31 @@ enum block_flags {
 	BF_DIRTY = (1 << 1),
 };
 
+/*
+ * The block pool is made of chunks.  A non elastic cache has a single
+ * chunk, an elastic cache adds chunks when it runs out of blocks and
+ * releases them again in bcache_shrink().
+ */
+struct block_chunk {
+	struct dm_list list;
+	void *data;
+	struct block *blocks;
+	unsigned nr_blocks;
+};
+
 struct bcache {
 	sector_t block_sectors;
 	uint64_t nr_data_blocks;
 	uint64_t nr_cache_blocks;
+	uint64_t min_cache_blocks;
+	uint64_t max_cache_blocks;
 	unsigned max_io;
+	unsigned engine_max_io;
+	unsigned page_size;
 
 	struct io_engine *engine;
 
-	void *raw_data;
-	struct block *raw_blocks;
+	struct dm_list chunks;
 
 	/*
 	 * Lists that categorize the blocks.
@@ -711,6 +1215,8 @@ struct bcache {
 	unsigned write_hits;
 	unsigned write_misses;
 	unsigned prefetches;
+	unsigned grows;
+	unsigned shrinks;
 };
 
 //----------------------------------------------------------------
@@ -763,39 +1269,93 @@ static void _block_remove(struct block *b)
 
 //----------------------------------------------------------------
 
-static bool _init_free_list(struct bcache *cache, unsigned count, unsigned pgsize)
+static bool _add_chunk(struct bcache *cache, unsigned count)
 {
 	unsigned i;
 	size_t block_size = cache->block_sectors << SECTOR_SHIFT;
-	unsigned char *data =
-		(unsigned char *) _alloc_aligned(count * block_size, pgsize);
+	struct block_chunk *c;
+	unsigned char *data;
+
+	if (!(c = malloc(sizeof(*c))))
+		return false;
 
 	/* Allocate the data for each block.  We page align the data. */
-	if (!data)
+	if (!(data = _alloc_aligned(count * block_size, cache->page_size))) {
+		free(c);
 		return false;
+	}
 
-	cache->raw_blocks = malloc(count * sizeof(*cache->raw_blocks));
-	if (!cache->raw_blocks) {
+	c->blocks = malloc(count * sizeof(*c->blocks));
+	if (!c->blocks) {
 		free(data);
+		free(c);
 		return false;
 	}
 
-	cache->raw_data = data;
+	c->data = data;
+	c->nr_blocks = count;
 
 	for (i = 0; i < count; i++) {
-		struct block *b = cache->raw_blocks + i;
+		struct block *b = c->blocks + i;
 		b->cache = cache;
 		b->data = data + (block_size * i);
 		dm_list_add(&cache->free, &b->list);
 	}
 
+	dm_list_add(&cache->chunks, &c->list);
+	cache->nr_cache_blocks += count;
+
 	return true;
 }
 
+static void _free_chunk(struct block_chunk *c)
+{
+	dm_list_del(&c->list);
+	free(c->data);
+	free(c->blocks);
+	free(c);
+}
+
 static void _exit_free_list(struct bcache *cache)
 {
-	free(cache->raw_data);
-	free(cache->raw_blocks);
+	struct block_chunk *c, *tmp;
+
+	dm_list_iterate_items_safe(c, tmp, &cache->chunks)
+		_free_chunk(c);
+}
+
+static bool _in_chunk(struct block_chunk *c, struct block *b)
+{
+	return (b >= c->blocks) && (b < c->blocks + c->nr_blocks);
+}
+
+static void _update_max_io(struct bcache *cache)
+{
+	cache->max_io = cache->max_cache_blocks < cache->engine_max_io ?
+		cache->max_cache_blocks : cache->engine_max_io;
+}
+
+/*
+ * Elastic caches double in size each time they run out of blocks,
+ * up to max_cache_blocks.
+ */
+static bool _grow(struct bcache *cache, uint64_t nr_blocks)
+{
+	if (cache->nr_cache_blocks + nr_blocks > cache->max_cache_blocks)
+		nr_blocks = cache->max_cache_blocks - cache->nr_cache_blocks;
+
+	if (!nr_blocks)
+		return false;
+
+	if (!_add_chunk(cache, nr_blocks)) {
+		log_debug("bcache unable to grow by %u blocks.", (unsigned) nr_blocks);
+		return false;
+	}
+
+	cache->grows++;
+	log_debug("bcache grown to %u blocks.", (unsigned) cache->nr_cache_blocks);
+
+	return true;
 }
 
 static struct block *_alloc_block(struct bcache *cache)
@@ -983,7 +1543,18 @@ static struct block *_new_block(struct bcache *cache, int di, block_address i, b
 
 	b = _alloc_block(cache);
 	while (!b) {
+		/*
+		 * Prefetched blocks are clean and unused until the caller gets
+		 * them, so a prefetch grows the pool rather than recycling them.
+		 */
+		if (!can_wait && _grow(cache, cache->nr_cache_blocks)) {
+			b = _alloc_block(cache);
+			continue;
+		}
+
 		b = _find_unused_clean_block(cache);
+		if (!b && can_wait && _grow(cache, cache->nr_cache_blocks))
+			b = _alloc_block(cache);
 		if (!b) {
 			if (can_wait) {
 				if (dm_list_empty(&cache->io_pending))
@@ -1123,8 +1694,8 @@ static void _preemptive_writeback(struct bcache *cache)
 /*----------------------------------------------------------------
  * Public interface
  *--------------------------------------------------------------*/
-struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
-			     struct io_engine *engine)
+struct bcache *bcache_create_elastic(sector_t block_sectors, unsigned nr_cache_blocks,
+				     unsigned max_cache_blocks, struct io_engine *engine)
 {
 	static long _pagesize = 0;
 	struct bcache *cache;
@@ -1141,6 +1712,9 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 		return NULL;
 	}
 
+	if (max_cache_blocks < nr_cache_blocks)
+		max_cache_blocks = nr_cache_blocks;
+
 	if (!block_sectors) {
 		log_warn("bcache must have a non zero block size");
 		return NULL;
@@ -1156,8 +1730,12 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 		return NULL;
 
 	cache->block_sectors = block_sectors;
-	cache->nr_cache_blocks = nr_cache_blocks;
-	cache->max_io = nr_cache_blocks < max_io ? nr_cache_blocks : max_io;
+	cache->nr_cache_blocks = 0;
+	cache->min_cache_blocks = nr_cache_blocks;
+	cache->max_cache_blocks = max_cache_blocks;
+	cache->engine_max_io = max_io;
+	cache->page_size = (unsigned) _pagesize;
+	_update_max_io(cache);
 	cache->engine = engine;
 	cache->nr_locked = 0;
 	cache->nr_dirty = 0;
@@ -1168,6 +1746,7 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 	dm_list_init(&cache->dirty);
 	dm_list_init(&cache->clean);
 	dm_list_init(&cache->io_pending);
+	dm_list_init(&cache->chunks);
 
         cache->rtree = radix_tree_create(NULL, NULL);
 	if (!cache->rtree) {
@@ -1182,29 +1761,48 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 	cache->write_hits = 0;
 	cache->write_misses = 0;
 	cache->prefetches = 0;
+	cache->grows = 0;
+	cache->shrinks = 0;
 
-	if (!_init_free_list(cache, nr_cache_blocks, _pagesize)) {
+	if (!_add_chunk(cache, nr_cache_blocks)) {
 		cache->engine->destroy(cache->engine);
 		radix_tree_destroy(cache->rtree);
 		free(cache);
 		return NULL;
 	}
 
-	_fd_table_size = FD_TABLE_INC;
+	/* Only the initial chunk, which is never released, is registered. */
+	_uring_register_pool(engine, dm_list_item(dm_list_first(&cache->chunks), struct block_chunk)->data,
+			     nr_cache_blocks * (block_sectors << SECTOR_SHIFT));
 
-	if (!(_fd_table = malloc(sizeof(int) * _fd_table_size))) {
-		cache->engine->destroy(cache->engine);
-		radix_tree_destroy(cache->rtree);
-		free(cache);
-		return NULL;
-	}
+	/*
+	 * Caches with different block sizes can exist side by side and
+	 * share the di numbers of the fd table.
+	 */
+	if (!_fd_table_users++) {
+		_fd_table_size = FD_TABLE_INC;
+
+		if (!(_fd_table = malloc(sizeof(int) * _fd_table_size))) {
+			_fd_table_users--;
+			cache->engine->destroy(cache->engine);
+			radix_tree_destroy(cache->rtree);
+			free(cache);
+			return NULL;
+		}
 
-	for (i = 0; i < _fd_table_size; i++)
-		_fd_table[i] = -1;
+		for (i = 0; i < _fd_table_size; i++)
+			_fd_table[i] = -1;
+	}
 
 	return cache;
 }
 
+struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
+			     struct io_engine *engine)
+{
+	return bcache_create_elastic(block_sectors, nr_cache_blocks, nr_cache_blocks, engine);
+}
+
 void bcache_destroy(struct bcache *cache)
 {
 	if (cache->nr_locked)
@@ -1216,9 +1814,15 @@ void bcache_destroy(struct bcache *cache)
 	radix_tree_destroy(cache->rtree);
 	cache->engine->destroy(cache->engine);
 	free(cache);
-	free(_fd_table);
-	_fd_table = NULL;
-	_fd_table_size = 0;
+
+	if (!--_fd_table_users) {
+		free(_fd_table);
+		_fd_table = NULL;
+		_fd_table_size = 0;
+		free(_last_bytes);
+		_last_bytes = NULL;
+		_last_bytes_count = _last_bytes_size = 0;
+	}
 }
 
 sector_t bcache_block_sectors(struct bcache *cache)
@@ -1236,6 +1840,135 @@ unsigned bcache_max_prefetches(struct bcache *cache)
 	return cache->max_io;
 }
 
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats)
+{
+	stats->nr_cache_blocks = cache->nr_cache_blocks;
+	stats->read_hits = cache->read_hits;
+	stats->read_misses = cache->read_misses;
+	stats->write_zeroes = cache->write_zeroes;
+	stats->write_hits = cache->write_hits;
+	stats->write_misses = cache->write_misses;
+	stats->prefetches = cache->prefetches;
+	stats->grows = cache->grows;
+	stats->shrinks = cache->shrinks;
+}
+
+bool bcache_grow(struct bcache *cache, unsigned nr_cache_blocks)
+{
+	uint64_t want = nr_cache_blocks;
+
+	if (want > cache->max_cache_blocks)
+		want = cache->max_cache_blocks;
+
+	if ((want > cache->nr_cache_blocks) &&
+	    !_grow(cache, want - cache->nr_cache_blocks))
+		return false;
+
+	/* Keep what was asked for explicitly over bcache_shrink(). */
+	if (want > cache->min_cache_blocks)
+		cache->min_cache_blocks = cache->nr_cache_blocks;
+
+	return cache->nr_cache_blocks >= nr_cache_blocks;
+}
+
+static struct block *_alloc_block_outside(struct bcache *cache, struct block_chunk *c)
+{
+	struct block *b;
+
+	dm_list_iterate_items (b, &cache->free)
+		if (!_in_chunk(c, b)) {
+			dm_list_del(&b->list);
+			return b;
+		}
+
+	return NULL;
+}
+
+static bool _chunk_pinned(struct block_chunk *c, struct dm_list *head)
+{
+	struct block *b;
+
+	dm_list_iterate_items (b, head)
+		if (_in_chunk(c, b) && ((head != &b->cache->clean) || b->ref_count))
+			return true;
+
+	return false;
+}
+
+/*
+ * Release a chunk whose blocks are all free or clean and unheld.
+ * Clean blocks are copied to free blocks in other chunks so that
+ * the cached data survives, or dropped if there is no room.
+ */
+static bool _release_chunk(struct bcache *cache, struct block_chunk *c)
+{
+	struct block *b, *tmp, *nb;
+	size_t block_size = cache->block_sectors << SECTOR_SHIFT;
+
+	if (_chunk_pinned(c, &cache->clean) ||
+	    _chunk_pinned(c, &cache->dirty) ||
+	    _chunk_pinned(c, &cache->io_pending) ||
+	    _chunk_pinned(c, &cache->errored))
+		return false;
+
+	dm_list_iterate_items_safe (b, tmp, &cache->clean) {
+		if (!_in_chunk(c, b))
+			continue;
+
+		_unlink_block(b);
+		_block_remove(b);
+
+		if ((nb = _alloc_block_outside(cache, c))) {
+			memcpy(nb->data, b->data, block_size);
+			dm_list_init(&nb->list);
+			nb->flags = 0;
+			nb->di = b->di;
+			nb->index = b->index;
+			nb->ref_count = 0;
+			nb->error = 0;
+			nb->io_dir = b->io_dir;
+
+			if (_block_insert(nb))
+				_link_block(nb);
+			else
+				_free_block(nb);
+		}
+
+		_free_block(b);
+	}
+
+	dm_list_iterate_items_safe (b, tmp, &cache->free)
+		if (_in_chunk(c, b))
+			dm_list_del(&b->list);
+
+	cache->nr_cache_blocks -= c->nr_blocks;
+	_free_chunk(c);
+
+	return true;
+}
+
+void bcache_shrink(struct bcache *cache)
+{
+	struct dm_list *l, *prev;
+	struct block_chunk *c;
+	unsigned released = 0;
+
+	/* Newest chunks first, the initial chunk is never released. */
+	for (l = cache->chunks.p; l != cache->chunks.n; l = prev) {
+		prev = l->p;
+		c = dm_list_item(l, struct block_chunk);
+		if (cache->nr_cache_blocks - c->nr_blocks < cache->min_cache_blocks)
+			continue;
+		if (_release_chunk(cache, c))
+			released++;
+	}
+
+	if (released) {
+		cache->shrinks++;
+		log_debug("bcache shrunk to %u blocks.", (unsigned) cache->nr_cache_blocks);
+	}
+}
+
 void bcache_prefetch(struct bcache *cache, int di, block_address i)
 {
 	struct block *b = _block_lookup(cache, di, i);
@@ -1481,22 +2214,64 @@ void bcache_abort_di(struct bcache *cache, int di)
 
 //----------------------------------------------------------------
 
+bool bcache_add_last_byte(struct bcache *cache, int di, uint64_t offset, int sector_size)
+{
+	struct last_byte *lb;
+	unsigned i, size;
+
+	if (!offset)
+		return true;
+
+	for (i = 0; i < _last_bytes_count; i++)
+		if ((_last_bytes[i].di == di) && (_last_bytes[i].offset == offset)) {
+			_last_bytes[i].sector_size = sector_size ? : 512;
+			return true;
+		}
+
+	if (_last_bytes_count == _last_bytes_size) {
+		size = _last_bytes_size ? _last_bytes_size * 2 : 16;
+		if (!(lb = realloc(_last_bytes, size * sizeof(*lb))))
+			return false;
+		_last_bytes = lb;
+		_last_bytes_size = size;
+	}
+
+	lb = &_last_bytes[_last_bytes_count++];
+	lb->di = di;
+	lb->offset = offset;
+	lb->sector_size = sector_size ? : 512;
+
+	return true;
+}
+
 void bcache_set_last_byte(struct bcache *cache, int di, uint64_t offset, int sector_size)
 {
-	_last_byte_di = di;
-	_last_byte_offset = offset;
-	_last_byte_sector_size = sector_size;
-	if (!sector_size)
-		_last_byte_sector_size = 512;
+	_last_bytes_count = 0;
+
+	if (!bcache_add_last_byte(cache, di, offset, sector_size))
+		log_warn("WARNING: Failed to limit writes to %llu.", (unsigned long long)offset);
 }
 
 void bcache_unset_last_byte(struct bcache *cache, int di)
 {
-	if (_last_byte_di == di) {
-		_last_byte_di = 0;
-		_last_byte_offset = 0;
-		_last_byte_sector_size = 0;
-	}
+	unsigned i = 0;
+
+	while (i < _last_bytes_count)
+		if (_last_bytes[i].di == di)
+			_last_bytes[i] = _last_bytes[--_last_bytes_count];
+		else
+			i++;
+}
+
+bool bcache_has_errors_di(struct bcache *cache, int di)
+{
+	struct block *b;
+
+	dm_list_iterate_items(b, &cache->errored)
+		if (b->di == di)
+			return true;
+
+	return false;
 }
 
 int bcache_set_fd(int fd)
@@ -1544,6 +2319,7 @@ void bcache_clear_fd(int di)
 {
 	if (di >= _fd_table_size)
 		return;
+	_uring_release_fd(di);
 	_fd_table[di] = -1;
 }
 
@@ -1555,6 +2331,7 @@ int bcache_change_fd(int di, int fd)
 		log_error(INTERNAL_ERROR "Cannot change not opened DI with FD:%d", fd);
 		return 0;
 	}
+	_uring_release_fd(di);
 	_fd_table[di] = fd;
 	return 1;
 }
@@ -42,6 +42,7 @@ struct io_engine {
 
 struct io_engine *create_async_io_engine(void);
 struct io_engine *create_sync_io_engine(void);
+struct io_engine *create_io_uring_engine(void);
 
 /*----------------------------------------------------------------*/
 
@@ -66,6 +67,15 @@ struct block {
  */
 struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 			     struct io_engine *engine);
+
+/*
+ * An elastic cache starts with nr_cache_blocks and grows, up to
+ * max_cache_blocks, instead of recycling blocks that are still needed
+ * or waiting for io when it runs out.  bcache_shrink() gives the extra
+ * memory back.
+ */
+struct bcache *bcache_create_elastic(sector_t block_sectors, unsigned nr_cache_blocks,
+				     unsigned max_cache_blocks, struct io_engine *engine);
 void bcache_destroy(struct bcache *cache);
 
 enum bcache_get_flags {
@@ -87,6 +97,34 @@ sector_t bcache_block_sectors(struct bcache *cache);
 unsigned bcache_nr_cache_blocks(struct bcache *cache);
 unsigned bcache_max_prefetches(struct bcache *cache);
 
+/*
+ * Grow an elastic cache to at least nr_cache_blocks, or to its maximum
+ * size if that is smaller, and keep it at least that big.  Returns false
+ * if the cache is still smaller than nr_cache_blocks, i.e. the maximum
+ * size is smaller or memory could not be allocated.
+ */
+bool bcache_grow(struct bcache *cache, unsigned nr_cache_blocks);
+
+/*
+ * Release the blocks added by growing, as far as they are not held,
+ * dirty or in flight.  Cached data is kept where there is room.
+ */
+void bcache_shrink(struct bcache *cache);
+
+struct bcache_stats {
+	unsigned nr_cache_blocks;
+	unsigned read_hits;
+	unsigned read_misses;
+	unsigned write_zeroes;
+	unsigned write_hits;
+	unsigned write_misses;
+	unsigned prefetches;
+	unsigned grows;
+	unsigned shrinks;
+};
+
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats);
+
 /*
  * Use the prefetch method to take advantage of asynchronous IO.  For example,
  * if you wanted to read a block from many devices concurrently you'd do
@@ -158,9 +196,19 @@ bool bcache_zero_bytes(struct bcache *cache, int di, uint64_t start, size_t len)
 bool bcache_set_bytes(struct bcache *cache, int di, uint64_t start, size_t len, uint8_t val);
 bool bcache_invalidate_bytes(struct bcache *cache, int di, uint64_t start, size_t len);
 
+/*
+ * Limit writes of blocks to a device so they end at offset.
+ * bcache_set_last_byte() replaces all limits, bcache_add_last_byte() adds
+ * one for writes that are queued for several areas of a device before a
+ * flush; each block is then limited by the nearest limit at or after it.
+ */
 void bcache_set_last_byte(struct bcache *cache, int di, uint64_t offset, int sector_size);
+bool bcache_add_last_byte(struct bcache *cache, int di, uint64_t offset, int sector_size);
 void bcache_unset_last_byte(struct bcache *cache, int di);
 
+/* True if writes of blocks of the device failed in the last flush. */
+bool bcache_has_errors_di(struct bcache *cache, int di);
+
 //----------------------------------------------------------------
 
 int bcache_set_fd(int fd); /* returns di */
@@ -18,6 +18,7 @@
 #include "lib/misc/lib.h"
 #include "lib/device/dev-type.h"
 #include "lib/device/device_id.h"
+#include "lib/device/dev-sysfs.h"
 #include "lib/label/label.h"
 #include "lib/config/config.h"
 #include "lib/commands/toolcontext.h"
@@ -33,8 +34,11 @@
 #include <dirent.h>
 #include <locale.h>
 #include <time.h>
+#include <poll.h>
 /* coverity[unnecessary_header] needed for MuslC */
 #include <sys/file.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 
 struct dev_iter {
 	union radix_value *values;
@@ -68,6 +72,12 @@ static struct {
 	struct dm_list dirs;
 	struct dm_list files;
 
+	/* See "Device events" below. */
+	int events_fd;
+	int events_rescan;
+#ifdef UDEV_SYNC_SUPPORT
+	struct udev_monitor *events_monitor;
+#endif
 } _cache;
 
 #define _zalloc(x) dm_pool_zalloc(_cache.mem, (x))
@@ -190,28 +200,25 @@ static int _apply_builtin_path_preference_rules(const char *path0, const char *p
 static int _compare_paths(const char *path0, const char *path1)
 {
 	int slash0 = 0, slash1 = 0;
-	int m0, m1;
+	const char *paths[2] = { path0, path1 };
+	int m[2];
 	const char *p;
 	char p0[PATH_MAX], p1[PATH_MAX];
 	char *s0, *s1;
 	struct stat stat0, stat1;
 	int r;
 
-	/*
-	 * FIXME Better to compare patterns one-at-a-time against all names.
-	 */
 	if (_cache.preferred_names_matcher) {
-		m0 = dm_regex_match(_cache.preferred_names_matcher, path0);
-		m1 = dm_regex_match(_cache.preferred_names_matcher, path1);
+		dm_regex_match_many(_cache.preferred_names_matcher, paths, 2, m);
 
-		if (m0 != m1) {
-			if (m0 < 0)
+		if (m[0] != m[1]) {
+			if (m[0] < 0)
 				return 1;
-			if (m1 < 0)
+			if (m[1] < 0)
 				return 0;
-			if (m0 < m1)
+			if (m[0] < m[1])
 				return 1;
-			if (m1 < m0)
+			if (m[1] < m[0])
 				return 0;
 		}
 	}
@@ -1197,15 +1204,320 @@ static void _drop_all_aliases(struct device *dev)
 	}
 }
 
-void dev_cache_scan(struct cmd_context *cmd)
+/*
+ * Device events
+ *
+ * A long running process (lvm shell, liblvm2cmd) keeps dev-cache between
+ * commands, but each command scans the device directories again.  With
+ * devices/update_device_list_from_events, the first scan also starts
+ * listening to uevents for block devices, and the following scans apply
+ * the devices added, changed and removed since the previous scan instead
+ * of walking the directories.
+ *
+ * udev events carry the device node and all its symlinks once udev has
+ * processed the device, so they are applied directly.  Kernel events only
+ * name the node in /dev, so a device added or changed makes the next
+ * scan a full one, and only removal is applied directly.  Lost events
+ * (the socket buffer overflowed) also make the next scan a full one.
+ */
+
+#define DEV_EVENTS_BUFFER_SIZE (4 * 1024 * 1024)
+
+static void _dev_events_close(void)
 {
-	log_debug_devs("Creating list of system devices.");
+#ifdef UDEV_SYNC_SUPPORT
+	if (_cache.events_monitor) {
+		udev_monitor_unref(_cache.events_monitor);
+		_cache.events_monitor = NULL;
+		_cache.events_fd = -1;
+	}
+#endif
+	if (_cache.events_fd >= 0 && close(_cache.events_fd))
+		log_sys_debug("close", "uevent socket");
+
+	_cache.events_fd = -1;
+}
+
+static int _dev_events_open_kernel(void)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = 1,	/* kernel uevents */
+	};
+	int size = DEV_EVENTS_BUFFER_SIZE;
+	int fd;
+
+	if ((fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			 NETLINK_KOBJECT_UEVENT)) < 0) {
+		log_sys_debug("socket", "uevent");
+		return 0;
+	}
+
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) &&
+	    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)))
+		log_sys_debug("setsockopt", "uevent");
+
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+		log_sys_debug("bind", "uevent");
+		if (close(fd))
+			stack;
+		return 0;
+	}
+
+	_cache.events_fd = fd;
+
+	return 1;
+}
+
+#ifdef UDEV_SYNC_SUPPORT
+static int _dev_events_open_udev(struct udev *udev)
+{
+	struct udev_monitor *mon;
+
+	if (!(mon = udev_monitor_new_from_netlink(udev, "udev"))) {
+		log_debug_devs("Failed to create udev monitor.");
+		return 0;
+	}
+
+	if (udev_monitor_filter_add_match_subsystem_devtype(mon, "block", NULL) ||
+	    udev_monitor_enable_receiving(mon)) {
+		log_debug_devs("Failed to enable udev monitor.");
+		udev_monitor_unref(mon);
+		return 0;
+	}
+
+	(void) udev_monitor_set_receive_buffer_size(mon, DEV_EVENTS_BUFFER_SIZE);
+
+	_cache.events_monitor = mon;
+	_cache.events_fd = udev_monitor_get_fd(mon);
+
+	return 1;
+}
+#endif
+
+static int _dev_events_open(void)
+{
+#ifdef UDEV_SYNC_SUPPORT
+	struct udev *udev;
+
+	if (obtain_device_list_from_udev() && (udev = udev_get_library_context()))
+		return _dev_events_open_udev(udev);
+#endif
+	return _dev_events_open_kernel();
+}
+
+static void _dev_event_remove(dev_t devno)
+{
+	struct device *dev;
+	uint32_t key = _shuffle_devno(devno);
+
+	if (!(dev = _dev_cache_get_dev_by_devno(_cache.devices, devno)))
+		return;
+
+	log_debug_devs("Device event: remove %u:%u %s.", MAJOR(devno), MINOR(devno), dev_name(dev));
+
+	if (dev->fd >= 0 && !dev_close_immediate(dev))
+		stack;
+
+	_drop_all_aliases(dev);
+
+	if (!radix_tree_remove(_cache.devices, &key, sizeof(key)))
+		stack;
+}
+
+#ifdef UDEV_SYNC_SUPPORT
+/*
+ * The device node and symlinks from udev replace the names of the device,
+ * apart from names in other directories that udev does not manage.
+ */
+static void _dev_event_udev(struct udev_device *device)
+{
+	struct udev_list_entry *symlink_entry;
+	struct dm_str_list *strl, *strl2;
+	struct device *dev;
+	const char *action, *node_name, *name;
+	dev_t devno = udev_device_get_devnum(device);
+	int found;
+
+	if (!(action = udev_device_get_action(device)) || !devno)
+		return;
+
+	if (!strcmp(action, "remove")) {
+		_dev_event_remove(devno);
+		return;
+	}
+
+	if (!(node_name = udev_device_get_devnode(device)))
+		return;
 
+	log_debug_devs("Device event: %s %u:%u %s.", action, MAJOR(devno), MINOR(devno), node_name);
+
+	if ((dev = _dev_cache_get_dev_by_devno(_cache.devices, devno))) {
+		dm_list_iterate_items_safe(strl, strl2, &dev->aliases) {
+			if (strncmp(strl->str, _cache.dev_dir, _cache.dev_dir_len) ||
+			    !strcmp(strl->str, node_name))
+				continue;
+			found = 0;
+			udev_list_entry_foreach(symlink_entry, udev_device_get_devlinks_list_entry(device))
+				if ((name = udev_list_entry_get_name(symlink_entry)) &&
+				    !strcmp(strl->str, name)) {
+					found = 1;
+					break;
+				}
+			if (!found)
+				dev_cache_failed_path(dev, strl->str);
+		}
+	}
+
+	(void) _insert(node_name, NULL, 0, 0);
+
+	udev_list_entry_foreach(symlink_entry, udev_device_get_devlinks_list_entry(device))
+		if ((name = udev_list_entry_get_name(symlink_entry)))
+			(void) _insert(name, NULL, 0, 0);
+}
+
+/*
+ * udev_monitor_receive_device() also returns NULL for a message it filters
+ * out, so read while the socket has messages, and rescan if any were lost.
+ */
+static void _dev_events_read_udev(void)
+{
+	struct udev_device *device;
+	struct pollfd pfd = { .fd = _cache.events_fd, .events = POLLIN };
+
+	while (poll(&pfd, 1, 0) > 0) {
+		errno = 0;
+		if ((device = udev_monitor_receive_device(_cache.events_monitor))) {
+			_dev_event_udev(device);
+			udev_device_unref(device);
+			continue;
+		}
+
+		if (errno == ENOBUFS) {
+			log_debug_devs("Device events were lost, scanning devices.");
+			_cache.events_rescan = 1;
+		} else if (!(pfd.revents & POLLIN))
+			break;
+	}
+}
+#endif
+
+/*
+ * A kernel uevent is "ACTION@DEVPATH" followed by KEY=VALUE strings,
+ * each terminated by '\0'.
+ */
+static void _dev_event_kernel(const char *buf, size_t len)
+{
+	const char *end = buf + len;
+	const char *action = NULL, *subsystem = NULL;
+	unsigned major = 0, minor = 0;
+	int have_major = 0, have_minor = 0;
+	const char *p;
+
+	for (p = buf + strlen(buf) + 1; p < end; p += strlen(p) + 1) {
+		if (!strncmp(p, "ACTION=", 7))
+			action = p + 7;
+		else if (!strncmp(p, "SUBSYSTEM=", 10))
+			subsystem = p + 10;
+		else if (!strncmp(p, "MAJOR=", 6))
+			have_major = (sscanf(p + 6, "%u", &major) == 1);
+		else if (!strncmp(p, "MINOR=", 6))
+			have_minor = (sscanf(p + 6, "%u", &minor) == 1);
+	}
+
+	if (!action || !subsystem || strcmp(subsystem, "block") || !have_major || !have_minor)
+		return;
+
+	if (!strcmp(action, "remove"))
+		_dev_event_remove(MKDEV(major, minor));
+	else if (!strcmp(action, "add") || !strcmp(action, "change") ||
+		 !strcmp(action, "move")) {
+		if (!_cache.events_rescan)
+			log_debug_devs("Device event: %s %u:%u, scanning devices.", action, major, minor);
+		_cache.events_rescan = 1;
+	}
+}
+
+static void _dev_events_read_kernel(void)
+{
+	char buf[8192];
+	ssize_t len;
+
+	for (;;) {
+		if ((len = recv(_cache.events_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOBUFS) {
+				log_debug_devs("Device events were lost, scanning devices.");
+				_cache.events_rescan = 1;
+				continue;
+			}
+			if (errno != EAGAIN) {
+				log_sys_debug("recv", "uevent");
+				_dev_events_close();
+				_cache.events_rescan = 1;
+			}
+			break;
+		}
+
+		if (!len)
+			continue;
+
+		buf[len] = '\0';
+		_dev_event_kernel(buf, (size_t) len);
+	}
+}
+
+/*
+ * Returns 1 if dev-cache is up to date with the events since the last
+ * scan, or 0 if the directories need to be scanned.
+ */
+static int _dev_events_apply(struct cmd_context *cmd)
+{
+	if (!cmd->is_long_lived ||
+	    !find_config_tree_bool(cmd, devices_update_device_list_from_events_CFG, NULL)) {
+		if (_cache.events_fd >= 0)
+			_dev_events_close();
+		return 0;
+	}
+
+	if (_cache.events_fd < 0) {
+		/* Listen before scanning so no change is missed. */
+		if (!_dev_events_open())
+			log_debug_devs("Device events are not available, scanning devices.");
+		return 0;
+	}
+
+#ifdef UDEV_SYNC_SUPPORT
+	if (_cache.events_monitor)
+		_dev_events_read_udev();
+	else
+#endif
+		_dev_events_read_kernel();
+
+	if (_cache.events_rescan) {
+		_cache.events_rescan = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+void dev_cache_scan(struct cmd_context *cmd)
+{
 	_cache.has_scanned = 1;
 
+	if (_dev_events_apply(cmd)) {
+		log_debug_devs("Updated list of system devices from events.");
+		goto index;
+	}
+
+	log_debug_devs("Creating list of system devices.");
+
 	setlocale(LC_COLLATE, "C"); /* Avoid sorting by locales */
 	_insert_dirs(&_cache.dirs);
 	setlocale(LC_COLLATE, "");
+ index:
 
 	if (cmd->check_devs_used)
 		(void) _dev_cache_index_devs(cmd);
@@ -1381,6 +1693,15 @@ void dm_devs_cache_label_invalidate(struct cmd_context *cmd)
 	}
 }
 
+/* List of struct dm_active_device, NULL when the cache is not in use */
+const struct dm_list *dm_devs_cache_get_devs(void)
+{
+	if (!_cache.use_dm_devs_cache)
+		return NULL;
+
+	return _cache.dm_devs;
+}
+
 /* Find active DM device in devs array for given major:minor */
 const struct dm_active_device *
 dm_devs_cache_get_by_devno(struct cmd_context *cmd, dev_t devno)
@@ -1406,6 +1727,7 @@ dm_devs_cache_get_by_uuid(struct cmd_context *cmd, const char *dm_uuid)
 int dev_cache_init(struct cmd_context *cmd)
 {
 	_cache.names = NULL;
+	_cache.events_fd = -1;
 
 	if (!(_cache.mem = dm_pool_create("dev_cache", 10 * 1024)))
 		return_0;
@@ -1500,6 +1822,8 @@ int dev_cache_exit(void)
 		.free = 1,            /* free dids, wwids */
 	};
 
+	sysfs_cache_destroy();
+
 	if (_cache.names) {
 		/* check for open devices */
 		radix_tree_iterate(_cache.names, NULL, 0, &vt.it);
@@ -1510,6 +1834,7 @@ int dev_cache_exit(void)
 	}
 
 	dm_devs_cache_destroy();
+	_dev_events_close();
 
 	if (_cache.mem)
 		dm_pool_destroy(_cache.mem);
@@ -1530,6 +1855,7 @@ int dev_cache_exit(void)
 	       radix_tree_destroy(_cache.sysfs_only_devices);
 
 	memset(&_cache, 0, sizeof(_cache));
+	_cache.events_fd = -1;
 
 	return (!vt.num_open);
 }
@@ -1939,6 +2265,8 @@ static int _setup_devices_list(struct cmd_context *cmd)
 		dm_list_add(&cmd->use_devices, &du->list);
 	}
 
+	du_index_invalidate(cmd);
+
 	return 1;
 }
 
@@ -2235,6 +2563,12 @@ int setup_devices(struct cmd_context *cmd)
 	 */
 	dev_cache_scan(cmd);
 
+	/*
+	 * Read the sysfs attributes that device ids and filters use for
+	 * all devs in one pass, so later lookups come from the sysfs cache.
+	 */
+	sysfs_cache_prefetch(cmd);
+
 	/*
 	 * Match entries from cmd->use_devices with device structs in dev-cache.
 	 */
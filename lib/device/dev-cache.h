@@ -32,6 +32,7 @@ struct dev_filter {
 	void *private;
 	unsigned use_count;
 	const char *name;
+	unsigned needs_data:1;	/* checks data read from the device */
 };
 
 void dev_init(struct device *dev);
@@ -57,6 +58,7 @@ const struct dm_active_device *
 dm_devs_cache_get_by_devno(struct cmd_context *cmd, dev_t devno);
 const struct dm_active_device *
 dm_devs_cache_get_by_uuid(struct cmd_context *cmd, const char *dm_uuid);
+const struct dm_list *dm_devs_cache_get_devs(void);
 
 /*
  * The global device cache.
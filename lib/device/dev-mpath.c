@@ -17,6 +17,7 @@
 #include "lib/activate/activate.h"
 #include "lib/commands/toolcontext.h"
 #include "lib/device/device_id.h"
+#include "lib/device/dev-sysfs.h"
 #include "lib/datastruct/str_list.h"
 #include "libdm/misc/dm-ioctl.h"
 #ifdef UDEV_SYNC_SUPPORT
@@ -352,23 +353,18 @@ static const char *_get_sysfs_name(struct device *dev)
  * readlink translates /sys/dev/block/major:minor to /sys/.../foo
  * from /sys/.../foo return "foo"
  */
-static const char *_get_sysfs_name_by_devt(const char *sysfs_dir, dev_t devno,
-					  char *buf, size_t buf_size)
+static const char *_get_sysfs_name_by_devt(dev_t devno, char *buf, size_t buf_size)
 {
 	const char *name;
-	char path[PATH_MAX];
 	int size;
 
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u", sysfs_dir,
-			MAJOR(devno), MINOR(devno)) < 0) {
-		log_error("Sysfs path string is too long.");
-		return NULL;
-	}
-
-	if ((size = readlink(path, buf, buf_size - 1)) < 0) {
-		log_sys_error("readlink", path);
+	if ((size = sysfs_attr_read(devno, "", buf, buf_size - 1)) < 0) {
+		log_error("Failed to read sysfs link of device %u:%u: %s.",
+			  MAJOR(devno), MINOR(devno), strerror(-size));
 		return NULL;
 	}
+	if ((size_t) size > buf_size - 1)
+		size = buf_size - 1;
 	buf[size] = '\0';
 
 	if (!(name = strrchr(buf, '/'))) {
@@ -438,7 +434,7 @@ static int _dev_is_mpath_component_sysfs(struct cmd_context *cmd, struct device
 	case 2: /* The dev is partition. */
 
 		/* gets "foo" for "/dev/foo" where "/dev/foo" comes from major:minor */
-		if (!(name = _get_sysfs_name_by_devt(sysfs_dir, primary_dev, link_path, sizeof(link_path))))
+		if (!(name = _get_sysfs_name_by_devt(primary_dev, link_path, sizeof(link_path))))
 			return_0;
 		break;
 
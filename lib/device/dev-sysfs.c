@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/device/dev-sysfs.h"
+#include "lib/device/dev-cache.h"
+#include "lib/device/dev-type.h"
+#include "lib/commands/toolcontext.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* sysfs attributes are at most a page. */
+#define SYSFS_ATTR_MAX 4096
+
+struct sysfs_attr {
+	int ret;		/* length of data, or -errno */
+	unsigned syscalls;	/* spent reading it */
+	char data[0];
+};
+
+static struct {
+	struct dm_pool *mem;
+	struct dm_hash_table *attrs;
+	struct sysfs_cache_stats stats;
+} _sysfs;
+
+/*
+ * Attributes read for every device by sysfs_cache_prefetch():
+ * the sysfs filter and dev_get_primary_dev() look at the device link,
+ * the partition checks at "partition".
+ */
+static const char * const _prefetch_attrs[] = { "", "partition" };
+
+static int _attr_key(char *key, size_t key_size, dev_t devno, const char *attr)
+{
+	if (dm_snprintf(key, key_size, "%u:%u/%s", MAJOR(devno), MINOR(devno), attr) < 0) {
+		log_warn("WARNING: sysfs path for %s attribute is too long.", attr);
+		return 0;
+	}
+
+	return 1;
+}
+
+static struct sysfs_attr *_read_attr(const char *key)
+{
+	char path[PATH_MAX];
+	char buf[SYSFS_ATTR_MAX];
+	struct sysfs_attr *sa;
+	const char *sysfs_dir = dm_sysfs_dir();
+	size_t key_len = strlen(key);
+	unsigned syscalls;
+	ssize_t len;
+	int fd;
+
+	if (!sysfs_dir || !*sysfs_dir)
+		return NULL;
+
+	if (dm_snprintf(path, sizeof(path), "%sdev/block/%s", sysfs_dir, key) < 0) {
+		log_warn("WARNING: sysfs path %s is too long.", key);
+		return NULL;
+	}
+
+	if (key[key_len - 1] == '/') {
+		/* The device link, without the trailing '/'. */
+		path[strlen(path) - 1] = '\0';
+		syscalls = 1;
+		if ((len = readlink(path, buf, sizeof(buf))) < 0)
+			len = -errno;
+	} else if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+		syscalls = 1;
+		len = -errno;
+	} else {
+		syscalls = 3;
+		if ((len = read(fd, buf, sizeof(buf))) < 0)
+			len = -errno;
+		if (close(fd))
+			log_sys_debug("close", path);
+	}
+
+	if (!_sysfs.mem && !(_sysfs.mem = dm_pool_create("sysfs_cache", 16 * 1024)))
+		return_NULL;
+
+	if (!_sysfs.attrs && !(_sysfs.attrs = dm_hash_create(1024)))
+		return_NULL;
+
+	if (!(sa = dm_pool_alloc(_sysfs.mem, sizeof(*sa) + (len > 0 ? len : 0))))
+		return_NULL;
+
+	sa->ret = (int) len;
+	sa->syscalls = syscalls;
+	if (len > 0)
+		memcpy(sa->data, buf, len);
+
+	if (!dm_hash_insert(_sysfs.attrs, key, sa))
+		return_NULL;
+
+	_sysfs.stats.reads++;
+	_sysfs.stats.syscalls += syscalls;
+
+	return sa;
+}
+
+static struct sysfs_attr *_get_attr(dev_t devno, const char *attr)
+{
+	char key[PATH_MAX];
+	struct sysfs_attr *sa;
+
+	if (!_attr_key(key, sizeof(key), devno, attr))
+		return NULL;
+
+	_sysfs.stats.lookups++;
+
+	if (_sysfs.attrs && (sa = dm_hash_lookup(_sysfs.attrs, key))) {
+		_sysfs.stats.hits++;
+		_sysfs.stats.saved += sa->syscalls;
+		return sa;
+	}
+
+	return _read_attr(key);
+}
+
+int sysfs_attr_read(dev_t devno, const char *attr, char *buf, size_t buf_size)
+{
+	struct sysfs_attr *sa;
+
+	if (!(sa = _get_attr(devno, attr)))
+		return -EINVAL;
+
+	if (buf && (sa->ret > 0))
+		memcpy(buf, sa->data, ((size_t) sa->ret < buf_size) ? (size_t) sa->ret : buf_size);
+
+	return sa->ret;
+}
+
+int sysfs_attr_value(dev_t devno, const char *attr, char *buf, size_t buf_size)
+{
+	struct sysfs_attr *sa;
+	const char *nl;
+	size_t len;
+
+	if (!buf_size)
+		return 0;
+
+	buf[0] = '\0';
+
+	if (!(sa = _get_attr(devno, attr)) || (sa->ret <= 0))
+		return 0;
+
+	len = sa->ret;
+	if ((nl = memchr(sa->data, '\n', len)))
+		len = nl - sa->data;
+	if (len > buf_size - 1)
+		len = buf_size - 1;
+
+	memcpy(buf, sa->data, len);
+	buf[len] = '\0';
+
+	return buf[0] ? 1 : 0;
+}
+
+void sysfs_cache_prefetch(struct cmd_context *cmd)
+{
+	char key[PATH_MAX];
+	struct dev_iter *iter;
+	struct device *dev;
+	unsigned i, reads = _sysfs.stats.reads;
+
+	if (!(iter = dev_iter_create(NULL, 0)))
+		return;
+
+	while ((dev = dev_iter_get(cmd, iter))) {
+		for (i = 0; i < DM_ARRAY_SIZE(_prefetch_attrs); i++) {
+			if (!_attr_key(key, sizeof(key), dev->dev, _prefetch_attrs[i]))
+				continue;
+			if (_sysfs.attrs && dm_hash_lookup(_sysfs.attrs, key))
+				continue;
+			(void) _read_attr(key);
+		}
+
+		/* Partitioning of loop devices depends on partscan. */
+		if ((MAJOR(dev->dev) == cmd->dev_types->loop_major) &&
+		    _attr_key(key, sizeof(key), dev->dev, "loop/partscan") &&
+		    !(_sysfs.attrs && dm_hash_lookup(_sysfs.attrs, key)))
+			(void) _read_attr(key);
+	}
+
+	dev_iter_destroy(iter);
+
+	log_debug_devs("Prefetched %u sysfs attributes.", _sysfs.stats.reads - reads);
+}
+
+void sysfs_cache_get_stats(struct sysfs_cache_stats *stats)
+{
+	*stats = _sysfs.stats;
+}
+
+void sysfs_cache_destroy(void)
+{
+	if (_sysfs.stats.lookups)
+		log_debug_devs("sysfs cache: %u lookups, %u from cache, %u attributes read "
+			       "with %u syscalls, %u syscalls saved.",
+			       _sysfs.stats.lookups, _sysfs.stats.hits, _sysfs.stats.reads,
+			       _sysfs.stats.syscalls, _sysfs.stats.saved);
+
+	if (_sysfs.attrs)
+		dm_hash_destroy(_sysfs.attrs);
+
+	if (_sysfs.mem)
+		dm_pool_destroy(_sysfs.mem);
+
+	memset(&_sysfs, 0, sizeof(_sysfs));
+}
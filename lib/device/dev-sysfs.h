@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_DEV_SYSFS_H
+#define _LVM_DEV_SYSFS_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+struct cmd_context;
+
+/*
+ * Per-command cache of sysfs attributes of block devices, keyed by devno
+ * and attribute name, e.g. "queue/rotational" for
+ * /sys/dev/block/<major>:<minor>/queue/rotational.  The empty attribute
+ * name stands for the /sys/dev/block/<major>:<minor> link itself, and
+ * reading it gives the link target.  Each file is read once per command,
+ * failures included; sysfs_cache_destroy() drops everything.
+ */
+
+/*
+ * Copy up to buf_size bytes of the attribute to buf (buf may be NULL to
+ * check that it exists).  Returns the attribute length, or -errno.
+ */
+int sysfs_attr_read(dev_t devno, const char *attr, char *buf, size_t buf_size);
+
+/*
+ * Copy the first line of the attribute without the newline to buf,
+ * like get_sysfs_value().  Returns 1 if the value is not empty.
+ */
+int sysfs_attr_value(dev_t devno, const char *attr, char *buf, size_t buf_size);
+
+/*
+ * Read the attributes the device filters look at for all devices in
+ * dev-cache in one pass, before the filters ask for them one by one.
+ */
+void sysfs_cache_prefetch(struct cmd_context *cmd);
+
+struct sysfs_cache_stats {
+	unsigned lookups;	/* attribute lookups by callers */
+	unsigned hits;		/* lookups answered from the cache */
+	unsigned reads;		/* attributes read from sysfs */
+	unsigned syscalls;	/* syscalls made to read them */
+	unsigned saved;		/* syscalls the hits would have made */
+};
+
+void sysfs_cache_get_stats(struct sysfs_cache_stats *stats);
+
+void sysfs_cache_destroy(void);
+
+#endif
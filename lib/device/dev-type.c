@@ -15,6 +15,7 @@
 #include "base/memory/zalloc.h"
 #include "lib/misc/lib.h"
 #include "lib/device/dev-type.h"
+#include "lib/device/dev-sysfs.h"
 #include "lib/device/device-types.h"
 #include "lib/device/filesystem.h"
 #include "lib/mm/xlate.h"
@@ -475,63 +476,38 @@ int major_is_scsi_device(struct dev_types *dt, int major)
 
 static int _loop_is_with_partscan(struct device *dev)
 {
-	FILE *fp;
 	int partscan = 0;
-	char path[PATH_MAX];
 	char buffer[64];
 
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u/loop/partscan",
-			dm_sysfs_dir(), MAJOR(dev->dev), MINOR(dev->dev)) < 0) {
-		log_warn("Sysfs path for partscan is too long.");
-		return 0;
-	}
-
-	if (!(fp = fopen(path, "r")))
+	if (sysfs_attr_read(dev->dev, "loop/partscan", NULL, 0) < 0)
 		return 0; /* not there -> no partscan */
 
-	if (!fgets(buffer, sizeof(buffer), fp)) {
-		log_warn("Failed to read %s.", path);
+	if (!sysfs_attr_value(dev->dev, "loop/partscan", buffer, sizeof(buffer))) {
+		log_warn("Failed to read loop/partscan of %s.", dev_name(dev));
 	} else if (sscanf(buffer, "%d", &partscan) != 1) {
-		log_warn("Failed to parse %s '%s'.", path, buffer);
+		log_warn("Failed to parse loop/partscan of %s '%s'.", dev_name(dev), buffer);
 		partscan = 0;
 	}
 
-	if (fclose(fp))
-		log_sys_debug("fclose", path);
-
 	return partscan;
 }
 
 int dev_get_partition_number(struct device *dev, int *num)
 {
-	char path[PATH_MAX];
 	char buf[8] = { 0 };
-	dev_t devt = dev->dev;
-	struct stat sb;
 
 	if (dev->part != -1) {
 		*num = dev->part;
 		return 1;
 	}
 
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u/partition",
-			dm_sysfs_dir(), MAJOR(devt), MINOR(devt)) < 0) {
-		log_error("Failed to create sysfs path for %s", dev_name(dev));
-		return 0;
-	}
-
-	if (stat(path, &sb)) {
+	if (sysfs_attr_read(dev->dev, "partition", NULL, 0) < 0) {
 		dev->part = 0;
 		*num = 0;
 		return 1;
 	}
 
-	if (!get_sysfs_value(path, buf, sizeof(buf), 0)) {
-		log_error("Failed to read sysfs path for %s", dev_name(dev));
-		return 0;
-	}
-
-	if (!buf[0]) {
+	if (!sysfs_attr_value(dev->dev, "partition", buf, sizeof(buf))) {
 		log_error("Failed to read sysfs partition value for %s", dev_name(dev));
 		return 0;
 	}
@@ -566,21 +542,13 @@ struct partition {
 
 static int _has_sys_partition(struct device *dev)
 {
-	char path[PATH_MAX];
-	struct stat info;
-	unsigned major = MAJOR(dev->dev);
-	unsigned minor = MINOR(dev->dev);
+	int r;
 
 	/* check if dev is a partition */
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u/partition",
-			dm_sysfs_dir(), major, minor) < 0) {
-		log_warn("WARNING: %s: partition path is too long.", dev_name(dev));
-		return 0;
-	}
-
-	if (stat(path, &info) == -1) {
-		if (errno != ENOENT)
-			log_sys_debug("stat", path);
+	if ((r = sysfs_attr_read(dev->dev, "partition", NULL, 0)) < 0) {
+		if (r != -ENOENT)
+			log_debug("%s: Failed to read sysfs partition: %s",
+				  dev_name(dev), strerror(-r));
 		return 0;
 	}
 	return 1;
@@ -825,7 +793,6 @@ int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result)
 {
 	unsigned major = MAJOR(dev->dev);
 	unsigned minor = MINOR(dev->dev);
-	char path[PATH_MAX];
 	char path2[PATH_MAX];
 	char temp_path[PATH_MAX];
 	char buffer[64];
@@ -875,15 +842,12 @@ int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result)
 	 * - basename ../../block/md0/md0  = md0
 	 * Parent's 'dev' sysfs attribute  = /sys/block/md0/dev
 	 */
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u",
-			dm_sysfs_dir(), major, minor) < 0) {
-		log_warn("WARNING: %s: major:minor sysfs path is too long.", dev_name(dev));
-		return 0;
-	}
-	if ((size = readlink(path, temp_path, sizeof(temp_path) - 1)) < 0) {
-		log_warn("WARNING: Readlink of %s failed.", path);
+	if ((size = sysfs_attr_read(dev->dev, "", temp_path, sizeof(temp_path) - 1)) < 0) {
+		log_warn("WARNING: Readlink of sysfs %u:%u failed: %s.", major, minor, strerror(-size));
 		goto out;
 	}
+	if (size > (int) sizeof(temp_path) - 1)
+		size = sizeof(temp_path) - 1;
 
 	temp_path[size] = '\0';
 
@@ -1335,80 +1299,57 @@ int wipe_known_signatures(struct cmd_context *cmd, struct device *dev,
 
 #ifdef __linux__
 
-static int _snprintf_attr(char *buf, size_t buf_size, const char *sysfs_dir,
-			 const char *attribute, dev_t dev)
-{
-	if (dm_snprintf(buf, buf_size, "%sdev/block/%u:%u/%s", sysfs_dir,
-			MAJOR(dev), MINOR(dev),	attribute) < 0) {
-		log_warn("WARNING: sysfs path for %s attribute is too long.", attribute);
-		return 0;
-	}
-
-	return 1;
-}
-
 static int _dev_sysfs_block_attribute(struct dev_types *dt,
 				      const char *attribute,
 				      struct device *dev,
 				      unsigned long *value)
 {
 	const char *sysfs_dir = dm_sysfs_dir();
-	char path[PATH_MAX], buffer[64];
-	FILE *fp;
-	dev_t primary = 0;
-	int ret = 0;
+	char buffer[64];
+	dev_t devno = dev->dev;
+	int r;
 
 	if (!attribute || !*attribute)
-		goto_out;
+		return_0;
 
 	if (!sysfs_dir || !*sysfs_dir)
-		goto_out;
-
-	if (!_snprintf_attr(path, sizeof(path), sysfs_dir, attribute, dev->dev))
-		goto_out;
+		return_0;
 
 	/*
 	 * check if the desired sysfs attribute exists
 	 * - if not: either the kernel doesn't have topology support
 	 *   or the device could be a partition
 	 */
-	if (!(fp = fopen(path, "r"))) {
-		if (errno != ENOENT) {
-			log_sys_debug("fopen", path);
-			goto out;
+	if ((r = sysfs_attr_read(devno, attribute, NULL, 0)) < 0) {
+		if (r != -ENOENT) {
+			log_debug("%s: Failed to read sysfs attribute %s: %s",
+				  dev_name(dev), attribute, strerror(-r));
+			return 0;
 		}
-		if (!dev_get_primary_dev(dt, dev, &primary))
-			goto out;
+		if (!dev_get_primary_dev(dt, dev, &devno))
+			return 0;
 
 		/* get attribute from partition's primary device */
-		if (!_snprintf_attr(path, sizeof(path), sysfs_dir, attribute, primary))
-			goto_out;
-
-		if (!(fp = fopen(path, "r"))) {
-			if (errno != ENOENT)
-				log_sys_debug("fopen", path);
-			goto out;
+		if ((r = sysfs_attr_read(devno, attribute, NULL, 0)) < 0) {
+			if (r != -ENOENT)
+				log_debug("%s: Failed to read sysfs attribute %s: %s",
+					  dev_name(dev), attribute, strerror(-r));
+			return 0;
 		}
 	}
 
-	if (!fgets(buffer, sizeof(buffer), fp)) {
-		log_sys_debug("fgets", path);
-		goto out_close;
+	if (!sysfs_attr_value(devno, attribute, buffer, sizeof(buffer))) {
+		log_debug("%s: Empty sysfs attribute %s.", dev_name(dev), attribute);
+		return 0;
 	}
 
 	if (sscanf(buffer, "%lu", value) != 1) {
-		log_warn("WARNING: sysfs file %s not in expected format: %s", path, buffer);
-		goto out_close;
+		log_warn("WARNING: sysfs attribute %s of %u:%u not in expected format: %s",
+			 attribute, MAJOR(devno), MINOR(devno), buffer);
+		return 0;
 	}
 
-	ret = 1;
-
-out_close:
-	if (fclose(fp))
-		log_sys_debug("fclose", path);
-
-out:
-	return ret;
+	return 1;
 }
 
 static unsigned long _dev_topology_attribute(struct dev_types *dt,
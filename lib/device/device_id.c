@@ -13,9 +13,11 @@
  */
 
 #include "base/memory/zalloc.h"
+#include "lib/datastruct/radix-tree.h"
 #include "lib/misc/lib.h"
 #include "lib/device/device_id.h"
 #include "lib/device/dev-type.h"
+#include "lib/device/dev-sysfs.h"
 #include "lib/label/label.h"
 #include "lib/misc/crc.h"
 #include "lib/metadata/metadata.h"
@@ -483,7 +485,17 @@ static int _read_sys_block(struct cmd_context *cmd, struct device *dev,
 		return 0;
 	}
 
-	if (binary) {
+	if (!cmd->device_id_sysfs_dir) {
+		/* Reads of the real sysfs go through the per-command cache. */
+		if (binary) {
+			if ((ret = sysfs_attr_read(devt, suffix, sysbuf, sysbufsize)) > 0) {
+				*retlen = (ret > sysbufsize) ? sysbufsize : ret;
+				ret = 1;
+			} else
+				ret = 0;
+		} else
+			ret = sysfs_attr_value(devt, suffix, sysbuf, sysbufsize);
+	} else if (binary) {
 		ret = get_sysfs_binary(path, sysbuf, sysbufsize, retlen);
 		if (ret && !*retlen)
 			ret = 0;
@@ -1479,6 +1491,8 @@ int device_ids_read(struct cmd_context *cmd)
 	if (fclose(fp))
 		stack;
 
+	du_index_invalidate(cmd);
+
 	log_debug("Devices file comment hash %u calc hash %u", comment_hash, hash);
 
 	if (ignore_hash)
@@ -1763,6 +1777,7 @@ int device_ids_write(struct cmd_context *cmd)
 		if (lvmcache_vg_info_count()) {
 			log_print_unless_silent("Not creating system devices file due to existing VGs.");
 			free_dus(&cmd->use_devices);
+			du_index_invalidate(cmd);
 			return 1;
 		}
 		log_print_unless_silent("Creating devices file %s", cmd->devices_file_path);
@@ -2044,10 +2059,181 @@ int device_ids_use_lvmlv(struct cmd_context *cmd)
 	return 0;
 }
 
+/*
+ * Indexes over cmd->use_devices so that the get_du_for_*() lookups do not
+ * walk the list for every device.  The index is built on the first lookup
+ * and rebuilt on the next lookup after du_index_invalidate(), which must be
+ * called whenever entries are added, removed, or have dev, pvid, devname,
+ * idtype or idname changed.  Where several entries share a key, the first
+ * one in the list is indexed, which is what a walk of the list would find.
+ */
+#define DU_INDEX_MIN_ENTRIES 16
+
+struct dev_use_index {
+	int valid;
+	int linear;		/* too few entries to be worth indexing */
+	struct radix_tree *by_dev;
+	struct radix_tree *by_devno;
+	struct radix_tree *by_pvid;
+	struct radix_tree *by_devname;
+	struct radix_tree *by_device_id;
+};
+
+/* idtype followed by idname */
+#define DEVICE_ID_KEY_MAX (sizeof(uint16_t) + PATH_MAX)
+
+static size_t _device_id_key(char *key, uint16_t idtype, const char *idname)
+{
+	size_t len = strlen(idname);
+
+	if (len > PATH_MAX)
+		return 0;
+
+	memcpy(key, &idtype, sizeof(idtype));
+	memcpy(key + sizeof(idtype), idname, len);
+
+	return sizeof(idtype) + len;
+}
+
+static void _du_index_destroy_trees(struct dev_use_index *idx)
+{
+	if (idx->by_dev)
+		radix_tree_destroy(idx->by_dev);
+	if (idx->by_devno)
+		radix_tree_destroy(idx->by_devno);
+	if (idx->by_pvid)
+		radix_tree_destroy(idx->by_pvid);
+	if (idx->by_devname)
+		radix_tree_destroy(idx->by_devname);
+	if (idx->by_device_id)
+		radix_tree_destroy(idx->by_device_id);
+
+	idx->by_dev = idx->by_devno = idx->by_pvid = NULL;
+	idx->by_devname = idx->by_device_id = NULL;
+}
+
+static int _du_index_first(struct radix_tree *rt, const void *key, size_t keylen,
+			   struct dev_use *du)
+{
+	if (radix_tree_lookup_ptr(rt, key, keylen))
+		return 1;
+
+	return radix_tree_insert_ptr(rt, key, keylen, du);
+}
+
+static int _du_index_add(struct dev_use_index *idx, struct dev_use *du)
+{
+	char key[DEVICE_ID_KEY_MAX];
+	size_t keylen;
+
+	if (du->dev &&
+	    (!_du_index_first(idx->by_dev, &du->dev, sizeof(du->dev), du) ||
+	     !_du_index_first(idx->by_devno, &du->dev->dev, sizeof(du->dev->dev), du)))
+		return_0;
+
+	if (du->pvid && !_du_index_first(idx->by_pvid, du->pvid, ID_LEN, du))
+		return_0;
+
+	if (du->devname && !_du_index_first(idx->by_devname, du->devname, strlen(du->devname), du))
+		return_0;
+
+	if (du->idname) {
+		if (!(keylen = _device_id_key(key, du->idtype, du->idname)))
+			return 0;
+		if (!_du_index_first(idx->by_device_id, key, keylen, du))
+			return_0;
+	}
+
+	return 1;
+}
+
+/*
+ * Returns NULL when the list should be walked instead.
+ */
+static struct dev_use_index *_du_index(struct cmd_context *cmd)
+{
+	struct dev_use_index *idx = cmd->use_devices_index;
+	struct dev_use *du;
+
+	if (!idx) {
+		if (!(idx = zalloc(sizeof(*idx))))
+			return_NULL;
+		cmd->use_devices_index = idx;
+	}
+
+	if (idx->valid)
+		return idx->linear ? NULL : idx;
+
+	_du_index_destroy_trees(idx);
+	idx->valid = 1;
+	idx->linear = 1;
+
+	if (dm_list_size(&cmd->use_devices) < DU_INDEX_MIN_ENTRIES)
+		return NULL;
+
+	if (!(idx->by_dev = radix_tree_create(NULL, NULL)) ||
+	    !(idx->by_devno = radix_tree_create(NULL, NULL)) ||
+	    !(idx->by_pvid = radix_tree_create(NULL, NULL)) ||
+	    !(idx->by_devname = radix_tree_create(NULL, NULL)) ||
+	    !(idx->by_device_id = radix_tree_create(NULL, NULL)))
+		goto_bad;
+
+	dm_list_iterate_items(du, &cmd->use_devices)
+		if (!_du_index_add(idx, du))
+			goto bad;
+
+	log_debug("Indexed %u devices file entries.", radix_tree_size(idx->by_devname));
+	idx->linear = 0;
+
+	return idx;
+bad:
+	_du_index_destroy_trees(idx);
+
+	return NULL;
+}
+
+void du_index_invalidate(struct cmd_context *cmd)
+{
+	if (cmd->use_devices_index)
+		cmd->use_devices_index->valid = 0;
+}
+
+/*
+ * A new entry added at the end of the list can't change which entry is
+ * first for any key, so the index remains usable after adding its keys.
+ */
+static void _du_index_add_last(struct cmd_context *cmd, struct dev_use *du)
+{
+	struct dev_use_index *idx = cmd->use_devices_index;
+
+	if (!idx || !idx->valid || idx->linear)
+		return;
+
+	if (!_du_index_add(idx, du))
+		idx->valid = 0;
+}
+
+static void _du_index_destroy(struct cmd_context *cmd)
+{
+	if (!cmd->use_devices_index)
+		return;
+
+	_du_index_destroy_trees(cmd->use_devices_index);
+	free(cmd->use_devices_index);
+	cmd->use_devices_index = NULL;
+}
+
 struct dev_use *get_du_for_devno(struct cmd_context *cmd, dev_t devno)
 {
+	struct dev_use_index *idx;
 	struct dev_use *du;
 
+	if ((idx = _du_index(cmd))) {
+		du = radix_tree_lookup_ptr(idx->by_devno, &devno, sizeof(devno));
+		if (!du || (du->dev && du->dev->dev == devno))
+			return du;
+	}
+
 	dm_list_iterate_items(du, &cmd->use_devices) {
 		if (du->dev && du->dev->dev == devno)
 			return du;
@@ -2057,8 +2243,15 @@ struct dev_use *get_du_for_devno(struct cmd_context *cmd, dev_t devno)
 
 struct dev_use *get_du_for_dev(struct cmd_context *cmd, struct device *dev)
 {
+	struct dev_use_index *idx;
 	struct dev_use *du;
 
+	if ((idx = _du_index(cmd))) {
+		du = radix_tree_lookup_ptr(idx->by_dev, &dev, sizeof(dev));
+		if (!du || (du->dev == dev))
+			return du;
+	}
+
 	dm_list_iterate_items(du, &cmd->use_devices) {
 		if (du->dev == dev)
 			return du;
@@ -2068,8 +2261,15 @@ struct dev_use *get_du_for_dev(struct cmd_context *cmd, struct device *dev)
 
 struct dev_use *get_du_for_pvid(struct cmd_context *cmd, const char *pvid)
 {
+	struct dev_use_index *idx;
 	struct dev_use *du;
 
+	if ((idx = _du_index(cmd))) {
+		du = radix_tree_lookup_ptr(idx->by_pvid, pvid, ID_LEN);
+		if (!du || (du->pvid && !memcmp(du->pvid, pvid, ID_LEN)))
+			return du;
+	}
+
 	dm_list_iterate_items(du, &cmd->use_devices) {
 		if (!du->pvid)
 			continue;
@@ -2081,8 +2281,15 @@ struct dev_use *get_du_for_pvid(struct cmd_context *cmd, const char *pvid)
 
 struct dev_use *get_du_for_devname(struct cmd_context *cmd, const char *devname)
 {
+	struct dev_use_index *idx;
 	struct dev_use *du;
 
+	if ((idx = _du_index(cmd))) {
+		du = radix_tree_lookup_ptr(idx->by_devname, devname, strlen(devname));
+		if (!du || (du->devname && !strcmp(du->devname, devname)))
+			return du;
+	}
+
 	dm_list_iterate_items(du, &cmd->use_devices) {
 		if (!du->devname)
 			continue;
@@ -2094,7 +2301,16 @@ struct dev_use *get_du_for_devname(struct cmd_context *cmd, const char *devname)
 
 struct dev_use *get_du_for_device_id(struct cmd_context *cmd, uint16_t idtype, const char *idname)
 {
+	char key[DEVICE_ID_KEY_MAX];
+	struct dev_use_index *idx;
 	struct dev_use *du;
+	size_t keylen;
+
+	if ((idx = _du_index(cmd)) && (keylen = _device_id_key(key, idtype, idname))) {
+		du = radix_tree_lookup_ptr(idx->by_device_id, key, keylen);
+		if (!du || (du->idname && (du->idtype == idtype) && !strcmp(du->idname, idname)))
+			return du;
+	}
 
 	dm_list_iterate_items(du, &cmd->use_devices) {
 		if (du->idname && (du->idtype == idtype) && !strcmp(du->idname, idname))
@@ -2384,11 +2600,17 @@ id_done:
 
 	if (!du->idname || !du->devname || !du->pvid) {
 		free_du(du);
+		du_index_invalidate(cmd);
 		return_0;
 	}
 
 	dm_list_add(&cmd->use_devices, &du->list);
 
+	if (update_du)
+		du_index_invalidate(cmd);
+	else
+		_du_index_add_last(cmd, du);
+
 	return 1;
 }
 
@@ -2412,6 +2634,7 @@ void device_id_pvremove(struct cmd_context *cmd, struct device *dev)
 	if (du->pvid) {
 		free(du->pvid);
 		du->pvid = NULL;
+		du_index_invalidate(cmd);
 	}
 }
 
@@ -2448,6 +2671,7 @@ void device_id_lvremove(struct cmd_context *cmd, struct dm_list *removed_uuids)
 	 * changed system.devices after this command read and unlocked it.
 	 */
 	free_dus(&cmd->use_devices);
+	du_index_invalidate(cmd);
 
 	/*
 	 * Reread system.devices, recreating cmd->use_devices.
@@ -2466,6 +2690,7 @@ void device_id_lvremove(struct cmd_context *cmd, struct dm_list *removed_uuids)
 		log_debug("Removing devices file entry for device_id %s", sl->str);
 		dm_list_del(&du->list);
 		free_du(du);
+		du_index_invalidate(cmd);
 		found++;
 	}
 
@@ -2516,6 +2741,7 @@ void device_id_update_vg_uuid(struct cmd_context *cmd, struct volume_group *vg,
 			log_debug("device_id update %s pvid %s vgid %s to %s",
 				  du->devname ?: ".", du->pvid ?: ".", old_vgid, new_vgid);
 			memcpy(du->idname+4, new_vgid, ID_LEN);
+			du_index_invalidate(cmd);
 			update = 1;
 
 			if (du->dev && du->dev->id && (du->dev->id->idtype == DEV_ID_TYPE_LVMLV_UUID))
@@ -2707,6 +2933,7 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 			}
 			dm_list_add(&dev->ids, &id->list);
 			du->dev = dev;
+			du_index_invalidate(cmd);
 			dev->id = id;
 			dev->flags |= DEV_MATCHED_USE_ID;
 			log_debug("Match %s %s to %s",
@@ -2752,8 +2979,10 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 	 */
 	if (((du->idtype == DEV_ID_TYPE_MPATH_UUID) && !dm_uuid_has_prefix(du->idname, "mpath-")) ||
 	    ((du->idtype == DEV_ID_TYPE_CRYPT_UUID) && !dm_uuid_has_prefix(du->idname, "CRYPT-")) ||
-	    ((du->idtype == DEV_ID_TYPE_LVMLV_UUID) && !dm_uuid_has_prefix(du->idname, "LVM")))
+	    ((du->idtype == DEV_ID_TYPE_LVMLV_UUID) && !dm_uuid_has_prefix(du->idname, "LVM"))) {
 		_replace_incorrect_dm_idtype(du);
+		du_index_invalidate(cmd);
+	}
 
 	/*
 	 * Try to match du with ids that have already been read for the dev
@@ -2766,6 +2995,7 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 		if (id->idtype == du->idtype) {
 			if (!strcmp(id->idname, du_idname)) {
 				du->dev = dev;
+				du_index_invalidate(cmd);
 				dev->id = id;
 				dev->flags |= DEV_MATCHED_USE_ID;
 				log_debug("Match %s %s to %s",
@@ -2793,6 +3023,7 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 
 	if (idname && !strcmp(idname, du_idname)) {
 		du->dev = dev;
+		du_index_invalidate(cmd);
 		dev->id = id;
 		dev->flags |= DEV_MATCHED_USE_ID;
 		log_debug("Match %s %s to %s",
@@ -2857,6 +3088,7 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 				}
 				dm_list_add(&dev->ids, &id->list);
 				du->dev = dev;
+				du_index_invalidate(cmd);
 				dev->id = id;
 				dev->flags |= DEV_MATCHED_USE_ID;
 
@@ -2869,6 +3101,7 @@ static int _match_du_to_dev(struct cmd_context *cmd, struct dev_use *du, struct
 					  idtype_to_str(du->idtype), du_idname, dev_name(dev),
 					  idtype_to_str(id->idtype), id->idname ?: ".");
 				du->idtype = id->idtype;
+				du_index_invalidate(cmd);
 				return 1;
 			}
 		}
@@ -2935,6 +3168,7 @@ void device_ids_match_device_list(struct cmd_context *cmd)
 		} else {
 			/* Should we set dev->id?  Which idtype?  Use --deviceidtype? */
 			du->dev->flags |= DEV_MATCHED_USE_ID;
+			du_index_invalidate(cmd);
 		}
 	}
 }
@@ -3254,6 +3488,150 @@ int device_id_system_list(struct cmd_context *cmd, struct device *dev, uint16_t
 	return 1;
 }
 
+/*
+ * Clear the pvid from devname entries without a dev when another devname
+ * entry is correctly matched to a dev using the same pvid.  The pvids of
+ * the matched entries are collected first, rather than comparing every
+ * pair of entries.
+ */
+static int _clear_pvids_of_matched(struct cmd_context *cmd)
+{
+	struct radix_tree *matched;
+	struct dev_use *du;
+	int cleared = 0;
+
+	if (!(matched = radix_tree_create(NULL, NULL)))
+		return_0;
+
+	dm_list_iterate_items(du, &cmd->use_devices) {
+		if (du->idtype != DEV_ID_TYPE_DEVNAME)
+			continue;
+		if (!du->pvid || !du->dev)
+			continue;
+		if (!radix_tree_insert_ptr(matched, du->pvid, ID_LEN, du)) {
+			stack;
+			goto out;
+		}
+	}
+
+	dm_list_iterate_items(du, &cmd->use_devices) {
+		if (du->idtype != DEV_ID_TYPE_DEVNAME)
+			continue;
+		if (!du->pvid)
+			continue;
+		if (du->dev)
+			continue;
+		if (!radix_tree_lookup_ptr(matched, du->pvid, ID_LEN))
+			continue;
+
+		/*
+		 * another entry is correctly matched to a dev using this
+		 * pvid, so drop the pvid from du.
+		 * TODO: it would make sense to clear IDNAME, but
+		 * can we handle entries with no IDNAME?
+		 */
+		log_debug("Validate %s %s PVID %s: no device found, remove incorrect PVID",
+			  idtype_to_str(du->idtype), du->idname ?: ".", du->pvid ?: ".");
+		free(du->pvid);
+		free(du->devname);
+		du->pvid = NULL;
+		du->devname = NULL;
+		cleared = 1;
+	}
+out:
+	radix_tree_destroy(matched);
+
+	if (cleared)
+		du_index_invalidate(cmd);
+
+	return cleared;
+}
+
+struct du_sort {
+	struct dev_use *du;
+	unsigned pos;
+};
+
+static int _du_idname_cmp(const void *p1, const void *p2)
+{
+	const struct du_sort *s1 = p1, *s2 = p2;
+	int r;
+
+	if ((r = strcmp(s1->du->idname, s2->du->idname)))
+		return r;
+
+	return (s1->pos > s2->pos) - (s1->pos < s2->pos);
+}
+
+/*
+ * For each devname entry matched to a dev, remove the first other devname
+ * entry with the same name if it has no pvid.  Entries are sorted by name,
+ * keeping list order among equal names, so each entry is only compared
+ * with the others using its name.
+ */
+static int _remove_repeated_devnames(struct cmd_context *cmd)
+{
+	struct du_sort *sorted;
+	struct dev_use *du, *du2;
+	unsigned count = 0, i, j, k, end;
+	int removed = 0;
+
+	dm_list_iterate_items(du, &cmd->use_devices)
+		if ((du->idtype == DEV_ID_TYPE_DEVNAME) && du->idname)
+			count++;
+
+	if (count < 2)
+		return 0;
+
+	if (!(sorted = malloc(count * sizeof(*sorted))))
+		return_0;
+
+	i = 0;
+	dm_list_iterate_items(du, &cmd->use_devices)
+		if ((du->idtype == DEV_ID_TYPE_DEVNAME) && du->idname) {
+			sorted[i].du = du;
+			sorted[i].pos = i;
+			i++;
+		}
+
+	qsort(sorted, count, sizeof(*sorted), _du_idname_cmp);
+
+	for (i = 0; i < count; i = end) {
+		for (end = i + 1; end < count; end++)
+			if (strcmp(sorted[i].du->idname, sorted[end].du->idname))
+				break;
+
+		for (j = i; j < end; j++) {
+			if (!(du = sorted[j].du) || !du->pvid || !du->dev)
+				continue;
+
+			for (k = i; k < end; k++)
+				if ((k != j) && sorted[k].du)
+					break;
+			if (k == end)
+				continue;
+
+			du2 = sorted[k].du;
+			if (du2->pvid)
+				continue;
+
+			log_debug("Validate %s %s PVID none: remove entry with repeated devname",
+				  idtype_to_str(du2->idtype), du2->idname ?: ".");
+			dm_list_del(&du2->list);
+			free_du(du2);
+			sorted[k].du = NULL;
+			removed = 1;
+		}
+	}
+
+	free(sorted);
+
+	if (removed)
+		du_index_invalidate(cmd);
+
+	return removed;
+}
+
 /*
  * This is called after devices are scanned to compare what was found on disks
  * vs what's in the devices file.  The devices file could be outdated and need
@@ -3267,7 +3645,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 	struct dm_list wrong_devs;
 	struct device *dev = NULL;
 	struct device_list *devl;
-	struct dev_use *du, *du2;
+	struct dev_use *du;
 	struct dev_id *id;
 	const char *devname;
 	char *tmpdup;
@@ -3305,6 +3683,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 			free(du->idname);
 			du->idtype = DEV_ID_TYPE_SYS_WWID;
 			du->idname = tmpdup;
+			du_index_invalidate(cmd);
 			du->dev->id = id;
 			update_file = 1;
 		} else {
@@ -3393,6 +3772,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 					continue;
 				free(du->pvid);
 				du->pvid = tmpdup;
+				du_index_invalidate(cmd);
 				update_file = 1;
 				cmd->device_ids_invalid = 1;
 			}
@@ -3405,6 +3785,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 					 dev_name(dev), du->pvid);
 				free(du->pvid);
 				du->pvid = NULL;
+				du_index_invalidate(cmd);
 				update_file = 1;
 				cmd->device_ids_invalid = 1;
 			}
@@ -3431,6 +3812,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 				continue;
 			free(du->devname);
 			du->devname = tmpdup;
+			du_index_invalidate(cmd);
 			update_file = 1;
 			cmd->device_ids_invalid = 1;
 		}
@@ -3466,6 +3848,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 					continue;
 				free(du->idname);
 				du->idname = tmpdup;
+				du_index_invalidate(cmd);
 				update_file = 1;
 				cmd->device_ids_invalid = 1;
 			}
@@ -3479,6 +3862,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 					continue;
 				free(du->devname);
 				du->devname = tmpdup;
+				du_index_invalidate(cmd);
 				update_file = 1;
 				cmd->device_ids_invalid = 1;
 			}
@@ -3513,6 +3897,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 			du->dev->flags &= ~DEV_MATCHED_USE_ID;
 			du->dev->id = NULL;
 			du->dev = NULL;
+			du_index_invalidate(cmd);
 		}
 
 		/*
@@ -3551,6 +3936,7 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 			du->devname = dup_devname2;
 			id->idname = dup_devname3;
 			du->dev = dev;
+			du_index_invalidate(cmd);
 			dev->id = id;
 			dev->flags |= DEV_MATCHED_USE_ID;
 			dm_list_add(&dev->ids, &id->list);
@@ -3586,42 +3972,9 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 	 * For each du with no matching dev, if du->pvid is being used in
 	 * another entry with a properly matching dev, then clear du->pvid.
 	 */
-	dm_list_iterate_items(du, &cmd->use_devices) {
-		if (du->idtype != DEV_ID_TYPE_DEVNAME)
-			continue;
-		if (!du->pvid)
-			continue;
-		if (du->dev)
-			continue;
-
-		dm_list_iterate_items(du2, &cmd->use_devices) {
-			if (du == du2)
-				continue;
-			if (du2->idtype != DEV_ID_TYPE_DEVNAME)
-				continue;
-			if (!du2->pvid)
-				continue;
-			if (!du2->dev)
-				continue;
-			if (memcmp(du->pvid, du2->pvid, ID_LEN))
-				continue;
-
-			/*
-			 * du2 is correctly matched to a dev using this pvid,
-			 * so drop the pvid from du.
-			 * TODO: it would make sense to clear IDNAME, but
-			 * can we handle entries with no IDNAME?
-			 */
-			log_debug("Validate %s %s PVID %s: no device found, remove incorrect PVID",
-				  idtype_to_str(du->idtype), du->idname ?: ".", du->pvid ?: ".");
-			free(du->pvid);
-			free(du->devname);
-			du->pvid = NULL;
-			du->devname = NULL;
-			update_file = 1;
-			cmd->device_ids_invalid = 1;
-			break;
-		}
+	if (_clear_pvids_of_matched(cmd)) {
+		update_file = 1;
+		cmd->device_ids_invalid = 1;
 	}
 
 	/*
@@ -3641,35 +3994,9 @@ void device_ids_validate(struct cmd_context *cmd, struct dm_list *scanned_devs,
 	 * could be an another devname entry with the same device name but a
 	 * blank PVID, which we remove here.
 	 */
-	dm_list_iterate_items(du, &cmd->use_devices) {
-		if (du->idtype != DEV_ID_TYPE_DEVNAME)
-			continue;
-		if (!du->idname)
-			continue;
-		if (!du->pvid)
-			continue;
-		if (!du->dev)
-			continue;
-		dm_list_iterate_items(du2, &cmd->use_devices) {
-			if (du == du2)
-				continue;
-			if (du2->idtype != DEV_ID_TYPE_DEVNAME)
-				continue;
-			if (!du2->idname)
-				continue;
-			if (strcmp(du->idname, du2->idname))
-				continue;
-
-			if (!du2->pvid) {
-				log_debug("Validate %s %s PVID none: remove entry with repeated devname",
-					  idtype_to_str(du2->idtype), du2->idname ?: ".");
-				dm_list_del(&du2->list);
-				free_du(du2);
-				update_file = 1;
-				cmd->device_ids_invalid = 1;
-			}
-			break;
-		}
+	if (_remove_repeated_devnames(cmd)) {
+		update_file = 1;
+		cmd->device_ids_invalid = 1;
 	}
 
 	/*
@@ -3896,6 +4223,7 @@ void device_ids_check_serial(struct cmd_context *cmd, struct dm_list *scan_devs,
 		dm_list_add(&prev_devs, &dil->list);
 		du->dev->flags &= ~DEV_MATCHED_USE_ID;
 		du->dev = NULL;
+		du_index_invalidate(cmd);
 	}
 
 	/*
@@ -3913,6 +4241,7 @@ void device_ids_check_serial(struct cmd_context *cmd, struct dm_list *scan_devs,
 				du = dul->du;
 				dev = devl->dev;
 				du->dev = dev;
+				du_index_invalidate(cmd);
 				dev->flags |= DEV_MATCHED_USE_ID;
 
 				log_debug("Match suspect serial device id %s PVID %s to %s",
@@ -3973,6 +4302,7 @@ void device_ids_check_serial(struct cmd_context *cmd, struct dm_list *scan_devs,
 		free(du->pvid);
 		du->pvid = tmpdup;
 		du->dev = dev;
+		du_index_invalidate(cmd);
 		dev->flags |= DEV_MATCHED_USE_ID;
 		update_file = 1;
 	}
@@ -4033,6 +4363,7 @@ void device_ids_check_serial(struct cmd_context *cmd, struct dm_list *scan_devs,
 			if (du->devname) {
 				free(du->devname);
 				du->devname = NULL;
+				du_index_invalidate(cmd);
 				update_file = 1;
 			}
 		}
@@ -4073,12 +4404,16 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 	struct dev_use *du;
 	struct dev_id *id;
 	struct dev_iter *iter;
-	struct device_list *devl;           /* holds struct device */
+	struct device_list *devl, *devl2;   /* holds struct device */
 	struct device_id_list *dil, *dil2;  /* holds struct device + pvid */
 	struct dm_list search_pvids;        /* list of device_id_list */
 	struct dm_list search_devs;         /* list of device_list */
+	struct dm_list pv_devs;             /* list of device_list */
+	struct dm_timestamp *ts_start = NULL, *ts_end = NULL;
 	const char *devname;
 	int update_file = 0;
+	int read_count = 0;
+	int probe_count = 0;
 	int found = 0;
 	int not_found = 0;
 	int search_mode_none;
@@ -4091,6 +4426,7 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 
 	dm_list_init(&search_pvids);
 	dm_list_init(&search_devs);
+	dm_list_init(&pv_devs);
 
 	if (!cmd->enable_devices_file)
 		return;
@@ -4176,6 +4512,9 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 	 */
 	log_debug("Search for PVIDs filtering.");
 
+	if ((ts_start = dm_timestamp_alloc()))
+		(void) dm_timestamp_get(ts_start);
+
 	/*
 	 * Initial list of devs to search, eliminating any that have already
 	 * been matched, or don't pass filters that do not read dev.  We do not
@@ -4184,7 +4523,7 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 	 * filter.
 	 */
 	if (!(iter = dev_iter_create(NULL, 0)))
-		return;
+		goto out_ts;
 	while ((dev = dev_iter_get(cmd, iter))) {
 		if (dev->flags & DEV_MATCHED_USE_ID)
 			continue;
@@ -4219,19 +4558,16 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 	    _searched_devnames_exists(cmd, search_pvids_count, search_pvids_hash,
 		    		      search_devs_count, search_devs_hash)) {
 		log_debug("Search for PVIDs skipped for matching %s", _searched_file);
-		return;
+		goto out_ts;
 	}
 
 	log_debug("Search for PVIDs reading labels.");
 
 	/*
-	 * Read the dev to get the pvid, and run the filters that will use the
-	 * data that has been read to get the pvid.  Like above, we do not want
-	 * to modify the command's existing filter chain or the persistent
-	 * filter values.
+	 * Decide which devs need to be read before reading any of them, so
+	 * that the reads of the pvids can all be submitted together.
 	 */
-	dm_list_iterate_items(devl, &search_devs) {
-		int has_pvid;
+	dm_list_iterate_items_safe(devl, devl2, &search_devs) {
 		dev = devl->dev;
 
 		/*
@@ -4257,27 +4593,36 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 		 */
 		if (search_mode_auto && _dev_has_stable_id(cmd, dev)) {
 			log_debug("Search for PVIDs skip %s (stable id)", dev_name(dev));
+			dm_list_del(&devl->list);
 			continue;
 		}
 
 		log_debug("Search for PVIDs on %s", dev_name(dev));
+		probe_count++;
+	}
 
-		/*
-		 * Reads 4K from the start of the disk.
-		 * Returns 0 if the dev cannot be read.
-		 * Looks for LVM header, and sets dev->pvid if the device is a PV.
-		 * Sets has_pvid=1 if the dev has an lvm PVID.
-		 * This loop may look at and skip many non-LVM devices.
-		 */
-		if (!label_read_pvid(dev, &has_pvid))
-			continue;
+	/*
+	 * Reads 4K from the start of each disk.
+	 * Looks for LVM header, and sets dev->pvid if the device is a PV.
+	 * The devs with an lvm PVID are moved to pv_devs.
+	 * This may look at and skip many non-LVM devices.
+	 */
+	read_count = label_read_pvids(&search_devs, &pv_devs, NULL);
 
-		if (!has_pvid)
-			continue;
+	log_debug("Search for PVIDs read %d of %d devices, %d with PVID.",
+		  read_count, probe_count, dm_list_size(&pv_devs));
+
+	/*
+	 * Run the filters that will use the data that has been read to get
+	 * the pvid.  Like above, we do not want to modify the command's
+	 * existing filter chain or the persistent filter values.
+	 */
+	dm_list_iterate_items(devl, &pv_devs) {
+		dev = devl->dev;
 
 		/*
 		 * These filters will use the block of data from bcache that
-		 * was read label_read_pvid(), and may read other
+		 * was read label_read_pvids(), and may read other
 		 * data blocks beyond that.
 		 */
 		if (!cmd->filter->passes_filter(cmd, cmd->filter, dev, "partitioned"))
@@ -4381,6 +4726,7 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 		du->idname = new_idname;
 		du->devname = new_devname;
 		du->dev = dev;
+		du_index_invalidate(cmd);
 		id->idtype = new_idtype;
 		id->idname = new_idname2;
 		dev->id = id;
@@ -4404,9 +4750,18 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 			if (du) /* Should not happen 'du' is NULL */
 				du->dev = NULL;
 			dev->flags &= ~DEV_MATCHED_USE_ID;
+			du_index_invalidate(cmd);
 		}
 	}
 
+	if (ts_start && (ts_end = dm_timestamp_alloc()) && dm_timestamp_get(ts_end))
+		log_verbose("Searched %d devices for %d PVIDs in %.3f seconds, found %d.",
+			    probe_count, search_pvids_count,
+			    (double) dm_timestamp_delta(ts_end, ts_start) / 1000000000, found);
+	else
+		log_verbose("Searched %d devices for %d PVIDs, found %d.",
+			    probe_count, search_pvids_count, found);
+
  out:
 	/*
 	 * Remove REFRESH_UNTIL if it was set in the file,
@@ -4489,6 +4844,9 @@ void device_ids_search(struct cmd_context *cmd, struct dm_list *new_devs,
 	    !all_ids && not_found && !found && strcmp(cmd->name, "lvmdevices"))
 		_searched_devnames_create(cmd, search_pvids_count, search_pvids_hash,
 					  search_devs_count, search_devs_hash);
+ out_ts:
+	dm_timestamp_destroy(ts_start);
+	dm_timestamp_destroy(ts_end);
 }
 
 int devices_file_touch(struct cmd_context *cmd)
@@ -4684,6 +5042,7 @@ void devices_file_init(struct cmd_context *cmd)
 
 void devices_file_exit(struct cmd_context *cmd)
 {
+	_du_index_destroy(cmd);
 	if (!cmd->enable_devices_file)
 		return;
 	free_dus(&cmd->use_devices);
@@ -16,8 +16,13 @@
 #include "lib/misc/lib.h"
 #include "lib/device/online.h"
 #include "lib/config/defaults.h"
+#include "lib/datastruct/str_list.h"
+#include "lib/misc/crc.h"
 
 #include <dirent.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 
 /*
  * file contains:
@@ -130,6 +135,529 @@ int online_pvid_file_read(char *path, unsigned *major, unsigned *minor, char *vg
 	return 1;
 }
 
+/*
+ * Online PV table
+ *
+ * The online PVs are recorded in PVS_ONLINE_TABLE, a file that commands
+ * map shared, so that checking if PVs are online does not take a stat,
+ * or a readdir and a read of each pvs_online file.  The table holds the
+ * fields of each online PV in an array with a hash index by pvid, and
+ * counts the online PVs of each VG name in a second array with a hash
+ * index by VG name.
+ *
+ * The table is the reference while it can be used.  Commands still write
+ * and remove the pvs_online files, while holding a flock on the table,
+ * so the files are a copy to fall back on when the table cannot be used:
+ * it cannot be opened, or it is full.  The table is built from the files
+ * only when it is created, or when PVS_ONLINE_DIR has been created again.
+ * Removing the pvs_online files alone does not take PVs offline; the
+ * table is cleared by pvscan --cache, or by removing the table file too.
+ *
+ * Readers do not take the flock, the seq count is odd while a writer is
+ * making changes, and readers retry when it changes under them.
+ */
+
+#define ONLINE_TABLE_MAGIC	0x4c564f54	/* LVOT */
+#define ONLINE_TABLE_VERSION	2
+#define ONLINE_TABLE_MAX_PVS	8192
+#define ONLINE_TABLE_SLOTS	(2 * ONLINE_TABLE_MAX_PVS)
+#define ONLINE_TABLE_RETRIES	1000
+
+struct online_table_pv {
+	char pvid[ID_LEN];
+	uint32_t major;
+	uint32_t minor;
+	char vgname[NAME_LEN];
+	char devname[NAME_LEN];
+};
+
+struct online_table_vg {
+	char vgname[NAME_LEN];
+	uint32_t pvs;		/* online PVs with this VG name */
+	uint32_t unused;
+};
+
+struct online_table {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t count;
+	uint32_t overflow;	/* more online PVs than fit */
+	uint32_t vg_count;
+	uint32_t vg_overflow;	/* more VG names than fit, no counts */
+	uint32_t nameless;	/* online PVs without a VG name */
+	uint64_t dir_ino;
+	uint32_t slots[ONLINE_TABLE_SLOTS];	/* pvs index + 1, or 0 */
+	uint32_t vg_slots[ONLINE_TABLE_SLOTS];	/* vgs index + 1, or 0 */
+	struct online_table_pv pvs[ONLINE_TABLE_MAX_PVS];
+	struct online_table_vg vgs[ONLINE_TABLE_MAX_PVS];
+};
+
+static struct {
+	int fd;
+	int checked;
+	int failed;
+	struct online_table *t;
+} _ot = { .fd = -1 };
+
+static uint32_t _ot_hash(const char *pvid)
+{
+	return calc_crc(INITIAL_CRC, (const uint8_t *) pvid, ID_LEN) & (ONLINE_TABLE_SLOTS - 1);
+}
+
+static uint32_t _ot_vg_hash(const char *vgname)
+{
+	return calc_crc(INITIAL_CRC, (const uint8_t *) vgname, strlen(vgname)) & (ONLINE_TABLE_SLOTS - 1);
+}
+
+static int _ot_lock(void)
+{
+	if (flock(_ot.fd, LOCK_EX)) {
+		log_sys_debug("flock", PVS_ONLINE_TABLE);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _ot_unlock(void)
+{
+	if (flock(_ot.fd, LOCK_UN))
+		log_sys_debug("flock", PVS_ONLINE_TABLE);
+}
+
+static void _ot_write_begin(struct online_table *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _ot_write_end(struct online_table *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Returns 0 while a writer is making changes. */
+static int _ot_read_begin(struct online_table *t, uint32_t *seq)
+{
+	if ((*seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE)) & 1) {
+		sched_yield();
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Returns 1 if a writer made changes since _ot_read_begin. */
+static int _ot_read_retry(struct online_table *t, uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&t->seq, __ATOMIC_RELAXED) != seq;
+}
+
+static int _ot_dir_stat(struct stat *st)
+{
+	if (stat(PVS_ONLINE_DIR, st)) {
+		log_sys_debug("stat", PVS_ONLINE_DIR);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Returns 0 when PVS_ONLINE_DIR is not the one the table was built from. */
+static int _ot_dir_matches(struct online_table *t)
+{
+	struct stat st;
+
+	if (!_ot_dir_stat(&st))
+		return 0;
+
+	return t->dir_ino == (uint64_t) st.st_ino;
+}
+
+static void _ot_dir_record(struct online_table *t)
+{
+	struct stat st;
+
+	/* Without the dir, built again by the next command. */
+	t->dir_ino = _ot_dir_stat(&st) ? (uint64_t) st.st_ino : 0;
+}
+
+/* Returns the slot of the pvid, or of the empty slot where it would go. */
+static uint32_t _ot_slot(struct online_table *t, const char *pvid)
+{
+	uint32_t slot = _ot_hash(pvid);
+	uint32_t n, i;
+
+	for (i = 0; i < ONLINE_TABLE_SLOTS; i++) {
+		if (!(n = t->slots[slot]))
+			break;
+		if ((n <= ONLINE_TABLE_MAX_PVS) && !memcmp(t->pvs[n - 1].pvid, pvid, ID_LEN))
+			break;
+		slot = (slot + 1) & (ONLINE_TABLE_SLOTS - 1);
+	}
+
+	return slot;
+}
+
+static uint32_t _ot_vg_slot(struct online_table *t, const char *vgname)
+{
+	uint32_t slot = _ot_vg_hash(vgname);
+	uint32_t n, i;
+
+	for (i = 0; i < ONLINE_TABLE_SLOTS; i++) {
+		if (!(n = t->vg_slots[slot]))
+			break;
+		if ((n <= ONLINE_TABLE_MAX_PVS) && !strncmp(t->vgs[n - 1].vgname, vgname, NAME_LEN))
+			break;
+		slot = (slot + 1) & (ONLINE_TABLE_SLOTS - 1);
+	}
+
+	return slot;
+}
+
+/*
+ * Count a PV going online (delta 1) or offline (delta -1) for its VG.
+ * VG entries stay until the table is built again, with a zero count.
+ */
+static void _ot_vg_count(struct online_table *t, const char *vgname, int delta)
+{
+	struct online_table_vg *vg;
+	uint32_t slot;
+
+	if (!vgname[0]) {
+		if ((delta > 0) || t->nameless)
+			t->nameless += delta;
+		return;
+	}
+
+	slot = _ot_vg_slot(t, vgname);
+
+	if (t->vg_slots[slot])
+		vg = &t->vgs[t->vg_slots[slot] - 1];
+	else if (delta < 0)
+		return;
+	else if (t->vg_count == ONLINE_TABLE_MAX_PVS) {
+		log_debug("Online table has no room for VG %s.", vgname);
+		t->vg_overflow = 1;
+		return;
+	} else {
+		vg = &t->vgs[t->vg_count++];
+		t->vg_slots[slot] = t->vg_count;
+		memset(vg, 0, sizeof(*vg));
+		dm_strncpy(vg->vgname, vgname, sizeof(vg->vgname));
+	}
+
+	if (delta > 0)
+		vg->pvs++;
+	else if (vg->pvs)
+		vg->pvs--;
+}
+
+static void _ot_insert(struct online_table *t, const char *pvid, unsigned major, unsigned minor,
+		       const char *vgname, const char *devname)
+{
+	struct online_table_pv *pv;
+	uint32_t slot = _ot_slot(t, pvid);
+
+	if (t->slots[slot]) {
+		pv = &t->pvs[t->slots[slot] - 1];
+		_ot_vg_count(t, pv->vgname, -1);
+	} else if (t->count == ONLINE_TABLE_MAX_PVS) {
+		log_debug("Online table is full.");
+		t->overflow = 1;
+		return;
+	} else {
+		pv = &t->pvs[t->count++];
+		t->slots[slot] = t->count;
+	}
+
+	memset(pv, 0, sizeof(*pv));
+	memcpy(pv->pvid, pvid, ID_LEN);
+	pv->major = major;
+	pv->minor = minor;
+	if (vgname)
+		dm_strncpy(pv->vgname, vgname, sizeof(pv->vgname));
+	if (devname)
+		dm_strncpy(pv->devname, devname, sizeof(pv->devname));
+
+	_ot_vg_count(t, pv->vgname, 1);
+}
+
+static void _ot_delete(struct online_table *t, const char *pvid)
+{
+	uint32_t slot = _ot_slot(t, pvid);
+	uint32_t next, home, n, last;
+
+	if (!(n = t->slots[slot]))
+		return;
+
+	_ot_vg_count(t, t->pvs[n - 1].vgname, -1);
+
+	/* Move the last pv into the place of the deleted one. */
+	last = t->count--;
+	if (n != last) {
+		t->pvs[n - 1] = t->pvs[last - 1];
+		t->slots[_ot_slot(t, t->pvs[n - 1].pvid)] = n;
+	}
+	memset(&t->pvs[last - 1], 0, sizeof(t->pvs[0]));
+
+	/* Shift back the slots that probed past the deleted one. */
+	t->slots[slot] = 0;
+	next = slot;
+	for (;;) {
+		next = (next + 1) & (ONLINE_TABLE_SLOTS - 1);
+		if (!(n = t->slots[next]))
+			break;
+		home = _ot_hash(t->pvs[n - 1].pvid);
+		if (((next > slot) && ((home <= slot) || (home > next))) ||
+		    ((next < slot) && ((home <= slot) && (home > next)))) {
+			t->slots[slot] = n;
+			t->slots[next] = 0;
+			slot = next;
+		}
+	}
+}
+
+/* Called with the table locked. */
+static void _ot_build(struct online_table *t)
+{
+	char path[PATH_MAX];
+	char file_vgname[NAME_LEN];
+	char file_devname[NAME_LEN];
+	unsigned file_major, file_minor;
+	struct dirent *de;
+	DIR *dir;
+
+	_ot_write_begin(t);
+
+	t->count = 0;
+	t->overflow = 0;
+	t->vg_count = 0;
+	t->vg_overflow = 0;
+	t->nameless = 0;
+	memset(t->slots, 0, sizeof(t->slots));
+	memset(t->vg_slots, 0, sizeof(t->vg_slots));
+
+	if ((dir = opendir(PVS_ONLINE_DIR))) {
+		while ((de = readdir(dir))) {
+			if (de->d_name[0] == '.')
+				continue;
+
+			if (strlen(de->d_name) != ID_LEN)
+				continue;
+
+			if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, de->d_name) < 0)
+				continue;
+
+			file_major = 0;
+			file_minor = 0;
+			memset(file_vgname, 0, sizeof(file_vgname));
+			memset(file_devname, 0, sizeof(file_devname));
+
+			if (!online_pvid_file_read(path, &file_major, &file_minor, file_vgname, file_devname))
+				continue;
+
+			_ot_insert(t, de->d_name, file_major, file_minor, file_vgname, file_devname);
+		}
+
+		if (closedir(dir))
+			log_sys_debug("closedir", PVS_ONLINE_DIR);
+	}
+
+	_ot_dir_record(t);
+
+	_ot_write_end(t);
+
+	log_debug("Built online table with %u PVs.", t->count);
+}
+
+static int _ot_open(void)
+{
+	struct stat st;
+	void *p;
+
+	if ((_ot.fd = open(PVS_ONLINE_TABLE, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR)) < 0) {
+		log_sys_debug("open", PVS_ONLINE_TABLE);
+		return 0;
+	}
+
+	if (!_ot_lock())
+		goto_bad;
+
+	if (fstat(_ot.fd, &st)) {
+		log_sys_debug("fstat", PVS_ONLINE_TABLE);
+		goto bad_unlock;
+	}
+
+	/*
+	 * A new table is all zeros.  The file is sparse, only the pages
+	 * in use take space.
+	 */
+	if ((st.st_size != sizeof(struct online_table)) &&
+	    (ftruncate(_ot.fd, 0) || ftruncate(_ot.fd, sizeof(struct online_table)))) {
+		log_sys_debug("ftruncate", PVS_ONLINE_TABLE);
+		goto bad_unlock;
+	}
+
+	if ((p = mmap(NULL, sizeof(struct online_table), PROT_READ | PROT_WRITE,
+		      MAP_SHARED, _ot.fd, 0)) == MAP_FAILED) {
+		log_sys_debug("mmap", PVS_ONLINE_TABLE);
+		goto bad_unlock;
+	}
+
+	_ot.t = p;
+
+	if ((_ot.t->magic != ONLINE_TABLE_MAGIC) || (_ot.t->version != ONLINE_TABLE_VERSION)) {
+		if ((st.st_size == sizeof(struct online_table)) &&
+		    (ftruncate(_ot.fd, 0) || ftruncate(_ot.fd, sizeof(struct online_table)))) {
+			log_sys_debug("ftruncate", PVS_ONLINE_TABLE);
+			goto bad_unmap;
+		}
+		_ot.t->magic = ONLINE_TABLE_MAGIC;
+		_ot.t->version = ONLINE_TABLE_VERSION;
+		_ot_build(_ot.t);
+	}
+
+	_ot_unlock();
+
+	return 1;
+
+bad_unmap:
+	if (munmap(_ot.t, sizeof(struct online_table)))
+		log_sys_debug("munmap", PVS_ONLINE_TABLE);
+	_ot.t = NULL;
+bad_unlock:
+	_ot_unlock();
+bad:
+	if (close(_ot.fd))
+		log_sys_debug("close", PVS_ONLINE_TABLE);
+	_ot.fd = -1;
+	return 0;
+}
+
+/*
+ * Returns the table, or NULL when the pvs_online files need to be used.
+ * The first use in a command checks that PVS_ONLINE_DIR was not created
+ * again since the table was built, e.g. after /run was cleared.
+ */
+static struct online_table *_ot_get(void)
+{
+	if (_ot.failed)
+		return NULL;
+
+	if (!_ot.t && !_ot_open()) {
+		_ot.failed = 1;
+		return NULL;
+	}
+
+	if (!_ot.checked) {
+		if (!_ot_dir_matches(_ot.t)) {
+			if (!_ot_lock()) {
+				_ot.failed = 1;
+				return NULL;
+			}
+			if (!_ot_dir_matches(_ot.t))
+				_ot_build(_ot.t);
+			_ot_unlock();
+		}
+		_ot.checked = 1;
+	}
+
+	if (_ot.t->overflow)
+		return NULL;
+
+	return _ot.t;
+}
+
+/*
+ * Lock the table for changing it, and the pvs_online files with it.
+ * Returns NULL when only the files are changed.
+ */
+static struct online_table *_ot_write_lock(void)
+{
+	if (!_ot_get())
+		return NULL;
+
+	if (!_ot_lock())
+		return NULL;
+
+	if (_ot.t->overflow) {
+		_ot_unlock();
+		return NULL;
+	}
+
+	_ot_write_begin(_ot.t);
+
+	return _ot.t;
+}
+
+static void _ot_write_unlock(struct online_table *t)
+{
+	_ot_write_end(t);
+	_ot_unlock();
+}
+
+/*
+ * Copy the table entry for the pvid.
+ * Returns 1 if found, 0 if not, -1 if the table is not usable.
+ */
+static int _ot_find(const char *pvid, struct online_table_pv *out)
+{
+	struct online_table *t;
+	uint32_t seq, slot, n;
+	unsigned i;
+	int found;
+
+	if (!(t = _ot_get()))
+		return -1;
+
+	for (i = 0; i < ONLINE_TABLE_RETRIES; i++) {
+		if (!_ot_read_begin(t, &seq))
+			continue;
+		slot = _ot_slot(t, pvid);
+		n = t->slots[slot];
+		found = (n && (n <= ONLINE_TABLE_MAX_PVS));
+		if (found)
+			memcpy(out, &t->pvs[n - 1], sizeof(*out));
+		if (!_ot_read_retry(t, seq))
+			return found;
+	}
+
+	return -1;
+}
+
+/*
+ * Get the number of online PVs with the VG name, and of online PVs
+ * without a VG name, which may belong to any VG.  Returns 0 when the
+ * table cannot count them.
+ */
+int online_vg_count(const char *vgname, unsigned *pvs, unsigned *nameless)
+{
+	struct online_table *t;
+	uint32_t seq, slot, n;
+	unsigned i;
+
+	if (!(t = _ot_get()))
+		return 0;
+
+	for (i = 0; i < ONLINE_TABLE_RETRIES; i++) {
+		if (!_ot_read_begin(t, &seq))
+			continue;
+		if (t->vg_overflow)
+			return 0;
+		slot = _ot_vg_slot(t, vgname);
+		n = t->vg_slots[slot];
+		*pvs = (n && (n <= ONLINE_TABLE_MAX_PVS)) ? t->vgs[n - 1].pvs : 0;
+		*nameless = t->nameless;
+		if (!_ot_read_retry(t, seq))
+			return 1;
+	}
+
+	return 0;
+}
+
 void free_po_list(struct dm_list *list)
 {
 	struct pv_online *po, *po2;
@@ -142,6 +670,73 @@ void free_po_list(struct dm_list *list)
 	dm_list_init(list);     /* Coverity will see empty initialized list */
 }
 
+static struct pv_online *_po_from_table(struct online_table_pv *pv)
+{
+	struct pv_online *po;
+
+	if (!(po = zalloc(sizeof(*po))))
+		return_NULL;
+
+	memcpy(po->pvid, pv->pvid, ID_LEN);
+	if (pv->major || pv->minor)
+		po->devno = MKDEV(pv->major, pv->minor);
+	dm_strncpy(po->vgname, pv->vgname, sizeof(po->vgname));
+	dm_strncpy(po->devname, pv->devname, sizeof(po->devname));
+
+	return po;
+}
+
+/* Returns 0 when the table is not usable. */
+static int _get_pvs_online_table(struct dm_list *pvs_online, const char *vgname)
+{
+	struct online_table *t;
+	struct online_table_pv pv;
+	struct pv_online *po;
+	struct dm_list found;
+	uint32_t seq, count, n;
+	unsigned i;
+
+	if (!(t = _ot_get()))
+		return 0;
+
+	dm_list_init(&found);
+
+	for (i = 0; i < ONLINE_TABLE_RETRIES; i++) {
+		if (!_ot_read_begin(t, &seq))
+			continue;
+
+		if ((count = t->count) > ONLINE_TABLE_MAX_PVS)
+			count = ONLINE_TABLE_MAX_PVS;
+
+		for (n = 0; n < count; n++) {
+			memcpy(&pv, &t->pvs[n], sizeof(pv));
+			pv.vgname[NAME_LEN - 1] = '\0';
+			pv.devname[NAME_LEN - 1] = '\0';
+
+			if (vgname && strcmp(pv.vgname, vgname))
+				continue;
+
+			if (!(po = _po_from_table(&pv)))
+				break;
+
+			dm_list_add(&found, &po->list);
+		}
+
+		if ((n == count) && !_ot_read_retry(t, seq)) {
+			dm_list_iterate_items(po, &found)
+				log_debug("Found PV online %s for VG %s %s", po->pvid, vgname, po->devname);
+			dm_list_splice(pvs_online, &found);
+			log_debug("Found PVs online %d for %s in online table",
+				  dm_list_size(pvs_online), vgname ?: "all");
+			return 1;
+		}
+
+		free_po_list(&found);
+	}
+
+	return 0;
+}
+
 int get_pvs_online(struct dm_list *pvs_online, const char *vgname)
 {
 	char path[PATH_MAX];
@@ -152,6 +747,9 @@ int get_pvs_online(struct dm_list *pvs_online, const char *vgname)
 	struct pv_online *po;
 	unsigned file_major, file_minor;
 
+	if (_get_pvs_online_table(pvs_online, vgname))
+		return 1;
+
 	if (!(dir = opendir(PVS_ONLINE_DIR)))
 		return 0;
 
@@ -246,7 +844,12 @@ int online_vg_file_create(struct cmd_context *cmd, const char *vgname)
 	return 1;
 }
 
-int online_pvid_file_create(struct cmd_context *cmd, struct device *dev, const char *vgname)
+/*
+ * With replace, the file is written over an existing one, which the
+ * online table has already checked.
+ */
+static int _online_pvid_file_create(struct cmd_context *cmd, struct device *dev,
+				    const char *vgname, int replace)
 {
 	char path[PATH_MAX];
 	char buf[MAX_PVID_FILE_SIZE] = { 0 };
@@ -298,9 +901,9 @@ int online_pvid_file_create(struct cmd_context *cmd, struct device *dev, const c
 
 	log_debug("Create pv online: %s %u:%u %s.", path, major, minor, dev_name(dev));
 
-	fd = open(path, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	fd = open(path, O_CREAT | O_RDWR | (replace ? O_TRUNC : O_EXCL), S_IRUSR | S_IWUSR);
 	if (fd < 0) {
-		if (errno == EEXIST)
+		if (!replace && (errno == EEXIST))
 			goto check_duplicate;
 		log_error_pvscan(cmd, "Failed to create online file for %s path %s error %d", dev_name(dev), path, errno);
 		return 0;
@@ -363,12 +966,68 @@ check_duplicate:
 	return 0;
 }
 
+int online_pvid_file_create(struct cmd_context *cmd, struct device *dev, const char *vgname)
+{
+	struct online_table *t;
+	struct online_table_pv *pv;
+	const char *devname = dev_name(dev);
+	size_t devnamelen = strlen(devname);
+	unsigned major = MAJOR(dev->dev);
+	unsigned minor = MINOR(dev->dev);
+	uint32_t n;
+	int ret = 1;
+
+	if (!(t = _ot_write_lock()))
+		return _online_pvid_file_create(cmd, dev, vgname, 0);
+
+	if ((n = t->slots[_ot_slot(t, dev->pvid)])) {
+		/* Check for a duplicate PV as with an existing file. */
+		pv = &t->pvs[n - 1];
+
+		if ((pv->major == major) && (pv->minor == minor))
+			log_debug("Existing online entry for %u:%u", major, minor);
+		else {
+			log_error_pvscan(cmd, "PV %s %u:%u is duplicate for PVID %s on %u:%u %s.",
+					 devname, major, minor, dev->pvid, pv->major, pv->minor, pv->devname);
+
+			if (pv->vgname[0] && vgname && strcmp(pv->vgname, vgname))
+				log_error_pvscan(cmd, "PV %s has unexpected VG %s vs %s.",
+						 devname, vgname, pv->vgname);
+			ret = 0;
+		}
+	} else {
+		log_debug("Add pv online: %s %u:%u %s.", dev->pvid, major, minor, devname);
+
+		/* The same fields as the file. */
+		_ot_insert(t, dev->pvid, major, minor, vgname,
+			   ((devnamelen > 5) && (devnamelen < NAME_LEN - 1)) ? devname : NULL);
+
+		/* The copy to fall back on, see Online PV table. */
+		if (!t->overflow && !_online_pvid_file_create(cmd, dev, vgname, 1))
+			log_debug("Online file for %s not written.", devname);
+	}
+
+	_ot_write_unlock(t);
+
+	/* Full, so the files need to have this PV too. */
+	if (t->overflow)
+		return _online_pvid_file_create(cmd, dev, vgname, 0);
+
+	return ret;
+}
+
 int online_pvid_file_exists(const char *pvid)
 {
 	char path[PATH_MAX] = { 0 };
+	struct online_table_pv pv;
 	struct stat buf;
 	int rv;
 
+	if ((rv = _ot_find(pvid, &pv)) >= 0) {
+		log_debug("Check pv online %s: %s", pvid, rv ? "yes" : "no");
+		return rv;
+	}
+
 	if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid) < 0) {
 		log_debug(INTERNAL_ERROR "Path %s/%s is too long.", PVS_ONLINE_DIR, pvid);
 		return 0;
@@ -385,10 +1044,37 @@ int online_pvid_file_exists(const char *pvid)
 	return 0;
 }
 
+/*
+ * Get the fields of the pvs_online file of the pvid.
+ * Returns 0 if the PV is not online.
+ */
+int online_pvid_get(const char *pvid, unsigned *major, unsigned *minor, char *vgname, char *devname)
+{
+	char path[PATH_MAX];
+	struct online_table_pv pv;
+	int rv;
+
+	if ((rv = _ot_find(pvid, &pv)) >= 0) {
+		if (!rv)
+			return 0;
+		*major = pv.major;
+		*minor = pv.minor;
+		if (vgname)
+			dm_strncpy(vgname, pv.vgname, NAME_LEN);
+		if (devname)
+			dm_strncpy(devname, pv.devname, NAME_LEN);
+		return 1;
+	}
+
+	if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid) < 0)
+		return_0;
+
+	return online_pvid_file_read(path, major, minor, vgname, devname);
+}
+
 int get_pvs_lookup(struct dm_list *pvs_online, const char *vgname)
 {
 	char lookup_path[PATH_MAX] = { 0 };
-	char path[PATH_MAX] = { 0 };
 	char line[64];
 	char pvid[ID_LEN + 1] __attribute__((aligned(8))) = { 0 };
 	char file_vgname[NAME_LEN];
@@ -408,14 +1094,12 @@ int get_pvs_lookup(struct dm_list *pvs_online, const char *vgname)
 		if (strlen(pvid) != ID_LEN)
 			goto_bad;
 
-		snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid);
-
 		file_major = 0;
 		file_minor = 0;
 		memset(file_vgname, 0, sizeof(file_vgname));
 		memset(file_devname, 0, sizeof(file_devname));
 
-		if (!online_pvid_file_read(path, &file_major, &file_minor, file_vgname, file_devname))
+		if (!online_pvid_get(pvid, &file_major, &file_minor, file_vgname, file_devname))
 			goto_bad;
 
 		/*
@@ -441,7 +1125,7 @@ int get_pvs_lookup(struct dm_list *pvs_online, const char *vgname)
 		if (file_devname[0])
 			dm_strncpy(po->devname, file_devname, sizeof(po->devname));
 
-		log_debug("Found PV online lookup %s for VG %s on %s.", path, vgname, file_devname);
+		log_debug("Found PV online lookup %s for VG %s on %s.", pvid, vgname, file_devname);
 		dm_list_add(pvs_online, &po->list);
 	}
 
@@ -460,8 +1144,117 @@ bad:
 	return 0;
 }
 
+/*
+ * When a device goes offline we only know its major:minor, not its PVID.
+ * Since the dev isn't around, we can't read it to get its PVID, so we have to
+ * read the PVID files to find the one containing this major:minor and remove
+ * that one. This means that the PVID files need to contain the devno's they
+ * were created from.
+ */
+
+static void _online_pvid_file_remove_devno(unsigned major, unsigned minor)
+{
+	char path[PATH_MAX];
+	char file_vgname[NAME_LEN];
+	DIR *dir;
+	struct dirent *de;
+	unsigned file_major, file_minor;
+
+	if (!(dir = opendir(PVS_ONLINE_DIR)))
+		return;
+
+	while ((de = readdir(dir))) {
+		if (de->d_name[0] == '.')
+			continue;
+
+		memset(path, 0, sizeof(path));
+		snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, de->d_name);
+
+		file_major = 0;
+		file_minor = 0;
+		memset(file_vgname, 0, sizeof(file_vgname));
+
+		online_pvid_file_read(path, &file_major, &file_minor, file_vgname, NULL);
+
+		if ((file_major == major) && (file_minor == minor)) {
+			log_debug("Unlink pv online %s", path);
+			if (unlink(path) && (errno != ENOENT))
+				log_sys_debug("unlink", path);
+
+			if (file_vgname[0]) {
+				online_vg_file_remove(file_vgname);
+				online_lookup_file_remove(file_vgname);
+			}
+		}
+	}
+	if (closedir(dir))
+		log_sys_debug("closedir", PVS_ONLINE_DIR);
+}
+
+void online_pvid_file_remove_devno(unsigned major, unsigned minor)
+{
+	char path[PATH_MAX];
+	char pvid[ID_LEN + 1] = { 0 };
+	char vgname[NAME_LEN];
+	struct online_table *t;
+	uint32_t n = 0;
+
+	log_debug("Remove pv online devno %u:%u", major, minor);
+
+	if (!(t = _ot_write_lock())) {
+		_online_pvid_file_remove_devno(major, minor);
+		return;
+	}
+
+	while (n < t->count) {
+		if ((t->pvs[n].major != major) || (t->pvs[n].minor != minor)) {
+			n++;
+			continue;
+		}
+
+		memcpy(pvid, t->pvs[n].pvid, ID_LEN);
+		dm_strncpy(vgname, t->pvs[n].vgname, sizeof(vgname));
+
+		/* The last pv takes the place of the deleted one. */
+		_ot_delete(t, pvid);
+
+		if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid) >= 0) {
+			log_debug("Unlink pv online %s", path);
+			if (unlink(path) && (errno != ENOENT))
+				log_sys_debug("unlink", path);
+		}
+
+		if (vgname[0]) {
+			online_vg_file_remove(vgname);
+			online_lookup_file_remove(vgname);
+		}
+	}
+
+	_ot_write_unlock(t);
+}
+
+/*
+ * Build the online table again from the pvs_online files, after
+ * pvscan --cache has removed them to start over.
+ */
+void online_table_clear(void)
+{
+	if (!_ot_get() && !_ot.t)
+		return;
+
+	if (!_ot_lock())
+		return;
+
+	_ot_build(_ot.t);
+
+	_ot_unlock();
+}
+
 void online_dir_setup(struct cmd_context *cmd)
 {
+	/* Check the online table is in sync with the files again. */
+	_ot.checked = 0;
+
 	if (!dir_create_recursive(PVS_ONLINE_DIR, 0755))
 		stack;
 	if (!dir_create_recursive(VGS_ONLINE_DIR, 0755))
@@ -488,12 +1281,24 @@ void online_lookup_file_remove(const char *vgname)
 static int _online_pvid_file_remove(char *pvid)
 {
 	char path[PATH_MAX] = { 0 };
+	struct online_table *t;
+	int ret = 0;
 
 	if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid) < 0)
 		return_0;
+
+	t = _ot_write_lock();
+
 	if (!unlink(path))
-		return 1;
-	return 0;
+		ret = 1;
+
+	if (t) {
+		ret = t->slots[_ot_slot(t, pvid)] ? 1 : 0;
+		_ot_delete(t, pvid);
+		_ot_write_unlock(t);
+	}
+
+	return ret;
 }
 
 /*
@@ -524,3 +1329,152 @@ void online_vgremove(struct volume_group *vg)
 	}
 }
 
+
+/*
+ * With global/event_activation_coalesce, pvscan --cache -aay commands
+ * for devices that appear together are coalesced.  Each pvscan writes
+ * its device args to a queue file pvs_queue/<pid>, and then waits for
+ * the queue lock.  A pvscan that gets the lock and still finds its own
+ * queue file takes the queue files of all the other pvscans, and scans
+ * and autoactivates their devices together with its own.  A pvscan that
+ * gets the lock and finds its queue file was taken has nothing left to
+ * do.  A queue file written after the others were taken is found by
+ * its own pvscan, which then takes the queue in the same way.
+ */
+
+#define PVS_QUEUE_LOCK PVS_QUEUE_DIR "/.lock"
+
+int online_queue_add(struct cmd_context *cmd, struct dm_list *args,
+		     char *path, size_t path_size)
+{
+	char tmp_path[PATH_MAX];
+	struct dm_str_list *sl;
+	FILE *fp;
+
+	if (!dir_create_recursive(PVS_QUEUE_DIR, 0755))
+		return_0;
+
+	if ((dm_snprintf(path, path_size, "%s/%d", PVS_QUEUE_DIR, getpid()) < 0) ||
+	    (dm_snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) < 0))
+		return_0;
+
+	/* The queue file appears whole, or not at all. */
+	if (!(fp = fopen(tmp_path, "w"))) {
+		log_sys_debug("fopen", tmp_path);
+		return 0;
+	}
+
+	dm_list_iterate_items(sl, args)
+		fprintf(fp, "%s\n", sl->str);
+
+	if (fclose(fp)) {
+		log_sys_debug("fclose", tmp_path);
+		goto bad;
+	}
+
+	if (rename(tmp_path, path)) {
+		log_sys_debug("rename", tmp_path);
+		goto bad;
+	}
+
+	log_debug("Queued %d pvscan args in %s.", dm_list_size(args), path);
+
+	return 1;
+bad:
+	if (unlink(tmp_path))
+		log_sys_debug("unlink", tmp_path);
+	return 0;
+}
+
+/*
+ * Returns the fd holding the queue lock, or -1.
+ */
+int online_queue_lock(struct cmd_context *cmd)
+{
+	int fd;
+
+	if ((fd = open(PVS_QUEUE_LOCK, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
+		log_sys_debug("open", PVS_QUEUE_LOCK);
+		return -1;
+	}
+
+	if (flock(fd, LOCK_EX)) {
+		log_sys_debug("flock", PVS_QUEUE_LOCK);
+		if (close(fd))
+			log_sys_debug("close", PVS_QUEUE_LOCK);
+		return -1;
+	}
+
+	return fd;
+}
+
+void online_queue_unlock(int fd)
+{
+	if (fd < 0)
+		return;
+
+	if (flock(fd, LOCK_UN))
+		log_sys_debug("flock", PVS_QUEUE_LOCK);
+
+	if (close(fd))
+		log_sys_debug("close", PVS_QUEUE_LOCK);
+}
+
+/*
+ * Take the args from all queue files, removing the files.
+ * The args are added to the list allocated from cmd->mem.
+ * Returns the number of queue files taken.
+ */
+int online_queue_take(struct cmd_context *cmd, struct dm_list *args)
+{
+	char path[PATH_MAX];
+	char line[PATH_MAX];
+	DIR *dir;
+	struct dirent *de;
+	FILE *fp;
+	size_t len;
+	int count = 0;
+
+	if (!(dir = opendir(PVS_QUEUE_DIR)))
+		return 0;
+
+	while ((de = readdir(dir))) {
+		if (de->d_name[0] == '.')
+			continue;
+
+		/* Still being written, its pvscan will find it. */
+		if (strstr(de->d_name, ".tmp"))
+			continue;
+
+		if (dm_snprintf(path, sizeof(path), "%s/%s", PVS_QUEUE_DIR, de->d_name) < 0)
+			continue;
+
+		if (!(fp = fopen(path, "r"))) {
+			log_sys_debug("fopen", path);
+			continue;
+		}
+
+		while (fgets(line, sizeof(line), fp)) {
+			if ((len = strlen(line)) && (line[len - 1] == '\n'))
+				line[--len] = '\0';
+			if (!len)
+				continue;
+			if (!str_list_add_no_dup_check(cmd->mem, args, dm_pool_strdup(cmd->mem, line)))
+				stack;
+		}
+
+		if (fclose(fp))
+			log_sys_debug("fclose", path);
+
+		if (unlink(path))
+			log_sys_debug("unlink", path);
+
+		log_debug("Took pvscan queue file %s.", path);
+		count++;
+	}
+
+	if (closedir(dir))
+		log_sys_debug("closedir", PVS_QUEUE_DIR);
+
+	return count;
+}
@@ -53,11 +53,20 @@ int online_vg_file_create(struct cmd_context *cmd, const char *vgname);
 void online_vg_file_remove(const char *vgname);
 int online_pvid_file_create(struct cmd_context *cmd, struct device *dev, const char *vgname);
 int online_pvid_file_exists(const char *pvid);
+int online_pvid_get(const char *pvid, unsigned *major, unsigned *minor, char *vgname, char *devname);
+int online_vg_count(const char *vgname, unsigned *pvs, unsigned *nameless);
+void online_pvid_file_remove_devno(unsigned major, unsigned minor);
+void online_table_clear(void);
 void online_dir_setup(struct cmd_context *cmd);
 int get_pvs_online(struct dm_list *pvs_online, const char *vgname);
 int get_pvs_lookup(struct dm_list *pvs_online, const char *vgname);
 void free_po_list(struct dm_list *list);
 void online_lookup_file_remove(const char *vgname);
 void online_vgremove(struct volume_group *vg);
+int online_queue_add(struct cmd_context *cmd, struct dm_list *args,
+		     char *path, size_t path_size);
+int online_queue_lock(struct cmd_context *cmd);
+void online_queue_unlock(int fd);
+int online_queue_take(struct cmd_context *cmd, struct dm_list *args);
 
 #endif
@@ -17,6 +17,7 @@
 #include "lib/misc/lib.h"
 #include "lib/filters/filter.h"
 #include "lib/device/device.h"
+#include "lib/commands/toolcontext.h"
 
 static int _and_p(struct cmd_context *cmd, struct dev_filter *f, struct device *dev, const char *use_filter_name)
 {
@@ -29,6 +30,8 @@ static int _and_p(struct cmd_context *cmd, struct dev_filter *f, struct device *
 	for (filters = (struct dev_filter **) f->private; *filters; ++filters) {
 		if (use_filter_name && strcmp((*filters)->name, use_filter_name))
 			continue;
+		if (cmd->filter_data_only && !(*filters)->needs_data)
+			continue;
 		ret = (*filters)->passes_filter(cmd, *filters, dev, use_filter_name);
 
 		if (!ret) {
@@ -64,6 +64,7 @@ struct dev_filter *partitioned_filter_create(struct dev_types *dt)
 	f->destroy = _partitioned_filter_destroy;
 	f->use_count = 0;
 	f->name = "partitioned";
+	f->needs_data = 1;
 
 	log_debug_devs("Partitioned filter initialised.");
 
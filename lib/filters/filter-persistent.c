@@ -16,12 +16,43 @@
 #include "base/memory/zalloc.h"
 #include "lib/datastruct/radix-tree.h"
 #include "lib/misc/lib.h"
+#include "lib/misc/crc.h"
 #include "lib/filters/filter.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/config/config.h"
+#include "lib/device/dev-sysfs.h"
+#include "lvm-version.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * Verdict of the nodata filters for a device, saved in the filter cache
+ * file together with a hash of everything the verdict depends on.
+ */
+struct saved_verdict {
+	dev_t devt;
+	uint32_t inputs_hash;
+	uint32_t filtered_flags;
+	unsigned pass:1;
+	unsigned valid:1;	/* pass and filtered_flags are set for inputs_hash */
+	unsigned checked:1;	/* inputs_hash was computed by this command */
+};
 
 struct pfilter {
 	struct radix_tree *devices;
 	struct dev_filter *real;
 	struct dev_types *dt;
+
+	/* The filter cache file, loaded by each command that uses it. */
+	struct dm_pool *mem;
+	struct dm_hash_table *saved;	/* saved_verdict by devt */
+	uint32_t config_hash;
+	unsigned hits;
+	unsigned misses;
+	unsigned loaded:1;
+	unsigned enabled:1;
+	unsigned dirty:1;
 };
 
 /*
@@ -77,9 +108,457 @@ static void _persistent_filter_wipe(struct cmd_context *cmd, struct dev_filter *
 	}
 }
 
+/*
+ * The filter cache file saves the verdict of the filters that do not need
+ * data from the device (regex, type, deviceid, sysfs, usable, mpath) so
+ * that later commands do not evaluate them again for devices that have
+ * not changed.
+ *
+ * The file is only used when it was written with the same config_hash.
+ * This covers the filter settings, the devices file and multipath wwids
+ * file (by stat), and the set of dm and md devices, which are the devices
+ * that can become holders of other devices.  Each saved verdict is used
+ * only when the hash of the inputs of the device is unchanged: devno,
+ * names, sysfs path and size, devices file match, and the udev db entry
+ * when udev is the external device info source.  dm devices are never
+ * saved because their state (suspended, error target, etc) can change
+ * at any time.
+ *
+ * When the saved verdict passed the device, the filters run after the
+ * device is read only check the filters that need data.
+ *
+ * The file is rewritten at the end of a command that evaluated devices
+ * the file did not have.  A new file is written under a temporary name
+ * and renamed into place, so no lock is needed.
+ *
+ * File format:
+ *
+ * filter_cache_version: <major>.<minor>
+ * config_hash: <hash>
+ * dev: <major>:<minor> <inputs_hash> <pass> <filtered_flags>
+ */
+
+static const char _filter_cache_file[] = DEFAULT_RUN_DIR "/filtercache";
+static const char _udev_db_dir[] = "/run/udev/data";
+
+#define FILTER_CACHE_VERSION_MAJOR 1
+#define FILTER_CACHE_VERSION_MINOR 0
+
+#define FILTER_CACHE_LINE_LEN 128
+
+/* Config settings used by the nodata filters. */
+static const int _config_ids[] = {
+	devices_global_filter_CFG,
+	devices_filter_CFG,
+	devices_types_CFG,
+	devices_sysfs_scan_CFG,
+	devices_scan_lvs_CFG,
+	devices_pv_min_size_CFG,
+	devices_external_device_info_source_CFG,
+	devices_multipath_component_detection_CFG,
+	devices_multipath_wwids_file_CFG,
+	devices_ignore_suspended_devices_CFG,
+	devices_ignore_lvm_mirrors_CFG,
+	devices_use_devicesfile_CFG,
+	devices_devicesfile_CFG,
+};
+
+static uint32_t _hash_stat(uint32_t hash, const char *path)
+{
+	struct stat info;
+	uint64_t st[4] = { 0 };
+
+	if (path && *path && !stat(path, &info)) {
+		st[0] = (uint64_t) info.st_ino;
+		st[1] = (uint64_t) info.st_size;
+		st[2] = (uint64_t) info.st_mtim.tv_sec;
+		st[3] = (uint64_t) info.st_mtim.tv_nsec;
+	}
+
+	return calc_crc(hash, (const uint8_t *)st, sizeof(st));
+}
+
+static uint32_t _config_hash(struct cmd_context *cmd, struct pfilter *pf)
+{
+	const struct dm_config_node *cn;
+	const struct dm_config_value *cv;
+	struct dev_iter *iter;
+	struct device *dev;
+	uint32_t hash = INITIAL_CRC;
+	unsigned i, flags;
+
+	hash = calc_crc(hash, (const uint8_t *)LVM_VERSION, strlen(LVM_VERSION));
+
+	for (i = 0; i < DM_ARRAY_SIZE(_config_ids); i++) {
+		hash = calc_crc(hash, (const uint8_t *)&i, sizeof(i));
+		if (!(cn = find_config_tree_node(cmd, _config_ids[i], NULL)))
+			continue;
+		for (cv = cn->v; cv; cv = cv->next) {
+			if (cv->type == DM_CFG_STRING)
+				hash = calc_crc(hash, (const uint8_t *)cv->v.str, strlen(cv->v.str) + 1);
+			else if (cv->type == DM_CFG_INT)
+				hash = calc_crc(hash, (const uint8_t *)&cv->v.i, sizeof(cv->v.i));
+			else if (cv->type == DM_CFG_FLOAT)
+				hash = calc_crc(hash, (const uint8_t *)&cv->v.f, sizeof(cv->v.f));
+		}
+	}
+
+	flags = cmd->scan_lvs | (cmd->enable_devices_file << 1) |
+		(cmd->filter_regex_with_devices_file << 2);
+	hash = calc_crc(hash, (const uint8_t *)&flags, sizeof(flags));
+
+	if (cmd->enable_devices_file)
+		hash = _hash_stat(hash, cmd->devices_file_path);
+
+	hash = _hash_stat(hash, find_config_tree_str(cmd, devices_multipath_wwids_file_CFG, NULL));
+
+	/* Devices that can be holders of other devices. */
+	if ((iter = dev_iter_create(NULL, 0))) {
+		while ((dev = dev_iter_get(cmd, iter)))
+			if (dm_is_dm_major(MAJOR(dev->dev)) ||
+			    (MAJOR(dev->dev) == pf->dt->md_major))
+				hash = calc_crc(hash, (const uint8_t *)&dev->dev, sizeof(dev->dev));
+		dev_iter_destroy(iter);
+	}
+
+	return hash;
+}
+
+/*
+ * Returns 0 if the verdict for dev cannot be saved.
+ */
+static int _inputs_hash(struct device *dev, uint32_t *hash_ret)
+{
+	char buf[PATH_MAX];
+	struct dm_str_list *sl;
+	uint32_t hash = INITIAL_CRC;
+	uint32_t flags;
+	int len;
+
+	if (dm_is_dm_major(MAJOR(dev->dev)) || (dev->flags & DEV_REGULAR))
+		return 0;
+
+	hash = calc_crc(hash, (const uint8_t *)&dev->dev, sizeof(dev->dev));
+
+	dm_list_iterate_items(sl, &dev->aliases)
+		hash = calc_crc(hash, (const uint8_t *)sl->str, strlen(sl->str) + 1);
+
+	/* The sysfs path of the device and its size, from the sysfs cache. */
+	if ((len = sysfs_attr_read(dev->dev, "", buf, sizeof(buf))) <= 0)
+		return 0;
+	if (len > (int) sizeof(buf))
+		len = sizeof(buf);
+	hash = calc_crc(hash, (const uint8_t *)buf, len);
+
+	if (!sysfs_attr_value(dev->dev, "size", buf, sizeof(buf)))
+		return 0;
+	hash = calc_crc(hash, (const uint8_t *)buf, strlen(buf));
+
+	/* The deviceid filter passes devs matched to the devices file. */
+	flags = dev->flags & DEV_MATCHED_USE_ID;
+	hash = calc_crc(hash, (const uint8_t *)&flags, sizeof(flags));
+
+	if (external_device_info_source() == DEV_EXT_UDEV) {
+		if (dm_snprintf(buf, sizeof(buf), "%s/b%u:%u", _udev_db_dir,
+				MAJOR(dev->dev), MINOR(dev->dev)) < 0)
+			return 0;
+		hash = _hash_stat(hash, buf);
+	}
+
+	*hash_ret = hash;
+	return 1;
+}
+
+static struct saved_verdict *_add_saved(struct pfilter *pf, dev_t devt)
+{
+	struct saved_verdict *sv;
+
+	if (!(sv = dm_pool_zalloc(pf->mem, sizeof(*sv))))
+		return_NULL;
+
+	sv->devt = devt;
+
+	if (!dm_hash_insert_binary(pf->saved, &sv->devt, sizeof(sv->devt), sv))
+		return_NULL;
+
+	return sv;
+}
+
+static void _read_filter_cache_file(struct pfilter *pf)
+{
+	char line[FILTER_CACHE_LINE_LEN];
+	struct saved_verdict *sv;
+	FILE *fp;
+	unsigned hv_major, hv_minor, hash, flags, pass;
+	unsigned major, minor;
+	unsigned count = 0, bad = 0;
+	dev_t devt;
+	int version_ok = 0;
+
+	if (!(fp = fopen(_filter_cache_file, "r"))) {
+		if (errno != ENOENT)
+			log_debug("filter_cache open errno %d %s", errno, _filter_cache_file);
+		pf->dirty = 1;
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#')
+			continue;
+
+		if (sscanf(line, "filter_cache_version: %u.%u", &hv_major, &hv_minor) == 2) {
+			if (hv_major != FILTER_CACHE_VERSION_MAJOR) {
+				log_debug("Ignoring filter cache with unknown version.");
+				break;
+			}
+			version_ok = 1;
+			continue;
+		}
+
+		if (!version_ok)
+			break;
+
+		if (sscanf(line, "config_hash: %x", &hash) == 1) {
+			if (hash != pf->config_hash) {
+				log_debug_devs("Ignoring filter cache for different config.");
+				break;
+			}
+			version_ok = 2;
+			continue;
+		}
+
+		if (version_ok != 2)
+			break;
+
+		if (sscanf(line, "dev: %u:%u %x %u %x", &major, &minor, &hash, &pass, &flags) != 5) {
+			bad++;
+			continue;
+		}
+
+		devt = MKDEV(major, minor);
+		if (dm_hash_lookup_binary(pf->saved, &devt, sizeof(devt)) ||
+		    !(sv = _add_saved(pf, devt))) {
+			bad++;
+			continue;
+		}
+
+		sv->inputs_hash = hash;
+		sv->pass = pass ? 1 : 0;
+		sv->filtered_flags = flags;
+		sv->valid = 1;
+		count++;
+	}
+
+	if (fclose(fp))
+		log_debug("filter_cache close errno %d %s", errno, _filter_cache_file);
+
+	/* The file is replaced when it is not for this config. */
+	if (version_ok != 2 || bad)
+		pf->dirty = 1;
+
+	log_debug_devs("Read filter cache with %u devices.", count);
+}
+
+static void _free_saved(struct pfilter *pf)
+{
+	if (pf->saved)
+		dm_hash_destroy(pf->saved);
+	if (pf->mem)
+		dm_pool_destroy(pf->mem);
+
+	pf->saved = NULL;
+	pf->mem = NULL;
+	pf->hits = pf->misses = 0;
+	pf->loaded = pf->enabled = pf->dirty = 0;
+}
+
+/*
+ * Returns 1 if this command can use the filter cache.
+ */
+static int _load_saved(struct cmd_context *cmd, struct pfilter *pf)
+{
+	/*
+	 * Options that change the filters for one command, and
+	 * callers that skip some filters, do not use the cache.
+	 */
+	if (cmd->enable_devices_list || cmd->devicesfile ||
+	    cmd->filter_regex_skip || cmd->filter_deviceid_skip)
+		return 0;
+
+	if (pf->loaded)
+		return pf->enabled;
+
+	pf->loaded = 1;
+
+	if (!find_config_tree_bool(cmd, devices_filter_cache_CFG, NULL))
+		return 0;
+
+	if (!(pf->mem = dm_pool_create("filter_cache", 4096)) ||
+	    !(pf->saved = dm_hash_create(1024))) {
+		_free_saved(pf);
+		pf->loaded = 1;
+		return_0;
+	}
+
+	pf->enabled = 1;
+	pf->config_hash = _config_hash(cmd, pf);
+
+	_read_filter_cache_file(pf);
+
+	return 1;
+}
+
+/*
+ * Nodata filtering.  Returns 1 with *pass set from the filter cache, or
+ * 0 with *sv_ret set to the entry that the new verdict should be saved in
+ * (NULL if it cannot be saved).
+ */
+static int _saved_lookup(struct cmd_context *cmd, struct pfilter *pf, struct device *dev,
+			 int *pass, struct saved_verdict **sv_ret)
+{
+	struct saved_verdict *sv;
+	uint32_t hash;
+
+	*sv_ret = NULL;
+
+	if (!_load_saved(cmd, pf) || !_inputs_hash(dev, &hash))
+		return 0;
+
+	if (!(sv = dm_hash_lookup_binary(pf->saved, &dev->dev, sizeof(dev->dev))) &&
+	    !(sv = _add_saved(pf, dev->dev)))
+		return_0;
+
+	if (sv->valid && (sv->inputs_hash == hash)) {
+		sv->checked = 1;
+		*pass = sv->pass;
+		dev->filtered_flags = sv->filtered_flags;
+		pf->hits++;
+		return 1;
+	}
+
+	if (sv->valid)
+		log_debug_devs("%s: filter cache entry is stale.", dev_name(dev));
+
+	sv->inputs_hash = hash;
+	sv->valid = 0;
+	sv->checked = 1;
+	pf->misses++;
+	*sv_ret = sv;
+
+	return 0;
+}
+
+static void _saved_update(struct pfilter *pf, struct device *dev, struct saved_verdict *sv, int pass)
+{
+	/*
+	 * Keep evaluating mpath components that are in the devices file
+	 * so that the warning about the misconfiguration is repeated.
+	 */
+	if ((dev->filtered_flags & DEV_FILTERED_MPATH_COMPONENT) &&
+	    (dev->flags & DEV_MATCHED_USE_ID))
+		return;
+
+	sv->pass = pass;
+	sv->filtered_flags = dev->filtered_flags;
+	sv->valid = 1;
+	pf->dirty = 1;
+}
+
+/*
+ * Returns 1 if the nodata filters passed dev in this command.
+ */
+static int _saved_passed(struct pfilter *pf, struct device *dev)
+{
+	struct saved_verdict *sv;
+
+	if (!pf->enabled)
+		return 0;
+
+	if (!(sv = dm_hash_lookup_binary(pf->saved, &dev->dev, sizeof(dev->dev))))
+		return 0;
+
+	return sv->checked && sv->valid && sv->pass;
+}
+
+static int _write_filter_cache_file(struct cmd_context *cmd, struct pfilter *pf, const char *path)
+{
+	struct dm_hash_node *n;
+	struct saved_verdict *sv;
+	FILE *fp;
+	time_t t;
+	int ret = 1;
+
+	if (!(fp = fopen(path, "w"))) {
+		log_debug("filter_cache open errno %d %s", errno, path);
+		return 0;
+	}
+
+	t = time(NULL);
+	fprintf(fp, "# Created by %s pid %d %s", cmd->name, getpid(), ctime(&t));
+	fprintf(fp, "filter_cache_version: %d.%d\n", FILTER_CACHE_VERSION_MAJOR, FILTER_CACHE_VERSION_MINOR);
+	fprintf(fp, "config_hash: %x\n", pf->config_hash);
+
+	dm_hash_iterate(n, pf->saved) {
+		sv = dm_hash_get_data(pf->saved, n);
+		if (!sv->valid)
+			continue;
+		fprintf(fp, "dev: %u:%u %x %u %x\n", MAJOR(sv->devt), MINOR(sv->devt),
+			sv->inputs_hash, sv->pass, sv->filtered_flags);
+	}
+
+	if (fflush(fp) || ferror(fp)) {
+		log_debug("filter_cache write errno %d %s", errno, path);
+		ret = 0;
+	}
+
+	if (fclose(fp)) {
+		log_debug("filter_cache close errno %d %s", errno, path);
+		ret = 0;
+	}
+
+	return ret;
+}
+
+/*
+ * Called at the end of each command.  The next command loads the file
+ * again, since the config or devices may have changed in between.
+ */
+void persistent_filter_dump(struct cmd_context *cmd, struct dev_filter *f)
+{
+	struct pfilter *pf = (struct pfilter *) f->private;
+	char tmp_path[PATH_MAX];
+
+	if (!pf->enabled)
+		goto out;
+
+	log_debug_devs("Filter cache used %u saved verdicts, evaluated %u devices.",
+		       pf->hits, pf->misses);
+
+	if (!pf->dirty)
+		goto out;
+
+	if (dm_snprintf(tmp_path, sizeof(tmp_path), "%s.%d", _filter_cache_file, getpid()) < 0)
+		goto out;
+
+	if (!_write_filter_cache_file(cmd, pf, tmp_path)) {
+		if (unlink(tmp_path) && errno != ENOENT)
+			log_debug("filter_cache unlink errno %d %s", errno, tmp_path);
+		goto out;
+	}
+
+	if (rename(tmp_path, _filter_cache_file)) {
+		log_debug("filter_cache rename errno %d %s", errno, _filter_cache_file);
+		if (unlink(tmp_path))
+			log_debug("filter_cache unlink errno %d %s", errno, tmp_path);
+	}
+ out:
+	_free_saved(pf);
+}
+
 static int _lookup_p(struct cmd_context *cmd, struct dev_filter *f, struct device *dev, const char *use_filter_name)
 {
 	struct pfilter *pf = (struct pfilter *) f->private;
+	struct saved_verdict *sv = NULL;
 	void *l;
 	struct dm_str_list *sl;
 	int pass = 1;
@@ -110,7 +589,23 @@ static int _lookup_p(struct cmd_context *cmd, struct dev_filter *f, struct devic
 
 	/* Uncached, check filters and cache the result */
 	if (!l) {
-		pass = pf->real->passes_filter(cmd, pf->real, dev, use_filter_name);
+		if (cmd->filter_nodata_only) {
+			if (_saved_lookup(cmd, pf, dev, &pass, &sv)) {
+				log_debug_devs("%s: filter cache using saved %s.",
+					       devname, pass ? "good" : "bad");
+				l = pass ? PF_GOOD_DEVICE : PF_BAD_DEVICE;
+				goto insert;
+			}
+			pass = pf->real->passes_filter(cmd, pf->real, dev, use_filter_name);
+			if (sv && (pass == 0 || pass == 1))
+				_saved_update(pf, dev, sv, pass);
+		} else if (_saved_passed(pf, dev)) {
+			/* The nodata filters have passed dev already. */
+			cmd->filter_data_only = 1;
+			pass = pf->real->passes_filter(cmd, pf->real, dev, use_filter_name);
+			cmd->filter_data_only = 0;
+		} else
+			pass = pf->real->passes_filter(cmd, pf->real, dev, use_filter_name);
 
 		if (!pass) {
 			/*
@@ -130,7 +625,7 @@ static int _lookup_p(struct cmd_context *cmd, struct dev_filter *f, struct devic
 
 		if (!dev->filtered_flags) /* skipping reason already logged by filter */
 			log_debug_devs("filter caching %s %s.", pass ? "good" : "bad", devname);
-
+ insert:
 		dm_list_iterate_items(sl, &dev->aliases)
 			if (!radix_tree_insert_ptr(pf->devices, sl->str, strlen(sl->str), l)) {
 				log_error("Failed to hash alias to filter.");
@@ -149,6 +644,7 @@ static void _persistent_destroy(struct dev_filter *f)
 		log_error(INTERNAL_ERROR "Destroying persistent filter while in use %u times.", f->use_count);
 
 	radix_tree_destroy(pf->devices);
+	_free_saved(pf);
 	pf->real->destroy(pf->real);
 	free(pf);
 	free(f);
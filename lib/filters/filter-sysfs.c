@@ -14,15 +14,12 @@
 
 #include "lib/misc/lib.h"
 #include "lib/filters/filter.h"
+#include "lib/device/dev-sysfs.h"
 
 #ifdef __linux__
 
 static int _accept_p(struct cmd_context *cmd, struct dev_filter *f, struct device *dev, const char *use_filter_name)
 {
-	char path[PATH_MAX];
-	const char *sysfs_dir = f->private;
-	struct stat info;
-
 	dev->filtered_flags &= ~DEV_FILTERED_SYSFS;
 
 	/*
@@ -32,13 +29,8 @@ static int _accept_p(struct cmd_context *cmd, struct dev_filter *f, struct devic
 	if (dev->id && dev->id->idtype && (dev->id->idtype != DEV_ID_TYPE_DEVNAME))
 		return 1;
 
-	if (dm_snprintf(path, sizeof(path), "%sdev/block/%u:%u",
-			sysfs_dir, MAJOR(dev->dev), MINOR(dev->dev)) < 0) {
-		log_debug("failed to create sysfs path");
-		return 1;
-	}
-
-	if (lstat(path, &info)) {
+	/* The sysfs cache reads dm_sysfs_dir(), which the filter was created with. */
+	if (sysfs_attr_read(dev->dev, "", NULL, 0) < 0) {
 		log_debug_devs("%s: Skipping (sysfs)", dev_name(dev));
 		dev->filtered_flags |= DEV_FILTERED_SYSFS;
 		return 0;
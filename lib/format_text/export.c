@@ -26,6 +26,7 @@
 #include "lib/device/device_id.h"
 #include "libdaemon/client/config-util.h"
 #include "lib/datastruct/radix-tree.h"
+#include "lib/misc/crc.h"
 
 #include <stdarg.h>
 #include <time.h>
@@ -49,6 +50,44 @@ typedef int (*nl_fn) (struct formatter * f);
 		va_end(ap); \
 	} while (r == -1)
 
+/*
+ * Raw text of an LV section from a previous raw export of the VG.
+ * The key holds every value the section is rendered from, so the text
+ * is reused when the key is unchanged.
+ *
+ * Sections are grouped in chunks, each starting at a section whose LV
+ * is chosen by its uuid.  The head of a chunk keeps the CRC of the
+ * chunk text, so a chunk of unchanged sections in unchanged order is
+ * added to the checksum of the metadata without reading it.
+ */
+struct lv_text {
+	const struct logical_volume *lv;
+	unsigned generation;	/* last export using the text */
+	unsigned seq;		/* position among LV sections in that export */
+	unsigned chunk_count;	/* sections in the chunk of a head */
+	uint32_t chunk_len;
+	uint32_t chunk_crc;	/* calc_crc(0, ...) of the chunk text */
+	size_t key_len;
+	size_t text_len;
+	char data[];		/* key followed by text */
+};
+
+struct export_cache {
+	struct dm_hash_table *lvs;	/* struct logical_volume * -> struct lv_text */
+	unsigned generation;
+	unsigned seq;
+	unsigned used;			/* entries used by the current export */
+
+	/* Chunk being exported */
+	struct lv_text *chunk;
+	unsigned chunk_seq;		/* seq of the head in the previous export */
+	unsigned chunk_count;
+	uint32_t chunk_start;
+	int chunk_unchanged;
+};
+
+#define LV_TEXT_CHUNK_MASK 31
+
 /*
  * The first half of this file deals with
  * exporting the vg, ie. writing it to a file.
@@ -56,6 +95,14 @@ typedef int (*nl_fn) (struct formatter * f);
 struct formatter {
 	struct radix_tree *pv_idx;	/* dev_name id -> pv_name (eg, pv1) */
 
+	/* Raw export only */
+	struct export_cache *cache;
+	char *key;			/* key of the LV being exported */
+	size_t key_size;
+	size_t key_used;
+	uint32_t crc;			/* calc_crc() of the buffer up to crc_done */
+	uint32_t crc_done;
+
 	union {
 		FILE *fp;	/* where we're writing to */
 		struct {
@@ -792,6 +839,280 @@ static int _print_lv(struct formatter *f, struct logical_volume *lv)
 	return 1;
 }
 
+static int _key_add(struct formatter *f, const void *data, size_t len)
+{
+	char *key;
+	size_t size;
+
+	if (f->key_used + len > f->key_size) {
+		size = f->key_size ? f->key_size * 2 : 1024;
+		while (f->key_used + len > size)
+			size *= 2;
+		if (!(key = realloc(f->key, size)))
+			return 0;
+		f->key = key;
+		f->key_size = size;
+	}
+
+	memcpy(f->key + f->key_used, data, len);
+	f->key_used += len;
+
+	return 1;
+}
+
+static int _key_add_u64(struct formatter *f, uint64_t v)
+{
+	return _key_add(f, &v, sizeof(v));
+}
+
+/* Length prefixed, so NULL and "" differ and strings can't run together */
+static int _key_add_str(struct formatter *f, const char *str)
+{
+	size_t len = str ? strlen(str) + 1 : 0;
+
+	return _key_add_u64(f, len) && _key_add(f, str, len);
+}
+
+static int _key_add_str_list(struct formatter *f, const struct dm_list *list)
+{
+	const struct dm_str_list *sl;
+
+	if (!_key_add_u64(f, dm_list_size(list)))
+		return 0;
+
+	dm_list_iterate_items(sl, list)
+		if (!_key_add_str(f, sl->str))
+			return 0;
+
+	return 1;
+}
+
+/*
+ * Build the key from everything _print_lv() prints for the LV.
+ * Returns 0 if the LV has segments of a type with its own text_export
+ * (other than striped), which can print any segment field; those LVs
+ * are always printed.
+ */
+static int _lv_text_key(struct formatter *f, const struct logical_volume *lv)
+{
+	const struct lv_segment *seg;
+	uint32_t s;
+	int idx;
+
+	f->key_used = 0;
+
+	dm_list_iterate_items(seg, &lv->segments)
+		if (seg->segtype->ops->text_export &&
+		    (!seg_is_striped(seg) || seg_is_raid(seg)))
+			return 0;
+
+	if (!_key_add_str(f, lv->name) ||
+	    !_key_add(f, &lv->lvid.id[1], sizeof(lv->lvid.id[1])) ||
+	    !_key_add_u64(f, lv->status) ||
+	    !_key_add_u64(f, vg_flag_write_locked(lv->vg)) ||
+	    !_key_add_str_list(f, &lv->tags) ||
+	    !_key_add_u64(f, (uint64_t) lv->timestamp) ||
+	    !_key_add_str(f, lv->timestamp ? lv->hostname : NULL) ||
+	    !_key_add_str(f, lv->lock_args) ||
+	    !_key_add_u64(f, lv->alloc) ||
+	    !_key_add_str(f, lv->profile ? lv->profile->name : NULL) ||
+	    !_key_add_u64(f, lv->read_ahead) ||
+	    !_key_add_u64(f, (uint64_t) lv->major) ||
+	    !_key_add_u64(f, (uint64_t) lv->minor) ||
+	    !_key_add_u64(f, dm_list_size(&lv->segments)))
+		return 0;
+
+	dm_list_iterate_items(seg, &lv->segments) {
+		if (!_key_add_u64(f, seg->le) ||
+		    !_key_add_u64(f, seg->len) ||
+		    !_key_add_u64(f, seg->reshape_len) ||
+		    !_key_add_str(f, seg->segtype->name) ||
+		    !_key_add_str_list(f, &seg->tags) ||
+		    !_key_add_u64(f, seg->area_count) ||
+		    !_key_add_u64(f, seg->stripe_size))
+			return 0;
+
+		if (!seg->segtype->ops->text_export)
+			continue;
+
+		for (s = 0; s < seg->area_count; s++) {
+			if (!_key_add_u64(f, seg_type(seg, s)))
+				return 0;
+
+			switch (seg_type(seg, s)) {
+			case AREA_PV:
+				if (!seg_pv(seg, s) || ((idx = _get_pv_idx(f, seg_pv(seg, s))) < 0) ||
+				    !_key_add_u64(f, (uint64_t) idx) ||
+				    !_key_add_u64(f, seg_pe(seg, s)))
+					return 0;
+				break;
+			case AREA_LV:
+				if (!_key_add_str(f, seg_lv(seg, s)->name) ||
+				    !_key_add_u64(f, seg_le(seg, s)))
+					return 0;
+				break;
+			default:
+				/* Let _print_lv() report it. */
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void _crc_to(struct formatter *f, uint32_t end)
+{
+	f->crc = calc_crc(f->crc, (const uint8_t *) f->data.buf.start + f->crc_done,
+			  end - f->crc_done);
+	f->crc_done = end;
+}
+
+/*
+ * Add the chunk ending at the current position to the checksum, reusing
+ * the CRC saved in its head when the chunk is the same as last time.
+ */
+static void _end_chunk(struct formatter *f)
+{
+	struct export_cache *ec = f->cache;
+	struct lv_text *head = ec->chunk;
+	uint32_t len = f->data.buf.used - ec->chunk_start;
+
+	if (!head)
+		return;
+
+	ec->chunk = NULL;
+	_crc_to(f, ec->chunk_start);
+
+	if (!ec->chunk_unchanged || (head->chunk_count != ec->chunk_count) ||
+	    (head->chunk_len != len)) {
+		head->chunk_crc = calc_crc(0, (const uint8_t *) f->data.buf.start + ec->chunk_start, len);
+		head->chunk_len = len;
+		head->chunk_count = ec->chunk_count;
+	}
+
+	f->crc = calc_crc_combine(f->crc, head->chunk_crc, len);
+	f->crc_done = f->data.buf.used;
+}
+
+static int _append_text(struct formatter *f, const char *text, size_t len)
+{
+	while (f->data.buf.used + len + 2 > f->data.buf.size)
+		if (!_extend_buffer(f))
+			return_0;
+
+	memcpy(f->data.buf.start + f->data.buf.used, text, len);
+	f->data.buf.used += len;
+	f->data.buf.start[f->data.buf.used] = '\0';
+
+	return 1;
+}
+
+static int _is_chunk_head(const struct logical_volume *lv)
+{
+	return !(calc_crc(0, (const uint8_t *) &lv->lvid.id[1], sizeof(lv->lvid.id[1])) &
+		 LV_TEXT_CHUNK_MASK);
+}
+
+static struct lv_text *_save_lv_text(struct formatter *f, const struct logical_volume *lv,
+				     struct lv_text *old, uint32_t start)
+{
+	struct export_cache *ec = f->cache;
+	size_t text_len = f->data.buf.used - start;
+	struct lv_text *lt;
+
+	if (old) {
+		dm_hash_remove_binary(ec->lvs, &lv, sizeof(lv));
+		free(old);
+	}
+
+	if (!(lt = malloc(sizeof(*lt) + f->key_used + text_len)))
+		return NULL;
+
+	memset(lt, 0, sizeof(*lt));
+	lt->lv = lv;
+	lt->key_len = f->key_used;
+	lt->text_len = text_len;
+	memcpy(lt->data, f->key, f->key_used);
+	memcpy(lt->data + f->key_used, f->data.buf.start + start, text_len);
+
+	if (!dm_hash_insert_binary(ec->lvs, &lv, sizeof(lv), lt)) {
+		free(lt);
+		return NULL;
+	}
+
+	return lt;
+}
+
+/*
+ * Print an LV section in a raw export, reusing the text from the
+ * previous export of the VG if the LV is unchanged.
+ */
+static int _print_lv_section(struct formatter *f, struct logical_volume *lv)
+{
+	struct export_cache *ec = f->cache;
+	struct lv_text *lt = NULL;
+	uint32_t start = f->data.buf.used;
+	unsigned seq = ec->seq++;
+	int keyed, head = 0, unchanged = 0;
+
+	if ((keyed = _lv_text_key(f, lv))) {
+		head = _is_chunk_head(lv);
+		if ((lt = dm_hash_lookup_binary(ec->lvs, &lv, sizeof(lv))) &&
+		    (lt->key_len == f->key_used) && !memcmp(lt->data, f->key, f->key_used))
+			unchanged = 1;
+	}
+
+	if (head)
+		_end_chunk(f);
+
+	if (unchanged) {
+		if (!_append_text(f, lt->data + lt->key_len, lt->text_len))
+			return_0;
+	} else {
+		if (!_print_lv(f, lv))
+			return_0;
+		if (keyed)
+			lt = _save_lv_text(f, lv, lt, start);
+		else
+			lt = NULL;
+	}
+
+	if (!lt) {
+		if (ec->chunk) {
+			ec->chunk_unchanged = 0;
+			ec->chunk_count++;
+		}
+		return 1;
+	}
+
+	if (head) {
+		ec->chunk = lt;
+		ec->chunk_seq = lt->seq;
+		ec->chunk_count = 1;
+		ec->chunk_start = start;
+		ec->chunk_unchanged = unchanged;
+	} else if (ec->chunk) {
+		if (!unchanged || (lt->seq != ec->chunk_seq + ec->chunk_count))
+			ec->chunk_unchanged = 0;
+		ec->chunk_count++;
+	}
+
+	lt->seq = seq;
+	lt->generation = ec->generation;
+	ec->used++;
+
+	return 1;
+}
+
+static int _print_lv_any(struct formatter *f, struct logical_volume *lv)
+{
+	if (f->cache)
+		return _print_lv_section(f, lv);
+
+	return _print_lv(f, lv);
+}
+
 static int _print_lvs(struct formatter *f, struct volume_group *vg)
 {
 	struct lv_list *lvl;
@@ -811,17 +1132,20 @@ static int _print_lvs(struct formatter *f, struct volume_group *vg)
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		if (!(lv_is_visible(lvl->lv)))
 			continue;
-		if (!_print_lv(f, lvl->lv))
+		if (!_print_lv_any(f, lvl->lv))
 			return_0;
 	}
 
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		if ((lv_is_visible(lvl->lv)))
 			continue;
-		if (!_print_lv(f, lvl->lv))
+		if (!_print_lv_any(f, lvl->lv))
 			return_0;
 	}
 
+	if (f->cache)
+		_end_chunk(f);
+
 	_dec_indent(f);
 	outf(f, "}");
 
@@ -1043,8 +1367,77 @@ int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp)
 	return r;
 }
 
-/* Returns amount of buffer used incl. terminating NUL */
-size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *buf_size)
+void export_cache_destroy(struct export_cache *ec)
+{
+	struct dm_hash_node *n;
+
+	if (!ec)
+		return;
+
+	dm_hash_iterate(n, ec->lvs)
+		free(dm_hash_get_data(ec->lvs, n));
+
+	dm_hash_destroy(ec->lvs);
+	free(ec);
+}
+
+static struct export_cache *_start_export_cache(struct volume_group *vg)
+{
+	struct export_cache *ec = vg->export_cache;
+
+	if (!ec) {
+		if (!(ec = zalloc(sizeof(*ec))))
+			return NULL;
+
+		if (!(ec->lvs = dm_hash_create(dm_list_size(&vg->lvs) + 64))) {
+			free(ec);
+			return NULL;
+		}
+
+		vg->export_cache = ec;
+	}
+
+	ec->generation++;
+	ec->seq = 0;
+	ec->used = 0;
+	ec->chunk = NULL;
+
+	return ec;
+}
+
+/* Drop the text of LVs that were not in the last export. */
+static void _end_export_cache(struct export_cache *ec)
+{
+	struct dm_hash_node *n;
+	struct lv_text *lt, **unused;
+	unsigned i, count = 0;
+
+	if (dm_hash_get_num_entries(ec->lvs) <= ec->used)
+		return;
+
+	if (!(unused = malloc(sizeof(*unused) * (dm_hash_get_num_entries(ec->lvs) - ec->used))))
+		return;
+
+	dm_hash_iterate(n, ec->lvs) {
+		lt = dm_hash_get_data(ec->lvs, n);
+		if (lt->generation != ec->generation)
+			unused[count++] = lt;
+	}
+
+	for (i = 0; i < count; i++) {
+		dm_hash_remove_binary(ec->lvs, &unused[i]->lv, sizeof(unused[i]->lv));
+		free(unused[i]);
+	}
+
+	free(unused);
+}
+
+/*
+ * Returns amount of buffer used incl. terminating NUL.
+ * The checksum of that is returned in checksum if it is set.
+ */
+size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *buf_size,
+			  uint32_t *checksum)
 {
 	size_t r;
 	struct formatter f = {
@@ -1062,23 +1455,40 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
 		return 0;
 	}
 
+	f.cache = _start_export_cache(vg);
+	f.crc = INITIAL_CRC;
+
 	if (!_text_vg_export(&f, vg, desc)) {
 		free(f.data.buf.start);
+		free(f.key);
+		/* The text of LVs is kept, but positions and chunks may be partly updated. */
+		export_cache_destroy(vg->export_cache);
+		vg->export_cache = NULL;
 		return 0;
 	}
 
+	free(f.key);
+
+	if (f.cache)
+		_end_export_cache(f.cache);
+
 	r = f.data.buf.used + 1;
 	*buf = f.data.buf.start;
 
 	if (buf_size)
 		*buf_size = f.data.buf.size;
 
+	if (checksum) {
+		_crc_to(&f, (uint32_t) r);
+		*checksum = f.crc;
+	}
+
 	return r;
 }
 
 static size_t _export_vg_to_buffer(struct volume_group *vg, char **buf)
 {
-	return text_vg_export_raw(vg, "", buf, NULL);
+	return text_vg_export_raw(vg, "", buf, NULL, NULL);
 }
 
 struct dm_config_tree *export_vg_to_config_tree(struct volume_group *vg)
@@ -27,6 +27,7 @@
 #include "lib/misc/crc.h"
 #include "lib/mm/xlate.h"
 #include "lib/label/label.h"
+#include "lib/label/scan_cache.h"
 #include "lib/cache/lvmcache.h"
 #include "libdaemon/client/config-util.h"
 
@@ -444,7 +445,7 @@ static struct volume_group *_vg_read_raw_area(struct cmd_context *cmd,
 	if (rlocn->offset + rlocn->size > mdah->size)
 		wrap = (uint32_t) ((rlocn->offset + rlocn->size) - mdah->size);
 
-	vg = text_read_metadata(fid, NULL, vg_fmtdata, use_previous_vg, area->dev, primary_mda,
+	vg = text_read_metadata(fid, NULL, vgname, vg_fmtdata, use_previous_vg, area->dev, primary_mda,
 				(off_t) (area->start + rlocn->offset),
 				(uint32_t) (rlocn->size - wrap),
 				(off_t) (area->start + MDA_HEADER_SIZE),
@@ -575,7 +576,6 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 			 struct metadata_area *mda)
 {
 	char desc[2048];
-	struct dm_config_tree *cft;
 	struct mda_context *mdac = (struct mda_context *) mda->metadata_locn;
 	struct text_fid_context *fidtc = (struct text_fid_context *) fid->private;
 	struct raw_locn *rlocn_old;
@@ -657,7 +657,7 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		else
 			(void) dm_snprintf(desc, sizeof(desc), "Write[%u] from %s.", vg->write_count, vg->cmd->cmd_line);
 
-		new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size);
+		new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size, &checksum);
 		if (!new_size || !write_buf) {
 			log_error("VG %s metadata writing failed", vg->name);
 			goto out;
@@ -672,17 +672,13 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		 *
 		 * 'Lazy' creation of such VG might improve performance, but we
 		 * lose important validation that written metadata can be parsed. */
-		if (!(cft = config_tree_from_string_without_dup_node_check(write_buf))) {
+		release_vg(vg->vg_precommitted);
+		if (!(vg->vg_precommitted = import_vg_from_text(vg->cmd, vg->fid, write_buf))) {
 			log_error("Error parsing metadata for VG %s.", vg->name);
 			goto out;
 		}
-		release_vg(vg->vg_precommitted);
-		vg->vg_precommitted = import_vg_from_config_tree(vg->cmd, vg->fid, cft);
-		dm_config_destroy(cft);
-		if (!vg->vg_precommitted)
-			goto_out;
 
-		fidtc->checksum = checksum = calc_crc(INITIAL_CRC, (uint8_t *)write_buf, new_size);
+		fidtc->checksum = checksum;
 	}
 
 	log_debug_metadata("VG %s seqno %u metadata write to %s mda_start %llu mda_size %llu mda_last %llu",
@@ -1587,6 +1583,18 @@ int read_metadata_location_summary(const struct format_type *fmt,
 	if (lvmcache_lookup_mda(vgsummary)) {
 		log_debug("Skipping read of already known VG metadata with matching mda checksum on %s.",
 			  dev_name(dev_area->dev));
+		goto save;
+	}
+
+	/*
+	 * A previous command may have saved the summary of this metadata
+	 * in the scan cache.  The entry is only used if the text location
+	 * and checksum in the mda_header are unchanged.
+	 */
+	if (scan_cache_lookup(fmt->cmd, dev_area->dev, dev_area->start,
+			      rlocn->offset, rlocn->size, rlocn->checksum, vgsummary)) {
+		log_debug("Skipping read of VG metadata with matching mda checksum in scan cache on %s.",
+			  dev_name(dev_area->dev));
 		goto out;
 	}
 
@@ -1609,6 +1617,9 @@ int read_metadata_location_summary(const struct format_type *fmt,
 			  (unsigned long long)(dev_area->start + rlocn->offset));
 		return 0;
 	}
+save:
+	scan_cache_save(fmt->cmd, dev_area->dev, dev_area->start,
+			rlocn->offset, rlocn->size, rlocn->checksum, vgsummary);
 out:
 	log_debug_metadata("Found metadata summary on %s at %llu size %llu for VG %s",
 			   dev_name(dev_area->dev),
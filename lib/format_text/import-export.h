@@ -63,6 +63,33 @@ struct text_vg_version_ops {
 
 const struct text_vg_version_ops *text_vg_vsn1_init(void);
 
+int text_import_vg_fields(struct cmd_context *cmd, struct volume_group *vg,
+			  const struct dm_config_node *vgn);
+int text_import_vg_done(struct volume_group *vg, struct format_instance *fid);
+int text_import_pv(struct cmd_context *cmd, const struct format_type *fmt,
+		   struct volume_group *vg, const struct dm_config_node *pvn);
+int text_import_special_lv(struct volume_group *vg, struct logical_volume *lv);
+int text_import_segment(struct cmd_context *cmd, struct logical_volume *lv,
+			const struct dm_config_node *sn);
+void text_import_add_segment(struct logical_volume *lv, struct lv_segment *seg);
+int text_import_check_segments(struct logical_volume *lv, int count, int seg_count);
+int text_import_historical_lv(struct cmd_context *cmd, struct volume_group *vg,
+			      const struct dm_config_node *hlvn);
+int text_import_historical_lv_links(struct cmd_context *cmd, struct volume_group *vg,
+				    const struct dm_config_node *hlvn);
+
+/*
+ * Import VG metadata text without building a config tree.  Returns NULL
+ * and sets *fallback when the text has to be parsed into a tree and read
+ * with the vsn1 importer instead; nothing has been reported in that case.
+ */
+struct volume_group *text_read_vg_stream(struct cmd_context *cmd,
+					 const struct format_type *fmt,
+					 struct format_instance *fid,
+					 const char *text,
+					 time_t *when, char **desc,
+					 int *fallback);
+
 int print_flags(char *buffer, size_t size, enum pv_vg_lv_e type, int mask, uint64_t status);
 int read_flags(uint64_t *status, enum pv_vg_lv_e type, int mask, const struct dm_config_value *cv);
 
@@ -70,12 +97,14 @@ int print_segtype_lvflags(char *buffer, size_t size, uint64_t status);
 int read_lvflags(uint64_t *status, const char *flags_str);
 
 int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp);
-size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *buf_size);
+size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *buf_size,
+			  uint32_t *checksum);
 struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc);
 struct volume_group *text_read_metadata(struct format_instance *fid,
 				       const char *file,
+				       const char *vgname,
 				       struct cached_vg_fmtdata **vg_fmtdata,
 				       unsigned *use_previous_vg,
 				       struct device *dev, int primary_mda,
@@ -17,6 +17,8 @@
 #include "lib/metadata/metadata.h"
 #include "lib/commands/toolcontext.h"
 #include "import-export.h"
+#include "lib/label/scan_workers.h"
+#include "lib/format_text/metadata_cache.h"
 
 /* FIXME Use tidier inclusion method */
 static const struct text_vg_version_ops *(_text_vsn_list[2]);
@@ -33,6 +35,27 @@ static void _init_text_import(void)
 	_text_import_initialised = 1;
 }
 
+static int _read_vgsummary(const struct format_type *fmt, const struct dm_config_tree *cft,
+			   struct lvmcache_vgsummary *vgsummary)
+{
+	const struct text_vg_version_ops **vsn;
+
+	/*
+	 * Find a set of version functions that can read this file
+	 */
+	for (vsn = &_text_vsn_list[0]; *vsn; vsn++) {
+		if (!(*vsn)->check_version(cft))
+			continue;
+
+		if (!(*vsn)->read_vgsummary(fmt, cft, vgsummary))
+			return_0;
+
+		return 1;
+	}
+
+	return 0;
+}
+
 /*
  * Find out vgname on a given device.
  */
@@ -45,11 +68,22 @@ int text_read_metadata_summary(const struct format_type *fmt,
 		       struct lvmcache_vgsummary *vgsummary)
 {
 	struct dm_config_tree *cft;
-	const struct text_vg_version_ops **vsn;
+	const struct dm_config_tree *prepared_cft;
 	int r = 0;
 
 	_init_text_import();
 
+	/*
+	 * Scan workers may have already read and parsed metadata text with
+	 * this checksum and size (verified against the text they read.)
+	 */
+	if (dev && !checksum_only &&
+	    (prepared_cft = scan_prepared_metadata(vgsummary->mda_checksum, vgsummary->mda_size))) {
+		log_debug_metadata("Using metadata summary for %s at %llu parsed by scan workers.",
+				   dev_name(dev), (unsigned long long)offset);
+		return _read_vgsummary(fmt, prepared_cft, vgsummary);
+	}
+
 	if (!(cft = config_open(CONFIG_FILE_SPECIAL, NULL, 0)))
 		return_0;
 
@@ -80,19 +114,10 @@ int text_read_metadata_summary(const struct format_type *fmt,
 		goto out;
 	}
 
-	/*
-	 * Find a set of version functions that can read this file
-	 */
-	for (vsn = &_text_vsn_list[0]; *vsn; vsn++) {
-		if (!(*vsn)->check_version(cft))
-			continue;
-
-		if (!(*vsn)->read_vgsummary(fmt, cft, vgsummary))
-			goto_out;
+	if (!_read_vgsummary(fmt, cft, vgsummary))
+		goto_out;
 
-		r = 1;
-		break;
-	}
+	r = 1;
 
       out:
 	config_destroy(cft);
@@ -106,6 +131,7 @@ struct cached_vg_fmtdata {
 
 struct volume_group *text_read_metadata(struct format_instance *fid,
 				       const char *file,
+				       const char *vgname,
 				       struct cached_vg_fmtdata **vg_fmtdata,
 				       unsigned *use_previous_vg,
 				       struct device *dev, int primary_mda,
@@ -118,7 +144,10 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 	struct volume_group *vg = NULL;
 	struct dm_config_tree *cft;
 	const struct text_vg_version_ops **vsn;
+	char *text = NULL;
 	int skip_parse;
+	int use_cache = 0, cached = 0;
+	int fallback = 0;
 
 	/*
 	 * This struct holds the checksum and size of the VG metadata
@@ -149,14 +178,51 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 		     ((*vg_fmtdata)->cached_mda_size == (size + size2));
 
 
-	if (dev) {
+	/*
+	 * A cache file saved from text with the same checksum and size
+	 * replaces only the parse.  The text is still read to verify it
+	 * matches the checksum in the mda_header.
+	 */
+	if (dev && vgname && !skip_parse &&
+	    metadata_cache_enabled(fid->fmt->cmd)) {
+		use_cache = 1;
+		cached = metadata_cache_read(cft, vgname, checksum, size + size2);
+	}
+
+	/*
+	 * Metadata read from a device is imported straight from the text,
+	 * without a config tree, unless the text needs the vsn1 importer.
+	 * The VG keeps the text to import its committed copy from.
+	 */
+	if (dev && !skip_parse && !use_cache) {
+		log_debug_metadata("Reading metadata from %s at %llu size %d (+%d)",
+				   dev_name(dev), (unsigned long long)offset,
+				   size, size2);
+
+		if (!(text = config_file_read_fd_text(dev, MDA_CONTENT_REASON(primary_mda), offset, size,
+						      offset2, size2, checksum_fn, checksum))) {
+			log_warn("WARNING: Couldn't read volume group metadata from %s.", dev_name(dev));
+			goto out;
+		}
+
+		if ((vg = text_read_vg_stream(fid->fmt->cmd, fid->fmt, fid, text, when, desc, &fallback))) {
+			vg->committed_text = text;
+			vg->buffer_size_hint = size + size2;
+			text = NULL;
+		} else if (!fallback)
+			goto_out;
+		else if (!dm_config_parse_without_dup_node_check(cft, text, text + size + size2)) {
+			log_warn("WARNING: Couldn't read volume group metadata from %s.", dev_name(dev));
+			goto out;
+		}
+	} else if (dev) {
 		log_debug_metadata("Reading metadata from %s at %llu size %d (+%d)",
 				   dev_name(dev), (unsigned long long)offset,
 				   size, size2);
 
 		if (!config_file_read_fd(cft, dev, MDA_CONTENT_REASON(primary_mda), offset, size,
 					 offset2, size2, checksum_fn, checksum,
-					 skip_parse, 1, 0)) {
+					 skip_parse || cached, 1, 0)) {
 			log_warn("WARNING: Couldn't read volume group metadata from %s.", dev_name(dev));
 			goto out;
 		}
@@ -177,7 +243,7 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 	/*
 	 * Find a set of version functions that can read this file
 	 */
-	for (vsn = &_text_vsn_list[0]; *vsn; vsn++) {
+	for (vsn = &_text_vsn_list[0]; !vg && *vsn; vsn++) {
 		if (!(*vsn)->check_version(cft))
 			continue;
 
@@ -185,6 +251,10 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 			goto_out;
 
 		(*vsn)->read_desc(vg->vgmem, cft, when, desc);
+
+		if (use_cache && !cached)
+			metadata_cache_write(cft, vgname, checksum, size + size2);
+
 		vg->committed_cft = cft; /* Reuse CFT for recreation of committed VG */
 		vg->buffer_size_hint = size + size2;
 		cft = NULL;
@@ -200,6 +270,7 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 		*use_previous_vg = 0;
 
       out:
+	free(text);
 	if (cft)
 		config_destroy(cft);
 	return vg;
@@ -209,18 +280,29 @@ struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc)
 {
-	return text_read_metadata(fid, file, NULL, NULL, NULL, 0,
+	return text_read_metadata(fid, file, NULL, NULL, NULL, NULL, 0,
 				  (off_t)0, 0, (off_t)0, 0, NULL, 0,
 				  when, desc);
 }
 
+static void _import_vg_done(struct format_instance *fid, struct volume_group *vg)
+{
+	int vg_missing;
+
+	set_pv_devices(fid, vg);
+
+	if ((vg_missing = vg_missing_pv_count(vg)))
+		log_verbose("There are %d physical volumes missing.", vg_missing);
+	vg_mark_partial_lvs(vg, 1);
+	/* FIXME: move this code inside read_vg() */
+}
+
 static struct volume_group *_import_vg_from_config_tree(struct cmd_context *cmd,
 							struct format_instance *fid,
 							const struct dm_config_tree *cft)
 {
 	struct volume_group *vg = NULL;
 	const struct text_vg_version_ops **vsn;
-	int vg_missing;
 
 	_init_text_import();
 
@@ -233,14 +315,8 @@ static struct volume_group *_import_vg_from_config_tree(struct cmd_context *cmd,
 		 */
 		if (!(vg = (*vsn)->read_vg(cmd, fid->fmt, fid, cft)))
 			stack;
-		else {
-			set_pv_devices(fid, vg);
-
-			if ((vg_missing = vg_missing_pv_count(vg)))
-				log_verbose("There are %d physical volumes missing.", vg_missing);
-			vg_mark_partial_lvs(vg, 1);
-			/* FIXME: move this code inside read_vg() */
-		}
+		else
+			_import_vg_done(fid, vg);
 		break;
 	}
 
@@ -254,6 +330,37 @@ struct volume_group *import_vg_from_config_tree(struct cmd_context *cmd,
 	return _import_vg_from_config_tree(cmd, fid, cft);
 }
 
+/*
+ * Import a VG from metadata text, as import_vg_from_config_tree()
+ * does from the config tree of the text.
+ */
+struct volume_group *import_vg_from_text(struct cmd_context *cmd,
+					 struct format_instance *fid,
+					 const char *text)
+{
+	struct volume_group *vg;
+	struct dm_config_tree *cft;
+	time_t when;
+	char *desc;
+	int fallback = 0;
+
+	if ((vg = text_read_vg_stream(cmd, fid->fmt, fid, text, &when, &desc, &fallback))) {
+		_import_vg_done(fid, vg);
+		return vg;
+	}
+
+	if (!fallback)
+		return_NULL;
+
+	if (!(cft = config_tree_from_string_without_dup_node_check(text)))
+		return_NULL;
+
+	vg = _import_vg_from_config_tree(cmd, fid, cft);
+	config_destroy(cft);
+
+	return vg;
+}
+
 struct volume_group *vg_from_config_tree(struct cmd_context *cmd, const struct dm_config_tree *cft)
 {
 	const struct text_vg_version_ops *ops;
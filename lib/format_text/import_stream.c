@@ -0,0 +1,1215 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/metadata/metadata.h"
+#include "import-export.h"
+#include "lib/display/display.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/metadata/lv_alloc.h"
+#include "lib/metadata/segtype.h"
+#include "lib/datastruct/str_list.h"
+#include "lib/datastruct/radix-tree.h"
+
+#include <ctype.h>
+
+/*
+ * Streaming import of VG metadata text.
+ *
+ * Most of the text of a big VG is the logical_volumes section, and most
+ * of that is linear and striped segments.  Those are read straight from
+ * the text into the VG.  Everything else (the VG header, the PVs, other
+ * segment types and historical LVs) is built into small config subtrees
+ * one section at a time and handed to the vsn1 readers, so that there is
+ * one implementation of their semantics.
+ *
+ * The tokenizer follows the one of the config tree parser.  Anything
+ * which the tree parser could read differently, or where the vsn1
+ * importer would report a problem on its own (quoted or '/' separated
+ * keys, bare or single quoted strings, floats, octal or out of range
+ * numbers, duplicate keys in an LV, unexpected value types or section
+ * order) stops the stream and the caller imports the text with a tree.
+ */
+
+enum {
+	TOK_EOF,
+	TOK_SECTION_B,
+	TOK_SECTION_E,
+	TOK_ARRAY_B,
+	TOK_ARRAY_E,
+	TOK_COMMA,
+	TOK_EQ,
+	TOK_INT,
+	TOK_STRING,
+	TOK_IDENTIFIER,
+	TOK_UNSUPPORTED,
+};
+
+struct stream_area {
+	const char *name;
+	size_t len;
+	uint32_t pe;
+};
+
+/* A segment of an LV, read in the second pass */
+struct stream_seg {
+	struct dm_list list;
+	const struct dm_config_node *sn;	/* for text_import_segment() */
+	const char *name;			/* plain striped segment */
+	size_t name_len;
+	uint32_t start_extent;
+	uint32_t extent_count;
+	uint32_t stripe_size;
+	uint32_t stripe_count;
+	struct stream_area *areas;
+};
+
+struct stream_lv {
+	struct dm_list list;
+	struct logical_volume *lv;
+	struct id id;
+	uint32_t segment_count;
+	uint32_t major;
+	uint32_t minor;
+	unsigned has_major:1;
+	unsigned has_minor:1;
+	struct dm_list segs;			/* struct stream_seg */
+};
+
+struct stream {
+	struct cmd_context *cmd;
+	const struct format_type *fmt;
+	struct volume_group *vg;
+	struct segment_type *striped;
+	struct dm_pool *mem;			/* lives for the import */
+	struct dm_pool *scratch;		/* emptied after each LV */
+
+	const char *pos;			/* next character to read */
+	const char *tok;			/* start of the current token */
+	const char *tb;				/* token text, without quotes */
+	size_t tl;
+	int t;
+	unsigned escaped;			/* TOK_STRING holds a backslash */
+	int64_t i;				/* value of TOK_INT */
+
+	const char *unsupported;		/* why the tree is needed */
+
+	const struct dm_config_value *contents;
+	const struct dm_config_value *version;
+	const struct dm_config_value *description;
+	const struct dm_config_value *creation_time;
+
+	struct dm_config_node *historical;	/* historical_logical_volumes */
+	struct dm_list lvs;			/* struct stream_lv */
+};
+
+static void _next(struct stream *s, int values_allowed)
+{
+	const char *te = s->pos;
+	uint64_t u, limit;
+	int neg = 0;
+	char c;
+
+	for (;;) {
+		while (*te && isspace(*te))
+			te++;
+		if (*te != '#')
+			break;
+		while (*te && (*te != '\n'))
+			te++;
+	}
+
+	s->tok = s->tb = te;
+
+	switch ((c = *te)) {
+	case '\0':
+		s->t = TOK_EOF;
+		s->tl = 0;
+		return;
+	case '{':
+		s->t = TOK_SECTION_B;
+		te++;
+		break;
+	case '}':
+		s->t = TOK_SECTION_E;
+		te++;
+		break;
+	case '[':
+		s->t = TOK_ARRAY_B;
+		te++;
+		break;
+	case ']':
+		s->t = TOK_ARRAY_E;
+		te++;
+		break;
+	case ',':
+		s->t = TOK_COMMA;
+		te++;
+		break;
+	case '=':
+		s->t = TOK_EQ;
+		te++;
+		break;
+	case '"':
+		s->t = TOK_STRING;
+		s->escaped = 0;
+		s->tb = ++te;
+		while (*te && (*te != '"')) {
+			if ((*te == '\\') && te[1]) {
+				s->escaped = 1;
+				te++;
+			}
+			te++;
+		}
+		if (!*te) {
+			s->t = TOK_UNSUPPORTED;
+			break;
+		}
+		s->tl = te - s->tb;
+		s->pos = te + 1;
+		return;
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+	case '+': case '-': case '.':
+		if (!values_allowed)
+			goto identifier;
+		s->t = TOK_INT;
+		if ((c == '+') || (c == '-')) {
+			neg = (c == '-');
+			te++;
+		}
+		limit = neg ? (uint64_t) INT64_MAX + 1 : INT64_MAX;
+		/* Only plain decimal numbers: strtoll() in the tree takes octal and hex */
+		if (!isdigit(*te) || ((*te == '0') && (isdigit(te[1]) || (te[1] == 'x') || (te[1] == 'X')))) {
+			s->t = TOK_UNSUPPORTED;
+			break;
+		}
+		for (u = 0; isdigit(*te); te++) {
+			if (u > (limit - (uint64_t)(*te - '0')) / 10) {
+				s->t = TOK_UNSUPPORTED;
+				break;
+			}
+			u = u * 10 + (uint64_t)(*te - '0');
+		}
+		if (*te == '.')
+			s->t = TOK_UNSUPPORTED;
+		s->i = neg ? (int64_t) (0 - u) : (int64_t) u;
+		break;
+	default:
+	identifier:
+		s->t = TOK_IDENTIFIER;
+		while ((c = *te) && !isspace(c) && (c != '#') && (c != '=') &&
+		       (c != '{') && (c != '}')) {
+			/* The tree parser makes a path of a key with '/' */
+			if (c == '/')
+				s->t = TOK_UNSUPPORTED;
+			te++;
+		}
+		/* Bare string value */
+		if (values_allowed)
+			s->t = TOK_UNSUPPORTED;
+	}
+
+	s->tl = te - s->tb;
+	s->pos = te;
+}
+
+static int _unsupported(struct stream *s, const char *reason)
+{
+	if (!s->unsupported)
+		s->unsupported = reason;
+
+	return 0;
+}
+
+static int _tok_is(const struct stream *s, const char *str)
+{
+	size_t len = strlen(str);
+
+	return (s->tl == len) && !memcmp(s->tb, str, len);
+}
+
+/* dm_pool_strndup() would run strlen() over the rest of the text */
+static char *_strndup(struct dm_pool *mem, const char *str, size_t len)
+{
+	char *r;
+
+	if ((r = dm_pool_alloc(mem, len + 1))) {
+		memcpy(r, str, len);
+		r[len] = '\0';
+	}
+
+	return r;
+}
+
+static char *_tok_dup(struct stream *s, struct dm_pool *mem)
+{
+	char *str;
+
+	if (!(str = _strndup(mem, s->tb, s->tl))) {
+		log_error("Failed to allocate metadata string.");
+		return NULL;
+	}
+
+	if (s->escaped && (s->t == TOK_STRING))
+		dm_unescape_double_quotes(str);
+
+	return str;
+}
+
+/* Cast as dm_config_get_uint32() does */
+static int _tok_uint32(const struct stream *s, uint32_t *result)
+{
+	if (s->t != TOK_INT)
+		return 0;
+
+	*result = (uint32_t) s->i;
+
+	return 1;
+}
+
+/*
+ * Read a value into a config value list.  The current token is the
+ * first one of the value, on return it is the one after the value.
+ */
+static struct dm_config_value *_value(struct stream *s, struct dm_pool *mem)
+{
+	struct dm_config_value *h = NULL, *l, *ll = NULL;
+	int array = (s->t == TOK_ARRAY_B);
+
+	if (array)
+		_next(s, 1);
+
+	do {
+		if (array && (s->t == TOK_ARRAY_E))
+			break;
+
+		if (!(l = dm_pool_zalloc(mem, sizeof(*l)))) {
+			log_error("Failed to allocate metadata value.");
+			return NULL;
+		}
+
+		if (s->t == TOK_INT) {
+			l->type = DM_CFG_INT;
+			l->v.i = s->i;
+		} else if (s->t == TOK_STRING) {
+			l->type = DM_CFG_STRING;
+			if (!(l->v.str = _tok_dup(s, mem)))
+				return_NULL;
+		} else {
+			_unsupported(s, "value");
+			return NULL;
+		}
+
+		if (!h)
+			h = l;
+		else
+			ll->next = l;
+		ll = l;
+
+		_next(s, 0);
+
+		/* Items may be separated with a comma */
+		if (array && (s->t == TOK_COMMA))
+			_next(s, 1);
+	} while (array);
+
+	if (array) {
+		if (!h) {
+			if (!(h = dm_pool_zalloc(mem, sizeof(*h)))) {
+				log_error("Failed to allocate metadata value.");
+				return NULL;
+			}
+			h->type = DM_CFG_EMPTY_ARRAY;
+		}
+		_next(s, 0);
+	}
+
+	return h;
+}
+
+static struct dm_config_node *_node(struct stream *s, struct dm_pool *mem,
+				    struct dm_config_node *parent);
+
+/*
+ * Build the nodes of a section into parent, or just check them without
+ * a parent.  The current token is the one after '{', on return it is
+ * the one after '}'.
+ */
+static int _section(struct stream *s, struct dm_pool *mem, struct dm_config_node *parent)
+{
+	struct dm_config_node *cn, *last = NULL;
+
+	while (s->t != TOK_SECTION_E) {
+		if (!(cn = _node(s, mem, parent)))
+			return_0;
+
+		if (!parent)
+			continue;
+
+		if (last)
+			last->sib = cn;
+		else
+			parent->child = cn;
+		last = cn;
+	}
+
+	_next(s, 0);
+
+	return 1;
+}
+
+static struct dm_config_node *_node(struct stream *s, struct dm_pool *mem,
+				    struct dm_config_node *parent)
+{
+	struct dm_config_node *cn;
+
+	if (s->t != TOK_IDENTIFIER) {
+		_unsupported(s, "key");
+		return NULL;
+	}
+
+	if (!(cn = dm_pool_zalloc(mem, sizeof(*cn))) ||
+	    !(cn->key = _tok_dup(s, mem))) {
+		log_error("Failed to allocate metadata node.");
+		return NULL;
+	}
+	cn->parent = parent;
+
+	_next(s, 0);
+
+	if (s->t == TOK_SECTION_B) {
+		_next(s, 0);
+		if (!_section(s, mem, cn))
+			return_NULL;
+	} else if (s->t == TOK_EQ) {
+		_next(s, 1);
+		if (!(cn->v = _value(s, mem)))
+			return_NULL;
+	} else {
+		_unsupported(s, "section");
+		return NULL;
+	}
+
+	return cn;
+}
+
+/*
+ * Read the body of a plain striped segment.  Returns 0 when the
+ * segment has to be built into a config node.
+ */
+static int _striped_segment(struct stream *s, struct stream_seg *sseg)
+{
+	struct stream_area area;
+	unsigned nr_areas = 0;
+	int has_start = 0, has_count = 0, has_type = 0, has_stripe_count = 0;
+	int has_stripe_size = 0, has_stripes = 0;
+
+	while (s->t != TOK_SECTION_E) {
+		if (s->t != TOK_IDENTIFIER)
+			return 0;
+
+		if (_tok_is(s, "start_extent")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_start++)
+				return 0;
+			_next(s, 1);
+			if (!_tok_uint32(s, &sseg->start_extent))
+				return 0;
+		} else if (_tok_is(s, "extent_count")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_count++)
+				return 0;
+			_next(s, 1);
+			if (!_tok_uint32(s, &sseg->extent_count))
+				return 0;
+		} else if (_tok_is(s, "type")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_type++)
+				return 0;
+			_next(s, 1);
+			if ((s->t != TOK_STRING) || s->escaped || !_tok_is(s, SEG_TYPE_NAME_STRIPED))
+				return 0;
+		} else if (_tok_is(s, "stripe_count")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_stripe_count++)
+				return 0;
+			_next(s, 1);
+			/* Wider segments go through the segment type */
+			if (!_tok_uint32(s, &sseg->stripe_count) || !sseg->stripe_count ||
+			    (sseg->stripe_count > MAX_STRIPES))
+				return 0;
+		} else if (_tok_is(s, "stripe_size")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_stripe_size++)
+				return 0;
+			_next(s, 1);
+			if (!_tok_uint32(s, &sseg->stripe_size))
+				return 0;
+		} else if (_tok_is(s, "stripes")) {
+			_next(s, 0);
+			if ((s->t != TOK_EQ) || has_stripes++ || !has_stripe_count)
+				return 0;
+			_next(s, 1);
+			if (s->t != TOK_ARRAY_B)
+				return 0;
+			if (!(sseg->areas = dm_pool_alloc(s->mem, sseg->stripe_count * sizeof(*sseg->areas))))
+				return 0;
+			for (_next(s, 1); s->t != TOK_ARRAY_E; nr_areas++) {
+				/* Names with a path go through find_lv() */
+				if ((s->t != TOK_STRING) || s->escaped || !s->tl ||
+				    memchr(s->tb, '/', s->tl))
+					return 0;
+				area.name = s->tb;
+				area.len = s->tl;
+				_next(s, 0);
+				if (s->t != TOK_COMMA)
+					return 0;
+				_next(s, 1);
+				if (!_tok_uint32(s, &area.pe) || (nr_areas >= sseg->stripe_count))
+					return 0;
+				sseg->areas[nr_areas] = area;
+				_next(s, 0);
+				if (s->t == TOK_COMMA)
+					_next(s, 1);
+			}
+		} else
+			return 0;
+
+		_next(s, 0);
+	}
+
+	return has_start && has_count && has_type && has_stripes &&
+		(nr_areas == sseg->stripe_count) &&
+		((sseg->stripe_count == 1) || has_stripe_size);
+}
+
+/*
+ * Read a segment section of an LV, the current token is the one
+ * after '{'.
+ */
+static int _stream_segment(struct stream *s, struct stream_lv *slv, const char *key, size_t key_len)
+{
+	struct stream_seg *sseg;
+	struct dm_config_node *sn;
+	const char *body = s->tok;
+
+	if (!(sseg = dm_pool_zalloc(s->mem, sizeof(*sseg))))
+		return_0;
+
+	if (!_striped_segment(s, sseg)) {
+		/* Read it again into a node for the segment type */
+		sseg->areas = NULL;
+		s->pos = body;
+		_next(s, 0);
+
+		if (!(sn = dm_pool_zalloc(s->mem, sizeof(*sn))) ||
+		    !(sn->key = _strndup(s->mem, key, key_len))) {
+			log_error("Failed to allocate metadata node.");
+			return 0;
+		}
+
+		if (!_section(s, s->mem, sn))
+			return_0;
+
+		sseg->sn = sn;
+	} else {
+		sseg->name = key;
+		sseg->name_len = key_len;
+		_next(s, 0);
+	}
+
+	dm_list_add(&slv->segs, &sseg->list);
+
+	return 1;
+}
+
+enum {
+	LV_KEY_ID = 1 << 0,
+	LV_KEY_STATUS = 1 << 1,
+	LV_KEY_FLAGS = 1 << 2,
+	LV_KEY_CREATION_TIME = 1 << 3,
+	LV_KEY_CREATION_HOST = 1 << 4,
+	LV_KEY_LOCK_ARGS = 1 << 5,
+	LV_KEY_ALLOCATION_POLICY = 1 << 6,
+	LV_KEY_PROFILE = 1 << 7,
+	LV_KEY_READ_AHEAD = 1 << 8,
+	LV_KEY_TAGS = 1 << 9,
+	LV_KEY_SEGMENT_COUNT = 1 << 10,
+	LV_KEY_MAJOR = 1 << 11,
+	LV_KEY_MINOR = 1 << 12,
+};
+
+static const struct {
+	const char *key;
+	unsigned field;
+} _lv_keys[] = {
+	{ "id", LV_KEY_ID },
+	{ "status", LV_KEY_STATUS },
+	{ "flags", LV_KEY_FLAGS },
+	{ "creation_time", LV_KEY_CREATION_TIME },
+	{ "creation_host", LV_KEY_CREATION_HOST },
+	{ "lock_args", LV_KEY_LOCK_ARGS },
+	{ "allocation_policy", LV_KEY_ALLOCATION_POLICY },
+	{ "profile", LV_KEY_PROFILE },
+	{ "read_ahead", LV_KEY_READ_AHEAD },
+	{ "tags", LV_KEY_TAGS },
+	{ "segment_count", LV_KEY_SEGMENT_COUNT },
+	{ "major", LV_KEY_MAJOR },
+	{ "minor", LV_KEY_MINOR },
+};
+
+static unsigned _lv_key(const struct stream *s)
+{
+	unsigned i;
+
+	for (i = 0; i < DM_ARRAY_SIZE(_lv_keys); i++)
+		if (_tok_is(s, _lv_keys[i].key))
+			return _lv_keys[i].field;
+
+	return 0;
+}
+
+/*
+ * Read an LV section, the current token is its name.  The LV is added
+ * to the VG as _read_lvnames() does, segments are kept for later.
+ */
+static int _stream_lv(struct stream *s)
+{
+	struct cmd_context *cmd = s->cmd;
+	struct volume_group *vg = s->vg;
+	struct dm_pool *mem = vg->vgmem;
+	struct stream_lv *slv;
+	struct logical_volume *lv;
+	const struct dm_config_value *status = NULL, *flags = NULL, *tags = NULL, *cv;
+	const char *name, *key, *hostname = NULL, *alloc = NULL, *profile = NULL;
+	char *str, *lock_args = NULL;
+	char buf[64];
+	uint64_t lvstatus = 0, timestamp = 0;
+	uint32_t read_ahead = 0;
+	size_t name_len, key_len;
+	unsigned field, seen = 0;
+
+	name = s->tb;
+	name_len = s->tl;
+
+	_next(s, 0);
+	if (s->t != TOK_SECTION_B)
+		return _unsupported(s, "logical volume");
+
+	if (!(slv = dm_pool_zalloc(s->mem, sizeof(*slv))))
+		return_0;
+	dm_list_init(&slv->segs);
+
+	for (_next(s, 0); s->t != TOK_SECTION_E; ) {
+		if (s->t != TOK_IDENTIFIER)
+			return _unsupported(s, "logical volume key");
+
+		key = s->tb;
+		key_len = s->tl;
+		field = _lv_key(s);
+
+		_next(s, 0);
+		if (s->t == TOK_SECTION_B) {
+			/* All sub-sections are segments */
+			if (field)
+				return _unsupported(s, "logical volume section");
+			_next(s, 0);
+			if (!_stream_segment(s, slv, key, key_len))
+				return_0;
+			continue;
+		}
+
+		if (s->t != TOK_EQ)
+			return _unsupported(s, "logical volume value");
+
+		if (seen & field)
+			return _unsupported(s, "duplicate logical volume key");
+		seen |= field;
+
+		_next(s, 1);
+
+		switch (field) {
+		case LV_KEY_ID:
+			if ((s->t != TOK_STRING) || s->escaped || (s->tl >= sizeof(buf)))
+				return _unsupported(s, "logical volume id");
+			memcpy(buf, s->tb, s->tl);
+			buf[s->tl] = '\0';
+			if (!id_read_format_try(&slv->id, buf))
+				return _unsupported(s, "logical volume id");
+			break;
+		case LV_KEY_CREATION_TIME:
+			if (s->t != TOK_INT)
+				return _unsupported(s, "creation_time");
+			timestamp = (uint64_t) s->i;
+			break;
+		case LV_KEY_READ_AHEAD:
+			if (!_tok_uint32(s, &read_ahead))
+				return _unsupported(s, "read_ahead");
+			break;
+		case LV_KEY_SEGMENT_COUNT:
+			if (!_tok_uint32(s, &slv->segment_count))
+				return _unsupported(s, "segment_count");
+			break;
+		case LV_KEY_MAJOR:
+			if (!_tok_uint32(s, &slv->major))
+				return _unsupported(s, "major");
+			slv->has_major = 1;
+			break;
+		case LV_KEY_MINOR:
+			if (!_tok_uint32(s, &slv->minor))
+				return _unsupported(s, "minor");
+			slv->has_minor = 1;
+			break;
+		case LV_KEY_CREATION_HOST:
+		case LV_KEY_LOCK_ARGS:
+		case LV_KEY_ALLOCATION_POLICY:
+		case LV_KEY_PROFILE:
+			if (s->t != TOK_STRING)
+				return _unsupported(s, "logical volume string");
+			if (!(str = _tok_dup(s, (field == LV_KEY_LOCK_ARGS) ? mem : s->scratch)))
+				return_0;
+			if (field == LV_KEY_CREATION_HOST)
+				hostname = str;
+			else if (field == LV_KEY_LOCK_ARGS)
+				lock_args = str;
+			else if (field == LV_KEY_ALLOCATION_POLICY)
+				alloc = str;
+			else
+				profile = str;
+			break;
+		default:
+			/* status, flags, tags and unknown values */
+			if (!(cv = _value(s, s->scratch)))
+				return_0;
+			if (field == LV_KEY_STATUS)
+				status = cv;
+			else if (field == LV_KEY_FLAGS)
+				flags = cv;
+			else if (field == LV_KEY_TAGS)
+				tags = cv;
+			continue;
+		}
+
+		_next(s, 0);
+	}
+
+	_next(s, 0);
+
+	/* Cases the vsn1 importer reports */
+	if (!(seen & LV_KEY_ID) || !(seen & LV_KEY_SEGMENT_COUNT) || !status ||
+	    (!(seen & LV_KEY_CREATION_TIME) != !(seen & LV_KEY_CREATION_HOST)))
+		return _unsupported(s, "logical volume fields");
+
+	if (tags && (tags->type != DM_CFG_EMPTY_ARRAY))
+		for (cv = tags; cv; cv = cv->next)
+			if (cv->type != DM_CFG_STRING)
+				return _unsupported(s, "logical volume tags");
+
+	if (!(lv = alloc_lv(mem)))
+		return_0;
+
+	if (!link_lv_to_vg(vg, lv))
+		return_0;
+
+	if (!(name = _strndup(mem, name, name_len)) ||
+	    !lv_set_name(lv, name))
+		return_0;
+
+	slv->lv = lv;
+	dm_list_add(&s->lvs, &slv->list);
+
+	log_debug_metadata("Importing logical volume %s.", lv->name);
+
+	/* For backward compatible metadata accept both type of flags */
+	if (!read_flags(&lvstatus, LV_FLAGS, STATUS_FLAG | SEGTYPE_FLAG, status)) {
+		log_error("Could not read status flags.");
+		goto bad_status;
+	}
+
+	if (flags && !read_flags(&lvstatus, LV_FLAGS, COMPATIBLE_FLAG, flags)) {
+		log_error("Could not read flags.");
+		goto bad_status;
+	}
+
+	if (lvstatus & LVM_WRITE_LOCKED) {
+		lvstatus |= LVM_WRITE;
+		lvstatus &= ~LVM_WRITE_LOCKED;
+	}
+	lv->status = lvstatus;
+
+	lv->lock_args = lock_args;
+
+	if (alloc) {
+		lv->alloc = get_alloc_from_string(alloc);
+		if (lv->alloc == ALLOC_INVALID) {
+			log_warn("WARNING: Ignoring unrecognised allocation policy %s for LV %s.",
+				 alloc, display_lvname(lv));
+			lv->alloc = ALLOC_INHERIT;
+		}
+	} else
+		lv->alloc = ALLOC_INHERIT;
+
+	if (profile) {
+		log_debug_metadata("Adding profile configuration %s for LV %s.",
+				   profile, display_lvname(lv));
+		if (!(lv->profile = add_profile(cmd, profile, CONFIG_PROFILE_METADATA))) {
+			log_error("Failed to add configuration profile %s for LV %s.",
+				  profile, display_lvname(lv));
+			return 0;
+		}
+	}
+
+	if (!(seen & LV_KEY_READ_AHEAD))
+		/* If not present, choice of auto or none is configurable */
+		lv->read_ahead = cmd->default_settings.read_ahead;
+	else if (!read_ahead)
+		lv->read_ahead = DM_READ_AHEAD_AUTO;
+	else if (read_ahead == UINT32_C(-1))
+		lv->read_ahead = DM_READ_AHEAD_NONE;
+	else
+		lv->read_ahead = read_ahead;
+
+	if (tags && (tags->type != DM_CFG_EMPTY_ARRAY))
+		for (cv = tags; cv; cv = cv->next)
+			if (!str_list_add(mem, &lv->tags, dm_pool_strdup(mem, cv->v.str)))
+				return_0;
+
+	if (timestamp && !lv_set_creation(lv, hostname, timestamp))
+		return_0;
+
+	if (!text_import_special_lv(vg, lv))
+		return_0;
+
+	dm_pool_empty(s->scratch);
+
+	return 1;
+
+bad_status:
+	log_error("Couldn't read status flags for logical volume %s.",
+		  display_lvname(lv));
+	return 0;
+}
+
+/*
+ * Add a plain striped segment as the striped segtype's text_import()
+ * would.
+ */
+static int _striped_seg(struct stream *s, struct logical_volume *lv,
+			const struct stream_seg *sseg)
+{
+	struct volume_group *vg = lv->vg;
+	const struct stream_area *area;
+	struct lv_segment *seg;
+	struct physical_volume *pv;
+	struct logical_volume *lv1;
+	uint32_t a;
+
+	if (!(seg = alloc_lv_segment(s->striped, lv, sseg->start_extent,
+				     sseg->extent_count, 0, 0, 0, NULL, sseg->stripe_count,
+				     sseg->extent_count, 1, 0, 0, 0, NULL))) {
+		log_error("Segment allocation failed");
+		return 0;
+	}
+
+	if (seg->area_count != 1)
+		seg->stripe_size = sseg->stripe_size;
+
+	seg->area_len /= seg->area_count;
+
+	for (a = 0; a < seg->area_count; a++) {
+		area = &sseg->areas[a];
+		if ((pv = radix_tree_lookup_ptr(vg->pv_names, area->name, area->len))) {
+			if (!set_lv_segment_area_pv(seg, a, pv, area->pe))
+				return_0;
+		} else if ((lv1 = radix_tree_lookup_ptr(vg->lv_names, area->name, area->len))) {
+			if (!set_lv_segment_area_lv(seg, a, lv1, area->pe, 0))
+				return_0;
+		} else {
+			log_error("Couldn't find volume '%.*s' for segment '%.*s'.",
+				  (int) area->len, area->name, (int) sseg->name_len, sseg->name);
+			return 0;
+		}
+	}
+
+	text_import_add_segment(lv, seg);
+
+	return 1;
+}
+
+/*
+ * Read the segments of an LV once all LVs exist, as _read_lvsegs() does.
+ */
+static int _stream_lvsegs(struct stream *s, struct stream_lv *slv)
+{
+	struct cmd_context *cmd = s->cmd;
+	struct logical_volume *lv = slv->lv;
+	struct stream_seg *sseg;
+	int count = 0;
+
+	lv->lvid.id[1] = slv->id;
+	memcpy(&lv->lvid.id[0], &lv->vg->id, sizeof(lv->lvid.id[0]));
+
+	dm_list_iterate_items(sseg, &slv->segs) {
+		if (sseg->sn) {
+			if (!text_import_segment(cmd, lv, sseg->sn))
+				return_0;
+		} else if (!_striped_seg(s, lv, sseg))
+			return_0;
+
+		count++;
+
+		/* FIXME Remove this restriction */
+		if (lv_is_snapshot(lv) && count > 1) {
+			log_error("Only one segment permitted for snapshot");
+			return 0;
+		}
+	}
+
+	if (!text_import_check_segments(lv, count, (int) slv->segment_count))
+		return_0;
+
+	lv->size = (uint64_t) lv->le_count * (uint64_t) lv->vg->extent_size;
+
+	if (lv->status & FIXED_MINOR) {
+		if (!slv->has_minor) {
+			log_error("Couldn't read minor number for logical volume %s.",
+				  display_lvname(lv));
+			return 0;
+		}
+		lv->minor = (int) slv->minor;
+
+		/* If major is missing, pick default */
+		lv->major = slv->has_major ? (int) slv->major : cmd->dev_types->device_mapper_major;
+
+		if (!validate_major_minor(cmd, s->fmt, lv->major, lv->minor)) {
+			log_warn("WARNING: Ignoring invalid major, minor number for "
+				 "logical volume %s.", display_lvname(lv));
+			lv->major = lv->minor = -1;
+		}
+	}
+
+	return 1;
+}
+
+/* Keys of the VG section read by _read_vg_fields() */
+static const char *const _vg_keys[] = {
+	"id", "seqno", "format", "status", "flags", "extent_size", "max_lv",
+	"max_pv", "allocation_policy", "profile", "metadata_copies", "system_id",
+	"lock_type", "lock_args", "pr", "tags",
+	"physical_volumes", "logical_volumes", "historical_logical_volumes",
+};
+
+static int _vg_key(const struct stream *s)
+{
+	unsigned i;
+
+	for (i = 0; i < DM_ARRAY_SIZE(_vg_keys); i++)
+		if (_tok_is(s, _vg_keys[i]))
+			return 1;
+
+	return 0;
+}
+
+/*
+ * Read a section of the VG into a node, the current token is its name.
+ */
+static int _stream_nodes(struct stream *s, struct dm_config_node **result)
+{
+	struct dm_config_node *cn;
+
+	if (!(*result = cn = dm_pool_zalloc(s->mem, sizeof(*cn))) ||
+	    !(cn->key = _tok_dup(s, s->mem))) {
+		log_error("Failed to allocate metadata node.");
+		return 0;
+	}
+
+	_next(s, 0);
+	if (s->t != TOK_SECTION_B)
+		return _unsupported(s, "volume group section");
+	_next(s, 0);
+
+	if (!_section(s, s->mem, cn))
+		return_0;
+
+	/* All the items must be sections */
+	for (cn = cn->child; cn; cn = cn->sib)
+		if (!cn->child)
+			return _unsupported(s, "volume group section item");
+
+	return 1;
+}
+
+/*
+ * Read the VG section, the current token is the one after '{'.
+ */
+static int _stream_vg(struct stream *s, const char *name, size_t name_len)
+{
+	struct cmd_context *cmd = s->cmd;
+	struct volume_group *vg;
+	struct dm_config_node *vgn, *cn, *last = NULL;
+	int pvs = 0, lvs = 0;
+
+	if (!(vgn = dm_pool_zalloc(s->mem, sizeof(*vgn))) ||
+	    !(vgn->key = _strndup(s->mem, name, name_len))) {
+		log_error("Failed to allocate metadata node.");
+		return 0;
+	}
+
+	if (!(s->vg = vg = alloc_vg("read_vg", cmd, vgn->key)))
+		return_0;
+
+	/*
+	 * The pv_names memorizes the pv section names -> pv
+	 * structures.
+	 */
+	if (!(vg->pv_names = radix_tree_create(NULL, NULL))) {
+		log_error("Couldn't create pv_names radix tree.");
+		return 0;
+	}
+
+	while (s->t != TOK_SECTION_E) {
+		if (s->t != TOK_IDENTIFIER)
+			return _unsupported(s, "volume group key");
+
+		if (!pvs) {
+			/* Values come first and are read by the vsn1 code */
+			if (_tok_is(s, "physical_volumes")) {
+				if (!vgn->child)
+					return _unsupported(s, "volume group fields");
+
+				if (!_stream_nodes(s, &cn))
+					return_0;
+
+				if (!text_import_vg_fields(cmd, vg, vgn->child))
+					return_0;
+
+				for (cn = cn->child; cn; cn = cn->sib)
+					if (!text_import_pv(cmd, s->fmt, vg, cn)) {
+						log_error("Couldn't find all physical volumes for volume "
+							  "group %s.", vg->name);
+						return 0;
+					}
+
+				pvs = 1;
+				continue;
+			}
+
+			if (!(cn = _node(s, s->mem, vgn)))
+				return_0;
+
+			if (!cn->v)
+				return _unsupported(s, "volume group section order");
+
+			if (last)
+				last->sib = cn;
+			else
+				vgn->child = cn;
+			last = cn;
+			continue;
+		}
+
+		if (_tok_is(s, "logical_volumes")) {
+			if (lvs++)
+				return _unsupported(s, "duplicate logical_volumes");
+
+			_next(s, 0);
+			if (s->t != TOK_SECTION_B)
+				return _unsupported(s, "logical_volumes");
+
+			for (_next(s, 0); s->t != TOK_SECTION_E; )
+				if (!_stream_lv(s)) {
+					if (!s->unsupported)
+						log_error("Couldn't read all logical volume names for volume "
+							  "group %s.", vg->name);
+					return 0;
+				}
+
+			_next(s, 0);
+			continue;
+		}
+
+		if (_tok_is(s, "historical_logical_volumes")) {
+			if (s->historical)
+				return _unsupported(s, "duplicate historical_logical_volumes");
+
+			if (!_stream_nodes(s, &s->historical))
+				return_0;
+
+			for (cn = s->historical->child; cn; cn = cn->sib)
+				if (!text_import_historical_lv(cmd, vg, cn)) {
+					log_error("Couldn't read all historical logical volumes for volume "
+						  "group %s.", vg->name);
+					return 0;
+				}
+			continue;
+		}
+
+		/* Anything after the PVs, which the vsn1 code might also see */
+		if (_vg_key(s))
+			return _unsupported(s, "volume group section order");
+
+		if (!_node(s, s->scratch, NULL))
+			return_0;
+	}
+
+	_next(s, 0);
+
+	if (!pvs)
+		return _unsupported(s, "physical_volumes");
+
+	return 1;
+}
+
+/*
+ * Second pass, once the whole text is read: segments, the links of
+ * historical LVs and the end of _read_vg().
+ */
+static int _stream_vg_done(struct stream *s, struct format_instance *fid)
+{
+	struct volume_group *vg = s->vg;
+	struct stream_lv *slv;
+	struct dm_config_node *cn;
+
+	dm_list_iterate_items(slv, &s->lvs)
+		if (!_stream_lvsegs(s, slv)) {
+			log_error("Couldn't read all logical volumes for "
+				  "volume group %s.", vg->name);
+			return 0;
+		}
+
+	if (s->historical)
+		for (cn = s->historical->child; cn; cn = cn->sib)
+			if (!text_import_historical_lv_links(s->cmd, vg, cn)) {
+				log_error("Couldn't read all removed logical volume interconnections "
+					  "for volume group %s.", vg->name);
+				return 0;
+			}
+
+	return text_import_vg_done(vg, fid);
+}
+
+static int _stream_file(struct stream *s, struct format_instance *fid)
+{
+	const struct dm_config_value **top, *cv;
+	const char *key;
+	size_t key_len;
+
+	while (s->t != TOK_EOF) {
+		if (s->t != TOK_IDENTIFIER)
+			return _unsupported(s, "top-level key");
+
+		key = s->tb;
+		key_len = s->tl;
+		top = _tok_is(s, CONTENTS_FIELD) ? &s->contents :
+		      _tok_is(s, FORMAT_VERSION_FIELD) ? &s->version :
+		      _tok_is(s, "description") ? &s->description :
+		      _tok_is(s, "creation_time") ? &s->creation_time : NULL;
+
+		_next(s, 0);
+
+		if (s->t == TOK_EQ) {
+			_next(s, 1);
+			if (!(cv = _value(s, s->mem)))
+				return_0;
+			/* The first one is found in the tree */
+			if (top && !*top)
+				*top = cv;
+			continue;
+		}
+
+		if (s->t != TOK_SECTION_B)
+			return _unsupported(s, "top-level section");
+
+		_next(s, 0);
+
+		/* The first section is the VG, later ones are skipped */
+		if (s->vg) {
+			if (!_section(s, s->scratch, NULL))
+				return_0;
+			continue;
+		}
+
+		if (!_stream_vg(s, key, key_len))
+			return_0;
+	}
+
+	if (!s->vg)
+		return _unsupported(s, "no volume group");
+
+	/* Metadata on disk has these after the VG section */
+	if (!s->contents || (s->contents->type != DM_CFG_STRING) ||
+	    strcmp(s->contents->v.str, CONTENTS_VALUE) ||
+	    !s->version || (s->version->type != DM_CFG_INT) ||
+	    (s->version->v.i != FORMAT_VERSION_VALUE))
+		return _unsupported(s, "contents or version");
+
+	return _stream_vg_done(s, fid);
+}
+
+struct volume_group *text_read_vg_stream(struct cmd_context *cmd,
+					 const struct format_type *fmt,
+					 struct format_instance *fid,
+					 const char *text,
+					 time_t *when, char **desc,
+					 int *fallback)
+{
+	struct stream s = {
+		.cmd = cmd,
+		.fmt = fmt,
+		.pos = text,
+	};
+	struct volume_group *vg = NULL;
+
+	*fallback = 0;
+	dm_list_init(&s.lvs);
+
+	if (!(s.mem = dm_pool_create("text stream", 64 * 1024)) ||
+	    !(s.scratch = dm_pool_create("text stream lv", 4 * 1024))) {
+		log_error("Failed to allocate metadata import pools.");
+		goto out;
+	}
+
+	if (!(s.striped = get_segtype_from_string(cmd, SEG_TYPE_NAME_STRIPED)))
+		goto_out;
+
+	_next(&s, 0);
+
+	if (!_stream_file(&s, fid)) {
+		if (s.unsupported) {
+			log_debug_metadata("Importing metadata through config tree (%s).",
+					   s.unsupported);
+			*fallback = 1;
+		} else
+			stack;
+		goto out;
+	}
+
+	*desc = dm_pool_strdup(s.vg->vgmem, (s.description && (s.description->type == DM_CFG_STRING)) ?
+			       s.description->v.str : "");
+	*when = (s.creation_time && (s.creation_time->type == DM_CFG_INT)) ?
+		(uint32_t) s.creation_time->v.i : 0;
+
+	vg = s.vg;
+	s.vg = NULL;
+out:
+	if (s.vg)
+		release_vg(s.vg);
+	if (s.scratch)
+		dm_pool_destroy(s.scratch);
+	if (s.mem)
+		dm_pool_destroy(s.mem);
+
+	return vg;
+}
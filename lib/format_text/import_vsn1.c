@@ -366,6 +366,29 @@ static void _insert_segment(struct logical_volume *lv, struct lv_segment *seg)
 	dm_list_add(&lv->segments, &seg->list);
 }
 
+static void _add_segment(struct logical_volume *lv, struct lv_segment *seg)
+{
+	/*
+	 * Insert into correct part of segment list.
+	 */
+	_insert_segment(lv, seg);
+
+	if (seg_is_mirror(seg))
+		lv->status |= MIRROR;
+
+	if (seg_is_mirrored(seg))
+		lv->status |= MIRRORED;
+
+	if (seg_is_raid(seg))
+		lv->status |= RAID;
+
+	if (seg_is_virtual(seg))
+		lv->status |= VIRTUAL;
+
+	if (!seg_is_raid(seg) && _is_converting(lv))
+		lv->status |= CONVERTING;
+}
+
 static struct segment_type *_read_segtype_and_lvflags(struct cmd_context *cmd,
 						      uint64_t *status,
 						      const char *segtype_str)
@@ -467,25 +490,7 @@ static int _read_segment(struct cmd_context *cmd,
 		return 0;
 	}
 
-	/*
-	 * Insert into correct part of segment list.
-	 */
-	_insert_segment(lv, seg);
-
-	if (seg_is_mirror(seg))
-		lv->status |= MIRROR;
-
-	if (seg_is_mirrored(seg))
-		lv->status |= MIRRORED;
-
-	if (seg_is_raid(seg))
-		lv->status |= RAID;
-
-	if (seg_is_virtual(seg))
-		lv->status |= VIRTUAL;
-
-	if (!seg_is_raid(seg) && _is_converting(lv))
-		lv->status |= CONVERTING;
+	_add_segment(lv, seg);
 
 	return 1;
 }
@@ -553,6 +558,29 @@ int text_import_areas(struct lv_segment *seg, const struct dm_config_node *sn,
 	return 1;
 }
 
+static int _check_segments(struct logical_volume *lv, int count, int seg_count)
+{
+	if (seg_count != count) {
+		log_error("segment_count and actual number of segments "
+			  "disagree for logical volume %s.", lv->name);
+		return 0;
+	}
+
+	/*
+	 * Check there are no gaps or overlaps in the lv.
+	 */
+	if (!check_lv_segments_incomplete_vg(lv))
+		return_0;
+
+	/*
+	 * Merge segments in case someones been editing things by hand.
+	 */
+	if (!lv_merge_segments(lv))
+		return_0;
+
+	return 1;
+}
+
 static int _read_segments(struct cmd_context *cmd,
 			  struct format_type *fmt,
 			  struct format_instance *fid,
@@ -586,23 +614,29 @@ static int _read_segments(struct cmd_context *cmd,
 		return 0;
 	}
 
-	if (seg_count != count) {
-		log_error("segment_count and actual number of segments "
-			  "disagree for logical volume %s.", lv->name);
-		return 0;
-	}
+	return _check_segments(lv, count, seg_count);
+}
 
-	/*
-	 * Check there are no gaps or overlaps in the lv.
-	 */
-	if (!check_lv_segments_incomplete_vg(lv))
-		return_0;
+static int _read_special_lv(struct volume_group *vg, struct logical_volume *lv)
+{
+	if (!lv_is_visible(lv) && strstr(lv->name, "_pmspare")) {
+		if (vg->pool_metadata_spare_lv) {
+			log_error("Couldn't use another pool metadata spare "
+				  "logical volume %s.", display_lvname(lv));
+			return 0;
+		}
+		log_debug_metadata("Logical volume %s is pool metadata spare.",
+				   display_lvname(lv));
+		lv->status |= POOL_METADATA_SPARE;
+		vg->pool_metadata_spare_lv = lv;
+	}
 
-	/*
-	 * Merge segments in case someones been editing things by hand.
-	 */
-	if (!lv_merge_segments(lv))
-		return_0;
+	if (!lv_is_visible(lv) && !strcmp(lv->name, LOCKD_SANLOCK_LV_NAME)) {
+		log_debug_metadata("Logical volume %s is sanlock lv.",
+				   display_lvname(lv));
+		lv->status |= LOCKD_SANLOCK_LV;
+		vg->sanlock_lv = lv;
+	}
 
 	return 1;
 }
@@ -740,26 +774,7 @@ static int _read_lvnames(struct cmd_context *cmd,
 	if (timestamp && !lv_set_creation(lv, hostname, timestamp))
 		return_0;
 
-	if (!lv_is_visible(lv) && strstr(lv->name, "_pmspare")) {
-		if (vg->pool_metadata_spare_lv) {
-			log_error("Couldn't use another pool metadata spare "
-				  "logical volume %s.", display_lvname(lv));
-			return 0;
-		}
-		log_debug_metadata("Logical volume %s is pool metadata spare.",
-				   display_lvname(lv));
-		lv->status |= POOL_METADATA_SPARE;
-		vg->pool_metadata_spare_lv = lv;
-	}
-
-	if (!lv_is_visible(lv) && !strcmp(lv->name, LOCKD_SANLOCK_LV_NAME)) {
-		log_debug_metadata("Logical volume %s is sanlock lv.",
-				   display_lvname(lv));
-		lv->status |= LOCKD_SANLOCK_LV;
-		vg->sanlock_lv = lv;
-	}
-
-	return 1;
+	return _read_special_lv(vg, lv);
 }
 
 static int _read_historical_lvnames(struct cmd_context *cmd,
@@ -1037,62 +1052,28 @@ static int _read_sections(struct cmd_context *cmd,
 	return 1;
 }
 
-static struct volume_group *_read_vg(struct cmd_context *cmd,
-				     const struct format_type *fmt,
-				     struct format_instance *fid,
-				     const struct dm_config_tree *cft)
+/*
+ * Read the values of the VG section, vgn is its first child.
+ */
+static int _read_vg_fields(struct cmd_context *cmd,
+			   struct volume_group *vg,
+			   const struct dm_config_node *vgn)
 {
-	struct dm_pool *mem;
-	const struct dm_config_node *vgn;
+	struct dm_pool *mem = vg->vgmem;
 	const struct dm_config_value *cv;
 	const char *str, *format_str, *system_id;
-	struct volume_group *vg;
 	uint64_t vgstatus;
 
-	/* skip any top-level values */
-	for (vgn = cft->root; (vgn && vgn->v); vgn = vgn->sib)
-		;
-
-	if (!vgn) {
-		log_error("Couldn't find volume group in file.");
-		return NULL;
-	}
-
-	if (!(vg = alloc_vg("read_vg", cmd, vgn->key)))
-		return_NULL;
-
-	mem = vg->vgmem;
-
-	/*
-	 * The pv_names memorizes the pv section names -> pv
-	 * structures.
-	 */
-	if (!(vg->pv_names = radix_tree_create(NULL, NULL))) {
-		log_error("Couldn't create pv_names radix tree.");
-		goto bad;
-	}
-
-	/*
-	 * The lv_names radix_tree memorizes the lv section names -> lv
-	 * structures.
-	 */
-	if (!(vg->lv_names = radix_tree_create(NULL, NULL))) {
-		log_error("Couldn't create lv_names radix tree.");
-		goto bad;
-	}
-
-	vgn = vgn->child;
-
 	/* A backup file might be a backup of a different format */
 	if (dm_config_get_str(vgn, "format", &format_str) &&
 	    !(vg->original_fmt = get_format_by_name(cmd, format_str))) {
 		log_error("Unrecognised format %s for volume group %s.", format_str, vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (dm_config_get_str(vgn, "lock_type", &str)) {
 		if (!(vg->lock_type = dm_pool_strdup(mem, str)))
-			goto bad;
+			return 0;
 	}
 
 	/*
@@ -1118,7 +1099,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	 */
 	if (dm_config_get_str(vgn, "lock_args", &str)) {
 		if (!(vg->lock_args = dm_pool_strdup(mem, str)))
-			goto bad;
+			return 0;
 	}
 
 	/*
@@ -1130,7 +1111,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 		dm_list_init(&pr_list);
 		if (!_read_str_list(mem, &pr_list, cv)) {
 			log_error("Couldn't read pr for volume group %s.", vg->name);
-			goto bad;
+			return 0;
 		}
 		if (str_list_match_item(&pr_list, "require"))
 			vg->pr |= VG_PR_REQUIRE;
@@ -1142,25 +1123,25 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 
 	if (!_read_id(&vg->id, vgn, "id")) {
 		log_error("Couldn't read uuid for volume group %s.", vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!_read_int32(vgn, "seqno", &vg->seqno)) {
 		log_error("Couldn't read 'seqno' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!_read_flag_config(vgn, &vgstatus, VG_FLAGS)) {
 		log_error("Error reading flags of volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (dm_config_get_str(vgn, "system_id", &system_id)) {
 		if (!(vg->system_id = dm_pool_strdup(mem, system_id))) {
 			log_error("Failed to allocate memory for system_id in _read_vg.");
-			goto bad;
+			return 0;
 		}
 	}
 
@@ -1173,7 +1154,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	if (!_read_int32(vgn, "extent_size", &vg->extent_size)) {
 		log_error("Couldn't read extent size for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	/*
@@ -1184,13 +1165,13 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	if (!_read_int32(vgn, "max_lv", &vg->max_lv)) {
 		log_error("Couldn't read 'max_lv' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!_read_int32(vgn, "max_pv", &vg->max_pv)) {
 		log_error("Couldn't read 'max_pv' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (dm_config_get_str(vgn, "allocation_policy", &str)) {
@@ -1206,7 +1187,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 		vg->profile = add_profile(cmd, str, CONFIG_PROFILE_METADATA);
 		if (!vg->profile) {
 			log_error("Failed to add configuration profile %s for VG %s", str, vg->name);
-			goto bad;
+			return 0;
 		}
 	}
 
@@ -1214,17 +1195,77 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 		vg->mda_copies = DEFAULT_VGMETADATACOPIES;
 	}
 
-	if (!_read_sections(cmd, fmt, fid, mem, "physical_volumes", _read_pv, vg, NULL,
-			    vgn, 0)) {
-		log_error("Couldn't find all physical volumes for volume "
-			  "group %s.", vg->name);
-		goto bad;
-	}
-
 	/* Optional tags */
 	if (dm_config_get_list(vgn, "tags", &cv) &&
 	    !(_read_str_list(mem, &vg->tags, cv))) {
 		log_error("Couldn't read tags for volume group %s.", vg->name);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _read_vg_done(struct volume_group *vg, struct format_instance *fid)
+{
+	if (vg->fixup_imported_mirrors &&
+	    !fixup_imported_mirrors(vg)) {
+		log_error("Failed to fixup mirror pointers after import for "
+			  "volume group %s.", vg->name);
+		return 0;
+	}
+
+	if (fid)
+		vg_set_fid(vg, fid);
+
+	if (vg->pv_names) {
+		radix_tree_destroy(vg->pv_names);
+		vg->pv_names = NULL; /* PV names are no longer valid outside of _read_vg() */
+	}
+
+	return 1;
+}
+
+static struct volume_group *_read_vg(struct cmd_context *cmd,
+				     const struct format_type *fmt,
+				     struct format_instance *fid,
+				     const struct dm_config_tree *cft)
+{
+	struct dm_pool *mem;
+	const struct dm_config_node *vgn;
+	struct volume_group *vg;
+
+	/* skip any top-level values */
+	for (vgn = cft->root; (vgn && vgn->v); vgn = vgn->sib)
+		;
+
+	if (!vgn) {
+		log_error("Couldn't find volume group in file.");
+		return NULL;
+	}
+
+	if (!(vg = alloc_vg("read_vg", cmd, vgn->key)))
+		return_NULL;
+
+	mem = vg->vgmem;
+
+	/*
+	 * The pv_names memorizes the pv section names -> pv
+	 * structures.
+	 */
+	if (!(vg->pv_names = radix_tree_create(NULL, NULL))) {
+		log_error("Couldn't create pv_names radix tree.");
+		goto bad;
+	}
+
+	vgn = vgn->child;
+
+	if (!_read_vg_fields(cmd, vg, vgn))
+		goto_bad;
+
+	if (!_read_sections(cmd, fmt, fid, mem, "physical_volumes", _read_pv, vg, NULL,
+			    vgn, 0)) {
+		log_error("Couldn't find all physical volumes for volume "
+			  "group %s.", vg->name);
 		goto bad;
 	}
 
@@ -1256,20 +1297,8 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 		goto bad;
 	}
 
-	if (vg->fixup_imported_mirrors &&
-	    !fixup_imported_mirrors(vg)) {
-		log_error("Failed to fixup mirror pointers after import for "
-			  "volume group %s.", vg->name);
-		goto bad;
-	}
-
-	if (fid)
-		vg_set_fid(vg, fid);
-
-	if (vg->pv_names) {
-		radix_tree_destroy(vg->pv_names);
-		vg->pv_names = NULL; /* PV names are no longer valid outside of _read_vg() */
-	}
+	if (!_read_vg_done(vg, fid))
+		goto_bad;
 
 	/*
 	 * Finished.
@@ -1367,6 +1396,60 @@ static int _read_vgsummary(const struct format_type *fmt, const struct dm_config
 	return 1;
 }
 
+/*
+ * Used by the streaming importer (import_stream.c) for the sections
+ * it passes on as small config trees and for the checks it shares.
+ */
+int text_import_vg_fields(struct cmd_context *cmd, struct volume_group *vg,
+			  const struct dm_config_node *vgn)
+{
+	return _read_vg_fields(cmd, vg, vgn);
+}
+
+int text_import_vg_done(struct volume_group *vg, struct format_instance *fid)
+{
+	return _read_vg_done(vg, fid);
+}
+
+int text_import_pv(struct cmd_context *cmd, const struct format_type *fmt,
+		   struct volume_group *vg, const struct dm_config_node *pvn)
+{
+	return _read_pv(cmd, (struct format_type *)fmt, NULL, vg->vgmem, vg, NULL, pvn, NULL);
+}
+
+int text_import_special_lv(struct volume_group *vg, struct logical_volume *lv)
+{
+	return _read_special_lv(vg, lv);
+}
+
+int text_import_segment(struct cmd_context *cmd, struct logical_volume *lv,
+			const struct dm_config_node *sn)
+{
+	return _read_segment(cmd, NULL, NULL, lv->vg->vgmem, lv, sn);
+}
+
+void text_import_add_segment(struct logical_volume *lv, struct lv_segment *seg)
+{
+	_add_segment(lv, seg);
+}
+
+int text_import_check_segments(struct logical_volume *lv, int count, int seg_count)
+{
+	return _check_segments(lv, count, seg_count);
+}
+
+int text_import_historical_lv(struct cmd_context *cmd, struct volume_group *vg,
+			      const struct dm_config_node *hlvn)
+{
+	return _read_historical_lvnames(cmd, NULL, NULL, vg->vgmem, vg, NULL, hlvn, NULL);
+}
+
+int text_import_historical_lv_links(struct cmd_context *cmd, struct volume_group *vg,
+				    const struct dm_config_node *hlvn)
+{
+	return _read_historical_lvnames_interconnections(cmd, NULL, NULL, vg->vgmem, vg, NULL, hlvn, NULL);
+}
+
 static const struct text_vg_version_ops _vsn1_ops = {
 	.check_version = _vsn1_check_version,
 	.read_vg = _read_vg,
@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The metadata cache keeps a binary copy of the parsed metadata of each
+ * VG in a file under the run directory.  When a VG is read and the
+ * mda_header gives the same checksum and size of the metadata text as the
+ * cache file was saved from, the config tree is loaded from the file
+ * instead of parsing the text.  The text is still read and checked
+ * against the checksum, so the text on disk remains authoritative: any
+ * change to the metadata changes the checksum in the mda_header, and the
+ * cache file is replaced the next time the text is parsed.  The file is
+ * removed when the VG is removed or renamed.
+ *
+ * The file holds the nodes and values of the config tree in two arrays,
+ * linked by index, followed by a table of NUL terminated strings that
+ * keys and string values refer to by offset.  Repeated strings are
+ * stored once.  All numbers are little-endian.  The file is read into
+ * the pool of the config tree and the strings are used in place.
+ *
+ * Nodes are stored in pre-order, so the child and sib of a node always
+ * have higher indexes than the node, and the next of a value a higher
+ * index than the value, which is checked when reading, so a damaged file
+ * cannot make a loop.  Header and body have their own checksums.
+ */
+
+#include "lib/misc/lib.h"
+#include "base/memory/zalloc.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/config/config.h"
+#include "lib/format_text/metadata_cache.h"
+#include "lib/misc/crc.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MDC_MAGIC "LVM2MDC\n"
+#define MDC_VERSION 1
+#define MDC_NONE UINT32_MAX
+
+/* Larger metadata is not cached. */
+#define MDC_MAX_FILE_SIZE (256 * 1024 * 1024)
+
+struct mdc_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t text_checksum;
+	uint64_t text_size;
+	uint32_t node_count;
+	uint32_t value_count;
+	uint32_t strings_size;
+	uint32_t body_checksum;		/* nodes, values and strings */
+	uint32_t header_checksum;	/* fields above */
+	uint32_t unused;
+};
+
+struct mdc_node {
+	uint32_t key;			/* string offset */
+	uint32_t child;
+	uint32_t sib;
+	uint32_t value;
+};
+
+struct mdc_value {
+	uint32_t type;
+	uint32_t next;
+	uint64_t v;			/* int, float bits or string offset */
+};
+
+struct mdc_writer {
+	struct dm_hash_table *strings;	/* string -> offset + 1 */
+	uint32_t strings_size;
+	uint32_t node_count;
+	uint32_t value_count;
+	struct mdc_node *nodes;
+	struct mdc_value *values;
+	uint32_t node_next;
+	uint32_t value_next;
+};
+
+int metadata_cache_enabled(struct cmd_context *cmd)
+{
+	return find_config_tree_bool(cmd, metadata_binary_cache_CFG, NULL);
+}
+
+static int _cache_path(char *path, size_t size, const char *vgname)
+{
+	if (dm_snprintf(path, size, "%s/%s", METADATA_CACHE_DIR, vgname) < 0) {
+		log_debug_metadata("Metadata cache path too long for VG %s.", vgname);
+		return 0;
+	}
+
+	return 1;
+}
+
+static uint32_t _header_checksum(const struct mdc_header *hdr)
+{
+	return calc_crc(INITIAL_CRC, (const uint8_t *) hdr,
+			offsetof(struct mdc_header, header_checksum));
+}
+
+/*
+ * Writing
+ */
+static int _count_string(struct mdc_writer *w, const char *str)
+{
+	size_t len;
+
+	if (dm_hash_lookup(w->strings, str))
+		return 1;
+
+	len = strlen(str) + 1;
+	if (len > MDC_MAX_FILE_SIZE - w->strings_size)
+		return_0;
+
+	if (!dm_hash_insert(w->strings, str, (void *) (uintptr_t) (w->strings_size + 1)))
+		return_0;
+
+	w->strings_size += len;
+
+	return 1;
+}
+
+static int _count_nodes(struct mdc_writer *w, const struct dm_config_node *cn)
+{
+	const struct dm_config_value *v;
+
+	for (; cn; cn = cn->sib) {
+		w->node_count++;
+		if (!_count_string(w, cn->key))
+			return_0;
+
+		for (v = cn->v; v; v = v->next) {
+			w->value_count++;
+			if ((v->type == DM_CFG_STRING) && !_count_string(w, v->v.str))
+				return_0;
+		}
+
+		if (!_count_nodes(w, cn->child))
+			return_0;
+	}
+
+	return 1;
+}
+
+static uint32_t _string_offset(struct mdc_writer *w, const char *str)
+{
+	return (uint32_t) (uintptr_t) dm_hash_lookup(w->strings, str) - 1;
+}
+
+static uint32_t _put_values(struct mdc_writer *w, const struct dm_config_value *v)
+{
+	uint32_t first = w->value_next;
+	struct mdc_value *mv;
+	uint64_t bits;
+	float f;
+
+	for (; v; v = v->next) {
+		mv = &w->values[w->value_next++];
+		mv->type = htole32(v->type);
+		mv->next = htole32(v->next ? w->value_next : MDC_NONE);
+
+		switch (v->type) {
+		case DM_CFG_INT:
+			bits = (uint64_t) v->v.i;
+			break;
+		case DM_CFG_FLOAT:
+			f = v->v.f;
+			bits = 0;
+			memcpy(&bits, &f, sizeof(f));
+			break;
+		case DM_CFG_STRING:
+			bits = _string_offset(w, v->v.str);
+			break;
+		default:
+			bits = 0;
+		}
+
+		mv->v = htole64(bits);
+	}
+
+	return first;
+}
+
+static uint32_t _put_nodes(struct mdc_writer *w, const struct dm_config_node *cn)
+{
+	uint32_t first = w->node_next;
+	struct mdc_node *mn = NULL;
+	uint32_t idx;
+
+	for (; cn; cn = cn->sib) {
+		idx = w->node_next++;
+		if (mn)
+			mn->sib = htole32(idx);
+
+		mn = &w->nodes[idx];
+		mn->key = htole32(_string_offset(w, cn->key));
+		mn->value = htole32(cn->v ? _put_values(w, cn->v) : MDC_NONE);
+		mn->child = htole32(cn->child ? _put_nodes(w, cn->child) : MDC_NONE);
+		mn->sib = htole32(MDC_NONE);
+	}
+
+	return first;
+}
+
+static int _write_all(int fd, const char *buf, size_t size)
+{
+	ssize_t rv;
+
+	while (size) {
+		rv = write(fd, buf, size);
+		if (rv < 0 && errno == EINTR)
+			continue;
+		if (rv <= 0)
+			return 0;
+		buf += rv;
+		size -= rv;
+	}
+
+	return 1;
+}
+
+int metadata_cache_write_file(const struct dm_config_tree *cft, const char *path,
+			      uint32_t text_checksum, uint64_t text_size)
+{
+	struct mdc_writer w = { 0 };
+	struct mdc_header *hdr;
+	struct dm_hash_node *hn;
+	char *buf = NULL, *strings;
+	size_t size;
+	int fd, r = 0;
+
+	if (!(w.strings = dm_hash_create(1024)))
+		return_0;
+
+	if (!_count_nodes(&w, cft->root))
+		goto_out;
+
+	size = sizeof(*hdr) + (size_t) w.node_count * sizeof(struct mdc_node) +
+		(size_t) w.value_count * sizeof(struct mdc_value) + w.strings_size;
+
+	if (size > MDC_MAX_FILE_SIZE) {
+		log_debug_metadata("Metadata cache file would be too large.");
+		goto out;
+	}
+
+	if (!(buf = zalloc(size)))
+		goto_out;
+
+	hdr = (struct mdc_header *) buf;
+	w.nodes = (struct mdc_node *) (hdr + 1);
+	w.values = (struct mdc_value *) (w.nodes + w.node_count);
+	strings = (char *) (w.values + w.value_count);
+
+	dm_hash_iterate(hn, w.strings)
+		strcpy(strings + (uintptr_t) dm_hash_get_data(w.strings, hn) - 1,
+		       dm_hash_get_key(w.strings, hn));
+
+	if (cft->root)
+		(void) _put_nodes(&w, cft->root);
+
+	memcpy(hdr->magic, MDC_MAGIC, sizeof(hdr->magic));
+	hdr->version = htole32(MDC_VERSION);
+	hdr->text_checksum = htole32(text_checksum);
+	hdr->text_size = htole64(text_size);
+	hdr->node_count = htole32(w.node_count);
+	hdr->value_count = htole32(w.value_count);
+	hdr->strings_size = htole32(w.strings_size);
+	hdr->body_checksum = htole32(calc_crc(INITIAL_CRC, (const uint8_t *) (hdr + 1),
+					      (uint32_t) (size - sizeof(*hdr))));
+	hdr->header_checksum = htole32(_header_checksum(hdr));
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0) {
+		log_debug_metadata("Failed to create metadata cache %s errno %d.", path, errno);
+		goto out;
+	}
+
+	if (!(r = _write_all(fd, buf, size)))
+		log_debug_metadata("Failed to write metadata cache %s errno %d.", path, errno);
+
+	if (close(fd)) {
+		log_debug_metadata("Failed to close metadata cache %s errno %d.", path, errno);
+		r = 0;
+	}
+out:
+	free(buf);
+	dm_hash_destroy(w.strings);
+
+	return r;
+}
+
+void metadata_cache_write(const struct dm_config_tree *cft, const char *vgname,
+			  uint32_t text_checksum, uint64_t text_size)
+{
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+
+	if (!_cache_path(path, sizeof(path), vgname) ||
+	    (dm_snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, getpid()) < 0))
+		return;
+
+	if (mkdir(METADATA_CACHE_DIR, 0700) && (errno != EEXIST)) {
+		log_debug_metadata("Failed to create %s errno %d.", METADATA_CACHE_DIR, errno);
+		return;
+	}
+
+	/* Written under a temporary name so readers see a complete file. */
+	if (!metadata_cache_write_file(cft, tmp_path, text_checksum, text_size)) {
+		if (unlink(tmp_path) && (errno != ENOENT))
+			log_debug_metadata("Failed to unlink %s errno %d.", tmp_path, errno);
+		return;
+	}
+
+	if (rename(tmp_path, path)) {
+		log_debug_metadata("Failed to rename %s errno %d.", path, errno);
+		if (unlink(tmp_path))
+			log_debug_metadata("Failed to unlink %s errno %d.", tmp_path, errno);
+		return;
+	}
+
+	log_debug_metadata("Saved metadata cache for VG %s.", vgname);
+}
+
+void metadata_cache_remove(const char *vgname)
+{
+	char path[PATH_MAX];
+
+	if (!_cache_path(path, sizeof(path), vgname))
+		return;
+
+	if (unlink(path)) {
+		if (errno != ENOENT)
+			log_debug_metadata("Failed to unlink %s errno %d.", path, errno);
+		return;
+	}
+
+	log_debug_metadata("Removed metadata cache for VG %s.", vgname);
+}
+
+/*
+ * Reading
+ */
+static int _read_all(int fd, char *buf, size_t size)
+{
+	ssize_t rv;
+
+	while (size) {
+		rv = read(fd, buf, size);
+		if (rv < 0 && errno == EINTR)
+			continue;
+		if (rv <= 0)
+			return 0;
+		buf += rv;
+		size -= rv;
+	}
+
+	return 1;
+}
+
+static int _load_tree(struct dm_config_tree *cft, char *buf, size_t size,
+		      uint32_t text_checksum, uint64_t text_size)
+{
+	const struct mdc_header *hdr = (const struct mdc_header *) buf;
+	const struct mdc_node *mnodes;
+	const struct mdc_value *mvalues;
+	struct dm_config_node *nodes, *cn;
+	struct dm_config_value *values = NULL;
+	uint32_t node_count, value_count, strings_size, i, key, child, sib, value, next;
+	const char *strings;
+	uint64_t bits;
+	float f;
+
+	if ((size < sizeof(*hdr)) ||
+	    memcmp(hdr->magic, MDC_MAGIC, sizeof(hdr->magic)) ||
+	    (le32toh(hdr->version) != MDC_VERSION) ||
+	    (le32toh(hdr->header_checksum) != _header_checksum(hdr)))
+		return 0;
+
+	if ((le32toh(hdr->text_checksum) != text_checksum) ||
+	    (le64toh(hdr->text_size) != text_size))
+		return 0;
+
+	node_count = le32toh(hdr->node_count);
+	value_count = le32toh(hdr->value_count);
+	strings_size = le32toh(hdr->strings_size);
+
+	if (!node_count || !strings_size ||
+	    (node_count > MDC_MAX_FILE_SIZE / sizeof(*mnodes)) ||
+	    (value_count > MDC_MAX_FILE_SIZE / sizeof(*mvalues)) ||
+	    (size != sizeof(*hdr) + (size_t) node_count * sizeof(*mnodes) +
+		     (size_t) value_count * sizeof(*mvalues) + strings_size))
+		return 0;
+
+	if (le32toh(hdr->body_checksum) !=
+	    calc_crc(INITIAL_CRC, (const uint8_t *) (hdr + 1), (uint32_t) (size - sizeof(*hdr))))
+		return 0;
+
+	mnodes = (const struct mdc_node *) (hdr + 1);
+	mvalues = (const struct mdc_value *) (mnodes + node_count);
+	strings = (const char *) (mvalues + value_count);
+
+	/* Any offset within the table is then a terminated string. */
+	if (strings[strings_size - 1])
+		return 0;
+
+	if (!(nodes = dm_pool_zalloc(cft->mem, sizeof(*nodes) * node_count)) ||
+	    (value_count && !(values = dm_pool_zalloc(cft->mem, sizeof(*values) * value_count))))
+		return_0;
+
+	for (i = 0; i < value_count; i++) {
+		next = le32toh(mvalues[i].next);
+		bits = le64toh(mvalues[i].v);
+
+		if ((next != MDC_NONE) && ((next <= i) || (next >= value_count)))
+			return 0;
+
+		values[i].next = (next != MDC_NONE) ? &values[next] : NULL;
+		values[i].type = le32toh(mvalues[i].type);
+
+		switch (values[i].type) {
+		case DM_CFG_INT:
+			values[i].v.i = (int64_t) bits;
+			break;
+		case DM_CFG_FLOAT:
+			memcpy(&f, &bits, sizeof(f));
+			values[i].v.f = f;
+			break;
+		case DM_CFG_STRING:
+			if (bits >= strings_size)
+				return 0;
+			values[i].v.str = strings + bits;
+			break;
+		case DM_CFG_EMPTY_ARRAY:
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	for (i = 0; i < node_count; i++) {
+		key = le32toh(mnodes[i].key);
+		child = le32toh(mnodes[i].child);
+		sib = le32toh(mnodes[i].sib);
+		value = le32toh(mnodes[i].value);
+
+		if ((key >= strings_size) ||
+		    ((child != MDC_NONE) && ((child <= i) || (child >= node_count))) ||
+		    ((sib != MDC_NONE) && ((sib <= i) || (sib >= node_count))) ||
+		    ((value != MDC_NONE) && (value >= value_count)))
+			return 0;
+
+		nodes[i].key = strings + key;
+		nodes[i].child = (child != MDC_NONE) ? &nodes[child] : NULL;
+		nodes[i].sib = (sib != MDC_NONE) ? &nodes[sib] : NULL;
+		nodes[i].v = (value != MDC_NONE) ? &values[value] : NULL;
+	}
+
+	for (i = 0; i < node_count; i++)
+		for (cn = nodes[i].child; cn; cn = cn->sib)
+			cn->parent = &nodes[i];
+
+	cft->root = &nodes[0];
+
+	return 1;
+}
+
+int metadata_cache_read_file(struct dm_config_tree *cft, const char *path,
+			     uint32_t text_checksum, uint64_t text_size)
+{
+	struct stat st;
+	char *buf;
+	int fd, r = 0;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		if (errno != ENOENT)
+			log_debug_metadata("Failed to open metadata cache %s errno %d.", path, errno);
+		return 0;
+	}
+
+	if (fstat(fd, &st) || (st.st_size > MDC_MAX_FILE_SIZE)) {
+		log_debug_metadata("Ignoring metadata cache %s.", path);
+		goto out;
+	}
+
+	if (!(buf = dm_pool_alloc(cft->mem, (size_t) st.st_size)))
+		goto_out;
+
+	if (!_read_all(fd, buf, (size_t) st.st_size)) {
+		log_debug_metadata("Failed to read metadata cache %s errno %d.", path, errno);
+		dm_pool_free(cft->mem, buf);
+		goto out;
+	}
+
+	if (!(r = _load_tree(cft, buf, (size_t) st.st_size, text_checksum, text_size))) {
+		cft->root = NULL;
+		dm_pool_free(cft->mem, buf);
+	}
+out:
+	if (close(fd))
+		log_debug_metadata("Failed to close metadata cache %s errno %d.", path, errno);
+
+	return r;
+}
+
+int metadata_cache_read(struct dm_config_tree *cft, const char *vgname,
+			uint32_t text_checksum, uint64_t text_size)
+{
+	char path[PATH_MAX];
+
+	if (!_cache_path(path, sizeof(path), vgname))
+		return 0;
+
+	if (!metadata_cache_read_file(cft, path, text_checksum, text_size))
+		return 0;
+
+	log_debug_metadata("Using metadata cache for VG %s.", vgname);
+
+	return 1;
+}
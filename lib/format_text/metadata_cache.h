@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_METADATA_CACHE_H
+#define _LVM_METADATA_CACHE_H
+
+#include <stdint.h>
+
+struct cmd_context;
+struct dm_config_tree;
+
+int metadata_cache_enabled(struct cmd_context *cmd);
+
+/*
+ * Fill in cft from the cache file of the VG if it was saved from metadata
+ * text with the given checksum and size.  Returns 0 if there is no usable
+ * cache file.
+ */
+int metadata_cache_read(struct dm_config_tree *cft, const char *vgname,
+			uint32_t text_checksum, uint64_t text_size);
+
+/*
+ * Save cft, parsed from metadata text with the given checksum and size,
+ * to the cache file of the VG.
+ */
+void metadata_cache_write(const struct dm_config_tree *cft, const char *vgname,
+			  uint32_t text_checksum, uint64_t text_size);
+
+/*
+ * Remove the cache file of a VG that was removed or renamed.
+ */
+void metadata_cache_remove(const char *vgname);
+
+/*
+ * The file format, exposed for the unit tests which write and read
+ * files in a given path.
+ */
+int metadata_cache_read_file(struct dm_config_tree *cft, const char *path,
+			     uint32_t text_checksum, uint64_t text_size);
+int metadata_cache_write_file(const struct dm_config_tree *cft, const char *path,
+			      uint32_t text_checksum, uint64_t text_size);
+
+#endif
@@ -23,6 +23,8 @@
 #include "lib/commands/toolcontext.h"
 #include "lib/activate/activate.h"
 #include "lib/label/hints.h"
+#include "lib/label/scan_cache.h"
+#include "lib/label/scan_workers.h"
 #include "lib/metadata/metadata.h"
 #include "lib/format_text/layout.h"
 #include "lib/device/device_id.h"
@@ -36,7 +38,6 @@
 
 /* FIXME Allow for larger labels?  Restricted to single sector currently */
 
-static uint64_t _current_bcache_size_bytes;
 
 /*
  * Internal labeller struct.
@@ -257,6 +258,7 @@ struct label *label_create(struct labeller *labeller)
 static struct bcache *scan_bcache;
 
 #define BCACHE_BLOCK_SIZE_IN_SECTORS 256 /* 256*512 = 128K */
+#define BCACHE_BLOCK_SIZE_BYTES (BCACHE_BLOCK_SIZE_IN_SECTORS * 512)
 
 static bool _in_bcache(struct device *dev)
 {
@@ -620,29 +622,206 @@ static void _invalidate_di(struct bcache *cache, int di)
 
 #define HEADERS_BUF_SIZE 4096
 
+/*
+ * With devices/scan_label_first the scan reads only HEADERS_BUF_SIZE
+ * from each device first, which covers the label in the first four
+ * sectors for any logical block size.  The full scan_bcache block,
+ * with the mda_header and usually the metadata, is then read only from
+ * the devices that have an lvm label.  _label_bcache shares the di
+ * numbers of scan_bcache.
+ */
+static struct bcache *_label_bcache;
+
+#define LABEL_BCACHE_BLOCK_SECTORS (HEADERS_BUF_SIZE >> SECTOR_SHIFT)
+#define LABEL_BCACHE_BLOCKS 256
+
+/*
+ * While a device without a label is processed after the first pass,
+ * filters reading within the first HEADERS_BUF_SIZE bytes get the data
+ * already read instead of reading a full scan_bcache block.
+ */
+static struct device *_headers_dev;
+static const char *_headers_dev_buf;
+
+static struct io_engine *_create_io_engine(void);
+
+static int _setup_label_bcache(void)
+{
+	struct io_engine *ioe;
+
+	if (_label_bcache)
+		return 1;
+
+	if (!(ioe = _create_io_engine()))
+		return_0;
+
+	if (!(_label_bcache = bcache_create(LABEL_BCACHE_BLOCK_SECTORS, LABEL_BCACHE_BLOCKS, ioe))) {
+		log_debug_devs("Failed to set up label io layer, reading full blocks.");
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _has_label_id(const char *headers_buf)
+{
+	const struct label_header *lh;
+	uint64_t sector;
+
+	for (sector = 0; sector < LABEL_SCAN_SECTORS; sector += LABEL_SIZE >> SECTOR_SHIFT) {
+		lh = (const struct label_header *) (headers_buf + (sector << SECTOR_SHIFT));
+		if (!memcmp(lh->id, LABEL_ID, sizeof(lh->id)))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void _scan_read_failed(struct device *dev, struct block *bb)
+{
+	log_debug_devs("Scan failed to read %s.", dev_name(dev));
+	dev->flags |= DEV_SCAN_NOT_READ;
+	lvmcache_del_dev(dev);
+	if (bb)
+		bcache_put(bb);
+}
+
+/*
+ * Returns 0 if processing failed for an lvm device.
+ */
+static int _scan_process_dev(struct cmd_context *cmd, struct dev_filter *f,
+			     struct device *dev, char *headers_buf, int want_other_devs)
+{
+	int is_lvm_device = 0;
+	int ret;
+
+	log_debug_devs("Processing data from device %s %u:%u di %d.",
+		       dev_name(dev), MAJOR(dev->dev), MINOR(dev->dev), dev->bcache_di);
+
+	ret = _process_block(cmd, f, dev, headers_buf, HEADERS_BUF_SIZE, 0, 0, &is_lvm_device);
+
+	if (!ret && is_lvm_device)
+		log_debug_devs("Scan failed to process %s", dev_name(dev));
+
+	/*
+	 * Keep the bcache block of lvm devices we have processed so
+	 * that the vg_read phase can reuse it.  If bcache failed to
+	 * read the block, or the device does not belong to lvm, then
+	 * drop it from bcache.  When "want_other_devs" is set, it
+	 * means the caller wants to scan and keep open non-lvm devs,
+	 * e.g. to pvcreate them.
+	 */
+	if (!is_lvm_device && !want_other_devs) {
+		_invalidate_di(scan_bcache, dev->bcache_di);
+		_scan_dev_close(dev);
+	}
+
+	return (!ret && is_lvm_device) ? 0 : 1;
+}
+
+static void _scan_workers_no_log(int level, const char *file, int line,
+				 int dm_errno_or_class, const char *f, ...)
+{
+}
+
+/*
+ * Let scan workers read and parse the metadata text of the devs whose
+ * full blocks have been prefetched, before the devs are processed
+ * serially.  read_metadata_location_summary() then finds the parsed
+ * metadata by the mda_header checksum.
+ *
+ * The libdm config parser logs errors in bad metadata text through
+ * print_log_libdm(), which is not thread safe, so libdm logging is off
+ * while the workers run.  The serial scan parses a text that a worker
+ * could not parse again and reports the problem.  When libdm does not
+ * log through lvm, its log function could not be put back, so there
+ * are no workers.
+ */
+static void _scan_prepare_devs(struct cmd_context *cmd, struct dm_list *devs, unsigned workers)
+{
+	struct scan_prepare_job *jobs;
+	struct block **bbs;
+	struct device_list *devl;
+	unsigned count = dm_list_size(devs);
+	unsigned n = 0;
+	unsigned i;
+
+	if (workers < 2 || count < 2 || !cmd->libdm_log)
+		return;
+
+	if (!(jobs = zalloc(count * sizeof(*jobs))))
+		return;
+
+	if (!(bbs = zalloc(count * sizeof(*bbs)))) {
+		free(jobs);
+		return;
+	}
+
+	dm_list_iterate_items(devl, devs) {
+		if (!bcache_get(scan_bcache, devl->dev->bcache_di, 0, 0, &bbs[n])) {
+			/* The serial scan reports the error. */
+			if (bbs[n])
+				bcache_put(bbs[n]);
+			bbs[n] = NULL;
+			continue;
+		}
+
+		jobs[n].fd = devl->dev->bcache_fd;
+		jobs[n].block = bbs[n]->data;
+		jobs[n].block_size = BCACHE_BLOCK_SIZE_IN_SECTORS << SECTOR_SHIFT;
+		n++;
+	}
+
+	if (n) {
+		dm_log_with_errno_init(_scan_workers_no_log);
+		(void) scan_prepare_metadata(jobs, n, workers);
+		dm_log_with_errno_init(print_log_libdm);
+	}
+
+	for (i = 0; i < n; i++)
+		bcache_put(bbs[i]);
+
+	free(bbs);
+	free(jobs);
+}
+
 static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 		      struct dm_list *devs, int want_other_devs, int *failed)
 {
 	char headers_buf[HEADERS_BUF_SIZE];
 	struct dm_list wait_devs;
+	struct dm_list full_devs;
 	struct dm_list done_devs;
 	struct device_list *devl, *devl2;
+	struct bcache *first_bcache = scan_bcache;
 	struct block *bb;
 	int scan_read_errors = 0;
 	int scan_process_errors = 0;
 	int scan_failed_count = 0;
+	int scan_label_reads = 0;
+	int scan_full_reads = 0;
 	int rem_prefetches;
 	int submit_count;
-	int is_lvm_device;
-	int ret;
+	int workers;
 
 	dm_list_init(&wait_devs);
+	dm_list_init(&full_devs);
 	dm_list_init(&done_devs);
 
 	log_debug_devs("Scanning %d devices for VG info", dm_list_size(devs));
 
+	if (find_config_tree_bool(cmd, devices_scan_label_first_CFG, NULL) &&
+	    _setup_label_bcache())
+		first_bcache = _label_bcache;
+
+	workers = find_config_tree_int(cmd, devices_scan_workers_CFG, NULL);
+	if (workers > SCAN_WORKERS_MAX)
+		workers = SCAN_WORKERS_MAX;
+
  scan_more:
 	rem_prefetches = bcache_max_prefetches(scan_bcache);
+	if (bcache_max_prefetches(first_bcache) < (unsigned) rem_prefetches)
+		rem_prefetches = bcache_max_prefetches(first_bcache);
 	submit_count = 0;
 
 	dm_list_iterate_items_safe(devl, devl2, devs) {
@@ -669,7 +848,7 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 			}
 		}
 
-		bcache_prefetch(scan_bcache, devl->dev->bcache_di, 0);
+		bcache_prefetch(first_bcache, devl->dev->bcache_di, 0);
 
 		rem_prefetches--;
 		submit_count++;
@@ -680,72 +859,116 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 
 	log_debug_devs("Scanning submitted %d reads", submit_count);
 
+	if (first_bcache == scan_bcache && workers > 1)
+		_scan_prepare_devs(cmd, &wait_devs, workers);
+
 	dm_list_iterate_items_safe(devl, devl2, &wait_devs) {
 		bb = NULL;
-		is_lvm_device = 0;
 
-		if (!bcache_get(scan_bcache, devl->dev->bcache_di, 0, 0, &bb)) {
-			log_debug_devs("Scan failed to read %s.", dev_name(devl->dev));
+		if (!bcache_get(first_bcache, devl->dev->bcache_di, 0, 0, &bb)) {
+			_scan_read_failed(devl->dev, bb);
 			scan_read_errors++;
 			scan_failed_count++;
-			devl->dev->flags |= DEV_SCAN_NOT_READ;
-			lvmcache_del_dev(devl->dev);
-			if (bb)
+			if (!want_other_devs) {
+				_invalidate_di(scan_bcache, devl->dev->bcache_di);
+				_scan_dev_close(devl->dev);
+			}
+			goto next;
+		}
+
+		if (first_bcache != scan_bcache) {
+			scan_label_reads++;
+
+			if (_has_label_id(bb->data)) {
+				/* Read the full block together with other lvm devs. */
 				bcache_put(bb);
-		} else {
-			/* copy the first 4k from bb that will contain label_header */
+				_invalidate_di(first_bcache, devl->dev->bcache_di);
+				bcache_prefetch(scan_bcache, devl->dev->bcache_di, 0);
+				scan_full_reads++;
+				dm_list_del(&devl->list);
+				dm_list_add(&full_devs, &devl->list);
+				continue;
+			}
+		}
 
-			memcpy(headers_buf, bb->data, HEADERS_BUF_SIZE);
+		/* copy the first 4k from bb that will contain label_header */
 
-			/*
-			 * "put" the bcache block before process_block because
-			 * processing metadata may need to invalidate and reread
-			 * metadata that's covered by bb. invalidate/reread is
-			 * not allowed while bb is held.  The functions for
-			 * filtering and scanning metadata for this device use
-			 * dev_read_bytes(), which will generally grab the
-			 * bcache block/data that we're putting here.  Since
-			 * we're doing put, it's possible but not likely that
-			 * bcache could drop the block before dev_read_bytes()
-			 * uses it again, in which case bcache will reread it
-			 * from disk for dev_read_bytes().
-			 */
-			bcache_put(bb);
+		memcpy(headers_buf, bb->data, HEADERS_BUF_SIZE);
+
+		/*
+		 * "put" the bcache block before process_block because
+		 * processing metadata may need to invalidate and reread
+		 * metadata that's covered by bb. invalidate/reread is
+		 * not allowed while bb is held.  The functions for
+		 * filtering and scanning metadata for this device use
+		 * dev_read_bytes(), which will generally grab the
+		 * bcache block/data that we're putting here.  Since
+		 * we're doing put, it's possible but not likely that
+		 * bcache could drop the block before dev_read_bytes()
+		 * uses it again, in which case bcache will reread it
+		 * from disk for dev_read_bytes().
+		 */
+		bcache_put(bb);
+
+		if (first_bcache != scan_bcache) {
+			_invalidate_di(first_bcache, devl->dev->bcache_di);
+			_headers_dev = devl->dev;
+			_headers_dev_buf = headers_buf;
+		}
+
+		if (!_scan_process_dev(cmd, f, devl->dev, headers_buf, want_other_devs)) {
+			scan_process_errors++;
+			scan_failed_count++;
+		}
+
+		_headers_dev = NULL;
+		_headers_dev_buf = NULL;
+ next:
+		dm_list_del(&devl->list);
+		dm_list_add(&done_devs, &devl->list);
+	}
 
-			log_debug_devs("Processing data from device %s %u:%u di %d.",
-				       dev_name(devl->dev),
-				       MAJOR(devl->dev->dev), MINOR(devl->dev->dev),
-				       devl->dev->bcache_di);
+	/*
+	 * Second pass of scan_label_first: the devs with an lvm label,
+	 * their full blocks were prefetched above.
+	 */
+	if (workers > 1)
+		_scan_prepare_devs(cmd, &full_devs, workers);
 
-			ret = _process_block(cmd, f, devl->dev, headers_buf, sizeof(headers_buf), 0, 0, &is_lvm_device);
+	dm_list_iterate_items_safe(devl, devl2, &full_devs) {
+		bb = NULL;
 
-			if (!ret && is_lvm_device) {
-				log_debug_devs("Scan failed to process %s", dev_name(devl->dev));
+		if (!bcache_get(scan_bcache, devl->dev->bcache_di, 0, 0, &bb)) {
+			_scan_read_failed(devl->dev, bb);
+			scan_read_errors++;
+			scan_failed_count++;
+			if (!want_other_devs) {
+				_invalidate_di(scan_bcache, devl->dev->bcache_di);
+				_scan_dev_close(devl->dev);
+			}
+		} else {
+			memcpy(headers_buf, bb->data, HEADERS_BUF_SIZE);
+			bcache_put(bb);
+
+			if (!_scan_process_dev(cmd, f, devl->dev, headers_buf, want_other_devs)) {
 				scan_process_errors++;
 				scan_failed_count++;
 			}
 		}
 
-		/*
-		 * Keep the bcache block of lvm devices we have processed so
-		 * that the vg_read phase can reuse it.  If bcache failed to
-		 * read the block, or the device does not belong to lvm, then
-		 * drop it from bcache.  When "want_other_devs" is set, it
-		 * means the caller wants to scan and keep open non-lvm devs,
-		 * e.g. to pvcreate them.
-		 */
-		if (!is_lvm_device && !want_other_devs) {
-			_invalidate_di(scan_bcache, devl->dev->bcache_di);
-			_scan_dev_close(devl->dev);
-		}
-
 		dm_list_del(&devl->list);
 		dm_list_add(&done_devs, &devl->list);
 	}
 
+	scan_prepared_metadata_clear();
+
 	if (!dm_list_empty(devs))
 		goto scan_more;
 
+	if (first_bcache != scan_bcache)
+		log_debug_devs("Scanned devices: label reads %d full reads %d",
+			       scan_label_reads, scan_full_reads);
+
 	log_debug_devs("Scanned devices: read errors %d process errors %d failed %d",
 			scan_read_errors, scan_process_errors, scan_failed_count);
 
@@ -758,21 +981,43 @@ static int _scan_list(struct cmd_context *cmd, struct dev_filter *f,
 }
 
 /*
- * We don't know ahead of time if we will find some VG metadata 
- * that is larger than the total size of the bcache, which would
- * prevent us from reading/writing the VG since we do not dynamically
- * increase the bcache size when we find it's too small.  In these
- * cases the user would need to set io_memory_size to be larger
- * than the max VG metadata size (lvm does not impose any limit on
- * the metadata size.)
+ * The bcache starts with io_memory_size and is elastic: it grows when
+ * more reads are in flight than it has blocks, and label_scan grows it
+ * to hold the largest VG metadata it found, so that metadata larger
+ * than io_memory_size can still be read and written.  The blocks added
+ * for the scan are released again at the end of label_scan.
  */
 
 #define MIN_BCACHE_BLOCKS 32    /* 4MB (32 * 128KB) */
 #define MAX_BCACHE_BLOCKS 4096  /* 512MB (4096 * 128KB) */
 
-int label_scan_setup_bcache(void)
+static struct io_engine *_create_io_engine(void)
 {
 	struct io_engine *ioe = NULL;
+
+	if (use_io_uring()) {
+		if (!(ioe = create_io_uring_engine()))
+			log_debug("Failed to set up io_uring, trying async io.");
+	}
+
+	if (!ioe && use_aio()) {
+		if (!(ioe = create_async_io_engine())) {
+			log_warn("Failed to set up async io, using sync io.");
+			init_use_aio(0);
+		}
+	}
+
+	if (!ioe) {
+		if (!(ioe = create_sync_io_engine()))
+			log_error("Failed to set up sync io.");
+	}
+
+	return ioe;
+}
+
+int label_scan_setup_bcache(void)
+{
+	struct io_engine *ioe;
 	int iomem_kb = io_memory_size();
 	int block_size_kb = (BCACHE_BLOCK_SIZE_IN_SECTORS * 512) / 1024;
 	int cache_blocks;
@@ -788,23 +1033,11 @@ int label_scan_setup_bcache(void)
 	if (cache_blocks > MAX_BCACHE_BLOCKS)
 		cache_blocks = MAX_BCACHE_BLOCKS;
 
-	_current_bcache_size_bytes = cache_blocks * BCACHE_BLOCK_SIZE_IN_SECTORS * 512;
-
-	if (use_aio()) {
-		if (!(ioe = create_async_io_engine())) {
-			log_warn("Failed to set up async io, using sync io.");
-			init_use_aio(0);
-		}
-	}
-
-	if (!ioe) {
-		if (!(ioe = create_sync_io_engine())) {
-			log_error("Failed to set up sync io.");
-			return 0;
-		}
-	}
+	if (!(ioe = _create_io_engine()))
+		return_0;
 
-	if (!(scan_bcache = bcache_create(BCACHE_BLOCK_SIZE_IN_SECTORS, cache_blocks, ioe))) {
+	if (!(scan_bcache = bcache_create_elastic(BCACHE_BLOCK_SIZE_IN_SECTORS, cache_blocks,
+						  MAX_BCACHE_BLOCKS, ioe))) {
 		log_error("Failed to set up io layer with %d blocks.", cache_blocks);
 		return 0;
 	}
@@ -957,8 +1190,10 @@ static void _clear_scan_state(struct cmd_context *cmd, struct dm_list *devs)
 		dev->flags &= ~DEV_MATCHED_USE_ID;
 		dev->id = NULL;
 
-		if ((du = get_du_for_dev(cmd, dev)))
+		if ((du = get_du_for_dev(cmd, dev))) {
 			du->dev = NULL;
+			du_index_invalidate(cmd);
+		}
 
 		lvmcache_del_dev(dev);
 
@@ -1245,6 +1480,7 @@ int label_scan(struct cmd_context *cmd)
 	struct device_list *devl, *devl2;
 	struct device *dev;
 	uint64_t max_metadata_size_bytes;
+	unsigned want_blocks;
 	int using_hints;
 	int create_hints = 0; /* NEWHINTS_NONE */
 
@@ -1394,38 +1630,21 @@ int label_scan(struct cmd_context *cmd)
 	_scan_list(cmd, cmd->filter, &scan_devs, 0, NULL);
 
 	/*
-	 * Metadata could be larger than total size of bcache, and bcache
-	 * cannot currently be resized during the command.  If this is the
-	 * case (or within reach), warn that io_memory_size needs to be
-	 * set larger.
-	 *
-	 * Even if bcache out of space did not cause a failure during scan, it
-	 * may cause a failure during the next vg_read phase or during vg_write.
-	 *
-	 * If there was an error during scan, we could recreate bcache here
-	 * with a larger size and then restart label_scan.  But, this does not
-	 * address the problem of writing new metadata that exceeds the bcache
-	 * size and failing, which would often be hit first, i.e. we'll fail
-	 * to write new metadata exceeding the max size before we have a chance
-	 * to read any metadata with that size, unless we find an existing vg
-	 * that has been previously created with the larger size.
-	 *
-	 * If the largest metadata is within 1MB of the bcache size, then start
-	 * warning.
+	 * Metadata could be larger than total size of bcache.  Grow bcache
+	 * now so that the vg_read and vg_write phases have room for the
+	 * largest metadata seen plus 1MB.  Blocks added here are kept by
+	 * bcache_shrink() at the end of the scan.  Only if the metadata is
+	 * too large for the maximum bcache size, warn that it may not be
+	 * usable.
 	 */
 	max_metadata_size_bytes = lvmcache_max_metadata_size();
+	want_blocks = (max_metadata_size_bytes + (1024 * 1024)) / BCACHE_BLOCK_SIZE_BYTES + 1;
 
-	if (max_metadata_size_bytes + (1024 * 1024) > _current_bcache_size_bytes) {
-		/* we want bcache to be 1MB larger than the max metadata seen */
-		uint64_t want_size_kb = (max_metadata_size_bytes / 1024) + 1024;
-		uint64_t remainder;
-		if ((remainder = (want_size_kb % 1024)))
-			want_size_kb = want_size_kb + 1024 - remainder;
-
-		log_warn("WARNING: Metadata may not be usable with current io_memory_size %d KiB.",
-			 io_memory_size());
-		log_warn("WARNING: Increase lvm.conf io_memory_size to at least %llu KiB.",
-			 (unsigned long long)want_size_kb);
+	if (!bcache_grow(scan_bcache, want_blocks)) {
+		log_warn("WARNING: Metadata may not be usable with io memory limited to %u KiB.",
+			 (unsigned) (bcache_nr_cache_blocks(scan_bcache) * (BCACHE_BLOCK_SIZE_BYTES / 1024)));
+		log_warn("WARNING: Largest metadata found is %llu KiB.",
+			 (unsigned long long)(max_metadata_size_bytes / 1024));
 	}
 
 	/*
@@ -1492,6 +1711,12 @@ int label_scan(struct cmd_context *cmd)
 	if (create_hints && !cmd->device_ids_invalid)
 		write_hint_file(cmd, create_hints);
 
+	/* Save VG summaries that were read from metadata text for the next command. */
+	scan_cache_write(cmd);
+
+	/* Give back bcache blocks that were only needed for the scan. */
+	bcache_shrink(scan_bcache);
+
 	return 1;
 }
 
@@ -1547,6 +1772,78 @@ int label_read_pvid(struct device *dev, int *has_pvid)
 	return 1;
 }
 
+/*
+ * label_read_pvid() for each dev on the devs list, with the reads of the
+ * first block submitted together in batches as large as bcache allows,
+ * rather than waiting for each read before starting the next.  The devs
+ * that are PVs are moved to pv_devs, and are left open with their first
+ * block in bcache.  The devs that cannot be read are moved to failed_devs,
+ * or dropped if it's NULL, and the others remain on devs.  Returns the
+ * number of devs that could be read.
+ */
+int label_read_pvids(struct dm_list *devs, struct dm_list *pv_devs,
+		     struct dm_list *failed_devs)
+{
+	struct dm_list batch_devs;
+	struct dm_list other_devs;
+	struct device_list *devl, *devl2;
+	unsigned max_prefetches;
+	unsigned submit_count;
+	int read_count = 0;
+	int has_pvid;
+
+	if (!scan_bcache && !label_scan_setup_bcache())
+		return_0;
+
+	dm_list_init(&batch_devs);
+	dm_list_init(&other_devs);
+
+	if (!(max_prefetches = bcache_max_prefetches(scan_bcache)))
+		max_prefetches = 1;
+
+	while (!dm_list_empty(devs)) {
+		submit_count = 0;
+
+		dm_list_iterate_items_safe(devl, devl2, devs) {
+			if (submit_count == max_prefetches)
+				break;
+
+			dm_list_del(&devl->list);
+
+			if (!label_scan_open(devl->dev)) {
+				log_debug_devs("Read pvid failed to open %s.", dev_name(devl->dev));
+				if (failed_devs)
+					dm_list_add(failed_devs, &devl->list);
+				continue;
+			}
+
+			bcache_prefetch(scan_bcache, devl->dev->bcache_di, 0);
+			dm_list_add(&batch_devs, &devl->list);
+			submit_count++;
+		}
+
+		log_debug_devs("Read pvid submitted %u reads.", submit_count);
+
+		dm_list_iterate_items_safe(devl, devl2, &batch_devs) {
+			dm_list_del(&devl->list);
+
+			if (!label_read_pvid(devl->dev, &has_pvid)) {
+				if (failed_devs)
+					dm_list_add(failed_devs, &devl->list);
+				continue;
+			}
+
+			read_count++;
+
+			dm_list_add(has_pvid ? pv_devs : &other_devs, &devl->list);
+		}
+	}
+
+	dm_list_splice(devs, &other_devs);
+
+	return read_count;
+}
+
 /*
  * label_scan_devs without invalidating data for the devs first,
  * when the caller wants to make use of any bcache data that
@@ -1707,13 +2004,28 @@ void label_scan_drop(struct cmd_context *cmd)
 
 void label_scan_destroy(struct cmd_context *cmd)
 {
+	struct bcache_stats stats;
+
 	if (!scan_bcache)
 		return;
 
 	label_scan_drop(cmd);
 
+	bcache_get_stats(scan_bcache, &stats);
+	log_debug("bcache stats: blocks %u read hits %u misses %u write hits %u misses %u zeroes %u prefetches %u grows %u shrinks %u",
+		  stats.nr_cache_blocks, stats.read_hits, stats.read_misses,
+		  stats.write_hits, stats.write_misses, stats.write_zeroes,
+		  stats.prefetches, stats.grows, stats.shrinks);
+
 	bcache_destroy(scan_bcache);
 	scan_bcache = NULL;
+
+	if (_label_bcache) {
+		bcache_destroy(_label_bcache);
+		_label_bcache = NULL;
+	}
+
+	scan_cache_exit(cmd);
 }
 
 /*
@@ -1870,6 +2182,11 @@ bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 		return false;
 	}
 
+	if ((dev == _headers_dev) && (start + len <= HEADERS_BUF_SIZE)) {
+		memcpy(data, _headers_dev_buf + start, len);
+		return true;
+	}
+
 	if (dev->bcache_di < 0) {
 		/* This is not often needed. */
 		if (!label_scan_open(dev)) {
@@ -1889,6 +2206,123 @@ bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 
 }
 
+/*
+ * Writes made by dev_write_bytes() between dev_write_batch_start() and
+ * dev_write_batch_end() are left in bcache and issued together by
+ * dev_write_batch_end(), which waits for all of them, so writing to
+ * many devices costs about one device round trip.  Callers end a batch
+ * wherever later writes must not reach disk before earlier ones.
+ */
+/*
+ * The blocks of a failed write stay dirty and in error, so invalidating
+ * them only warns before giving up; drop them directly instead.
+ */
+static void _write_failed_close(struct device *dev)
+{
+	if (_in_bcache(dev)) {
+		bcache_abort_di(scan_bcache, dev->bcache_di);
+		_scan_dev_close(dev);
+	}
+}
+
+struct write_batch_dev {
+	struct device *dev;
+	int failed;
+};
+
+static int _write_batch;
+static struct write_batch_dev *_batch_devs;
+static unsigned _batch_devs_count;
+static unsigned _batch_devs_size;
+
+static struct write_batch_dev *_find_batch_dev(struct device *dev)
+{
+	unsigned i;
+
+	for (i = 0; i < _batch_devs_count; i++)
+		if (_batch_devs[i].dev == dev)
+			return &_batch_devs[i];
+
+	return NULL;
+}
+
+static int _add_batch_dev(struct device *dev)
+{
+	struct write_batch_dev *bd;
+	unsigned size;
+
+	if (_find_batch_dev(dev))
+		return 1;
+
+	if (_batch_devs_count == _batch_devs_size) {
+		size = _batch_devs_size ? _batch_devs_size * 2 : 32;
+		if (!(bd = realloc(_batch_devs, size * sizeof(*bd))))
+			return 0;
+		_batch_devs = bd;
+		_batch_devs_size = size;
+	}
+
+	bd = &_batch_devs[_batch_devs_count++];
+	bd->dev = dev;
+	bd->failed = 0;
+
+	return 1;
+}
+
+static int _write_batch_flush(void)
+{
+	struct write_batch_dev *bd;
+	unsigned i;
+	int r = 1;
+
+	if (!bcache_flush(scan_bcache)) {
+		for (i = 0; i < _batch_devs_count; i++) {
+			bd = &_batch_devs[i];
+			if (!bcache_has_errors_di(scan_bcache, bd->dev->bcache_di))
+				continue;
+			log_error("Error writing device %s.", dev_name(bd->dev));
+			bd->failed = 1;
+			dev_unset_last_byte(bd->dev);
+			_write_failed_close(bd->dev);
+		}
+		r = 0;
+	}
+
+	for (i = 0; i < _batch_devs_count; i++)
+		if (_batch_devs[i].dev->bcache_di >= 0)
+			bcache_unset_last_byte(scan_bcache, _batch_devs[i].dev->bcache_di);
+
+	return r;
+}
+
+void dev_write_batch_start(void)
+{
+	_batch_devs_count = 0;
+	_write_batch = scan_bcache && !test_mode();
+}
+
+bool dev_write_batch_end(void)
+{
+	int r;
+
+	if (!_write_batch)
+		return true;
+
+	_write_batch = 0;
+	r = _write_batch_flush();
+
+	log_debug_devs("Wrote batch to %u devices%s.", _batch_devs_count, r ? "" : " with errors");
+
+	return r;
+}
+
+bool dev_write_batch_failed(struct device *dev)
+{
+	struct write_batch_dev *bd = _find_batch_dev(dev);
+
+	return bd && bd->failed;
+}
+
 bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 {
 	if (test_mode())
@@ -1928,11 +2362,14 @@ bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 		return false;
 	}
 
+	if (_write_batch && _add_batch_dev(dev))
+		return true;
+
 	if (!bcache_flush(scan_bcache)) {
 		log_error("Error writing device %s at %llu length %u.",
 			  dev_name(dev), (unsigned long long)start, (uint32_t)len);
 		dev_unset_last_byte(dev);
-		label_scan_invalidate(dev);
+		_write_failed_close(dev);
 		return false;
 	}
 	return true;
@@ -2043,10 +2480,28 @@ void dev_set_last_byte(struct device *dev, uint64_t offset)
 		bs = 512;
 	}
 
-	bcache_set_last_byte(scan_bcache, dev->bcache_di, offset, bs);
+	if (!_write_batch) {
+		bcache_set_last_byte(scan_bcache, dev->bcache_di, offset, bs);
+		return;
+	}
+
+	/*
+	 * Writes to other areas may still be queued, so keep their limits.
+	 * If no more can be kept, write out what is queued first.
+	 */
+	if (!bcache_add_last_byte(scan_bcache, dev->bcache_di, offset, bs)) {
+		if (!_write_batch_flush())
+			stack;
+		_batch_devs_count = 0;
+		bcache_set_last_byte(scan_bcache, dev->bcache_di, offset, bs);
+	}
 }
 
 void dev_unset_last_byte(struct device *dev)
 {
+	/* Queued writes still need the limit; it's dropped when they're written. */
+	if (_write_batch && _find_batch_dev(dev))
+		return;
+
 	bcache_unset_last_byte(scan_bcache, dev->bcache_di);
 }
@@ -117,6 +117,8 @@ int label_scan_open_excl(struct device *dev);
 int label_scan_open_rw(struct device *dev);
 int label_scan_reopen_rw(struct device *dev);
 int label_read_pvid(struct device *dev, int *has_pvid);
+int label_read_pvids(struct dm_list *devs, struct dm_list *pv_devs,
+		     struct dm_list *failed_devs);
 int label_scan_vg_online(struct cmd_context *cmd, const char *vgname,
 			 int *found_none, int *found_all, int *found_incomplete);
 
@@ -136,6 +138,15 @@ void dev_invalidate(struct device *dev);
 void dev_set_last_byte(struct device *dev, uint64_t offset);
 void dev_unset_last_byte(struct device *dev);
 
+/*
+ * Queue dev_write_bytes() until dev_write_batch_end(), which writes all
+ * and returns false if any failed; dev_write_batch_failed() then tells
+ * which devices failed.
+ */
+void dev_write_batch_start(void);
+bool dev_write_batch_end(void);
+bool dev_write_batch_failed(struct device *dev);
+
 void prepare_open_file_limit(struct cmd_context *cmd, unsigned int num_devs);
 
 #endif
@@ -0,0 +1,838 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The scan cache saves the VG summary that label_scan extracts from the
+ * metadata text of each PV, so that later commands do not need to read
+ * and parse the metadata text again when it has not changed.
+ *
+ * label_scan always reads the mda_header of each metadata area.  The
+ * committed raw_locn in the mda_header gives the offset, size and checksum
+ * of the current metadata text.  An entry in the scan cache is found by
+ * device number and mda start, and it is only used if the pvid of the
+ * device and the offset, size and checksum of the text all match what the
+ * mda_header says now.  Any change to the metadata (by any lvm version,
+ * with or without the scan cache) changes the raw_locn, so stale entries
+ * are never used, and no invalidation is needed when metadata is written.
+ *
+ * When an entry is used, the VG summary saved in it is passed to lvmcache
+ * in place of the summary that would be parsed from the metadata text.
+ * vg_read() still reads and verifies the full metadata text.
+ *
+ * The file is rewritten at the end of label_scan when entries were added
+ * or found to be stale.  A new file is written under a temporary name and
+ * renamed into place, so readers always see a complete file and no lock
+ * is needed.  The last line holds a checksum of all the lines before it,
+ * and a file without a matching checksum is ignored as a whole.  When two commands write the file concurrently, one version
+ * wins and the other command's new entries are added again by the next
+ * command that scans.
+ *
+ * File format:
+ *
+ * scan_cache_version: <major>.<minor>
+ * vg: <vgid> <text_checksum> <text_size> <seqno> <status> <name> <host> <sysid> <locktype>
+ * pv: <pvid> <dev_size> <device_hint> <device_id_type> <device_id>
+ * mda: <major>:<minor> <mda_start> <pvid> <text_offset> <text_size> <text_checksum> <vgid>
+ * checksum: <crc of the preceding lines>
+ *
+ * pv lines belong to the preceding vg line.  String values are written
+ * as "-" for unset, or "=" followed by the string.  Strings containing
+ * whitespace are not saved.
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/label/label.h"
+#include "lib/label/scan_cache.h"
+#include "lib/cache/lvmcache.h"
+#include "lib/config/config.h"
+#include "lib/metadata/metadata.h"
+#include "lib/misc/crc.h"
+
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+static const char _scan_cache_file[] = DEFAULT_RUN_DIR "/scancache";
+
+/*
+ * Increase the major number for changes that older lvm versions can't
+ * use, they will ignore the file and replace it.
+ */
+#define SCAN_CACHE_VERSION_MAJOR 1
+#define SCAN_CACHE_VERSION_MINOR 1
+
+#define SCAN_CACHE_LINE_LEN (3 * PATH_MAX + NAME_LEN + 128)
+#define SCAN_CACHE_LINE_WORDS 10
+
+/* Limit the size of the file when devices keep changing. */
+#define SCAN_CACHE_MAX_MDAS 8192
+
+struct scan_cache_pv {
+	struct dm_list list;
+	char pvid[ID_LEN + 1];
+	uint64_t dev_size;
+	const char *device_hint;
+	const char *device_id_type;
+	const char *device_id;
+};
+
+/* Key for _vg_hash */
+struct scan_cache_vg_key {
+	char vgid[ID_LEN];
+	uint32_t text_checksum;
+	uint64_t text_size;
+};
+
+struct scan_cache_vg {
+	struct dm_list list;
+	struct scan_cache_vg_key key;
+	uint32_t seqno;
+	uint64_t status;
+	const char *vgname;
+	const char *creation_host;
+	const char *system_id;
+	const char *lock_type;
+	struct dm_list pvs; /* scan_cache_pv */
+	unsigned write:1;
+};
+
+/* Key for _mda_hash */
+struct scan_cache_mda_key {
+	uint64_t devt;
+	uint64_t mda_start;
+};
+
+struct scan_cache_mda {
+	struct dm_list list;
+	struct scan_cache_mda_key key;
+	char pvid[ID_LEN + 1];
+	uint64_t text_offset;
+	uint64_t text_size;
+	uint32_t text_checksum;
+	struct scan_cache_vg *vg;
+	unsigned stale:1;
+};
+
+static struct {
+	struct dm_pool *mem;
+	struct dm_hash_table *vg_hash;
+	struct dm_hash_table *mda_hash;
+	struct dm_list vgs;   /* scan_cache_vg */
+	struct dm_list mdas;  /* scan_cache_mda, newest first */
+	unsigned hits;
+	unsigned misses;
+	unsigned loaded:1;
+	unsigned enabled:1;
+	unsigned dirty:1;
+} _sc;
+
+static char _scan_cache_line[SCAN_CACHE_LINE_LEN];
+
+static void _mda_key(struct scan_cache_mda_key *key, struct device *dev, uint64_t mda_start)
+{
+	memset(key, 0, sizeof(*key));
+	key->devt = (uint64_t) dev->dev;
+	key->mda_start = mda_start;
+}
+
+static void _vg_key(struct scan_cache_vg_key *key, const char *vgid,
+		    uint32_t text_checksum, uint64_t text_size)
+{
+	memset(key, 0, sizeof(*key));
+	memcpy(key->vgid, vgid, ID_LEN);
+	key->text_checksum = text_checksum;
+	key->text_size = text_size;
+}
+
+static int _str_is_word(const char *str)
+{
+	const char *p;
+
+	if (!str)
+		return 1;
+
+	for (p = str; *p; p++)
+		if (isspace((unsigned char) *p))
+			return 0;
+
+	return 1;
+}
+
+static void _print_str(FILE *fp, const char *str)
+{
+	if (str)
+		fprintf(fp, " =%s", str);
+	else
+		fprintf(fp, " -");
+}
+
+static int _read_str(const char *word, const char **str)
+{
+	if (!word)
+		return 0;
+
+	if (word[0] == '-' && !word[1]) {
+		*str = NULL;
+		return 1;
+	}
+
+	if (word[0] != '=')
+		return 0;
+
+	if (!(*str = dm_pool_strdup(_sc.mem, word + 1)))
+		return_0;
+
+	return 1;
+}
+
+static int _read_id_str(const char *word, char *id)
+{
+	if (!word || strlen(word) != ID_LEN)
+		return 0;
+
+	memcpy(id, word, ID_LEN);
+	id[ID_LEN] = '\0';
+
+	return 1;
+}
+
+static struct scan_cache_mda *_add_mda(const struct scan_cache_mda_key *key)
+{
+	struct scan_cache_mda *mda;
+
+	if (!(mda = dm_pool_zalloc(_sc.mem, sizeof(*mda))))
+		return_NULL;
+
+	mda->key = *key;
+
+	if (!dm_hash_insert_binary(_sc.mda_hash, &mda->key, sizeof(mda->key), mda))
+		return_NULL;
+
+	return mda;
+}
+
+static struct scan_cache_vg *_add_vg(const struct scan_cache_vg_key *key)
+{
+	struct scan_cache_vg *vg;
+
+	if (!(vg = dm_pool_zalloc(_sc.mem, sizeof(*vg))))
+		return_NULL;
+
+	vg->key = *key;
+	dm_list_init(&vg->pvs);
+
+	if (!dm_hash_insert_binary(_sc.vg_hash, &vg->key, sizeof(vg->key), vg))
+		return_NULL;
+
+	dm_list_add(&_sc.vgs, &vg->list);
+
+	return vg;
+}
+
+static int _read_vg_line(char **split, struct scan_cache_vg **vg_ret)
+{
+	struct scan_cache_vg_key key;
+	struct scan_cache_vg *vg;
+	char vgid[ID_LEN + 1];
+	unsigned long long text_size, status;
+	unsigned text_checksum, seqno;
+
+	*vg_ret = NULL;
+
+	if (!_read_id_str(split[1], vgid) ||
+	    !split[2] || sscanf(split[2], "%x", &text_checksum) != 1 ||
+	    !split[3] || sscanf(split[3], "%llu", &text_size) != 1 ||
+	    !split[4] || sscanf(split[4], "%u", &seqno) != 1 ||
+	    !split[5] || sscanf(split[5], "%llx", &status) != 1)
+		return 0;
+
+	_vg_key(&key, vgid, text_checksum, text_size);
+
+	if (dm_hash_lookup_binary(_sc.vg_hash, &key, sizeof(key)))
+		return 0;
+
+	if (!(vg = _add_vg(&key)))
+		return_0;
+
+	vg->seqno = seqno;
+	vg->status = status;
+
+	if (!_read_str(split[6], &vg->vgname) || !vg->vgname ||
+	    !_read_str(split[7], &vg->creation_host) ||
+	    !_read_str(split[8], &vg->system_id) ||
+	    !_read_str(split[9], &vg->lock_type)) {
+		dm_hash_remove_binary(_sc.vg_hash, &vg->key, sizeof(vg->key));
+		dm_list_del(&vg->list);
+		return 0;
+	}
+
+	*vg_ret = vg;
+	return 1;
+}
+
+static int _read_pv_line(char **split, struct scan_cache_vg *vg)
+{
+	struct scan_cache_pv *pv;
+	unsigned long long dev_size;
+
+	if (!vg)
+		return 0;
+
+	if (!(pv = dm_pool_zalloc(_sc.mem, sizeof(*pv))))
+		return_0;
+
+	if (!_read_id_str(split[1], pv->pvid) ||
+	    !split[2] || sscanf(split[2], "%llu", &dev_size) != 1 ||
+	    !_read_str(split[3], &pv->device_hint) ||
+	    !_read_str(split[4], &pv->device_id_type) ||
+	    !_read_str(split[5], &pv->device_id))
+		return 0;
+
+	pv->dev_size = dev_size;
+	dm_list_add(&vg->pvs, &pv->list);
+
+	return 1;
+}
+
+static int _read_mda_line(char **split)
+{
+	struct scan_cache_mda_key key;
+	struct scan_cache_vg_key vg_key;
+	struct scan_cache_mda *mda;
+	struct scan_cache_vg *vg;
+	char vgid[ID_LEN + 1];
+	char pvid[ID_LEN + 1];
+	unsigned long long mda_start, text_offset, text_size;
+	unsigned text_checksum;
+	int major, minor;
+
+	if (!split[1] || sscanf(split[1], "%d:%d", &major, &minor) != 2 ||
+	    !split[2] || sscanf(split[2], "%llu", &mda_start) != 1 ||
+	    !_read_id_str(split[3], pvid) ||
+	    !split[4] || sscanf(split[4], "%llu", &text_offset) != 1 ||
+	    !split[5] || sscanf(split[5], "%llu", &text_size) != 1 ||
+	    !split[6] || sscanf(split[6], "%x", &text_checksum) != 1 ||
+	    !_read_id_str(split[7], vgid))
+		return 0;
+
+	_vg_key(&vg_key, vgid, text_checksum, text_size);
+
+	if (!(vg = dm_hash_lookup_binary(_sc.vg_hash, &vg_key, sizeof(vg_key))))
+		return 0;
+
+	memset(&key, 0, sizeof(key));
+	key.devt = (uint64_t) makedev(major, minor);
+	key.mda_start = mda_start;
+
+	if (dm_hash_lookup_binary(_sc.mda_hash, &key, sizeof(key)))
+		return 0;
+
+	if (!(mda = _add_mda(&key)))
+		return_0;
+
+	memcpy(mda->pvid, pvid, sizeof(mda->pvid));
+	mda->text_offset = text_offset;
+	mda->text_size = text_size;
+	mda->text_checksum = text_checksum;
+	mda->vg = vg;
+	dm_list_add(&_sc.mdas, &mda->list);
+
+	return 1;
+}
+
+/*
+ * Returns 0 if the file was read but is not usable as a whole, and
+ * the entries read from it need to be dropped.
+ */
+static int _read_scan_cache_file(void)
+{
+	char *split[SCAN_CACHE_LINE_WORDS];
+	struct scan_cache_vg *vg = NULL;
+	FILE *fp;
+	char *p;
+	int hv_major, hv_minor;
+	int version_ok = 0;
+	int checksum_ok = 0;
+	int keylen;
+	unsigned bad = 0;
+	unsigned file_crc;
+	uint32_t crc = INITIAL_CRC;
+
+	if (!(fp = fopen(_scan_cache_file, "r"))) {
+		if (errno != ENOENT)
+			log_debug("scan_cache open errno %d %s", errno, _scan_cache_file);
+		return 1;
+	}
+
+	while (fgets(_scan_cache_line, sizeof(_scan_cache_line), fp)) {
+		keylen = sizeof("checksum:") - 1;
+		if (!strncmp(_scan_cache_line, "checksum:", keylen)) {
+			if ((sscanf(_scan_cache_line + keylen, "%x", &file_crc) == 1) &&
+			    (file_crc == crc))
+				checksum_ok = 1;
+			break;
+		}
+
+		crc = calc_crc(crc, (const uint8_t *)_scan_cache_line, strlen(_scan_cache_line));
+
+		if (_scan_cache_line[0] == '#')
+			continue;
+
+		if ((p = strchr(_scan_cache_line, '\n')))
+			*p = '\0';
+
+		keylen = sizeof("scan_cache_version:") - 1;
+		if (!strncmp(_scan_cache_line, "scan_cache_version:", keylen)) {
+			if ((sscanf(_scan_cache_line + keylen, "%d.%d", &hv_major, &hv_minor) != 2) ||
+			    (hv_major != SCAN_CACHE_VERSION_MAJOR)) {
+				log_debug("Ignoring scan cache with unknown version.");
+				break;
+			}
+			version_ok = 1;
+			continue;
+		}
+
+		if (!version_ok)
+			break;
+
+		memset(split, 0, sizeof(split));
+		if (dm_split_words(_scan_cache_line, SCAN_CACHE_LINE_WORDS, 0, split) < 2)
+			continue;
+
+		/* Ignore any other line prefixes that we don't recognize. */
+		if (!strcmp(split[0], "vg:")) {
+			if (!_read_vg_line(split, &vg))
+				bad++;
+		} else if (!strcmp(split[0], "pv:")) {
+			if (!_read_pv_line(split, vg))
+				bad++;
+		} else if (!strcmp(split[0], "mda:")) {
+			if (!_read_mda_line(split))
+				bad++;
+		}
+	}
+
+	if (fclose(fp))
+		log_debug("scan_cache close errno %d %s", errno, _scan_cache_file);
+
+	/* A truncated or damaged file is replaced by the next write. */
+	if (!version_ok || !checksum_ok) {
+		log_debug("Ignoring scan cache with %s.",
+			  version_ok ? "wrong checksum" : "unknown version");
+		_sc.dirty = 1;
+		return 0;
+	}
+
+	/* Bad lines are dropped when the file is written again. */
+	if (bad) {
+		log_debug("Ignored %u bad lines in scan cache.", bad);
+		_sc.dirty = 1;
+	}
+
+	log_debug("Read scan cache with %u VGs %u mdas.",
+		  dm_list_size(&_sc.vgs), dm_list_size(&_sc.mdas));
+
+	return 1;
+}
+
+static void _destroy_tables(void)
+{
+	if (_sc.vg_hash)
+		dm_hash_destroy(_sc.vg_hash);
+	if (_sc.mda_hash)
+		dm_hash_destroy(_sc.mda_hash);
+	if (_sc.mem)
+		dm_pool_destroy(_sc.mem);
+
+	_sc.vg_hash = NULL;
+	_sc.mda_hash = NULL;
+	_sc.mem = NULL;
+}
+
+static int _create_tables(void)
+{
+	dm_list_init(&_sc.vgs);
+	dm_list_init(&_sc.mdas);
+
+	if (!(_sc.mem = dm_pool_create("scan_cache", 4096)) ||
+	    !(_sc.vg_hash = dm_hash_create(64)) ||
+	    !(_sc.mda_hash = dm_hash_create(256))) {
+		_destroy_tables();
+		return_0;
+	}
+
+	return 1;
+}
+
+static int _scan_cache_load(struct cmd_context *cmd)
+{
+	if (_sc.loaded)
+		return _sc.enabled;
+
+	_sc.loaded = 1;
+	_sc.enabled = 0;
+
+	if (!find_config_tree_bool(cmd, devices_scan_cache_CFG, NULL))
+		return 0;
+
+	if (!_create_tables())
+		return_0;
+
+	if (!_read_scan_cache_file()) {
+		_destroy_tables();
+		if (!_create_tables())
+			return_0;
+	}
+
+	_sc.enabled = 1;
+
+	return 1;
+}
+
+/*
+ * Called from read_metadata_location_summary() with the location of the
+ * committed metadata text from the mda_header.  When the scan cache has a
+ * matching entry, fill in vgsummary from it and return 1 so the metadata
+ * text is not read.
+ */
+int scan_cache_lookup(struct cmd_context *cmd, struct device *dev, uint64_t mda_start,
+		      uint64_t text_offset, uint64_t text_size, uint32_t text_checksum,
+		      struct lvmcache_vgsummary *vgsummary)
+{
+	struct scan_cache_mda_key key;
+	struct scan_cache_mda *mda;
+	struct scan_cache_vg *vg;
+	struct scan_cache_pv *pv;
+	struct pv_list *pvl;
+	struct dm_pool *mem = cmd->mem;
+
+	if (!_scan_cache_load(cmd))
+		return 0;
+
+	_mda_key(&key, dev, mda_start);
+
+	if (!(mda = dm_hash_lookup_binary(_sc.mda_hash, &key, sizeof(key))) || mda->stale) {
+		_sc.misses++;
+		return 0;
+	}
+
+	if (memcmp(mda->pvid, dev->pvid, ID_LEN) ||
+	    (mda->text_offset != text_offset) ||
+	    (mda->text_size != text_size) ||
+	    (mda->text_checksum != text_checksum)) {
+		log_debug("Scan cache entry for %s mda at %llu is stale.",
+			  dev_name(dev), (unsigned long long)mda_start);
+		mda->stale = 1;
+		_sc.dirty = 1;
+		_sc.misses++;
+		return 0;
+	}
+
+	vg = mda->vg;
+
+	if (!(vgsummary->vgname = dm_pool_strdup(mem, vg->vgname)) ||
+	    !(vgsummary->creation_host = dm_pool_strdup(mem, vg->creation_host ? : "")))
+		goto_bad;
+
+	if (vg->system_id && !(vgsummary->system_id = dm_pool_strdup(mem, vg->system_id)))
+		goto_bad;
+
+	if (vg->lock_type && !(vgsummary->lock_type = dm_pool_strdup(mem, vg->lock_type)))
+		goto_bad;
+
+	memset(vgsummary->vgid, 0, sizeof(vgsummary->vgid));
+	memcpy(vgsummary->vgid, vg->key.vgid, ID_LEN);
+	vgsummary->vgstatus = vg->status;
+	vgsummary->seqno = vg->seqno;
+
+	dm_list_iterate_items(pv, &vg->pvs) {
+		if (!(pvl = dm_pool_zalloc(mem, sizeof(*pvl))) ||
+		    !(pvl->pv = dm_pool_zalloc(mem, sizeof(*pvl->pv))))
+			goto_bad;
+
+		memcpy(&pvl->pv->id, pv->pvid, ID_LEN);
+		pvl->pv->size = pv->dev_size;
+
+		if ((pv->device_hint && !(pvl->pv->device_hint = dm_pool_strdup(mem, pv->device_hint))) ||
+		    (pv->device_id_type && !(pvl->pv->device_id_type = dm_pool_strdup(mem, pv->device_id_type))) ||
+		    (pv->device_id && !(pvl->pv->device_id = dm_pool_strdup(mem, pv->device_id))))
+			goto_bad;
+
+		dm_list_add(&vgsummary->pvsummaries, &pvl->list);
+	}
+
+	_sc.hits++;
+
+	return 1;
+
+ bad:
+	vgsummary->vgname = NULL;
+	vgsummary->creation_host = NULL;
+	vgsummary->system_id = NULL;
+	vgsummary->lock_type = NULL;
+	dm_list_init(&vgsummary->pvsummaries);
+
+	return 0;
+}
+
+static struct scan_cache_vg *_save_vg(const struct scan_cache_vg_key *key,
+				      struct lvmcache_vgsummary *vgsummary)
+{
+	struct scan_cache_vg *vg;
+	struct scan_cache_pv *pv;
+	struct pv_list *pvl;
+
+	if ((vg = dm_hash_lookup_binary(_sc.vg_hash, key, sizeof(*key))))
+		return vg;
+
+	/*
+	 * A vgsummary that was copied from another device in lvmcache
+	 * has no pvsummaries, and is only usable if the VG was already
+	 * saved from the metadata text.
+	 */
+	if (dm_list_empty(&vgsummary->pvsummaries))
+		return NULL;
+
+	if (!_str_is_word(vgsummary->creation_host) ||
+	    !_str_is_word(vgsummary->system_id) ||
+	    !_str_is_word(vgsummary->lock_type))
+		return NULL;
+
+	dm_list_iterate_items(pvl, &vgsummary->pvsummaries)
+		if (!_str_is_word(pvl->pv->device_hint) ||
+		    !_str_is_word(pvl->pv->device_id_type) ||
+		    !_str_is_word(pvl->pv->device_id))
+			return NULL;
+
+	if (!(vg = _add_vg(key)))
+		return_NULL;
+
+	vg->seqno = vgsummary->seqno;
+	vg->status = vgsummary->vgstatus;
+
+	if (!(vg->vgname = dm_pool_strdup(_sc.mem, vgsummary->vgname)))
+		return_NULL;
+
+	if (vgsummary->creation_host &&
+	    !(vg->creation_host = dm_pool_strdup(_sc.mem, vgsummary->creation_host)))
+		return_NULL;
+
+	if (vgsummary->system_id &&
+	    !(vg->system_id = dm_pool_strdup(_sc.mem, vgsummary->system_id)))
+		return_NULL;
+
+	if (vgsummary->lock_type &&
+	    !(vg->lock_type = dm_pool_strdup(_sc.mem, vgsummary->lock_type)))
+		return_NULL;
+
+	dm_list_iterate_items(pvl, &vgsummary->pvsummaries) {
+		if (!(pv = dm_pool_zalloc(_sc.mem, sizeof(*pv))))
+			return_NULL;
+
+		memcpy(pv->pvid, &pvl->pv->id, ID_LEN);
+		pv->dev_size = pvl->pv->size;
+
+		if ((pvl->pv->device_hint && !(pv->device_hint = dm_pool_strdup(_sc.mem, pvl->pv->device_hint))) ||
+		    (pvl->pv->device_id_type && !(pv->device_id_type = dm_pool_strdup(_sc.mem, pvl->pv->device_id_type))) ||
+		    (pvl->pv->device_id && !(pv->device_id = dm_pool_strdup(_sc.mem, pvl->pv->device_id))))
+			return_NULL;
+
+		dm_list_add(&vg->pvs, &pv->list);
+	}
+
+	return vg;
+}
+
+/*
+ * Called from read_metadata_location_summary() after the VG summary
+ * for the committed metadata text has been found.
+ */
+void scan_cache_save(struct cmd_context *cmd, struct device *dev, uint64_t mda_start,
+		     uint64_t text_offset, uint64_t text_size, uint32_t text_checksum,
+		     struct lvmcache_vgsummary *vgsummary)
+{
+	struct scan_cache_mda_key key;
+	struct scan_cache_vg_key vg_key;
+	struct scan_cache_mda *mda;
+	struct scan_cache_vg *vg;
+
+	if (!_scan_cache_load(cmd))
+		return;
+
+	if (!vgsummary->vgname || !_str_is_word(vgsummary->vgname))
+		return;
+
+	_vg_key(&vg_key, vgsummary->vgid, text_checksum, text_size);
+
+	if (!(vg = _save_vg(&vg_key, vgsummary)))
+		return;
+
+	_mda_key(&key, dev, mda_start);
+
+	if ((mda = dm_hash_lookup_binary(_sc.mda_hash, &key, sizeof(key)))) {
+		if (!mda->stale && (mda->vg == vg) &&
+		    !memcmp(mda->pvid, dev->pvid, ID_LEN) &&
+		    (mda->text_offset == text_offset))
+			return;
+		dm_list_del(&mda->list);
+	} else if (!(mda = _add_mda(&key)))
+		return;
+
+	memcpy(mda->pvid, dev->pvid, ID_LEN);
+	mda->pvid[ID_LEN] = '\0';
+	mda->text_offset = text_offset;
+	mda->text_size = text_size;
+	mda->text_checksum = text_checksum;
+	mda->vg = vg;
+	mda->stale = 0;
+	dm_list_add_h(&_sc.mdas, &mda->list);
+
+	_sc.dirty = 1;
+}
+
+static int _write_scan_cache_file(struct cmd_context *cmd, const char *path)
+{
+	struct scan_cache_mda *mda;
+	struct scan_cache_vg *vg;
+	struct scan_cache_pv *pv;
+	unsigned count = 0;
+	uint32_t crc = INITIAL_CRC;
+	FILE *fp;
+	time_t t;
+	int ret = 1;
+
+	if (!(fp = fopen(path, "w+"))) {
+		log_debug("scan_cache open errno %d %s", errno, path);
+		return 0;
+	}
+
+	dm_list_iterate_items(vg, &_sc.vgs)
+		vg->write = 0;
+
+	dm_list_iterate_items(mda, &_sc.mdas) {
+		if (mda->stale)
+			continue;
+		if (++count > SCAN_CACHE_MAX_MDAS)
+			mda->stale = 1;
+		else
+			mda->vg->write = 1;
+	}
+
+	t = time(NULL);
+	fprintf(fp, "# Created by %s pid %d %s", cmd->name, getpid(), ctime(&t));
+	fprintf(fp, "scan_cache_version: %d.%d\n", SCAN_CACHE_VERSION_MAJOR, SCAN_CACHE_VERSION_MINOR);
+
+	dm_list_iterate_items(vg, &_sc.vgs) {
+		if (!vg->write)
+			continue;
+
+		fprintf(fp, "vg: %.*s %x %llu %u %llx =%s", ID_LEN, vg->key.vgid,
+			vg->key.text_checksum, (unsigned long long)vg->key.text_size,
+			vg->seqno, (unsigned long long)vg->status, vg->vgname);
+		_print_str(fp, vg->creation_host);
+		_print_str(fp, vg->system_id);
+		_print_str(fp, vg->lock_type);
+		fprintf(fp, "\n");
+
+		dm_list_iterate_items(pv, &vg->pvs) {
+			fprintf(fp, "pv: %s %llu", pv->pvid, (unsigned long long)pv->dev_size);
+			_print_str(fp, pv->device_hint);
+			_print_str(fp, pv->device_id_type);
+			_print_str(fp, pv->device_id);
+			fprintf(fp, "\n");
+		}
+	}
+
+	dm_list_iterate_items(mda, &_sc.mdas) {
+		if (mda->stale)
+			continue;
+
+		fprintf(fp, "mda: %u:%u %llu %s %llu %llu %x %.*s\n",
+			major((dev_t) mda->key.devt), minor((dev_t) mda->key.devt),
+			(unsigned long long)mda->key.mda_start, mda->pvid,
+			(unsigned long long)mda->text_offset,
+			(unsigned long long)mda->text_size,
+			mda->text_checksum, ID_LEN, mda->vg->key.vgid);
+	}
+
+	/* Read back what was written to checksum it. */
+	if (fflush(fp) || fseek(fp, 0, SEEK_SET)) {
+		log_debug("scan_cache write errno %d %s", errno, path);
+		ret = 0;
+	} else {
+		while (fgets(_scan_cache_line, sizeof(_scan_cache_line), fp))
+			crc = calc_crc(crc, (const uint8_t *)_scan_cache_line, strlen(_scan_cache_line));
+
+		if (ferror(fp) || fseek(fp, 0, SEEK_END))
+			ret = 0;
+		else
+			fprintf(fp, "checksum: %x\n", crc);
+	}
+
+	if (fflush(fp) || ferror(fp)) {
+		log_debug("scan_cache write errno %d %s", errno, path);
+		ret = 0;
+	}
+
+	if (fclose(fp)) {
+		log_debug("scan_cache close errno %d %s", errno, path);
+		ret = 0;
+	}
+
+	return ret;
+}
+
+/*
+ * Called at the end of label_scan.
+ */
+void scan_cache_write(struct cmd_context *cmd)
+{
+	char tmp_path[PATH_MAX];
+
+	if (!_sc.enabled)
+		return;
+
+	log_debug("Scan cache hits %u misses %u.", _sc.hits, _sc.misses);
+
+	if (!_sc.dirty)
+		return;
+
+	if (dm_snprintf(tmp_path, sizeof(tmp_path), "%s.%d", _scan_cache_file, getpid()) < 0)
+		return;
+
+	log_debug("Writing scan cache.");
+
+	if (!_write_scan_cache_file(cmd, tmp_path)) {
+		if (unlink(tmp_path) && errno != ENOENT)
+			log_debug("scan_cache unlink errno %d %s", errno, tmp_path);
+		return;
+	}
+
+	if (rename(tmp_path, _scan_cache_file)) {
+		log_debug("scan_cache rename errno %d %s", errno, _scan_cache_file);
+		if (unlink(tmp_path))
+			log_debug("scan_cache unlink errno %d %s", errno, tmp_path);
+		return;
+	}
+
+	_sc.dirty = 0;
+}
+
+void scan_cache_exit(struct cmd_context *cmd __attribute__((unused)))
+{
+	_destroy_tables();
+
+	memset(&_sc, 0, sizeof(_sc));
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_SCAN_CACHE_H
+#define _LVM_SCAN_CACHE_H
+
+#include "lib/commands/toolcontext.h"
+
+struct lvmcache_vgsummary;
+
+int scan_cache_lookup(struct cmd_context *cmd, struct device *dev, uint64_t mda_start,
+		      uint64_t text_offset, uint64_t text_size, uint32_t text_checksum,
+		      struct lvmcache_vgsummary *vgsummary);
+
+void scan_cache_save(struct cmd_context *cmd, struct device *dev, uint64_t mda_start,
+		     uint64_t text_offset, uint64_t text_size, uint32_t text_checksum,
+		     struct lvmcache_vgsummary *vgsummary);
+
+void scan_cache_write(struct cmd_context *cmd);
+
+void scan_cache_exit(struct cmd_context *cmd);
+
+#endif
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Scan workers do the cpu heavy part of label scanning in parallel:
+ * reading the metadata text that the mda_header points to, computing
+ * its checksum and parsing it into a config tree.
+ *
+ * Everything else in label scanning (filters, label and pv_header
+ * processing, lvmcache updates, bcache) is not thread safe and is still
+ * done serially by _scan_list().  The workers only look at the first
+ * block of each device held by the caller, read the text with pread()
+ * on the device fd, and use a private config tree for each text.  They
+ * do not log, and the caller turns off libdm logging for the parser
+ * while they run; anything unexpected is skipped and left to the serial
+ * scan, which will then read and parse the text itself and report any
+ * problem.
+ *
+ * The parsed trees are kept in a set keyed by the checksum and size of
+ * the text, so PVs in the same VG share one parse, and the serial scan
+ * finds a tree from the raw_locn in the mda_header that it reads.
+ */
+
+#include "lib/misc/lib.h"
+#include "base/memory/zalloc.h"
+#include "lib/label/label.h"
+#include "lib/label/scan_workers.h"
+#include "lib/format_text/layout.h"
+#include "lib/misc/crc.h"
+#include "lib/mm/xlate.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/* Covers the logical block size of devices opened with O_DIRECT. */
+#define TEXT_READ_ALIGN 4096
+
+struct prepared_key {
+	uint32_t checksum;
+	uint64_t size;
+};
+
+struct prepared {
+	struct prepared_key key;
+	struct dm_config_tree *cft;
+};
+
+static struct dm_hash_table *_prepared_hash;
+
+struct scan_pool {
+	pthread_mutex_t lock;
+	struct scan_prepare_job *jobs;
+	unsigned count;
+	unsigned next;
+	unsigned parsed;
+};
+
+static struct prepared *_find_prepared(uint32_t checksum, uint64_t size)
+{
+	struct prepared_key key;
+
+	if (!_prepared_hash)
+		return NULL;
+
+	memset(&key, 0, sizeof(key));
+	key.checksum = checksum;
+	key.size = size;
+
+	return dm_hash_lookup_binary(_prepared_hash, &key, sizeof(key));
+}
+
+/*
+ * Called with pool->lock held.  Returns an entry for the caller to
+ * fill in, or NULL if another worker already has the text.
+ */
+static struct prepared *_claim_prepared(uint32_t checksum, uint64_t size)
+{
+	struct prepared *p;
+
+	if (!_prepared_hash && !(_prepared_hash = dm_hash_create(64)))
+		return NULL;
+
+	if (_find_prepared(checksum, size))
+		return NULL;
+
+	if (!(p = zalloc(sizeof(*p))))
+		return NULL;
+
+	p->key.checksum = checksum;
+	p->key.size = size;
+
+	if (!dm_hash_insert_binary(_prepared_hash, &p->key, sizeof(p->key), p)) {
+		free(p);
+		return NULL;
+	}
+
+	return p;
+}
+
+static int _read_aligned(int fd, uint64_t offset, uint64_t size, char *dst)
+{
+	uint64_t start = offset & ~((uint64_t) TEXT_READ_ALIGN - 1);
+	uint64_t end = (offset + size + TEXT_READ_ALIGN - 1) & ~((uint64_t) TEXT_READ_ALIGN - 1);
+	uint64_t done = 0;
+	void *buf;
+	ssize_t rv;
+
+	if (!size)
+		return 1;
+
+	if (posix_memalign(&buf, TEXT_READ_ALIGN, end - start))
+		return 0;
+
+	while (done < end - start) {
+		rv = pread(fd, (char *) buf + done, end - start - done, (off_t) (start + done));
+		if (rv < 0 && errno == EINTR)
+			continue;
+		if (rv <= 0)
+			break;
+		done += rv;
+	}
+
+	/* A short read at the end of a regular file is fine. */
+	if (done < (offset - start) + size) {
+		free(buf);
+		return 0;
+	}
+
+	memcpy(dst, (char *) buf + (offset - start), size);
+	free(buf);
+
+	return 1;
+}
+
+/*
+ * Find the committed raw_locn of the first metadata area in the block.
+ * Returns 0 if the block doesn't hold a usable label and mda_header.
+ */
+static int _find_text(const char *block, size_t block_size, uint64_t *mda_start,
+		      struct raw_locn *rlocn, uint64_t *mda_size)
+{
+	const struct label_header *lh = NULL;
+	const struct pv_header *pvhdr;
+	const struct disk_locn *dlocn_xl, *label_end;
+	const struct mda_header *mdah;
+	const char *label_buf;
+	uint32_t pv_offset;
+	uint64_t sector;
+
+	if (block_size < LABEL_SCAN_SECTORS << SECTOR_SHIFT)
+		return 0;
+
+	for (sector = 0; sector < LABEL_SCAN_SECTORS; sector++) {
+		lh = (const struct label_header *) (block + (sector << SECTOR_SHIFT));
+		if (!memcmp(lh->id, LABEL_ID, sizeof(lh->id)))
+			break;
+	}
+
+	if (sector == LABEL_SCAN_SECTORS || memcmp(lh->type, LVM2_LABEL, sizeof(lh->type)))
+		return 0;
+
+	label_buf = (const char *) lh;
+	pv_offset = le32toh(lh->offset_xl);
+	if (pv_offset > LABEL_SIZE - sizeof(struct pv_header))
+		return 0;
+
+	pvhdr = (const struct pv_header *) (label_buf + pv_offset);
+	label_end = (const struct disk_locn *) (label_buf + LABEL_SIZE);
+
+	/* Skip the data areas. */
+	dlocn_xl = pvhdr->disk_areas_xl;
+	while ((dlocn_xl + 1) <= label_end && le64toh(dlocn_xl->offset))
+		dlocn_xl++;
+	dlocn_xl++;
+
+	/* First metadata area. */
+	if ((dlocn_xl + 1) > label_end || !(*mda_start = le64toh(dlocn_xl->offset)))
+		return 0;
+
+	if (*mda_start > block_size - MDA_HEADER_SIZE)
+		return 0;
+
+	mdah = (const struct mda_header *) (block + *mda_start);
+
+	if (memcmp(mdah->magic, FMTT_MAGIC, sizeof(mdah->magic)) ||
+	    le32toh(mdah->version) != FMTT_VERSION ||
+	    le64toh(mdah->start) != *mda_start ||
+	    le32toh(mdah->checksum_xl) != calc_crc(INITIAL_CRC, (const uint8_t *) mdah->magic,
+						   MDA_HEADER_SIZE - sizeof(mdah->checksum_xl)))
+		return 0;
+
+	*mda_size = le64toh(mdah->size);
+	rlocn->offset = le64toh(mdah->raw_locns[0].offset);
+	rlocn->size = le64toh(mdah->raw_locns[0].size);
+	rlocn->checksum = le32toh(mdah->raw_locns[0].checksum);
+	rlocn->flags = le32toh(mdah->raw_locns[0].flags);
+
+	if ((rlocn->flags & RAW_LOCN_IGNORED) || !rlocn->offset || !rlocn->size)
+		return 0;
+
+	/* Same bounds as read_metadata_location_summary(). */
+	if (*mda_size <= MDA_HEADER_SIZE ||
+	    rlocn->offset >= *mda_size ||
+	    rlocn->size > *mda_size - MDA_HEADER_SIZE ||
+	    rlocn->size > UINT32_MAX)
+		return 0;
+
+	return 1;
+}
+
+static void _prepare_one(struct scan_pool *pool, struct scan_prepare_job *job)
+{
+	struct prepared *p;
+	struct raw_locn rlocn;
+	struct dm_config_tree *cft;
+	uint64_t mda_start, mda_size;
+	uint64_t wrap = 0;
+	char *buf;
+
+	if (!_find_text(job->block, job->block_size, &mda_start, &rlocn, &mda_size))
+		return;
+
+	if (rlocn.offset + rlocn.size > mda_size)
+		wrap = rlocn.offset + rlocn.size - mda_size;
+
+	pthread_mutex_lock(&pool->lock);
+	p = _claim_prepared(rlocn.checksum, rlocn.size);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!p)
+		return;
+
+	/* Extra '\0' after the text, like config_file_read_fd(). */
+	if (!(buf = zalloc(rlocn.size + 1)))
+		return;
+
+	if (!_read_aligned(job->fd, mda_start + rlocn.offset, rlocn.size - wrap, buf) ||
+	    !_read_aligned(job->fd, mda_start + MDA_HEADER_SIZE, wrap, buf + rlocn.size - wrap))
+		goto out;
+
+	if (calc_crc(INITIAL_CRC, (const uint8_t *) buf, (uint32_t) rlocn.size) != rlocn.checksum)
+		goto out;
+
+	if (!(cft = dm_config_create()))
+		goto out;
+
+	/*
+	 * Same parse as text_read_metadata_summary().  Parse errors are
+	 * logged by libdm, which the caller has silenced.
+	 */
+	if (!dm_config_parse_only_section(cft, buf, buf + rlocn.size, "physical_volumes")) {
+		dm_config_destroy(cft);
+		goto out;
+	}
+
+	p->cft = cft;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->parsed++;
+	pthread_mutex_unlock(&pool->lock);
+ out:
+	free(buf);
+}
+
+static void *_worker(void *arg)
+{
+	struct scan_pool *pool = arg;
+	unsigned i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->count)
+			break;
+
+		_prepare_one(pool, &pool->jobs[i]);
+	}
+
+	return NULL;
+}
+
+unsigned scan_prepare_metadata(struct scan_prepare_job *jobs, unsigned count, unsigned workers)
+{
+	pthread_t threads[SCAN_WORKERS_MAX];
+	struct scan_pool pool = {
+		.jobs = jobs,
+		.count = count,
+	};
+	unsigned started = 0;
+	unsigned i;
+
+	if (workers > SCAN_WORKERS_MAX)
+		workers = SCAN_WORKERS_MAX;
+	if (workers > count)
+		workers = count;
+
+	if (pthread_mutex_init(&pool.lock, NULL))
+		return 0;
+
+	/* The calling thread is one of the workers. */
+	for (i = 1; i < workers; i++) {
+		if (pthread_create(&threads[started], NULL, _worker, &pool))
+			break;
+		started++;
+	}
+
+	(void) _worker(&pool);
+
+	for (i = 0; i < started; i++)
+		(void) pthread_join(threads[i], NULL);
+
+	(void) pthread_mutex_destroy(&pool.lock);
+
+	log_debug_devs("Scan workers %u parsed %u metadata texts for %u devices.",
+		       started + 1, pool.parsed, count);
+
+	return pool.parsed;
+}
+
+const struct dm_config_tree *scan_prepared_metadata(uint32_t checksum, uint64_t size)
+{
+	struct prepared *p;
+
+	if (!(p = _find_prepared(checksum, size)))
+		return NULL;
+
+	return p->cft;
+}
+
+void scan_prepared_metadata_clear(void)
+{
+	struct dm_hash_node *n;
+	struct prepared *p;
+
+	if (!_prepared_hash)
+		return;
+
+	dm_hash_iterate(n, _prepared_hash) {
+		p = dm_hash_get_data(_prepared_hash, n);
+		if (p->cft)
+			dm_config_destroy(p->cft);
+		free(p);
+	}
+
+	dm_hash_destroy(_prepared_hash);
+	_prepared_hash = NULL;
+}
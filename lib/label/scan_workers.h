@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_SCAN_WORKERS_H
+#define _LVM_SCAN_WORKERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct dm_config_tree;
+
+/* Upper limit for devices/scan_workers. */
+#define SCAN_WORKERS_MAX 64
+
+/*
+ * One device for scan_prepare_metadata().  The caller holds the first
+ * block of the device, which contains the label and the mda_header of
+ * the first metadata area.  fd is used to read the metadata text.
+ */
+struct scan_prepare_job {
+	int fd;
+	const char *block;
+	size_t block_size;
+};
+
+/*
+ * Read, checksum and parse the metadata text of the first metadata area
+ * of each device using up to 'workers' threads.  Each distinct text is
+ * parsed once.  Returns the number of metadata texts parsed.
+ */
+unsigned scan_prepare_metadata(struct scan_prepare_job *jobs, unsigned count, unsigned workers);
+
+/*
+ * Return the config tree parsed from metadata text with the given
+ * mda_header checksum and size, or NULL.  The tree remains owned by
+ * the prepared set until scan_prepared_metadata_clear().
+ */
+const struct dm_config_tree *scan_prepared_metadata(uint32_t checksum, uint64_t size);
+
+void scan_prepared_metadata_clear(void);
+
+#endif
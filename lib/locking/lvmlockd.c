@@ -27,6 +27,8 @@ static const char *_lvmlockd_socket = NULL;
 static int _use_lvmlockd = 0;         /* is 1 if command is configured to use lvmlockd */
 static int _lvmlockd_connected = 0;   /* is 1 if command is connected to lvmlockd */
 static int _lvmlockd_init_failed = 0; /* used to suppress further warnings */
+static struct dm_hash_table *_lv_batch = NULL; /* lv uuid to lv locked by lockd_lv_batch */
+static const char *_lv_batch_mode = NULL;
 
 struct lvmlockd_pvs {
 	char **path;
@@ -3007,6 +3009,25 @@ int lockd_query_lv(struct cmd_context *cmd, const struct logical_volume *lv, int
  * lockd_lv), the caller knows that the LV has a lock.
  */
 
+/*
+ * The persistent lock for an LV from lockd_lv_batch() is taken
+ * by the first persistent lockd_lv for the LV, which needs no
+ * request to lvmlockd if it asks for the same mode.
+ */
+static int _lv_batch_take(const char *lv_uuid, const char *mode, uint32_t flags)
+{
+	if (!(flags & LDLV_PERSISTENT) || !dm_hash_lookup(_lv_batch, lv_uuid))
+		return 0;
+
+	dm_hash_remove(_lv_batch, lv_uuid);
+
+	if (strcmp(mode, _lv_batch_mode))
+		return 0;
+
+	log_debug("lockd_lv %s %s locked by batch", mode, lv_uuid);
+	return 1;
+}
+
 int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 		  const char *lv_name, const struct id *lv_id,
 		  const char *lock_args, const char *def_mode, uint32_t flags)
@@ -3091,6 +3112,9 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 	if (!mode)
 		mode = "ex";
 
+	if (_lv_batch && _lv_batch_take(lv_uuid, mode, flags))
+		return 1;
+
 	if ((flags & LDLV_PERSISTENT) ||
 	    (cmd->lockopt & LOCKOPT_ADOPTLV) ||
 	    (cmd->lockopt & LOCKOPT_ADOPT) ||
@@ -3855,6 +3879,23 @@ static int _lockd_lv_vdo(struct cmd_context *cmd, struct logical_volume *lv,
  * the origin LV protects the combined origin + cache pool.
  */
 
+/*
+ * LV type cannot be active concurrently on multiple hosts,
+ * so shared mode activation is not allowed.
+ */
+static int _lockd_lv_no_sh(const struct logical_volume *lv)
+{
+	return (lv_is_external_origin(lv) ||
+		lv_is_thin_type(lv) ||
+		lv_is_mirror_type(lv) ||
+		lv_is_raid_type(lv) ||
+		lv_is_vdo_type(lv) ||
+		lv_is_writecache(lv) ||
+		lv_is_cache_type(lv) ||
+		lv_is_origin(lv) ||
+		lv_is_cow(lv));
+}
+
 int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags)
 {
@@ -3899,26 +3940,170 @@ int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	if (lv_is_cache_vol(lv))
 		return 1;
 
-	/*
-	 * LV type cannot be active concurrently on multiple hosts,
-	 * so shared mode activation is not allowed.
-	 */
-	if (lv_is_external_origin(lv) ||
-	    lv_is_thin_type(lv) ||
-	    lv_is_mirror_type(lv) ||
-	    lv_is_raid_type(lv) ||
-	    lv_is_vdo_type(lv) ||
-	    lv_is_writecache(lv) ||
-	    lv_is_cache_type(lv) ||
-	    lv_is_origin(lv) ||
-	    lv_is_cow(lv)) {
+	if (_lockd_lv_no_sh(lv))
 		flags |= LDLV_MODE_NO_SH;
-	}
 
 	return lockd_lv_name(cmd, lv->vg, lv->name, &lv->lvid.id[1],
 			     lv->lock_args, def_mode, flags);
 }
 
+static void _lockd_lv_batch_send(struct cmd_context *cmd, struct volume_group *vg,
+				 struct logical_volume **lvs, int count, const char *mode)
+{
+	char lv_uuid[LVMLOCKD_LOCK_LV_BATCH_MAX][64] __attribute__((aligned(8)));
+	const char *cmd_name = get_cmd_name();
+	daemon_request req;
+	daemon_reply reply;
+	char key[32];
+	uint32_t result_flags;
+	int result, lv_count;
+	int i, locked = 0;
+
+	for (i = 0; i < count; i++)
+		if (!id_write_format(&lvs[i]->lvid.id[1], lv_uuid[i], sizeof(lv_uuid[i])))
+			return;
+
+	if (!cmd_name || !cmd_name[0])
+		cmd_name = "none";
+
+	req = daemon_request_make("lock_lv");
+
+	if (!daemon_request_extend(req,
+				   "cmd = %s", cmd_name,
+				   "pid = " FMTd64, (int64_t) getpid(),
+				   "mode = %s", mode,
+				   "opts = %s", "persistent,",
+				   "vg_name = %s", vg->name,
+				   "lv_name = %s", lvs[0]->name,
+				   "lv_uuid = %s", lv_uuid[0],
+				   "vg_lock_type = %s", vg->lock_type,
+				   "vg_lock_args = %s", vg->lock_args ?: "none",
+				   "lv_lock_args = %s", lvs[0]->lock_args,
+				   "lv_count = " FMTd64, (int64_t) count,
+				   NULL))
+		goto bad;
+
+	for (i = 1; i < count; i++) {
+		if ((dm_snprintf(key, sizeof(key), "lv_name_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lvs[i]->name, NULL))
+			goto bad;
+		if ((dm_snprintf(key, sizeof(key), "lv_uuid_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lv_uuid[i], NULL))
+			goto bad;
+		if ((dm_snprintf(key, sizeof(key), "lv_lock_args_%d = %%s", i) < 0) ||
+		    !daemon_request_extend(req, key, lvs[i]->lock_args, NULL))
+			goto bad;
+	}
+
+	reply = daemon_send(_lvmlockd, req);
+	daemon_request_destroy(req);
+
+	if (!_lockd_result(cmd, "lock_lv", reply, &result, &result_flags, NULL, NULL))
+		goto out;
+
+	lv_count = daemon_reply_int(reply, "lv_count", 0);
+
+	for (i = 0; i < count; i++) {
+		if (lv_count) {
+			if (dm_snprintf(key, sizeof(key), "lv_result_%d", i) < 0)
+				break;
+			result = daemon_reply_int(reply, key, NO_LOCKD_RESULT);
+		} else if (i) {
+			/* An lvmlockd without lv_count only locked the first LV. */
+			break;
+		}
+
+		if (result)
+			continue;
+
+		if (!dm_hash_insert(_lv_batch, lv_uuid[i], lvs[i]))
+			break;
+		locked++;
+	}
+
+	log_debug("lockd_lv_batch %s %s locked %d of %d LVs", mode, vg->name, locked, count);
+out:
+	daemon_reply_destroy(reply);
+	return;
+bad:
+	log_error("Failed to create lock_lv request.");
+	daemon_request_destroy(req);
+}
+
+/*
+ * Lock the LVs that will be activated in a sanlock VG before activating
+ * them, with one lock_lv request for up to LVMLOCKD_LOCK_LV_BATCH_MAX
+ * LVs.  lvmlockd then acquires many leases with each sanlock call rather
+ * than a lease per call.  The lockd_lv() from activating each of these
+ * LVs finds the lock held.  An LV that fails to lock here is left to its
+ * own lockd_lv(), which repeats the request and reports the error.
+ * lockd_lv_batch_done() unlocks the LVs locked here but not activated.
+ */
+void lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+		    struct dm_list *lvs, const char *def_mode)
+{
+	struct logical_volume *batch[LVMLOCKD_LOCK_LV_BATCH_MAX];
+	const char *mode = def_mode ?: "ex";
+	struct lv_list *lvl;
+	struct logical_volume *lv;
+	int count = 0;
+
+	if (!vg_is_sanlock(vg) || !_use_lvmlockd || !_lvmlockd_connected)
+		return;
+
+	if (cmd->metadata_read_only || cmd->lockd_lv_disable ||
+	    (cmd->lockopt & (LOCKOPT_ADOPTLV | LOCKOPT_ADOPT | LOCKOPT_REPAIRLV | LOCKOPT_REPAIR)))
+		return;
+
+	if (!_lv_batch && !(_lv_batch = dm_hash_create(128))) {
+		log_debug("lockd_lv_batch no memory");
+		return;
+	}
+	_lv_batch_mode = mode;
+
+	dm_list_iterate_items(lvl, lvs) {
+		lv = lvl->lv;
+
+		/* LVs with special lock handling in lockd_lv() */
+		if (lv_is_thin_type(lv) || lv_is_vdo_type(lv) ||
+		    !lv->lock_args || lv_is_cache_vol(lv))
+			continue;
+
+		if (!strcmp(mode, "sh") && _lockd_lv_no_sh(lv))
+			continue;
+
+		batch[count++] = lv;
+
+		if (count == LVMLOCKD_LOCK_LV_BATCH_MAX) {
+			_lockd_lv_batch_send(cmd, vg, batch, count, mode);
+			count = 0;
+		}
+	}
+
+	if (count > 1)
+		_lockd_lv_batch_send(cmd, vg, batch, count, mode);
+}
+
+void lockd_lv_batch_done(struct cmd_context *cmd, struct volume_group *vg)
+{
+	struct dm_hash_node *hn;
+	struct logical_volume *lv;
+
+	if (!_lv_batch)
+		return;
+
+	while ((hn = dm_hash_get_first(_lv_batch))) {
+		lv = dm_hash_get_data(_lv_batch, hn);
+		dm_hash_remove(_lv_batch, dm_hash_get_key(_lv_batch, hn));
+		log_debug("lockd_lv_batch unlock unused %s", display_lvname(lv));
+		if (!lockd_lv_name(cmd, vg, lv->name, &lv->lvid.id[1], lv->lock_args, "un", LDLV_PERSISTENT))
+			log_warn("WARNING: Failed to unlock LV %s.", display_lvname(lv));
+	}
+
+	dm_hash_destroy(_lv_batch);
+	_lv_batch = NULL;
+}
+
 /*
  * Check if the LV being resized is used by gfs2/ocfs2 which we
  * know allow resizing under a shared lock.
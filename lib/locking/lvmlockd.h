@@ -126,6 +126,9 @@ int lockd_lv_name(struct cmd_context *cmd, struct volume_group *vg,
 		  const char *lock_args, const char *def_mode, uint32_t flags);
 int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags);
+void lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+		    struct dm_list *lvs, const char *def_mode);
+void lockd_lv_batch_done(struct cmd_context *cmd, struct volume_group *vg);
 int lockd_lv_resize(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags, struct lvresize_params *lp);
 
@@ -303,6 +306,15 @@ static inline int lockd_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	return 1;
 }
 
+static inline void lockd_lv_batch(struct cmd_context *cmd, struct volume_group *vg,
+				  struct dm_list *lvs, const char *def_mode)
+{
+}
+
+static inline void lockd_lv_batch_done(struct cmd_context *cmd, struct volume_group *vg)
+{
+}
+
 static inline int lockd_lv_resize(struct cmd_context *cmd, struct logical_volume *lv,
 	     const char *def_mode, uint32_t flags, struct lvresize_params *lp)
 {
@@ -1745,7 +1745,9 @@ int lv_set_vg(struct logical_volume *lv, struct volume_group *vg)
 		lv_name = lv->name;
 		if (!lv_set_name(lv, NULL))
 			return_0; /* drop from existing VG radix_tree */
+		vg_drop_uuid_index(lv->vg);
 		lv->vg = vg;
+		vg_drop_uuid_index(vg);
 		if (!lv_set_name(lv, lv_name))
 			return_0;
 	}
@@ -31,6 +31,7 @@
 #include "lib/format_text/format-text.h"
 #include "lib/format_text/layout.h"
 #include "lib/format_text/import-export.h"
+#include "lib/format_text/metadata_cache.h"
 #include "lib/config/defaults.h"
 #include "lib/locking/lvmlockd.h"
 #include "lib/device/persist.h"
@@ -283,6 +284,7 @@ void add_pvl_to_vgs(struct volume_group *vg, struct pv_list *pvl)
 	vg->pv_count++;
 	pvl->pv->vg = vg;
 	pv_set_fid(pvl->pv, vg->fid);
+	vg_index_add_pv(vg, pvl);
 }
 
 void del_pvl_from_vgs(struct volume_group *vg, struct pv_list *pvl)
@@ -292,6 +294,7 @@ void del_pvl_from_vgs(struct volume_group *vg, struct pv_list *pvl)
 
 	vg->pv_count--;
 	dm_list_del(&pvl->list);
+	vg_index_del_pv(vg, pvl);
 
 	pvid[ID_LEN] = 0;
 	memcpy(pvid, &pvl->pv->id.uuid, ID_LEN);
@@ -423,6 +426,7 @@ int add_pv_to_vg(struct volume_group *vg, const char *pv_name,
 	dm_list_iterate_items(pvl, &fid->fmt->orphan_vg->pvs)
 		if (pv == pvl->pv) { /* unlink from orphan */
 			dm_list_del(&pvl->list);
+			vg_index_del_pv(fid->fmt->orphan_vg, pvl);
 			break;
 		}
 
@@ -700,6 +704,8 @@ int vg_remove_direct(struct volume_group *vg)
 	if (!backup_remove(vg->cmd, vg->name))
 		stack;
 
+	metadata_cache_remove(vg->name);
+
 	if (ret)
 		log_print_unless_silent("Volume group \"%s\" successfully removed", vg->name);
 	else
@@ -1585,11 +1591,32 @@ struct physical_volume *pv_create(const struct cmd_context *cmd,
 	return NULL;
 }
 
+/*
+ * A device holding a PV label has its pvid, so try the PV uuid index
+ * before walking the list.
+ */
+static struct pv_list *_find_pvl_by_dev(const struct volume_group *vg,
+					const struct device *dev)
+{
+	struct radix_tree *pv_uuids;
+	struct pv_list *pvl;
+
+	if (dev->pvid[0] && (pv_uuids = vg_pv_uuids(vg)) &&
+	    (pvl = radix_tree_lookup_ptr(pv_uuids, dev->pvid, ID_LEN)) &&
+	    (pvl->pv->dev == dev))
+		return pvl;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (pvl->pv->dev == dev)
+			return pvl;
+
+	return NULL;
+}
+
 /* FIXME: liblvm todo - make into function that returns handle */
 struct pv_list *find_pv_in_vg(const struct volume_group *vg,
 			       const char *pv_name)
 {
-	struct pv_list *pvl;
 	struct device *dev = dev_cache_get(vg->cmd, pv_name, vg->cmd->filter);
 
 	/*
@@ -1601,11 +1628,7 @@ struct pv_list *find_pv_in_vg(const struct volume_group *vg,
 	if (!dev)
 		return NULL;
 
-	dm_list_iterate_items(pvl, &vg->pvs)
-		if (pvl->pv->dev == dev)
-			return pvl;
-
-	return NULL;
+	return _find_pvl_by_dev(vg, dev);
 }
 
 struct pv_list *find_pv_in_pv_list(const struct dm_list *pl,
@@ -1622,8 +1645,14 @@ struct pv_list *find_pv_in_pv_list(const struct dm_list *pl,
 
 int pv_is_in_vg(struct volume_group *vg, struct physical_volume *pv)
 {
+	struct radix_tree *pv_uuids;
 	struct pv_list *pvl;
 
+	if ((pv_uuids = vg_pv_uuids(vg)) &&
+	    (pvl = radix_tree_lookup_ptr(pv_uuids, &pv->id, sizeof(pv->id))) &&
+	    (pvl->pv == pv))
+		return 1;
+
 	dm_list_iterate_items(pvl, &vg->pvs)
 		if (pv == pvl->pv)
 			 return 1;
@@ -1646,8 +1675,12 @@ int pv_is_in_vg(struct volume_group *vg, struct physical_volume *pv)
 struct pv_list *find_pv_in_vg_by_uuid(const struct volume_group *vg,
 				      const struct id *id)
 {
+	struct radix_tree *pv_uuids;
 	struct pv_list *pvl;
 
+	if ((pv_uuids = vg_pv_uuids(vg)))
+		return radix_tree_lookup_ptr(pv_uuids, id, sizeof(*id));
+
 	dm_list_iterate_items(pvl, &vg->pvs)
 		if (id_equal(&pvl->pv->id, id))
 			return pvl;
@@ -1658,16 +1691,14 @@ struct pv_list *find_pv_in_vg_by_uuid(const struct volume_group *vg,
 struct logical_volume *find_lv_in_vg_by_lvid(const struct volume_group *vg,
 					     const union lvid *lvid)
 {
+	struct radix_tree *lv_uuids;
 	struct lv_list *lvl;
 
 	if (memcmp(&lvid->id[0], &vg->id, ID_LEN))
 		return NULL; /* Check VG does not match */
 
-	if (vg->lv_uuids)
-		/* Used only for committed read-only VG (which happens to be
-		 * the only user of this 'find' function.
-		 * ATM we do NOT update this radix_tree when LV is added/removed! */
-		return radix_tree_lookup_ptr(vg->lv_uuids, &lvid->id[1],
+	if ((lv_uuids = vg_lv_uuids(vg)))
+		return radix_tree_lookup_ptr(lv_uuids, &lvid->id[1],
 					     sizeof(lvid->id[1]));
 
 	dm_list_iterate_items(lvl, &vg->lvs)
@@ -1754,11 +1785,10 @@ struct physical_volume *find_pv(struct volume_group *vg, struct device *dev)
 {
 	struct pv_list *pvl;
 
-	dm_list_iterate_items(pvl, &vg->pvs)
-		if (dev == pvl->pv->dev)
-			return pvl->pv;
+	if (!dev || !(pvl = _find_pvl_by_dev(vg, dev)))
+		return NULL;
 
-	return NULL;
+	return pvl->pv;
 }
 
 struct physical_volume *find_pv_by_pv_name(struct volume_group *vg, const char *pv_name)
@@ -3033,7 +3063,14 @@ int vg_write(struct volume_group *vg)
 		dm_list_del(&pvl->list);
 	}
 
-	/* Write to each copy of the metadata area */
+	/*
+	 * Write to each copy of the metadata area.  The writes are issued
+	 * together when the batch ends, and each later step (precommit,
+	 * commit) is a separate batch, so no mda_header can point to text
+	 * that is not yet on disk.
+	 */
+	dev_write_batch_start();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->status & MDA_FAILED)
 			continue;
@@ -3078,6 +3115,22 @@ int vg_write(struct volume_group *vg)
 			++ wrote;
 	}
 
+	/* After a break, mda must stay where it stopped for the revert below. */
+	if (!dev_write_batch_end() && !revert) {
+		dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+			if ((mda->status & MDA_FAILED) ||
+			    !(mda_dev = mda_get_device(mda)) ||
+			    !dev_write_batch_failed(mda_dev))
+				continue;
+			if (vg->cmd->handles_missing_pvs) {
+				log_warn("WARNING: Failed to write an MDA of VG %s.", vg->name);
+				mda->status |= MDA_FAILED;
+				--wrote;
+			} else
+				revert = 1;
+		}
+	}
+
 	if (revert || !wrote) {
 		log_error("Failed to write VG %s.", vg->name);
 		dm_list_uniterate(mdah, &vg->fid->metadata_areas_in_use, &mda->list) {
@@ -3086,6 +3139,9 @@ int vg_write(struct volume_group *vg)
 			if (mda->status & MDA_FAILED)
 				continue;
 
+			if ((mda_dev = mda_get_device(mda)) && dev_write_batch_failed(mda_dev))
+				continue;
+
 			if (mda->ops->vg_revert &&
 			    !mda->ops->vg_revert(vg->fid, vg, mda)) {
 				stack;
@@ -3095,23 +3151,32 @@ int vg_write(struct volume_group *vg)
 	}
 
 	/* Now pre-commit each copy of the new metadata */
+	dev_write_batch_start();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->status & MDA_FAILED)
 			continue;
 		if (mda->ops->vg_precommit &&
 		    !mda->ops->vg_precommit(vg->fid, vg, mda)) {
 			stack;
-			/* Revert */
-			dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
-				if (mda->status & MDA_FAILED)
-					continue;
-				if (mda->ops->vg_revert &&
-				    !mda->ops->vg_revert(vg->fid, vg, mda)) {
-					stack;
-				}
+			revert = 1;
+			break;
+		}
+	}
+
+	if (!dev_write_batch_end())
+		revert = 1;
+
+	if (revert) {
+		dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+			if (mda->status & MDA_FAILED)
+				continue;
+			if (mda->ops->vg_revert &&
+			    !mda->ops->vg_revert(vg->fid, vg, mda)) {
+				stack;
 			}
-			return 0;
 		}
+		return 0;
 	}
 
 	lockd_vg_update(vg);
@@ -3122,6 +3187,7 @@ int vg_write(struct volume_group *vg)
 static int _vg_commit_mdas(struct volume_group *vg)
 {
 	struct metadata_area *mda, *tmda;
+	struct device *mda_dev;
 	DM_LIST_INIT(ignored);
 	int good = 0;
 
@@ -3134,16 +3200,35 @@ static int _vg_commit_mdas(struct volume_group *vg)
 		dm_list_move(&vg->fid->metadata_areas_in_use, &mda->list);
 
 	/* Commit to each copy of the metadata area */
+	dev_write_batch_start();
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+		mda->status &= ~MDA_COMMIT_FAILED;
 		if (mda->status & MDA_FAILED)
 			continue;
 		if (mda->ops->vg_commit &&
 		    !mda->ops->vg_commit(vg->fid, vg, mda)) {
 			stack;
+			mda->status |= MDA_COMMIT_FAILED;
 		} else
 			good++;
 	}
-	if (good)
+
+	/* An mda whose commit already failed was not counted as good. */
+	if (!dev_write_batch_end()) {
+		dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+			if ((mda->status & (MDA_FAILED | MDA_COMMIT_FAILED)) ||
+			    !(mda_dev = mda_get_device(mda)) ||
+			    !dev_write_batch_failed(mda_dev))
+				continue;
+			log_warn("WARNING: Failed to commit an MDA of VG %s on %s.",
+				 vg->name, dev_name(mda_dev));
+			mda->status |= MDA_COMMIT_FAILED;
+			good--;
+		}
+	}
+
+	if (good > 0)
 		return 1;
 	return 0;
 }
@@ -3307,6 +3392,7 @@ struct volume_group *vg_read_orphans(struct cmd_context *cmd, const char *orphan
 			pv_set_fid(pvl->pv, NULL);
 
 	dm_list_init(&vg->pvs);
+	vg_drop_uuid_index(vg);
 	vg->pv_count = 0;
 	vg->extent_count = 0;
 	vg->free_count = 0;
@@ -4323,8 +4409,6 @@ const struct logical_volume *lv_committed(const struct logical_volume *lv)
 {
 	struct volume_group *vg;
 	const struct logical_volume *found_lv;
-	struct lv_list *lvl;
-	int r;
 
 	if (!lv)
 		return NULL;
@@ -4334,24 +4418,6 @@ const struct logical_volume *lv_committed(const struct logical_volume *lv)
 
 	vg = lv->vg->vg_committed;
 
-	if (!vg->lv_uuids &&
-	    (vg->lv_uuids = radix_tree_create(NULL, NULL)))
-		/* Create radix_tree for the 'committed' VG, that should
-		 * never be modified and is only used for 'activation'
-		 * so the tree need to constructed just once. */
-		dm_list_iterate_items(lvl, &vg->lvs) {
-			if (!(r = radix_tree_uniq_insert_ptr(vg->lv_uuids,
-								 &lvl->lv->lvid.id[1],
-								 sizeof(lvl->lv->lvid.id[1]),
-								 lvl->lv))) {
-				radix_tree_destroy(vg->lv_uuids);
-				vg->lv_uuids = NULL; /* fallback to linear search */
-				break;
-			}
-			if (r != 1) /* There is duplicate ID, but continue with 'best' effort */
-				log_warn("WARNING: Duplicate id found!");
-		}
-
 	if (!(found_lv = find_lv_in_vg_by_lvid(vg, &lv->lvid))) {
 		log_error(INTERNAL_ERROR "LV %s (UUID %s) not found in committed metadata.",
 			  display_lvname(lv), lv->lvid.s);
@@ -5196,12 +5262,17 @@ struct volume_group *vg_read(struct cmd_context *cmd, const char *vg_name, const
 			vg->vg_precommitted = NULL;
 		}
 
-		if (!vg->committed_cft) {
+		if (!vg->committed_cft && !vg->committed_text) {
 			log_error(INTERNAL_ERROR "Missing committed config tree.");
 			goto out;
 		}
 
-		if (!(vg->vg_committed = import_vg_from_config_tree(cmd, vg->fid, vg->committed_cft))) {
+		if (vg->committed_text)
+			vg->vg_committed = import_vg_from_text(cmd, vg->fid, vg->committed_text);
+		else
+			vg->vg_committed = import_vg_from_config_tree(cmd, vg->fid, vg->committed_cft);
+
+		if (!vg->vg_committed) {
 			log_error("Failed to import written VG.");
 			goto out;
 		}
@@ -163,6 +163,9 @@ struct metadata_area_ops {
 /* The primary metadata area on a device if the format supports more than one. */
 #define MDA_PRIMARY	 0x00000008
 
+/* vg_commit failed to write this metadata area. */
+#define MDA_COMMIT_FAILED 0x00000010
+
 #define mda_is_primary(mda) (((mda->status) & MDA_PRIMARY) ? 1 : 0)
 #define MDA_CONTENT_REASON(primary_mda) ((primary_mda) ? DEV_IO_MDA_CONTENT : DEV_IO_MDA_EXTRA_CONTENT)
 #define MDA_HEADER_REASON(primary_mda)  ((primary_mda) ? DEV_IO_MDA_HEADER : DEV_IO_MDA_EXTRA_HEADER)
@@ -477,9 +480,13 @@ void lv_calculate_readahead(const struct logical_volume *lv, uint32_t *read_ahea
  * For internal metadata caching.
  */
 struct dm_config_tree *export_vg_to_config_tree(struct volume_group *vg);
+void export_cache_destroy(struct export_cache *ec);
 struct volume_group *import_vg_from_config_tree(struct cmd_context *cmd,
 						struct format_instance *fid,
 						const struct dm_config_tree *cft);
+struct volume_group *import_vg_from_text(struct cmd_context *cmd,
+					 struct format_instance *fid,
+					 const char *text);
 struct volume_group *vg_from_config_tree(struct cmd_context *cmd, const struct dm_config_tree *cft);
 
 /*
@@ -59,6 +59,13 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 	dm_list_init(&vg->msg_list);
 	dm_list_init(&vg->lockd_free_lvs);
 
+	/* Maintained by lv_set_name() for every VG */
+	if (!(vg->lv_names = radix_tree_create(NULL, NULL))) {
+		log_error("Couldn't create lv_names radix tree.");
+		dm_pool_destroy(vgmem);
+		return NULL;
+	}
+
 	log_debug_mem("Allocated VG %s at %p.", vg->name ? : "<no name>", (void *)vg);
 
 	return vg;
@@ -79,11 +86,14 @@ static void _free_vg(struct volume_group *vg)
 	if (vg->committed_cft)
 		config_destroy(vg->committed_cft);
 
+	free(vg->committed_text);
+
 	if (vg->lv_names)
 		radix_tree_destroy(vg->lv_names);
 
-	if (vg->lv_uuids)
-		radix_tree_destroy(vg->lv_uuids);
+	vg_drop_uuid_index(vg);
+
+	export_cache_destroy(vg->export_cache);
 
 	if (vg->pv_names)
 		radix_tree_destroy(vg->pv_names);
@@ -113,6 +123,99 @@ void free_orphan_vg(struct volume_group *vg)
 	_free_vg(vg);
 }
 
+static int _lvid_is_set(const struct logical_volume *lv)
+{
+	static const struct id _zero_id;
+
+	return memcmp(&lv->lvid.id[1], &_zero_id, sizeof(_zero_id)) ? 1 : 0;
+}
+
+/* The indexes are only a lookup cache, so they may be built for a const VG. */
+struct radix_tree *vg_lv_uuids(const struct volume_group *vg)
+{
+	struct volume_group *ivg = (struct volume_group *) vg;
+	struct lv_list *lvl;
+	int r;
+
+	if (ivg->lv_uuids)
+		return ivg->lv_uuids;
+
+	if (!(ivg->lv_uuids = radix_tree_create(NULL, NULL)))
+		return_NULL;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (1 != (r = radix_tree_uniq_insert_ptr(ivg->lv_uuids, &lvl->lv->lvid.id[1],
+							 sizeof(lvl->lv->lvid.id[1]), lvl->lv))) {
+			if (r)
+				log_debug_metadata("Duplicate LV uuid in VG %s, not indexing LVs.",
+						   vg->name);
+			radix_tree_destroy(ivg->lv_uuids);
+			ivg->lv_uuids = NULL; /* fallback to linear search */
+			return NULL;
+		}
+
+	return ivg->lv_uuids;
+}
+
+struct radix_tree *vg_pv_uuids(const struct volume_group *vg)
+{
+	struct volume_group *ivg = (struct volume_group *) vg;
+	struct pv_list *pvl;
+	int r;
+
+	if (ivg->pv_uuids)
+		return ivg->pv_uuids;
+
+	if (!(ivg->pv_uuids = radix_tree_create(NULL, NULL)))
+		return_NULL;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (1 != (r = radix_tree_uniq_insert_ptr(ivg->pv_uuids, &pvl->pv->id,
+							 sizeof(pvl->pv->id), pvl))) {
+			if (r)
+				log_debug_metadata("Duplicate PV uuid in VG %s, not indexing PVs.",
+						   vg->name);
+			radix_tree_destroy(ivg->pv_uuids);
+			ivg->pv_uuids = NULL; /* fallback to linear search */
+			return NULL;
+		}
+
+	return ivg->pv_uuids;
+}
+
+void vg_drop_uuid_index(struct volume_group *vg)
+{
+	if (vg->lv_uuids) {
+		radix_tree_destroy(vg->lv_uuids);
+		vg->lv_uuids = NULL;
+	}
+
+	if (vg->pv_uuids) {
+		radix_tree_destroy(vg->pv_uuids);
+		vg->pv_uuids = NULL;
+	}
+}
+
+void vg_index_add_pv(struct volume_group *vg, struct pv_list *pvl)
+{
+	if (vg->pv_uuids &&
+	    (1 != radix_tree_uniq_insert_ptr(vg->pv_uuids, &pvl->pv->id,
+					     sizeof(pvl->pv->id), pvl))) {
+		radix_tree_destroy(vg->pv_uuids);
+		vg->pv_uuids = NULL; /* rebuilt on next lookup */
+	}
+}
+
+void vg_index_del_pv(struct volume_group *vg, struct pv_list *pvl)
+{
+	if (vg->pv_uuids &&
+	    (radix_tree_lookup_ptr(vg->pv_uuids, &pvl->pv->id, sizeof(pvl->pv->id)) == pvl) &&
+	    !radix_tree_remove(vg->pv_uuids, &pvl->pv->id, sizeof(pvl->pv->id))) {
+		radix_tree_destroy(vg->pv_uuids);
+		vg->pv_uuids = NULL;
+	}
+}
+
 int link_lv_to_vg(struct volume_group *vg, struct logical_volume *lv)
 {
 	struct lv_list *lvl;
@@ -126,6 +229,15 @@ int link_lv_to_vg(struct volume_group *vg, struct logical_volume *lv)
 	dm_list_add(&vg->lvs, &lvl->list);
 	lv->status &= ~LV_REMOVED;
 
+	/* New LVs get their uuid only after linking, so index them later */
+	if (vg->lv_uuids &&
+	    (!_lvid_is_set(lv) ||
+	     (1 != radix_tree_uniq_insert_ptr(vg->lv_uuids, &lv->lvid.id[1],
+					      sizeof(lv->lvid.id[1]), lv)))) {
+		radix_tree_destroy(vg->lv_uuids);
+		vg->lv_uuids = NULL;
+	}
+
 	return 1;
 }
 
@@ -143,6 +255,14 @@ int unlink_lv_from_vg(struct logical_volume *lv)
 	    !radix_tree_remove(lv->vg->lv_names, lv->name, strlen(lv->name)))
 		stack;
 
+	if (lv->vg->lv_uuids &&
+	    (radix_tree_lookup_ptr(lv->vg->lv_uuids, &lv->lvid.id[1],
+				   sizeof(lv->lvid.id[1])) == lv) &&
+	    !radix_tree_remove(lv->vg->lv_uuids, &lv->lvid.id[1], sizeof(lv->lvid.id[1]))) {
+		radix_tree_destroy(lv->vg->lv_uuids);
+		lv->vg->lv_uuids = NULL;
+	}
+
 	return 1;
 }
 
@@ -19,8 +19,11 @@
 #include "libdm/libdevmapper.h"
 
 struct cmd_context;
+struct export_cache;
 struct format_instance;
 struct logical_volume;
+struct pv_list;
+struct radix_tree;
 
 typedef enum {
 	ALLOC_INVALID,
@@ -53,6 +56,7 @@ struct volume_group {
 	unsigned fixup_imported_mirrors : 1;
 	uint32_t write_count; /* count the number of vg_write calls */
 	uint32_t buffer_size_hint; /* hint with buffer size of parsed VG */
+	struct export_cache *export_cache; /* LV text from the last raw export */
 
 	/*
 	 * The parsed committed (on-disk) copy of this VG; is NULL if this VG is committed
@@ -61,6 +65,7 @@ struct volume_group {
 	 * this will be NULL). The pointer is maintained by calls to vg_write & vg_commit
 	 */
 	struct dm_config_tree *committed_cft;
+	char *committed_text; /* metadata text, kept instead of committed_cft when imported without a tree */
 	struct volume_group *vg_committed;
 	struct volume_group *vg_precommitted;
 
@@ -69,7 +74,8 @@ struct volume_group {
 	uint64_t status;
 
 	struct radix_tree *lv_names;    /* maintained tree for LV names within VG */
-	struct radix_tree *lv_uuids;    /* LV uuid (when searching committed metadata) */
+	struct radix_tree *lv_uuids;    /* LV uuid index, built on first lookup */
+	struct radix_tree *pv_uuids;    /* PV uuid index, built on first lookup */
 	struct radix_tree *pv_names;    /* PV names used for metadata import */
 
 	struct id id;
@@ -157,6 +163,20 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 void release_vg(struct volume_group *vg);
 void free_orphan_vg(struct volume_group *vg);
 
+/*
+ * Indexes of the LVs and PVs of a VG by uuid.  They are built on the
+ * first lookup and then kept up to date as LVs are linked/unlinked and
+ * PVs are added/removed.  Anything changing uuids of LVs or PVs already
+ * in the VG must call vg_drop_uuid_index().
+ * NULL is returned when an index cannot be used (i.e. duplicate uuids)
+ * and the caller should search the lists.
+ */
+struct radix_tree *vg_lv_uuids(const struct volume_group *vg);
+struct radix_tree *vg_pv_uuids(const struct volume_group *vg);
+void vg_drop_uuid_index(struct volume_group *vg);
+void vg_index_add_pv(struct volume_group *vg, struct pv_list *pvl);
+void vg_index_del_pv(struct volume_group *vg, struct pv_list *pvl);
+
 char *vg_fmt_dup(const struct volume_group *vg);
 char *vg_name_dup(const struct volume_group *vg);
 char *vg_system_id_dup(const struct volume_group *vg);
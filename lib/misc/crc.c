@@ -206,3 +206,61 @@ uint32_t calc_crc(uint32_t initial, const uint8_t *buf, uint32_t size)
 }
 
 #endif /* DEBUG_CRC32 */
+
+/*
+ * CRC combination, as in zlib's crc32_combine().
+ *
+ * calc_crc() is linear, so the CRC of A followed by B is the CRC of A
+ * advanced over len2 zero bytes, xored with the CRC of B from 0.
+ * Advancing over n zero bytes multiplies by x^(8n) modulo the CRC
+ * polynomial, which takes O(log n) polynomial multiplications using a
+ * table of x^(2^k).  Polynomials are bit reflected like the CRC, so
+ * x^0 is the top bit.
+ */
+#define CRC_POLY 0xedb88320
+
+static uint32_t _crc_x2n[32];
+
+static uint32_t _crc_multmodp(uint32_t a, uint32_t b)
+{
+	uint32_t m = UINT32_C(1) << 31;
+	uint32_t p = 0;
+
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if (!(a & (m - 1)))
+				break;
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC_POLY : b >> 1;
+	}
+
+	return p;
+}
+
+/* x^(n * 2^k) modulo the polynomial */
+static uint32_t _crc_x2nmodp(uint64_t n, unsigned k)
+{
+	uint32_t p = UINT32_C(1) << 31;	/* x^0 */
+	unsigned i;
+
+	if (!_crc_x2n[0]) {
+		p = UINT32_C(1) << 30;	/* x^1 */
+		_crc_x2n[0] = p;
+		for (i = 1; i < DM_ARRAY_SIZE(_crc_x2n); i++)
+			_crc_x2n[i] = p = _crc_multmodp(p, p);
+		p = UINT32_C(1) << 31;
+	}
+
+	for (; n; n >>= 1, k++)
+		if (n & 1)
+			p = _crc_multmodp(_crc_x2n[k & 31], p);
+
+	return p;
+}
+
+uint32_t calc_crc_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+	return _crc_multmodp(_crc_x2nmodp(len2, 3), crc1) ^ crc2;
+}
@@ -22,4 +22,11 @@
 
 uint32_t calc_crc(uint32_t initial, const uint8_t *buf, uint32_t size);
 
+/*
+ * Given crc1 = calc_crc(initial, A, len1) and crc2 = calc_crc(0, B, len2),
+ * return calc_crc(initial, A followed by B, len1 + len2) without
+ * reading A or B.
+ */
+uint32_t calc_crc_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
 #endif
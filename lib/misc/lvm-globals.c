@@ -23,6 +23,7 @@ static int _verbose_level = VERBOSE_BASE_LEVEL;
 static int _silent = 0;
 static int _test = 0;
 static int _use_aio = 0;
+static int _use_io_uring = 0;
 static int _md_filtering = 0;
 static int _internal_filtering = 0;
 static int _fwraid_filtering = 0;
@@ -45,6 +46,7 @@ static int _error_message_produced = 0;
 static unsigned _is_static = 0;
 static int _udev_checking = 1;
 static int _retry_deactivation = DEFAULT_RETRY_DEACTIVATION;
+static unsigned _udev_sync_timeout = DEFAULT_UDEV_SYNC_TIMEOUT;
 static int _activation_checks = 0;
 static uint64_t _pv_min_size = (DEFAULT_PV_MIN_SIZE_KB * 1024L >> DM_SECTOR_SHIFT);
 static const char *_unknown_device_name = DEFAULT_UNKNOWN_DEVICE_NAME;
@@ -72,6 +74,11 @@ void init_use_aio(int useaio)
 	_use_aio = useaio;
 }
 
+void init_use_io_uring(int useiouring)
+{
+	_use_io_uring = useiouring;
+}
+
 void init_md_filtering(int level)
 {
 	_md_filtering = level;
@@ -182,6 +189,11 @@ void init_retry_deactivation(int retry)
 	_retry_deactivation = retry;
 }
 
+void init_udev_sync_timeout(unsigned timeout)
+{
+	_udev_sync_timeout = timeout;
+}
+
 void init_activation_checks(int checks)
 {
 	if ((_activation_checks = checks))
@@ -235,6 +247,11 @@ int use_aio(void)
 	return _use_aio;
 }
 
+int use_io_uring(void)
+{
+	return _use_io_uring;
+}
+
 int md_filtering(void)
 {
 	return _md_filtering;
@@ -339,6 +356,11 @@ int retry_deactivation(void)
 	return _retry_deactivation;
 }
 
+unsigned udev_sync_timeout(void)
+{
+	return _udev_sync_timeout;
+}
+
 int activation_checks(void)
 {
 	return _activation_checks;
@@ -28,6 +28,7 @@ void init_verbose(int level);
 void init_silent(int silent);
 void init_test(int level);
 void init_use_aio(int useaio);
+void init_use_io_uring(int useiouring);
 void init_md_filtering(int level);
 void init_internal_filtering(int level);
 void init_fwraid_filtering(int level);
@@ -50,6 +51,7 @@ void init_udev_checking(int checking);
 void init_pv_min_size(uint64_t sectors);
 void init_activation_checks(int checks);
 void init_retry_deactivation(int retry);
+void init_udev_sync_timeout(unsigned timeout);
 void init_unknown_device_name(const char *name);
 void init_io_memory_size(int val);
 
@@ -58,6 +60,7 @@ const char *get_cmd_name(void);
 
 int test_mode(void);
 int use_aio(void);
+int use_io_uring(void);
 int md_filtering(void);
 int internal_filtering(void);
 int fwraid_filtering(void);
@@ -79,6 +82,7 @@ int udev_checking(void);
 uint64_t pv_min_size(void);
 int activation_checks(void);
 int retry_deactivation(void);
+unsigned udev_sync_timeout(void);
 const char *unknown_device_name(void);
 int io_memory_size(void);
 
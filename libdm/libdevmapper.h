@@ -3160,6 +3160,13 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
  */
 int dm_regex_match(struct dm_regex *regex, const char *s);
 
+/*
+ * Match each of num_strs strings against the patterns, storing what
+ * dm_regex_match would return for strs[i] in results[i].
+ */
+void dm_regex_match_many(struct dm_regex *regex, const char * const *strs,
+			 unsigned num_strs, int *results);
+
 /*
  * This is useful for regression testing only.  The idea is if two
  * fingerprints are different, then the two dfas are certainly not
@@ -4108,6 +4115,17 @@ int dm_udev_wait(uint32_t cookie);
  */
 int dm_udev_wait_immediate(uint32_t cookie, int *ready);
 
+/*
+ * dm_udev_wait_timeout
+ * As dm_udev_wait(), but stop waiting after timeout_ms (0 waits without
+ * a limit).  If udev did not finish in time, *ready is 0 on return and
+ * device nodes left to udev are created by the library directly, as with
+ * udev fallback.  The cookie is not removed then, as udev rules still
+ * complete it, 'dmsetup udevcomplete_all' cleans it up.
+ * Returns 0 on error.
+ */
+int dm_udev_wait_timeout(uint32_t cookie, unsigned timeout_ms, int *ready);
+
 #define DM_DEV_DIR_UMASK 0022
 #define DM_CONTROL_NODE_UMASK 0177
 
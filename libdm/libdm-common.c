@@ -30,6 +30,7 @@
 #  include <sys/ipc.h>
 #  include <sys/sem.h>
 #  include <libudev.h>
+#  include <time.h>
 #endif
 
 #ifdef __linux__
@@ -1667,19 +1668,23 @@ static int _stack_node_op(node_op_t type, const char *dev_name, uint32_t major,
 	return 1;
 }
 
-static void _pop_node_ops(void)
+/*
+ * With udev_timed_out, udev did not finish in time and the nodes
+ * left to it are processed here as well, without warning per node.
+ */
+static void _pop_node_ops(int udev_timed_out)
 {
 	struct dm_list *noph, *nopht;
 	struct node_op_parms *nop;
 
 	dm_list_iterate_safe(noph, nopht, &_node_ops) {
 		nop = dm_list_item(noph, struct node_op_parms);
-		if (!nop->rely_on_udev) {
+		if (!nop->rely_on_udev || udev_timed_out) {
 			_log_node_op("Processing", nop);
 			_do_node_op(nop->type, nop->dev_name, nop->major, nop->minor,
 				    nop->uid, nop->gid, nop->mode, nop->old_name,
 				    nop->read_ahead, nop->read_ahead_flags,
-				    nop->warn_if_udev_failed);
+				    udev_timed_out ? 0 : nop->warn_if_udev_failed);
 		} else
 			_log_node_op("Skipping", nop);
 		_del_node_op(nop);
@@ -1718,7 +1723,7 @@ int set_dev_node_read_ahead(const char *dev_name,
 
 void update_devs(void)
 {
-	_pop_node_ops();
+	_pop_node_ops(0);
 }
 
 static int _canonicalize_and_set_dir(const char *src, const char *suffix, size_t max_len, char *dir)
@@ -2379,6 +2384,14 @@ int dm_udev_wait_immediate(uint32_t cookie, int *ready)
 	return 1;
 }
 
+int dm_udev_wait_timeout(uint32_t cookie, unsigned timeout_ms, int *ready)
+{
+	update_devs();
+	*ready = 1;
+
+	return 1;
+}
+
 #else		/* UDEV_SYNC_SUPPORT */
 
 static int _check_semaphore_is_supported(void)
@@ -2809,11 +2822,14 @@ int dm_udev_complete(uint32_t cookie)
  * If *nowait is set, return immediately leaving it set if the semaphore
  * is not ready to be decremented to 0.  *nowait is cleared if the wait
  * succeeds.
+ * With timeout_ms, stop waiting after that time and set *nowait.  The
+ * semaphore is left for the udev rules still to decrement it.
  */
-static int _udev_wait(uint32_t cookie, int *nowait)
+static int _udev_wait(uint32_t cookie, int *nowait, unsigned timeout_ms)
 {
 	int semid;
 	struct sembuf sb = {0, 0, 0};
+	struct timespec deadline, now, left;
 	int val;
 
 	if (!cookie || !dm_udev_get_sync_support())
@@ -2849,12 +2865,41 @@ static int _udev_wait(uint32_t cookie, int *nowait)
 	log_debug_activation("Udev cookie 0x%" PRIx32 " (semid %d) waiting for zero",
 			     cookie, semid);
 
+	if (timeout_ms) {
+		(void) clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
 repeat_wait:
-	if (semop(semid, &sb, 1) < 0) {
+	if (timeout_ms) {
+		(void) clock_gettime(CLOCK_MONOTONIC, &now);
+		left.tv_sec = deadline.tv_sec - now.tv_sec;
+		left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+		if (left.tv_nsec < 0) {
+			left.tv_sec--;
+			left.tv_nsec += 1000000000;
+		}
+		if (left.tv_sec < 0)
+			left.tv_sec = left.tv_nsec = 0;
+	}
+
+	if ((timeout_ms ? semtimedop(semid, &sb, 1, &left) : semop(semid, &sb, 1)) < 0) {
 		if (errno == EINTR)
 			goto repeat_wait;
 		else if (errno == EIDRM)
 			return 1;
+		else if (errno == EAGAIN && timeout_ms) {
+			log_debug_activation("Udev cookie 0x%" PRIx32 " (semid %d) not "
+					     "ready after %u ms, not waiting further.",
+					     cookie, semid, timeout_ms);
+			*nowait = 1;
+			return 1;
+		}
 
 		log_error("Could not set wait state for notification semaphore "
 			  "identified by cookie value %" PRIu32 " (0x%x): %s",
@@ -2869,7 +2914,7 @@ repeat_wait:
 int dm_udev_wait(uint32_t cookie)
 {
 	int nowait = 0;
-	int r = _udev_wait(cookie, &nowait);
+	int r = _udev_wait(cookie, &nowait, 0);
 
 	update_devs();
 
@@ -2879,7 +2924,7 @@ int dm_udev_wait(uint32_t cookie)
 int dm_udev_wait_immediate(uint32_t cookie, int *ready)
 {
 	int nowait = 1;
-	int r = _udev_wait(cookie, &nowait);
+	int r = _udev_wait(cookie, &nowait, 0);
 
 	if (r && nowait) {
 		*ready = 0;
@@ -2891,4 +2936,16 @@ int dm_udev_wait_immediate(uint32_t cookie, int *ready)
 
 	return r;
 }
+
+int dm_udev_wait_timeout(uint32_t cookie, unsigned timeout_ms, int *ready)
+{
+	int nowait = 0;
+	int r = _udev_wait(cookie, &nowait, timeout_ms);
+
+	_pop_node_ops(nowait);
+
+	*ready = !nowait;
+
+	return r;
+}
 #endif		/* UDEV_SYNC_SUPPORT */
@@ -2114,6 +2114,12 @@ static int _reactivate_siblings(struct dm_tree_node *dnode,
 	return r;
 }
 
+/*
+ * Siblings are resumed one at a time, in order of activation priority.
+ * lvm builds one tree per LV, so a vgchange of many LVs gets nothing
+ * from running independent siblings in parallel here.
+ * FIXME Activate independent LVs in parallel in lvm instead.
+ */
 int dm_tree_activate_children(struct dm_tree_node *dnode,
 				 const char *uuid_prefix,
 				 size_t uuid_prefix_len)
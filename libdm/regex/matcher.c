@@ -18,11 +18,19 @@
 #include "ttree.h"
 #include "assert.h"
 
+/*
+ * Upper bound on the number of dfa states calculated up front by
+ * dm_regex_create().  Pattern sets with bigger dfas fall back to
+ * calculating the states on demand.
+ */
+#define DFA_MAX_EAGER_STATES 1024
+
 struct dfa_state {
 	struct dfa_state *next;
 	int final;
+	int max_final;		/* highest final reachable, complete dfa only */
 	dm_bitset_t bits;
-	struct dfa_state *lookup[256];
+	struct dfa_state *lookup[];	/* indexed by byte class */
 };
 
 struct dm_regex {		/* Instance variables for the lexer */
@@ -41,6 +49,17 @@ struct dm_regex {		/* Instance variables for the lexer */
         struct ttree *tt;
         dm_bitset_t bs;
         struct dfa_state *h, *t;
+
+	/*
+	 * Bytes that appear in exactly the same charsets can't be told
+	 * apart by the dfa, so transitions are stored per byte class.
+	 */
+	unsigned num_classes;
+	unsigned char classes[256];
+	unsigned char class_rep[256];	/* a byte of each class */
+
+	unsigned num_states;
+	int complete;		/* all states and transitions calculated */
 };
 
 static int _count_nodes(struct rx_node *rx)
@@ -203,9 +222,17 @@ static void _calc_functions(struct dm_regex *m)
 	}
 }
 
-static struct dfa_state *_create_dfa_state(struct dm_pool *mem)
+static struct dfa_state *_create_dfa_state(struct dm_regex *m)
 {
-	return dm_pool_zalloc(mem, sizeof(struct dfa_state));
+	struct dfa_state *dfa;
+
+	if (!(dfa = dm_pool_zalloc(m->mem, sizeof(*dfa) +
+				   sizeof(*dfa->lookup) * m->num_classes)))
+		return_NULL;
+
+	m->num_states++;
+
+	return dfa;
 }
 
 static struct dfa_state *_create_state_queue(struct dm_pool *mem,
@@ -237,26 +264,31 @@ static int _calc_state(struct dm_regex *m, struct dfa_state *dfa, int a)
                 set_bits = 1;
         }
 
+        /* no accepting transition, don't look again */
+        if ((a == TARGET_TRANS) && (dfa->final < 0))
+                dfa->final = 0;
+
         if (set_bits) {
                 struct dfa_state *tmp;
                 struct dfa_state *ldfa = ttree_lookup(m->tt, m->bs + 1);
                 if (!ldfa) {
-                        /* push */
-			if (!(ldfa = _create_dfa_state(m->mem)))
+                        /*
+                         * push, keeping every state chained from
+                         * m->start in order of creation
+                         */
+			if (!(ldfa = _create_dfa_state(m)))
 				return_0;
 
 			ttree_insert(m->tt, m->bs + 1, ldfa);
 			if (!(tmp = _create_state_queue(m->scratch, ldfa, m->bs)))
 				return_0;
+                        m->t->next = tmp;
+                        m->t = tmp;
                         if (!m->h)
-                                m->h = m->t = tmp;
-                        else {
-                                m->t->next = tmp;
-                                m->t = tmp;
-                        }
+                                m->h = tmp;
                 }
 
-                dfa->lookup[a] = ldfa;
+                dfa->lookup[m->classes[a]] = ldfa;
                 dm_bit_clear_all(m->bs);
         }
 
@@ -291,8 +323,21 @@ static int _calc_states(struct dm_regex *m, struct rx_node *rx)
                 }
         }
 
+        /* split the bytes into classes, TARGET_TRANS always has its own */
+        for (a = 0; a < 256; a++) {
+                for (i = 0; i < m->num_classes; i++)
+                        if (m->class_rep[i] != TARGET_TRANS &&
+                            dm_bitset_equal(m->charmap[a], m->charmap[m->class_rep[i]]))
+                                break;
+
+                if ((i == m->num_classes) || (a == TARGET_TRANS))
+                        m->class_rep[i = m->num_classes++] = a;
+
+                m->classes[a] = i;
+        }
+
 	/* create first state */
-	if (!(dfa = _create_dfa_state(m->mem)))
+	if (!(dfa = _create_dfa_state(m)))
 		return_0;
 
 	m->start = dfa;
@@ -311,27 +356,62 @@ static int _calc_states(struct dm_regex *m, struct rx_node *rx)
 /*
  * Forces all the dfa states to be calculated up front, ie. what
  * _calc_states() used to do before we switched to calculating on demand.
+ * Stops once more than max_states exist, if max_states is non-zero.
  */
-static int _force_states(struct dm_regex *m)
+static int _force_states(struct dm_regex *m, unsigned max_states)
 {
-        int a;
+        unsigned i;
 
         /* keep processing until there's nothing in the queue */
         struct dfa_state *s;
         while ((s = m->h)) {
+                if (max_states && (m->num_states > max_states))
+                        return 1;
+
                 /* pop state off front of the queue */
                 m->h = m->h->next;
 
-                /* iterate through all the inputs for this state */
+                /* iterate through all the input classes for this state */
                 dm_bit_clear_all(m->bs);
-                for (a = 0; a < 256; a++)
-			if (!_calc_state(m, s, a))
+                for (i = 0; i < m->num_classes; i++)
+			if (!_calc_state(m, s, m->class_rep[i]))
 				return_0;
         }
 
         return 1;
 }
 
+/*
+ * With the complete dfa, work out the highest final each state can
+ * still reach, so matching can stop as soon as the result is settled.
+ */
+static void _calc_max_finals(struct dm_regex *m)
+{
+	unsigned target = m->classes[TARGET_TRANS];
+	struct dfa_state *s, *ns;
+	unsigned i;
+	int changed;
+
+	do {
+		changed = 0;
+		for (s = m->start; s; s = s->next)
+			for (i = 0; i < m->num_classes; i++) {
+				if ((i == target) || !(ns = s->lookup[i]))
+					continue;
+
+				if (ns->final > s->max_final) {
+					s->max_final = ns->final;
+					changed = 1;
+				}
+
+				if (ns->max_final > s->max_final) {
+					s->max_final = ns->max_final;
+					changed = 1;
+				}
+			}
+	} while (changed);
+}
+
 struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patterns,
 				 unsigned num_patterns)
 {
@@ -387,6 +467,20 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
 	if (!_calc_states(m, rx))
 		goto_bad;
 
+	/* most filters give small dfas, calculate them in full */
+	if (!_force_states(m, DFA_MAX_EAGER_STATES))
+		goto_bad;
+
+	/* an empty queue means every state is known */
+	if (!m->h) {
+		_calc_max_finals(m);
+		m->complete = 1;
+	}
+
+	log_debug("Regex matcher with %u patterns has %u byte classes and %u%s states.",
+		  num_patterns, m->num_classes, m->num_states,
+		  m->complete ? "" : "+");
+
 	return m;
 
       bad:
@@ -399,11 +493,11 @@ static struct dfa_state *_step_matcher(struct dm_regex *m, int c, struct dfa_sta
 {
         struct dfa_state *ns;
 
-	if (!(ns = cs->lookup[(unsigned char) c])) {
+	if (!(ns = cs->lookup[m->classes[(unsigned char) c]])) {
 		if (!_calc_state(m, cs, (unsigned char) c))
                         return_NULL;
 
-		if (!(ns = cs->lookup[(unsigned char) c]))
+		if (!(ns = cs->lookup[m->classes[(unsigned char) c]]))
 			return NULL;
 	}
 
@@ -418,11 +512,52 @@ static struct dfa_state *_step_matcher(struct dm_regex *m, int c, struct dfa_sta
 	return ns;
 }
 
+/*
+ * Matching against a complete dfa never needs to calculate anything.
+ * A missing transition is a dead state and once no reachable state has
+ * a higher final than already seen the rest of the string is skipped.
+ */
+static int _match_complete(const struct dm_regex *regex, const char *s)
+{
+	const unsigned char *c = (const unsigned char *) s;
+	const unsigned char *classes = regex->classes;
+	const struct dfa_state *cs;
+	int r = 0;
+
+	if (!(cs = regex->start->lookup[classes[HAT_CHAR]]))
+		goto out;
+
+	r = cs->final;
+
+	for (; *c; c++) {
+		if (cs->max_final <= r)
+			goto out;
+
+		if (!(cs = cs->lookup[classes[*c]]))
+			goto out;
+
+		if (cs->final > r)
+			r = cs->final;
+	}
+
+	if ((cs->max_final > r) &&
+	    (cs = cs->lookup[classes[DOLLAR_CHAR]]) &&
+	    (cs->final > r))
+		r = cs->final;
+
+      out:
+	/* subtract 1 to get back to zero index */
+	return r - 1;
+}
+
 int dm_regex_match(struct dm_regex *regex, const char *s)
 {
 	struct dfa_state *cs = regex->start;
 	int r = 0;
 
+	if (regex->complete)
+		return _match_complete(regex, s);
+
         dm_bit_clear_all(regex->bs);
 	if (!(cs = _step_matcher(regex, HAT_CHAR, cs, &r)))
 		goto out;
@@ -438,6 +573,21 @@ int dm_regex_match(struct dm_regex *regex, const char *s)
 	return r - 1;
 }
 
+void dm_regex_match_many(struct dm_regex *regex, const char * const *strs,
+			 unsigned num_strs, int *results)
+{
+	unsigned i;
+
+	if (regex->complete) {
+		for (i = 0; i < num_strs; i++)
+			results[i] = _match_complete(regex, strs[i]);
+		return;
+	}
+
+	for (i = 0; i < num_strs; i++)
+		results[i] = dm_regex_match(regex, strs[i]);
+}
+
 /*
  * The next block of code concerns calculating a fingerprint for the dfa.
  *
@@ -461,6 +611,7 @@ struct printer {
         struct node_list *pending;
         struct node_list *processed;
         unsigned next_index;
+        const unsigned char *classes;
 };
 
 static uint32_t _randomise(uint32_t n)
@@ -541,7 +692,7 @@ static uint32_t _fingerprint(struct printer *p)
                 result = _combine(result, (node->final < 0) ? 0 : node->final);
                 for (c = 0; c < 256; c++)
                         result = _combine(result,
-                                          _push_node(p, node->lookup[c]));
+                                          _push_node(p, node->lookup[p->classes[c]]));
         }
 
         return result;
@@ -556,13 +707,14 @@ uint32_t dm_regex_fingerprint(struct dm_regex *regex)
 	if (!mem)
 		return_0;
 
-	if (!_force_states(regex))
+	if (!_force_states(regex, 0))
 		goto_out;
 
         p.mem = mem;
         p.pending = NULL;
         p.processed = NULL;
         p.next_index = 0;
+        p.classes = regex->classes;
 
 	if (!_push_node(&p, regex->start))
 		goto_out;
@@ -27,6 +27,9 @@ struct ttree {
 	struct node *root;
 };
 
+/*
+ * Find the node holding k at this level, or the slot to put it in.
+ */
 __attribute__((nonnull(1)))
 static struct node **_lookup_single(struct node **c, unsigned int k)
 {
@@ -37,10 +40,8 @@ static struct node **_lookup_single(struct node **c, unsigned int k)
 		else if (k > (*c)->k)
 			c = &((*c)->r);
 
-		else {
-			c = &((*c)->m);
+		else
 			break;
-		}
 	}
 
 	return c;
@@ -51,12 +52,18 @@ void *ttree_lookup(struct ttree *tt, unsigned *key)
 	struct node **c = &tt->root;
 	int count = tt->klen;
 
-	while (*c && count) {
+	while (*c) {
 		c = _lookup_single(c, *key++);
-		count--;
+		if (!*c)
+			break;
+
+		if (!--count)
+			return (*c)->data;
+
+		c = &((*c)->m);
 	}
 
-	return *c ? (*c)->data : NULL;
+	return NULL;
 }
 
 static struct node *_tree_node(struct dm_pool *mem, unsigned int k)
@@ -69,30 +76,27 @@ static struct node *_tree_node(struct dm_pool *mem, unsigned int k)
 	return n;
 }
 
+/*
+ * The data lives in the node for the last element of the key, the
+ * same node ttree_lookup() finishes on.
+ */
 int ttree_insert(struct ttree *tt, unsigned int *key, void *data)
 {
 	struct node **c = &tt->root;
 	int count = tt->klen;
-	unsigned int k;
-
-	do {
-		k = *key++;
-		c = _lookup_single(c, k);
-		count--;
 
-	} while (*c && count);
+	while (1) {
+		c = _lookup_single(c, *key);
+		if (!*c && !(*c = _tree_node(tt->mem, *key)))
+			return_0;
 
-	if (!*c) {
-		do {
-			if (!(*c = _tree_node(tt->mem, k)))
-				return_0;
+		key++;
+		if (!--count)
+			break;
 
-			if (count) {
-				k = *key++;
-				c = &((*c)->m);
-			}
-		} while (count--);
+		c = &((*c)->m);
 	}
+
 	(*c)->data = data;
 
 	return 1;
@@ -131,8 +131,9 @@ prepare_lvmlockd() {
 
 	if [[ "${LVM_TEST_LOCK_TYPE_SANLOCK:-0}" != 0 ]]; then
 		# make check_lvmlockd_sanlock
+		# LVM_TEST_LVMLOCKD_LV_WORKERS=N runs the suite with lv workers
 		echo "Starting lvmlockd for sanlock."
-		lvmlockd -o 2
+		lvmlockd -o 2 ${LVM_TEST_LVMLOCKD_LV_WORKERS:+--lv-workers "$LVM_TEST_LVMLOCKD_LV_WORKERS"}
 
 	elif [[ "${LVM_TEST_LOCK_TYPE_DLM:-0}" != 0 ]]; then
 		# make check_lvmlockd_dlm
@@ -152,7 +153,7 @@ prepare_lvmlockd() {
 	elif [[ "${LVM_TEST_LVMLOCKD_TEST_SANLOCK:-0}" != 0 ]]; then
 		# FIXME: add option for this combination of --test and sanlock
 		echo "Starting lvmlockd --test (sanlock)."
-		lvmlockd --test -g sanlock -o 2
+		lvmlockd --test -g sanlock -o 2 ${LVM_TEST_LVMLOCKD_LV_WORKERS:+--lv-workers "$LVM_TEST_LVMLOCKD_LV_WORKERS"}
 
 	elif [[ "${LVM_TEST_LVMLOCKD_TEST_IDM:-0}" != 0 ]]; then
 		# make check_lvmlockd_test
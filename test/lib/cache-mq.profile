@@ -0,0 +1 @@
+/root/repo/conf/cache-mq.profile
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/conf/cache-smq.profile
\ No newline at end of file
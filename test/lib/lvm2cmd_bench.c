@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Run one lvm command many times through a single liblvm2cmd handle,
+ * the way a management agent does, and print the time taken.
+ *
+ * Usage: lvm2cmd_bench <count> <command>
+ */
+
+#include "tools/lvm2cmd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static void _log_fn(int level, const char *file, int line,
+		    int dm_errno, const char *message)
+{
+	/* Only errors, the command output is not of interest. */
+	if (level <= LVM2_LOG_ERROR)
+		fprintf(stderr, "%s\n", message);
+}
+
+static double _now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	void *handle;
+	double start, elapsed;
+	unsigned i, count;
+	int r = 0;
+
+	if (argc != 3 || !(count = strtoul(argv[1], NULL, 10))) {
+		fprintf(stderr, "Usage: %s <count> <command>\n", argv[0]);
+		return 2;
+	}
+
+	lvm2_log_fn(_log_fn);
+
+	if (!(handle = lvm2_init())) {
+		fprintf(stderr, "lvm2_init failed.\n");
+		return 1;
+	}
+
+	start = _now();
+	for (i = 0; i < count; i++)
+		if (lvm2_run(handle, argv[2]) != LVM2_COMMAND_SUCCEEDED) {
+			fprintf(stderr, "Command %u failed: %s\n", i, argv[2]);
+			r = 1;
+			break;
+		}
+	elapsed = _now() - start;
+
+	lvm2_exit(handle);
+
+	printf("%u x %s: %.3f s, %.3f ms per command\n",
+	       i, argv[2], elapsed, elapsed * 1000.0 / (i ? i : 1));
+
+	return r;
+}
@@ -0,0 +1 @@
+/root/repo/conf/thin-performance.profile
\ No newline at end of file
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Compare repeated commands through liblvm2cmd with and without
+# devices/update_device_list_from_events.
+
+
+. lib/inittest --skip-with-lvmpolld --skip-with-lvmlockd
+
+which lvm2cmd_bench || skip
+
+aux prepare_vg 3
+
+lvcreate -l1 -n $lv1 $vg
+
+aux lvmconf "devices/update_device_list_from_events = 0"
+lvm2cmd_bench 1000 "lvs $vg" | tee without
+
+aux lvmconf "devices/update_device_list_from_events = 1"
+lvm2cmd_bench 1000 "lvs $vg" | tee with
+
+vgremove -ff $vg
@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='devices file with many entries'
+
+
+. lib/inittest --skip-with-lvmpolld
+
+aux prepare_devs 3
+
+DFDIR="$LVM_SYSTEM_DIR/devices"
+mkdir -p "$DFDIR" || true
+DF="$DFDIR/system.devices"
+
+aux lvmconf 'devices/use_devicesfile = 1'
+
+rm -f "$DF"
+touch "$DF"
+pvcreate "$dev1"
+pvcreate "$dev2"
+vgcreate $vg1 "$dev1" "$dev2"
+
+PVID1=$(get pv_field "$dev1" uuid | tr -d - )
+PVID2=$(get pv_field "$dev2" uuid | tr -d - )
+
+# Entries for devices that do not exist, using both idtypes
+# that are looked up by name.
+for i in $(seq 1 2000); do
+	printf "IDTYPE=sys_wwid IDNAME=naa.600508b1001c%016x DEVNAME=/dev/sdx%d PVID=%032d\n" "$i" "$i" "$i"
+	printf "IDTYPE=devname IDNAME=/dev/sdy%d DEVNAME=/dev/sdy%d PVID=%032d\n" "$i" "$i" "$((i + 100000))"
+done >> "$DF"
+cp "$DF" df.large
+
+# The real entries are still matched among the missing ones.
+time pvs -o+uuid
+check pv_field "$dev1" vg_name $vg1
+check pv_field "$dev2" vg_name $vg1
+not pvs "$dev3"
+
+lvmdevices > out
+grep "$PVID1" out
+grep "$PVID2" out
+grep "DEVNAME=/dev/sdx1000 " out
+grep "DEVNAME=/dev/sdy2000 " out
+
+# Adding an entry is seen by later lookups in the same file.
+lvmdevices --adddev "$dev3"
+grep "$dev3" "$DF"
+pvcreate "$dev3"
+PVID3=$(get pv_field "$dev3" uuid | tr -d - )
+grep "$PVID3" "$DF"
+vgextend $vg1 "$dev3"
+check pv_field "$dev3" vg_name $vg1
+
+# Removing entries by pvid and by name.
+vgreduce $vg1 "$dev3"
+pvremove "$dev3"
+lvmdevices --deldev "$dev3"
+not grep "$dev3" "$DF"
+lvmdevices --delpvid "$(printf %032d 1)"
+not grep "DEVNAME=/dev/sdx1 " "$DF"
+grep "DEVNAME=/dev/sdx2 " "$DF"
+lvmdevices --deldev /dev/sdy1999
+not grep "DEVNAME=/dev/sdy1999 " "$DF"
+grep "DEVNAME=/dev/sdy1998 " "$DF"
+
+# Entries are unchanged otherwise.
+test "$(grep -c IDTYPE "$DF")" -eq "$(( $(grep -c IDTYPE df.large) - 2 ))"
+
+time pvs
+check pv_field "$dev1" vg_name $vg1
+check pv_field "$dev2" vg_name $vg1
+
+vgremove -ff $vg1
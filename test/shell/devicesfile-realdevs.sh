@@ -45,6 +45,7 @@ _clear_online_files() {
 	# wait till udev is finished
 	aux udev_wait
 	rm -f "$PVS_ONLINE_DIR"/*
+	rm -f "$RUNDIR/lvm/pvs_online_table"
 	rm -f "$VGS_ONLINE_DIR"/*
 	rm -f "$PVS_LOOKUP_DIR"/*
 }
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='dmeventd monitors mirrors and thin pools with shared worker threads'
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux driver_at_least 4 37 || skip "Kernel cannot poll for device events."
+aux have_thin 1 0 0 || skip
+
+LOG="$TESTDIR/command.log"
+
+dmeventd_threads_() {
+	local pid
+	read -r pid < LOCAL_DMEVENTD
+	awk '/^Threads:/ { print $2 }' "/proc/$pid/status"
+}
+
+dmeventd_zombies_() {
+	local pid
+	read -r pid < LOCAL_DMEVENTD
+	ps --ppid "$pid" -o stat= | grep -c Z || true
+}
+
+cat > command.sh << EOF
+#!/bin/bash
+echo "COMMAND executed for \$1" >> "$LOG"
+EOF
+chmod +x command.sh
+
+aux lvmconf "activation/thin_pool_autoextend_percent = 10" \
+	    "activation/thin_pool_autoextend_threshold = 70" \
+	    "dmeventd/thin_command = \"$PWD/command.sh\""
+
+aux prepare_dmeventd
+aux prepare_vg 3 64
+
+# Mirrors are monitored by the shared workers, not a thread each
+lvcreate -aey --type mirror -m 1 --nosync -l1 -n mirror0 $vg
+BEFORE=$(dmeventd_threads_)
+for i in $(seq 1 8); do
+	lvcreate -aey --type mirror -m 1 --nosync -l1 -n mirror$i $vg
+done
+AFTER=$(dmeventd_threads_)
+test "$AFTER" -lt $(( BEFORE + 8 )) || die "Thread per mirror: $BEFORE -> $AFTER"
+
+# Thin pool is monitored by the workers too
+lvcreate --monitor y -L12M -V12M -n $lv1 -T $vg/pool
+test "$(dmeventd_threads_)" -lt $(( AFTER + 2 )) || die "Thread for thin pool"
+
+# thin_command child is reaped on the next timeout (10s), not left a zombie
+> "$LOG"
+dd if=/dev/zero of="$DM_DEV_DIR/$vg/$lv1" bs=1M count=9 oflag=direct
+for i in $(seq 1 30); do
+	grep -q "COMMAND executed" "$LOG" && break
+	sleep 1
+done
+grep "COMMAND executed" "$LOG"
+for i in $(seq 1 15); do
+	test "$(dmeventd_zombies_)" -eq 0 && break
+	sleep 1
+done
+test "$(dmeventd_zombies_)" -eq 0
+
+vgremove -ff $vg
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test devices/filter_cache saving filter results across commands.
+
+
+. lib/inittest --skip-with-lvmpolld --skip-with-lvmlockd
+
+RUNDIR="/run"
+test -d "$RUNDIR" || RUNDIR="/var/run"
+FILTERCACHE="$RUNDIR/lvm/filtercache"
+
+aux prepare_devs 3
+aux lvmconf "devices/filter_cache = 1"
+
+rm -f "$FILTERCACHE"
+
+pvcreate "$dev1" "$dev2"
+pvs
+test -f "$FILTERCACHE"
+grep "^config_hash: " "$FILTERCACHE"
+
+# The test devices are dm devices, which are always checked, so
+# only the other devices (e.g. the backing loop device) are saved.
+pvs -vvvv 2>&1 | tee out
+grep "Filter cache used" out
+not grep "$dev1: filter cache using saved" out
+pvs "$dev1" "$dev2"
+
+# A different filter does not use the file.
+aux lvmconf "devices/filter = [ \"r|$dev2|\", \"a|.*|\" ]"
+pvs -vvvv 2>&1 | tee out
+grep "Ignoring filter cache for different config" out
+not grep "filter cache using saved" out
+not pvs "$dev2" 2>&1 | tee err
+grep "rejected by filter" err
+
+aux lvmconf "devices/filter = [ \"a|.*|\" ]"
+pvs "$dev1" "$dev2"
+
+# Data filters are still checked.
+aux wipefs_a "$dev3"
+pvcreate "$dev3"
+pvs "$dev3"
+
+pvremove "$dev1" "$dev2" "$dev3"
+rm -f "$FILTERCACHE"
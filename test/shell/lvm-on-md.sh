@@ -26,6 +26,7 @@ _clear_online_files() {
         # wait till udev is finished
         aux udev_wait
         rm -f "$PVS_ONLINE_DIR"/* "$VGS_ONLINE_DIR"/*
+        rm -f "$RUNDIR/lvm/pvs_online_table"
 }
 
 
@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='acquire sanlock leases for many LVs with one lvmlockd request'
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+[[ "${LVM_TEST_LVMLOCKD:-0}" = 0 ]] && skip
+[[ "${LVM_TEST_LOCK_TYPE_SANLOCK:-0}" = 0 ]] && skip
+
+aux prepare_devs 1 1024
+
+LVS=100
+
+vgcreate $SHARED $vg "$dev1"
+for i in $(seq 1 $LVS); do
+	lvcreate -an -l1 -n "lv$i" $vg
+done
+
+_activate() {
+	local start end
+
+	start=$(date +%s%N)
+	vgchange -vvvv "$@" $vg 2> debug.log
+	end=$(date +%s%N)
+	echo "Locked $LVS LVs at $(( LVS * 1000000000 / (end - start + 1) )) leases/s" "$@"
+
+	check lv_field $vg/lv1 lv_active "active"
+	check lv_field $vg/lv$LVS lv_active "active"
+}
+
+# Exclusive leases are acquired in batches of up to 64 LVs.
+_activate -ay
+grep "lockd_lv_batch ex $vg locked 64 of 64 LVs" debug.log
+test "$(grep -c "locked by batch" debug.log)" -eq $LVS
+vgchange -an $vg
+
+# Shared leases.
+_activate -asy
+test "$(grep -c "lockd_lv sh .* locked by batch" debug.log)" -eq $LVS
+vgchange -an $vg
+
+# An LV that is already locked is locked on its own again.
+lvchange -aey $vg/lv1
+_activate -aey
+test "$(grep -c "locked by batch" debug.log)" -eq $(( LVS - 1 ))
+vgchange -an $vg
+
+vgremove -ff $vg
@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='report LV status read for the whole VG at once'
+
+
+. lib/inittest --skip-with-lvmpolld
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_vg 2 64
+
+lvcreate -L8M -T $vg/pool
+for i in $(seq 1 40); do
+	lvcreate -V4M -n thin$i -T $vg/pool
+done
+lvcreate -L4M -n $lv1 $vg
+lvcreate -L4M -n $lv2 -an $vg
+
+# Some data in the pool and in one thin LV.
+dd if=/dev/zero of="$DM_DEV_DIR/$vg/thin1" bs=1M count=2 oflag=direct
+
+FIELDS="lv_name,lv_attr,lv_active,lv_size,data_percent,metadata_percent,seg_start,seg_size,lv_read_ahead"
+
+lvs -a --segments -o $FIELDS --config 'report/status_workers = 0' $vg > noprefetch
+lvs -a --segments -o $FIELDS --config 'report/status_workers = 1' $vg > prefetch1
+lvs -a --segments -o $FIELDS --config 'report/status_workers = 8' $vg > prefetch8
+diff noprefetch prefetch1
+diff noprefetch prefetch8
+
+# The same values come from one read of the VG.
+lvs -a -o $FIELDS -vvvv --config 'report/status_workers = 8' $vg > out 2> err
+diff <(lvs -a -o $FIELDS --config 'report/status_workers = 0' $vg) out
+grep "Prefetched status of" err
+not grep "Prefetched status of" <(lvs -vvvv $vg/thin1 2>&1)
+
+check lv_field $vg/thin1 data_percent "50.00"
+check lv_field $vg/$lv2 lv_active ""
+
+vgremove -ff $vg
@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Check metadata writes to all PVs of a VG are issued together,
+# so a commit to slow PVs takes about one write latency per step.
+
+. lib/inittest --skip-with-lvmlockd
+
+aux prepare_vg 10
+
+aux delay_dev "$dev1" 0 200
+test -f HAVE_DM_DELAY || { aux enable_dev "$dev1"; skip "delay_dev is missing"; }
+for d in "$dev2" "$dev3" "$dev4" "$dev5" "$dev6" "$dev7" "$dev8" "$dev9" "$dev10"; do
+	aux delay_dev "$d" 0 200
+done
+
+# vg_write, precommit and commit each write to all 10 PVs, which takes
+# 6s when the writes are done one device at a time.
+START=$(date +%s)
+lvcreate -an -Zn -l1 -n $lv1 $vg
+END=$(date +%s)
+DURATION=$(( END - START ))
+echo "lvcreate took $DURATION seconds"
+test "$DURATION" -lt 3
+
+aux enable_dev "$dev1" "$dev2" "$dev3" "$dev4" "$dev5" "$dev6" "$dev7" "$dev8" "$dev9" "$dev10"
+
+check lv_exists $vg $lv1
+vgck $vg
+
+vgremove -ff $vg
@@ -0,0 +1,64 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='binary metadata cache does not hide metadata text on disk'
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+RUNDIR="/run"
+test -d "$RUNDIR" || RUNDIR="/var/run"
+CACHEDIR="$RUNDIR/lvm/metadata_cache"
+
+aux lvmconf 'metadata/binary_cache = 1'
+
+aux prepare_devs 3
+get_devs
+
+rm -f "$CACHEDIR/$vg" "$CACHEDIR/$vg1" "$CACHEDIR/$vg2"
+
+vgcreate $SHARED $vg "$dev1" "$dev2"
+lvcreate -an -Zn -l1 -n $lv1 $vg
+vgs $vg
+test -f "$CACHEDIR/$vg"
+
+vgs -vvvv $vg 2> debug.log
+grep "Using metadata cache for VG $vg" debug.log
+
+# Damaged text is found although the cache matches the mda_header.
+dd if="$dev1" of=meta1 bs=4k count=2
+sed 's/flags =/flagx =/' meta1 > meta1.bad
+dd if=meta1.bad of="$dev1"
+
+vgs $vg 2>&1 | tee out
+grep "Checksum error" out
+
+vgck --updatemetadata $vg
+vgs $vg 2>&1 | tee out
+not grep "Checksum error" out
+
+# Cache files follow the VG name.
+vgrename $vg $vg1
+not ls "$CACHEDIR/$vg"
+vgs $vg1
+test -f "$CACHEDIR/$vg1"
+
+vgcreate $SHARED $vg2 "$dev3"
+vgs $vg2
+test -f "$CACHEDIR/$vg2"
+vgmerge $vg1 $vg2
+not ls "$CACHEDIR/$vg2"
+check pv_field "$dev3" vg_name $vg1
+
+vgremove -ff $vg1
+not ls "$CACHEDIR/$vg1"
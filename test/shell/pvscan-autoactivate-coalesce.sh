@@ -0,0 +1,155 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='coalesced pvscan autoactivation'
+
+
+RUNDIR="/run"
+test -d "$RUNDIR" || RUNDIR="/var/run"
+PVS_ONLINE_DIR="$RUNDIR/lvm/pvs_online"
+VGS_ONLINE_DIR="$RUNDIR/lvm/vgs_online"
+PVS_LOOKUP_DIR="$RUNDIR/lvm/pvs_lookup"
+PVS_QUEUE_DIR="$RUNDIR/lvm/pvs_queue"
+PVS_ONLINE_TABLE="$RUNDIR/lvm/pvs_online_table"
+
+# FIXME: kills logic for running system
+_clear_online_files() {
+	# wait till udev is finished
+	aux udev_wait
+	rm -f "$PVS_ONLINE_DIR"/*
+	rm -f "$PVS_ONLINE_TABLE"
+	rm -f "$VGS_ONLINE_DIR"/*
+	rm -f "$PVS_LOOKUP_DIR"/*
+}
+
+. lib/inittest --skip-with-lvmpolld
+
+aux prepare_devs 16
+
+aux lvmconf "global/event_activation = 1" \
+	    "global/event_activation_coalesce = 500"
+
+for i in 1 2 3 4; do
+	vg="${PREFIX}vg$i"
+	vgcreate $SHARED "$vg" "${DEVICES[@]:$(( (i - 1) * 4 )):4}"
+	lvcreate -n $lv1 -l 4 -an "$vg"
+done
+
+test -d "$PVS_ONLINE_DIR" || mkdir -p "$PVS_ONLINE_DIR"
+test -d "$VGS_ONLINE_DIR" || mkdir -p "$VGS_ONLINE_DIR"
+test -d "$PVS_LOOKUP_DIR" || mkdir -p "$PVS_LOOKUP_DIR"
+_clear_online_files
+
+# A burst of uevents, with each device reported several times,
+# as when storage is attached at boot.
+for n in $(seq 0 199); do
+	pvscan --cache -aay "${DEVICES[$(( n % 16 ))]}" > "pvscan$n.out" 2>&1 &
+done
+wait
+
+cat pvscan*.out
+
+for i in 1 2 3 4; do
+	vg="${PREFIX}vg$i"
+	check lv_field "$vg/$lv1" lv_active "active"
+	# Each VG is autoactivated once.
+	test "$(cat pvscan*.out | grep -c "VG $vg run autoactivation")" -eq 1
+done
+
+# Most pvscans let another one scan their device.
+test "$(cat pvscan*.out | grep -c "taken by another pvscan")" -gt 0
+
+# Nothing is left in the queue.
+test "$(ls "$PVS_QUEUE_DIR")" = ""
+
+vgchange -an
+
+# The pvscans run by the lvm udev rule are coalesced too: the VGs
+# completed by all the devices are reported once, and a pvscan
+# whose devices were taken prints nothing.
+_clear_online_files
+for n in $(seq 0 199); do
+	pvscan --cache --listvg --checkcomplete --vgonline --autoactivation event \
+		--udevoutput "${DEVICES[$(( n % 16 ))]}" > "udev$n.out" &
+done
+wait
+
+cat udev*.out
+not grep "LVM_VG_NAME_INCOMPLETE" udev*.out
+test "$(grep -l . udev*.out | wc -l)" -lt 200
+
+# Run the vgchange of the udev rule for each reply.
+for f in udev*.out; do
+	unset LVM_VG_NAME_COMPLETE LVM_VG_NAMES_COALESCED
+	. "./$f"
+	test -n "$LVM_VG_NAME_COMPLETE" || continue
+	echo $LVM_VG_NAME_COMPLETE $LVM_VG_NAMES_COALESCED >> udev_vgs
+	vgchange -aay --autoactivation event $LVM_VG_NAME_COMPLETE $LVM_VG_NAMES_COALESCED
+done
+
+for i in 1 2 3 4; do
+	vg="${PREFIX}vg$i"
+	check lv_field "$vg/$lv1" lv_active "active"
+	# Each VG is reported once.
+	test "$(tr ' ' '\n' < udev_vgs | grep -c "^$vg\$")" -eq 1
+done
+
+test "$(ls "$PVS_QUEUE_DIR")" = ""
+
+vgchange -an
+
+# Without coalescing, each pvscan scans its own device.
+_clear_online_files
+for n in $(seq 0 15); do
+	pvscan --cache -aay --config "global/event_activation_coalesce = 0" "${DEVICES[$n]}" > "nocoalesce$n.out" 2>&1 &
+done
+wait
+
+cat nocoalesce*.out
+not grep "taken by another pvscan" nocoalesce*.out
+
+for i in 1 2 3 4; do
+	vg="${PREFIX}vg$i"
+	check lv_field "$vg/$lv1" lv_active "active"
+done
+
+vgchange -an
+
+# The online table is the reference: removing only the pvs_online
+# files does not take the PVs offline.
+test -f "$PVS_ONLINE_TABLE"
+_clear_online_files
+pvscan --cache "$dev1" "$dev2" "$dev3"
+test -f "$PVS_ONLINE_DIR/$(get pv_field "$dev1" uuid | tr -d - )"
+test "$(ls "$PVS_ONLINE_DIR" | wc -l)" -eq 3
+rm -f "$PVS_ONLINE_DIR"/*
+pvscan --cache -aay "$dev4" 2>&1 | tee out
+grep "is complete" out
+check lv_field "${PREFIX}vg1/$lv1" lv_active "active"
+
+vgchange -an
+
+# The counts of the table find the VG incomplete.
+_clear_online_files
+pvscan --cache -aay "$dev1" "$dev2" 2>&1 | tee out
+grep "incomplete (need 2)" out
+
+# Without the table, it is built again from the pvs_online files.
+rm -f "$PVS_ONLINE_TABLE"
+pvscan --cache -aay "$dev3" "$dev4" 2>&1 | tee out
+grep "is complete" out
+check lv_field "${PREFIX}vg1/$lv1" lv_active "active"
+
+vgchange -an
+_clear_online_files
+
+vgremove -ff "${PREFIX}vg1" "${PREFIX}vg2" "${PREFIX}vg3" "${PREFIX}vg4"
@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='scan cache entries are never used for changed metadata'
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+RUNDIR="/run"
+test -d "$RUNDIR" || RUNDIR="/var/run"
+SCANCACHE="$RUNDIR/lvm/scancache"
+
+aux lvmconf 'devices/hints = "none"' \
+	    'devices/scan_cache = 1'
+
+aux prepare_devs 4
+
+# Reports using the scan cache must match reports reading all metadata.
+_check() {
+	pvs -a -o pv_name,vg_name,pv_uuid,pv_mda_count > out1
+	vgs -o vg_name,vg_uuid,pv_count,lv_count,vg_seqno,vg_tags >> out1
+	pvs -a -o pv_name,vg_name,pv_uuid,pv_mda_count --config "devices/scan_cache = 0" > out0
+	vgs -o vg_name,vg_uuid,pv_count,lv_count,vg_seqno,vg_tags --config "devices/scan_cache = 0" >> out0
+	diff out0 out1
+}
+
+rm -f "$SCANCACHE"
+
+pvcreate "$dev1" "$dev2" "$dev3"
+vgcreate $vg1 "$dev1" "$dev2"
+_check
+test -f "$SCANCACHE"
+grep "checksum:" "$SCANCACHE"
+
+# Unchanged metadata is taken from the scan cache.
+pvs -vvvv 2> debug.log
+grep "Skipping read of VG metadata with matching mda checksum in scan cache" debug.log
+
+# Metadata changes.
+vgextend $vg1 "$dev3"
+_check
+lvcreate -an -Zn -l1 -n $lv1 $vg1
+_check
+vgchange --addtag foo $vg1
+_check
+vgreduce $vg1 "$dev3"
+_check
+
+# New PV on a device with cached entries.
+vgcreate $vg2 "$dev3"
+_check
+vgremove -ff $vg2
+pvremove "$dev3"
+_check
+pvcreate "$dev3"
+vgcreate $vg2 "$dev3" "$dev4"
+_check
+
+# A different device takes over the device numbers of dev1 and dev3.
+pvs
+dmsetup load "$dev1" "${dev3##*/}.table"
+dmsetup load "$dev3" "${dev1##*/}.table"
+dmsetup resume "$dev1"
+dmsetup resume "$dev3"
+pvs -o pv_name,vg_name > out
+grep "$dev1" out | grep $vg2
+grep "$dev3" out | grep $vg1
+_check
+
+dmsetup load "$dev1" "${dev1##*/}.table"
+dmsetup load "$dev3" "${dev3##*/}.table"
+dmsetup resume "$dev1"
+dmsetup resume "$dev3"
+_check
+
+# A damaged or truncated file is ignored and replaced.
+sed -i -e "s/=$vg1 /=${vg1}x /" "$SCANCACHE"
+pvs -vvvv 2> debug.log
+grep "Ignoring scan cache with wrong checksum" debug.log
+not grep "${vg1}x" "$SCANCACHE"
+_check
+
+head -c 200 "$SCANCACHE" > scancache.part
+cp scancache.part "$SCANCACHE"
+pvs -vvvv 2> debug.log
+grep "Ignoring scan cache with wrong checksum" debug.log
+_check
+
+echo garbage > "$SCANCACHE"
+pvs -vvvv 2> debug.log
+grep "Ignoring scan cache with unknown version" debug.log
+_check
+
+# Concurrent writers replace the whole file.
+rm -f "$SCANCACHE"
+for i in $(seq 1 8); do
+	pvs > /dev/null &
+	vgchange --addtag "tag$i" $vg2 > /dev/null &
+done
+wait
+pvs -vvvv 2> debug.log
+not grep "Ignoring scan cache" debug.log
+not ls "$SCANCACHE".*
+_check
+
+vgremove -ff $vg1 $vg2
+_check
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='scan_label_first finds the same PVs as reading full blocks'
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux lvmconf 'devices/hints = "none"'
+
+aux prepare_devs 6
+
+pvcreate "$dev1"
+# Label in the last sector read by the first pass.
+pvcreate --labelsector 3 "$dev2"
+# Second mda at the end of the device.
+pvcreate --pvmetadatacopies 2 --metadatasize 1m "$dev3"
+
+# Not PVs: random data, and a label id past the first 4KiB.
+dd if=/dev/urandom of="$dev4" bs=1k count=64 oflag=direct
+printf 'LABELONE' | dd of="$dev5" bs=512 seek=8 conv=notrunc oflag=direct
+
+vgcreate $vg "$dev1" "$dev2" "$dev3"
+
+# Metadata text larger than the 128KiB scan block.
+TAGS=()
+for i in $(seq 1 200); do
+	TAGS+=( --addtag "$(printf 't%04d_%0900d' "$i" 0)" )
+done
+vgchange "${TAGS[@]}" $vg
+lvcreate -an -Zn -l1 -n $lv1 $vg
+
+_report() {
+	pvs -a --config "devices/scan_label_first = $1" -o+pv_mda_count,pv_mda_size,pe_start,vg_name
+	vgs --config "devices/scan_label_first = $1" -o+vg_mda_count,vg_tags
+	lvs --config "devices/scan_label_first = $1" -o+lv_tags
+}
+
+_report 0 > out0
+_report 1 > out1
+diff out0 out1
+
+# Only the three PVs are read in full.
+pvs -vvvv --config "devices/scan_label_first = 1" 2> debug.log
+grep "label reads 6 full reads 3" debug.log
+
+check pv_field "$dev2" vg_name $vg
+check pv_field "$dev3" pv_mda_count 2
+not pvs "$dev4"
+not pvs "$dev5"
+not pvs "$dev6"
+
+# Metadata changes are read back with either setting.
+lvcreate -an -Zn -l1 -n $lv2 $vg --config "devices/scan_label_first = 1"
+check lv_exists $vg $lv2
+lvremove $vg/$lv2 --config "devices/scan_label_first = 0"
+_report 1 > out1
+_report 0 > out0
+diff out0 out1
+
+vgremove -ff $vg
@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+test_description='activate LVs in several VGs with one udev wait'
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_devs 4
+
+LVS=50
+
+for i in 1 2 3 4; do
+	vgcreate $SHARED "${PREFIX}vg$i" "${DEVICES[$(( i - 1 ))]}"
+	for j in $(seq 1 $LVS); do
+		lvcreate -an -l1 -n "lv$j" "${PREFIX}vg$i"
+	done
+done
+
+_activate() {
+	local start end
+
+	start=$(date +%s%N)
+	vgchange -ay -vvvv "$@" "${PREFIX}vg1" "${PREFIX}vg2" "${PREFIX}vg3" "${PREFIX}vg4" 2> debug.log
+	end=$(date +%s%N)
+	echo "Activated $(( 4 * LVS )) LVs at $(( 4 * LVS * 1000000000 / (end - start + 1) )) LVs/s" "$@"
+
+	for i in 1 2 3 4; do
+		check lv_field "${PREFIX}vg$i/lv1" lv_active "active"
+		check lv_field "${PREFIX}vg$i/lv$LVS" lv_active "active"
+		test -e "$DM_DEV_DIR/${PREFIX}vg$i/lv$LVS"
+	done
+}
+
+# One wait when all VGs are activated.
+_activate --config "activation/udev_sync_batch = 1"
+BATCHED=$(grep -c "Syncing device names" debug.log)
+vgchange -an
+
+# A wait after each VG, the default.
+_activate
+test "$(grep -c "Syncing device names" debug.log)" -ge $(( BATCHED + 3 ))
+vgchange -an
+
+# Links are created whether or not udev finishes in time.
+_activate --config "activation/udev_sync_timeout = 1"
+not grep "Failed to create symlinks" debug.log
+vgchange -an
+
+vgremove -ff "${PREFIX}vg1" "${PREFIX}vg2" "${PREFIX}vg3" "${PREFIX}vg4"
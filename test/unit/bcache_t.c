@@ -377,6 +377,27 @@ static void _large_fixture_exit(void *context)
 	_fixture_exit(context);
 }
 
+static void *_elastic_fixture_init(void)
+{
+	struct fixture *f = malloc(sizeof(*f));
+
+	T_ASSERT(f);
+
+	f->me = _mock_create(64, 128);
+	T_ASSERT(f->me);
+
+	_expect(f->me, E_MAX_IO);
+	f->cache = bcache_create_elastic(128, 16, 64, &f->me->e);
+	T_ASSERT(f->cache);
+
+	return f;
+}
+
+static void _elastic_fixture_exit(void *context)
+{
+	_fixture_exit(context);
+}
+
 /*----------------------------------------------------------------
  * Tests
  *--------------------------------------------------------------*/
@@ -954,6 +975,113 @@ static void test_concurrent_reads_after_invalidate(void *context)
 	_cycle(f, nr_cache_blocks);
 }
 
+//----------------------------------------------------------------
+// Elastic caches
+
+static void _prefetch_and_get(struct fixture *f, unsigned nr_dis)
+{
+	struct block *b;
+	unsigned i;
+
+	for (i = 0; i < nr_dis; i++) {
+		_expect_read(f->me, i, 0);
+		bcache_prefetch(f->cache, i, 0);
+	}
+
+	// every prefetch must have been issued, none recycled
+	_no_outstanding_expectations(f->me);
+
+	for (i = 0; i < nr_dis; i++) {
+		_expect(f->me, E_WAIT);
+		T_ASSERT(bcache_get(f->cache, i, 0, 0, &b));
+		bcache_put(b);
+	}
+}
+
+static void test_elastic_prefetch_grows(void *context)
+{
+	struct fixture *f = context;
+	struct bcache_stats stats;
+
+	_prefetch_and_get(f, 32);
+
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.nr_cache_blocks, 32);
+	T_ASSERT_EQUAL(stats.grows, 1);
+	T_ASSERT_EQUAL(stats.prefetches, 32);
+}
+
+static void test_elastic_shrink_keeps_data(void *context)
+{
+	struct fixture *f = context;
+	struct bcache_stats stats;
+	struct block *b;
+	unsigned i;
+
+	_prefetch_and_get(f, 32);
+
+	// make room in the initial blocks for the grown ones
+	for (i = 0; i < 16; i++)
+		T_ASSERT(bcache_invalidate_di(f->cache, i));
+
+	bcache_shrink(f->cache);
+
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.nr_cache_blocks, 16);
+	T_ASSERT_EQUAL(stats.shrinks, 1);
+
+	// no reads expected, the data was moved
+	for (i = 16; i < 32; i++) {
+		T_ASSERT(bcache_get(f->cache, i, 0, 0, &b));
+		bcache_put(b);
+	}
+}
+
+static void test_elastic_shrink_skips_held(void *context)
+{
+	struct fixture *f = context;
+	struct bcache_stats stats;
+	struct block *b;
+
+	_prefetch_and_get(f, 32);
+
+	T_ASSERT(bcache_get(f->cache, 31, 0, 0, &b));
+	bcache_shrink(f->cache);
+	bcache_put(b);
+
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.nr_cache_blocks, 32);
+	T_ASSERT_EQUAL(stats.shrinks, 0);
+}
+
+static void test_elastic_grow(void *context)
+{
+	struct fixture *f = context;
+
+	T_ASSERT(bcache_grow(f->cache, 48));
+	T_ASSERT_EQUAL(bcache_nr_cache_blocks(f->cache), 48);
+
+	// explicitly grown blocks are kept
+	bcache_shrink(f->cache);
+	T_ASSERT_EQUAL(bcache_nr_cache_blocks(f->cache), 48);
+}
+
+static void test_elastic_grow_above_max(void *context)
+{
+	struct fixture *f = context;
+	struct bcache_stats stats;
+
+	// grown as far as the maximum, but that is less than asked for
+	T_ASSERT(!bcache_grow(f->cache, 65));
+	T_ASSERT_EQUAL(bcache_nr_cache_blocks(f->cache), 64);
+	T_ASSERT(bcache_grow(f->cache, 64));
+
+	bcache_shrink(f->cache);
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.nr_cache_blocks, 64);
+	T_ASSERT_EQUAL(stats.grows, 1);
+}
+
 /*----------------------------------------------------------------
  * Top level
  *--------------------------------------------------------------*/
@@ -1027,9 +1155,27 @@ static struct test_suite *_large_tests(void)
 	return ts;
 }
 
+static struct test_suite *_elastic_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_elastic_fixture_init, _elastic_fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("elastic-prefetch-grows", "prefetch grows the pool instead of recycling", test_elastic_prefetch_grows);
+	T("elastic-shrink-keeps-data", "shrink moves cached blocks into free ones", test_elastic_shrink_keeps_data);
+	T("elastic-shrink-skips-held", "shrink keeps chunks with held blocks", test_elastic_shrink_skips_held);
+	T("elastic-grow", "explicit grow is kept", test_elastic_grow);
+	T("elastic-grow-above-max", "explicit grow above the maximum grows to it", test_elastic_grow_above_max);
+
+	return ts;
+}
+
 void bcache_tests(struct dm_list *all_tests)
 {
 	dm_list_add(all_tests, &_tiny_tests()->list);
 	dm_list_add(all_tests, &_small_tests()->list);
 	dm_list_add(all_tests, &_large_tests()->list);
+	dm_list_add(all_tests, &_elastic_tests()->list);
 }
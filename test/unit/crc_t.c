@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/crc.h"
+
+#include <stdlib.h>
+
+#define BUF_SIZE (1024 * 1024 + 7)
+
+static void *_fix_init(void)
+{
+	uint8_t *buf = malloc(BUF_SIZE);
+	unsigned i;
+
+	T_ASSERT(buf);
+
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = (uint8_t) (i * 7 + (i >> 9));
+
+	return buf;
+}
+
+static void _fix_exit(void *fixture)
+{
+	free(fixture);
+}
+
+static void _test_combine(void *fixture)
+{
+	static const uint32_t splits[] = { 0, 1, 3, 16, 17, 300, 4096, 65535, BUF_SIZE - 1, BUF_SIZE };
+	const uint8_t *buf = fixture;
+	uint32_t full = calc_crc(INITIAL_CRC, buf, BUF_SIZE);
+	uint32_t crc1, crc2;
+	unsigned i;
+
+	for (i = 0; i < DM_ARRAY_SIZE(splits); i++) {
+		crc1 = calc_crc(INITIAL_CRC, buf, splits[i]);
+		crc2 = calc_crc(0, buf + splits[i], BUF_SIZE - splits[i]);
+		T_ASSERT_EQUAL(calc_crc_combine(crc1, crc2, BUF_SIZE - splits[i]), full);
+	}
+}
+
+static void _test_combine_pieces(void *fixture)
+{
+	const uint8_t *buf = fixture;
+	uint32_t crc = INITIAL_CRC;
+	uint32_t pos, len;
+
+	/* Uneven pieces, as text sections of different sizes. */
+	for (pos = 0, len = 1; pos < BUF_SIZE; pos += len, len = len * 3 % 5000 + 1) {
+		if (pos + len > BUF_SIZE)
+			len = BUF_SIZE - pos;
+		crc = calc_crc_combine(crc, calc_crc(0, buf + pos, len), len);
+	}
+
+	T_ASSERT_EQUAL(crc, calc_crc(INITIAL_CRC, buf, BUF_SIZE));
+}
+
+#define T(path, desc, fn) register_test(ts, "/base/crc/" path, desc, fn)
+
+void crc_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("combine", "crc of two buffers from their crcs", _test_combine);
+	T("combine-pieces", "crc of many pieces from their crcs", _test_combine_pieces);
+
+	dm_list_add(all_tests, &ts->list);
+}
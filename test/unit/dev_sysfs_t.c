@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/device/dev-sysfs.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#define DEVNO makedev(8, 0)
+
+struct fixture {
+	char dir[PATH_MAX];
+	char old_sysfs_dir[PATH_MAX];
+};
+
+static void _write_file(struct fixture *f, const char *name, const char *content)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	T_ASSERT(snprintf(path, sizeof(path), "%s/%s", f->dir, name) < (int) sizeof(path));
+	T_ASSERT(fp = fopen(path, "w"));
+	T_ASSERT(fputs(content, fp) >= 0);
+	T_ASSERT(!fclose(fp));
+}
+
+static void _mkdir(struct fixture *f, const char *name)
+{
+	char path[PATH_MAX];
+
+	T_ASSERT(snprintf(path, sizeof(path), "%s/%s", f->dir, name) < (int) sizeof(path));
+	T_ASSERT(!mkdir(path, 0755));
+}
+
+static void *_fix_init(void)
+{
+	struct fixture *f = malloc(sizeof(*f));
+	char path[PATH_MAX];
+
+	T_ASSERT(f);
+	T_ASSERT(getcwd(f->dir, sizeof(f->dir) - 32));
+	strcat(f->dir, "/sysfs-XXXXXX");
+	T_ASSERT(mkdtemp(f->dir));
+
+	/* <dir>/dev/block/8:0 -> ../../devices/sda, as in the real sysfs. */
+	_mkdir(f, "devices");
+	_mkdir(f, "devices/sda");
+	_mkdir(f, "devices/sda/queue");
+	_mkdir(f, "dev");
+	_mkdir(f, "dev/block");
+	_write_file(f, "devices/sda/partition", "1\n");
+	_write_file(f, "devices/sda/queue/rotational", "0\n");
+	T_ASSERT(snprintf(path, sizeof(path), "%s/dev/block/8:0", f->dir) < (int) sizeof(path));
+	T_ASSERT(!symlink("../../devices/sda", path));
+
+	strcpy(f->old_sysfs_dir, dm_sysfs_dir());
+	T_ASSERT(dm_set_sysfs_dir(f->dir));
+	sysfs_cache_destroy();
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	char cmd[PATH_MAX + 16];
+
+	sysfs_cache_destroy();
+	(void) dm_set_sysfs_dir(f->old_sysfs_dir);
+
+	T_ASSERT(snprintf(cmd, sizeof(cmd), "rm -rf '%s'", f->dir) < (int) sizeof(cmd));
+	T_ASSERT(!system(cmd));
+	free(f);
+}
+
+//----------------------------------------------------------------
+
+static void _test_values(void *fixture)
+{
+	char buf[64];
+	int len;
+
+	len = sysfs_attr_read(DEVNO, "", buf, sizeof(buf) - 1);
+	T_ASSERT(len > 0);
+	buf[len] = '\0';
+	T_ASSERT(!strcmp(buf, "../../devices/sda"));
+
+	T_ASSERT(sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf)));
+	T_ASSERT(!strcmp(buf, "1"));
+
+	T_ASSERT_EQUAL(sysfs_attr_read(DEVNO, "queue/rotational", buf, sizeof(buf)), 2);
+	T_ASSERT(!memcmp(buf, "0\n", 2));
+
+	/* Truncated to the buffer, but the full length is returned. */
+	T_ASSERT(sysfs_attr_value(DEVNO, "queue/rotational", buf, 1) == 0);
+	T_ASSERT_EQUAL(sysfs_attr_read(DEVNO, "", NULL, 0), (int) strlen("../../devices/sda"));
+}
+
+static void _test_cached(void *fixture)
+{
+	struct fixture *f = fixture;
+	char buf[64];
+
+	T_ASSERT(sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf)));
+	T_ASSERT(!strcmp(buf, "1"));
+
+	/* Changes are not seen until the cache is dropped. */
+	_write_file(f, "devices/sda/partition", "2\n");
+	T_ASSERT(sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf)));
+	T_ASSERT(!strcmp(buf, "1"));
+
+	sysfs_cache_destroy();
+	T_ASSERT(sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf)));
+	T_ASSERT(!strcmp(buf, "2"));
+}
+
+static void _test_missing(void *fixture)
+{
+	struct fixture *f = fixture;
+	char buf[64];
+
+	T_ASSERT_EQUAL(sysfs_attr_read(DEVNO, "queue/dax", buf, sizeof(buf)), -ENOENT);
+	T_ASSERT_EQUAL(sysfs_attr_read(makedev(8, 16), "", NULL, 0), -ENOENT);
+	T_ASSERT(!sysfs_attr_value(makedev(8, 16), "partition", buf, sizeof(buf)));
+	T_ASSERT(!buf[0]);
+
+	/* Failures are cached as well. */
+	_write_file(f, "devices/sda/queue/dax", "0\n");
+	T_ASSERT_EQUAL(sysfs_attr_read(DEVNO, "queue/dax", buf, sizeof(buf)), -ENOENT);
+}
+
+static void _test_stats(void *fixture)
+{
+	struct sysfs_cache_stats stats;
+	char buf[64];
+
+	sysfs_cache_get_stats(&stats);
+	T_ASSERT_EQUAL(stats.lookups, 0);
+
+	(void) sysfs_attr_read(DEVNO, "", buf, sizeof(buf));
+	(void) sysfs_attr_read(DEVNO, "", buf, sizeof(buf));
+	(void) sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf));
+	(void) sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf));
+	(void) sysfs_attr_value(DEVNO, "partition", buf, sizeof(buf));
+	(void) sysfs_attr_read(DEVNO, "queue/dax", buf, sizeof(buf));
+	(void) sysfs_attr_read(DEVNO, "queue/dax", buf, sizeof(buf));
+
+	sysfs_cache_get_stats(&stats);
+	T_ASSERT_EQUAL(stats.lookups, 7);
+	T_ASSERT_EQUAL(stats.hits, 4);
+	T_ASSERT_EQUAL(stats.reads, 3);
+	/* readlink, open+read+close, failed open */
+	T_ASSERT_EQUAL(stats.syscalls, 1 + 3 + 1);
+	T_ASSERT_EQUAL(stats.saved, 1 + 2 * 3 + 1);
+
+	sysfs_cache_destroy();
+	sysfs_cache_get_stats(&stats);
+	T_ASSERT_EQUAL(stats.lookups, 0);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/device/dev-sysfs/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("values", "attributes and the device link are read", _test_values);
+	T("cached", "attributes are read once until the cache is dropped", _test_cached);
+	T("missing", "missing attributes fail with -ENOENT", _test_missing);
+	T("stats", "counters show the syscalls saved", _test_stats);
+
+	return ts;
+}
+
+void dev_sysfs_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
@@ -0,0 +1,596 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/metadata/metadata.h"
+#include "lib/format_text/import-export.h"
+#include "libdaemon/client/config-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * The streaming importer has to give the same VG as the vsn1 importer
+ * reading the config tree of the same text.  Both VGs are exported and
+ * the text compared, along with the LV fields the text doesn't show.
+ */
+
+#define PVS \
+	"physical_volumes {\n" \
+	"pv0 {\n" \
+	"id = \"Pv0000-0000-0000-0000-0000-0000-000000\"\n" \
+	"device = \"/dev/sda\"\n" \
+	"status = [\"ALLOCATABLE\"]\n" \
+	"flags = []\n" \
+	"dev_size = 2097152\n" \
+	"pe_start = 2048\n" \
+	"pe_count = 255\n" \
+	"}\n" \
+	"pv1 {\n" \
+	"id = \"Pv1111-1111-1111-1111-1111-1111-111111\"\n" \
+	"device = \"/dev/sdb\"\n" \
+	"status = [\"ALLOCATABLE\"]\n" \
+	"flags = []\n" \
+	"dev_size = 2097152\n" \
+	"pe_start = 2048\n" \
+	"pe_count = 255\n" \
+	"}\n" \
+	"}\n"
+
+#define VG_BEGIN \
+	"vg0 {\n" \
+	"id = \"Vg0000-0000-0000-0000-0000-0000-000000\"\n" \
+	"seqno = 7\n" \
+	"format = \"lvm2\"\n" \
+	"status = [\"RESIZEABLE\", \"READ\", \"WRITE\"]\n" \
+	"flags = []\n" \
+	"tags = [\"vgtag\"]\n" \
+	"extent_size = 8192\n" \
+	"max_lv = 0\n" \
+	"max_pv = 0\n" \
+	"metadata_copies = 0\n" \
+	PVS
+
+#define VG_END \
+	"}\n" \
+	"# Generated by LVM2\n" \
+	"contents = \"Text Format Volume Group\"\n" \
+	"version = 1\n" \
+	"description = \"a \\\"quoted\\\" description\"\n" \
+	"creation_host = \"host\"\n" \
+	"creation_time = 1700000000\n"
+
+#define LINEAR(name, id, status, pv, pe, count) \
+	name " {\n" \
+	"id = \"" id "\"\n" \
+	"status = " status "\n" \
+	"flags = []\n" \
+	"creation_time = 1700000000\n" \
+	"creation_host = \"host\"\n" \
+	"segment_count = 1\n" \
+	"segment1 {\n" \
+	"start_extent = 0\n" \
+	"extent_count = " #count "\n" \
+	"type = \"striped\"\n" \
+	"stripe_count = 1\n" \
+	"stripes = [\"" pv "\", " #pe "]\n" \
+	"}\n" \
+	"}\n"
+
+#define VISIBLE "[\"READ\", \"WRITE\", \"VISIBLE\"]"
+#define HIDDEN "[\"READ\", \"WRITE\"]"
+
+static const char _striped[] =
+	VG_BEGIN
+	"logical_volumes {\n"
+	LINEAR("lv0", "Lv0000-0000-0000-0000-0000-0000-000000", VISIBLE, "pv0", 0, 10)
+	"lv1 {\n"
+	"id = \"Lv1111-1111-1111-1111-1111-1111-111111\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"tags = [\"a\\\"b\", \"c\\\\d\", \"e\"]\n"
+	"allocation_policy = \"contiguous\"\n"
+	"read_ahead = 256\n"
+	"lock_args = \"1.0.0:70254592\"\n"
+	"segment_count = 3\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 5\n"
+	"type = \"striped\"\n"
+	"stripe_count = 1	# linear\n"
+	"stripes = [\n"
+	"\"pv0\", 10\n"
+	"]\n"
+	"}\n"
+	"segment2 {\n"
+	"start_extent = 5\n"
+	"extent_count = 8\n"
+	"type = \"striped\"\n"
+	"stripe_count = 2\n"
+	"stripe_size = 128\n"
+	"stripes = [\n"
+	"\"pv0\", 15,\n"
+	"\"pv1\", 0,\n"
+	"]\n"
+	"}\n"
+	/* Out of order, and not merged with segment1 */
+	"segment3 {\n"
+	"extent_count = 2\n"
+	"start_extent = 13\n"
+	"type = \"striped\"\n"
+	"stripe_count = 1\n"
+	"stripes = [\"pv1\", 4]\n"
+	"tags = [\"segtag\"]\n"
+	"}\n"
+	"}\n"
+	"lv2 {\n"
+	"id = \"Lv2222-2222-2222-2222-2222-2222-222222\"\n"
+	"status = [\"READ\", \"VISIBLE\", \"FIXED_MINOR\"]\n"
+	"flags = [\"ACTIVATION_SKIP\"]\n"
+	"major = 253\n"
+	"minor = 10\n"
+	"read_ahead = 0\n"
+	"unknown_key = [1, \"two\"]\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 4\n"
+	"type = \"striped\"\n"
+	"stripe_count = 1\n"
+	"stripes = [\"pv1\", 10]\n"
+	"}\n"
+	"}\n"
+	"lv3 {\n"
+	"id = \"Lv3333-3333-3333-3333-3333-3333-333333\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\", \"FIXED_MINOR\"]\n"
+	"flags = []\n"
+	"minor = 11\n"
+	"read_ahead = -1\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 1\n"
+	"type = \"striped\"\n"
+	"stripe_count = 1\n"
+	"stripes = [\"pv1\", 14]\n"
+	"}\n"
+	"}\n"
+	"}\n"
+	VG_END;
+
+static const char _mirror[] =
+	VG_BEGIN
+	"logical_volumes {\n"
+	"m {\n"
+	"id = \"Mi0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 10\n"
+	"type = \"mirror\"\n"
+	"mirror_count = 2\n"
+	"mirror_log = \"m_mlog\"\n"
+	"region_size = 1024\n"
+	"mirrors = [\n"
+	"\"m_mimage_0\", 0,\n"
+	"\"m_mimage_1\", 0\n"
+	"]\n"
+	"}\n"
+	"}\n"
+	LINEAR("m_mlog", "Mi1111-1111-1111-1111-1111-1111-111111", HIDDEN, "pv1", 20, 1)
+	LINEAR("m_mimage_0", "Mi2222-2222-2222-2222-2222-2222-222222", HIDDEN, "pv0", 0, 10)
+	LINEAR("m_mimage_1", "Mi3333-3333-3333-3333-3333-3333-333333", HIDDEN, "pv1", 0, 10)
+	"}\n"
+	VG_END;
+
+static const char _raid_snapshot[] =
+	VG_BEGIN
+	"logical_volumes {\n"
+	"r {\n"
+	"id = \"Ra0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 10\n"
+	"type = \"raid1\"\n"
+	"device_count = 2\n"
+	"region_size = 4096\n"
+	"raids = [\n"
+	"\"r_rmeta_0\", \"r_rimage_0\",\n"
+	"\"r_rmeta_1\", \"r_rimage_1\"\n"
+	"]\n"
+	"}\n"
+	"}\n"
+	"orig {\n"
+	"id = \"Or0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 5\n"
+	"type = \"striped\"\n"
+	"stripe_count = 1\n"
+	"stripes = [\"pv0\", 30]\n"
+	"}\n"
+	"}\n"
+	LINEAR("snap", "Sn0000-0000-0000-0000-0000-0000-000000", VISIBLE, "pv1", 30, 2)
+	LINEAR("r_rmeta_0", "Ra1111-1111-1111-1111-1111-1111-111111", HIDDEN, "pv0", 0, 1)
+	LINEAR("r_rimage_0", "Ra2222-2222-2222-2222-2222-2222-222222", HIDDEN, "pv0", 1, 10)
+	LINEAR("r_rmeta_1", "Ra3333-3333-3333-3333-3333-3333-333333", HIDDEN, "pv1", 0, 1)
+	LINEAR("r_rimage_1", "Ra4444-4444-4444-4444-4444-4444-444444", HIDDEN, "pv1", 1, 10)
+	"snapshot0 {\n"
+	"id = \"Sn1111-1111-1111-1111-1111-1111-111111\"\n"
+	"status = [\"READ\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 5\n"
+	"type = \"snapshot\"\n"
+	"chunk_size = 8\n"
+	"origin = \"orig\"\n"
+	"cow_store = \"snap\"\n"
+	"}\n"
+	"}\n"
+	"}\n"
+	VG_END;
+
+static const char _thin_cache[] =
+	VG_BEGIN
+	"logical_volumes {\n"
+	"pool {\n"
+	"id = \"Po0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 20\n"
+	"type = \"thin-pool\"\n"
+	"metadata = \"pool_tmeta\"\n"
+	"pool = \"pool_tdata\"\n"
+	"transaction_id = 2\n"
+	"chunk_size = 128\n"
+	"discards = \"passdown\"\n"
+	"zero_new_blocks = 1\n"
+	"}\n"
+	"}\n"
+	"thin1 {\n"
+	"id = \"Th1111-1111-1111-1111-1111-1111-111111\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 40\n"
+	"type = \"thin\"\n"
+	"thin_pool = \"pool\"\n"
+	"transaction_id = 0\n"
+	"device_id = 1\n"
+	"}\n"
+	"}\n"
+	"cpool {\n"
+	"id = \"Cp0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 4\n"
+	"type = \"cache-pool\"\n"
+	"data = \"cpool_cdata\"\n"
+	"metadata = \"cpool_cmeta\"\n"
+	"chunk_size = 128\n"
+	"metadata_format = 2\n"
+	"cache_mode = \"writethrough\"\n"
+	"policy = \"smq\"\n"
+	"policy_settings {\n"
+	"migration_threshold = 2048\n"
+	"}\n"
+	"}\n"
+	"}\n"
+	"corig {\n"
+	"id = \"Co0000-0000-0000-0000-0000-0000-000000\"\n"
+	"status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"flags = []\n"
+	"segment_count = 1\n"
+	"segment1 {\n"
+	"start_extent = 0\n"
+	"extent_count = 6\n"
+	"type = \"cache\"\n"
+	"cache_pool = \"cpool\"\n"
+	"origin = \"corig_corig\"\n"
+	"}\n"
+	"}\n"
+	LINEAR("lvol0_pmspare", "Ps0000-0000-0000-0000-0000-0000-000000", HIDDEN, "pv0", 0, 1)
+	LINEAR("pool_tmeta", "Po1111-1111-1111-1111-1111-1111-111111", HIDDEN, "pv0", 1, 1)
+	LINEAR("pool_tdata", "Po2222-2222-2222-2222-2222-2222-222222", HIDDEN, "pv0", 2, 20)
+	LINEAR("cpool_cdata", "Cp1111-1111-1111-1111-1111-1111-111111", HIDDEN, "pv1", 0, 4)
+	LINEAR("cpool_cmeta", "Cp2222-2222-2222-2222-2222-2222-222222", HIDDEN, "pv1", 4, 1)
+	LINEAR("corig_corig", "Co1111-1111-1111-1111-1111-1111-111111", HIDDEN, "pv1", 5, 6)
+	"}\n"
+	"historical_logical_volumes {\n"
+	"thin0 {\n"
+	"id = \"Hi0000-0000-0000-0000-0000-0000-000000\"\n"
+	"creation_time = 1600000000\n"
+	"removal_time = 1650000000\n"
+	"descendants = [\"thin1\"]\n"
+	"}\n"
+	"}\n"
+	VG_END;
+
+struct fixture {
+	char dir[64];
+	struct cmd_context *cmd;
+};
+
+static void *_fix_init(void)
+{
+	struct fixture *f = malloc(sizeof(*f));
+	char path[128];
+	FILE *fp;
+
+	T_ASSERT(f);
+	snprintf(f->dir, sizeof(f->dir), "unit-test-XXXXXX");
+	T_ASSERT(mkdtemp(f->dir));
+	snprintf(path, sizeof(path), "%s/lvm.conf", f->dir);
+	T_ASSERT((fp = fopen(path, "w")));
+	T_ASSERT(fclose(fp) == 0);
+
+	T_ASSERT((f->cmd = create_toolcontext(0, f->dir, 0, 0, 0, 0)));
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	char path[128];
+
+	destroy_toolcontext(f->cmd);
+	snprintf(path, sizeof(path), "%s/lvm.conf", f->dir);
+	(void) unlink(path);
+	(void) rmdir(f->dir);
+	free(f);
+}
+
+static struct volume_group *_tree_vg(struct cmd_context *cmd, const char *text)
+{
+	struct dm_config_tree *cft;
+	struct volume_group *vg;
+
+	T_ASSERT((cft = config_tree_from_string_without_dup_node_check(text)));
+	vg = vg_from_config_tree(cmd, cft);
+	dm_config_destroy(cft);
+
+	return vg;
+}
+
+static struct volume_group *_stream_vg(struct cmd_context *cmd, const char *text, int *fallback)
+{
+	time_t when;
+	char *desc;
+	struct volume_group *vg;
+
+	vg = text_read_vg_stream(cmd, cmd->fmt, NULL, text, &when, &desc, fallback);
+
+	if (vg) {
+		T_ASSERT(!*fallback);
+		T_ASSERT_EQUAL(when, 1700000000);
+		T_ASSERT(!strcmp(desc, "a \"quoted\" description"));
+	}
+
+	return vg;
+}
+
+/* The exported VG section, without the header with the time */
+static char *_export(struct volume_group *vg)
+{
+	char *buf = NULL, *p;
+
+	T_ASSERT(text_vg_export_raw(vg, "", &buf, NULL, NULL));
+	T_ASSERT((p = strstr(buf, "\n# Generated by")));
+	*p = '\0';
+
+	return buf;
+}
+
+static void _check_same(struct cmd_context *cmd, const char *text)
+{
+	struct volume_group *vg1, *vg2;
+	struct lv_list *lvl1, *lvl2;
+	struct logical_volume *lv;
+	char *text1, *text2;
+	int fallback = 1;
+
+	T_ASSERT((vg1 = _tree_vg(cmd, text)));
+	T_ASSERT((vg2 = _stream_vg(cmd, text, &fallback)));
+
+	text1 = _export(vg1);
+	text2 = _export(vg2);
+	if (strcmp(text1, text2))
+		fprintf(stderr, "tree:\n%s\nstream:\n%s\n", text1, text2);
+	T_ASSERT(!strcmp(text1, text2));
+	free(text1);
+	free(text2);
+
+	T_ASSERT_EQUAL(dm_list_size(&vg1->lvs), dm_list_size(&vg2->lvs));
+	lvl2 = dm_list_item(dm_list_first(&vg2->lvs), struct lv_list);
+	dm_list_iterate_items(lvl1, &vg1->lvs) {
+		lv = lvl2->lv;
+		T_ASSERT(!strcmp(lvl1->lv->name, lv->name));
+		T_ASSERT(find_lv_in_vg_by_lvid(vg2, &lvl1->lv->lvid) == lv);
+		T_ASSERT_EQUAL(lvl1->lv->status, lv->status);
+		T_ASSERT_EQUAL(lvl1->lv->size, lv->size);
+		T_ASSERT_EQUAL(lvl1->lv->le_count, lv->le_count);
+		T_ASSERT_EQUAL(lvl1->lv->read_ahead, lv->read_ahead);
+		T_ASSERT_EQUAL(lvl1->lv->major, lv->major);
+		T_ASSERT_EQUAL(lvl1->lv->minor, lv->minor);
+		T_ASSERT_EQUAL(lvl1->lv->alloc, lv->alloc);
+		T_ASSERT_EQUAL(lvl1->lv->timestamp, lv->timestamp);
+		T_ASSERT_EQUAL(dm_list_size(&lvl1->lv->segments), dm_list_size(&lv->segments));
+		T_ASSERT_EQUAL(dm_list_size(&lvl1->lv->segs_using_this_lv),
+			       dm_list_size(&lv->segs_using_this_lv));
+		lvl2 = dm_list_item(dm_list_next(&vg2->lvs, &lvl2->list), struct lv_list);
+	}
+
+	T_ASSERT(!vg1->pool_metadata_spare_lv == !vg2->pool_metadata_spare_lv);
+	T_ASSERT_EQUAL(dm_list_size(&vg1->historical_lvs), dm_list_size(&vg2->historical_lvs));
+	T_ASSERT(!vg2->pv_names);
+
+	release_vg(vg1);
+	release_vg(vg2);
+}
+
+/* Replace the first occurrence of old in text */
+static char *_edit(const char *text, const char *old, const char *new)
+{
+	const char *p;
+	char *r;
+
+	T_ASSERT((p = strstr(text, old)));
+	T_ASSERT(dm_asprintf(&r, "%.*s%s%s", (int) (p - text), text, new, p + strlen(old)) >= 0);
+
+	return r;
+}
+
+static void _check_fallback(struct cmd_context *cmd, const char *old, const char *new)
+{
+	char *text = _edit(_striped, old, new);
+	int fallback = 0;
+
+	T_ASSERT(!_stream_vg(cmd, text, &fallback));
+	T_ASSERT(fallback);
+	free(text);
+}
+
+//----------------------------------------------------------------
+
+static void _test_striped(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_check_same(f->cmd, _striped);
+}
+
+static void _test_mirror(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_check_same(f->cmd, _mirror);
+}
+
+static void _test_raid_snapshot(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_check_same(f->cmd, _raid_snapshot);
+}
+
+static void _test_thin_cache(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_check_same(f->cmd, _thin_cache);
+}
+
+static void _test_fallback(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	/* Duplicate key in an LV */
+	_check_fallback(f->cmd, "read_ahead = 256\n", "read_ahead = 256\nread_ahead = 8\n");
+	/* Octal and hex numbers, floats */
+	_check_fallback(f->cmd, "read_ahead = 256", "read_ahead = 0400");
+	_check_fallback(f->cmd, "read_ahead = 256", "read_ahead = 0x100");
+	_check_fallback(f->cmd, "unknown_key = [1,", "unknown_key = [1.5,");
+	/* Single quoted and bare strings */
+	_check_fallback(f->cmd, "lock_args = \"1.0.0:70254592\"", "lock_args = '1.0.0:70254592'");
+	_check_fallback(f->cmd, "allocation_policy = \"contiguous\"", "allocation_policy = contiguous");
+	/* Keys the tree reads as a path, or quoted */
+	_check_fallback(f->cmd, "unknown_key", "unknown/key");
+	_check_fallback(f->cmd, "unknown_key", "\"unknown_key\"");
+	/* Wrong type for a known key */
+	_check_fallback(f->cmd, "read_ahead = 256", "read_ahead = \"256\"");
+	/* Sections out of the usual order */
+	_check_fallback(f->cmd, "metadata_copies = 0\n", "metadata_copies = 0\nlogical_volumes {\n}\n");
+	/* Unterminated text */
+	_check_fallback(f->cmd, "version = 1\n", "version = 1\nx {\n");
+	/* Not metadata */
+	_check_fallback(f->cmd, "version = 1", "version = 2");
+}
+
+static void _test_errors(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *text;
+	int fallback = 1;
+
+	/* Reported like the vsn1 importer does, no second try with a tree */
+	text = _edit(_striped, "\"READ\", \"VISIBLE\", \"FIXED_MINOR\"", "\"READ\", \"BOGUS\"");
+	T_ASSERT(!_tree_vg(f->cmd, text));
+	T_ASSERT(!_stream_vg(f->cmd, text, &fallback));
+	T_ASSERT(!fallback);
+	free(text);
+
+	fallback = 1;
+	text = _edit(_striped, "\"pv1\", 4]", "\"pv9\", 4]");
+	T_ASSERT(!_tree_vg(f->cmd, text));
+	T_ASSERT(!_stream_vg(f->cmd, text, &fallback));
+	T_ASSERT(!fallback);
+	free(text);
+
+	fallback = 1;
+	text = _edit(_striped, "segment_count = 3", "segment_count = 2");
+	T_ASSERT(!_tree_vg(f->cmd, text));
+	T_ASSERT(!_stream_vg(f->cmd, text, &fallback));
+	T_ASSERT(!fallback);
+	free(text);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/import-stream/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("striped", "linear and striped LVs import as from a tree", _test_striped);
+	T("mirror", "mirror LVs import as from a tree", _test_mirror);
+	T("raid-snapshot", "raid and snapshot LVs import as from a tree", _test_raid_snapshot);
+	T("thin-cache", "thin, cache and historical LVs import as from a tree", _test_thin_cache);
+	T("fallback", "text the tree could read differently goes to the tree", _test_fallback);
+	T("errors", "errors of the vsn1 importer are reported", _test_errors);
+
+	return ts;
+}
+
+void import_stream_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
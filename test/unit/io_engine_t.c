@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -81,13 +82,12 @@ static void _print_buffer(const char *name, uint8_t *buffer, size_t count)
 	}
 }
 
-static void *_fix_init(void)
+static void *_fix_init_engine(struct io_engine *(*create)(void))
 {
 	struct fixture *f = malloc(sizeof(*f));
 
 	T_ASSERT(f);
-	f->e = create_async_io_engine();
-	T_ASSERT(f->e);
+	f->e = create();
 	if (posix_memalign((void **) &f->data, PAGE_SIZE, SECTOR_SIZE * BLOCK_SIZE_SECTORS))
 		test_fail("posix_memalign failed");
 
@@ -104,6 +104,29 @@ static void *_fix_init(void)
 	return f;
 }
 
+static void *_fix_init(void)
+{
+	struct fixture *f = _fix_init_engine(create_async_io_engine);
+
+	T_ASSERT(f->e);
+
+	return f;
+}
+
+/*
+ * io_uring may be missing or disabled (kernel.io_uring_disabled),
+ * in that case the tests using this fixture do nothing.
+ */
+static void *_fix_init_uring(void)
+{
+	struct fixture *f = _fix_init_engine(create_io_uring_engine);
+
+	if (!f->e)
+		fprintf(stderr, "io_uring not available, skipping\n");
+
+	return f;
+}
+
 static void _fix_exit(void *fixture)
 {
 	struct fixture *f = fixture;
@@ -145,7 +168,12 @@ static void _test_read(void *fixture)
 {
 	struct fixture *f = fixture;
 	struct io io;
-	struct bcache *cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache;
+
+	if (!f->e)
+		return;
+
+	cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -168,7 +196,12 @@ static void _test_write(void *fixture)
 {
 	struct fixture *f = fixture;
 	struct io io;
-	struct bcache *cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache;
+
+	if (!f->e)
+		return;
+
+	cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -192,7 +225,12 @@ static void _test_write_bytes(void *fixture)
 	unsigned offset = 345;
 	char buf_out[32];
 	char buf_in[32];
-	struct bcache *cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
+	struct bcache *cache;
+
+	if (!f->e)
+		return;
+
+	cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
 	T_ASSERT(cache);
 
 	f->di = bcache_set_fd(f->fd);
@@ -212,6 +250,61 @@ static void _test_write_bytes(void *fixture)
 	f->e = NULL;   // already destroyed
 }
 
+/*
+ * io_uring registers the fds of the bcache fd table when they are first
+ * used.  If that update fails (here for a closed fd in the first slot of
+ * the update) the ios already queued with the slot index must still be
+ * done, with the plain fd, and later ios must not use the slots either.
+ */
+static void _test_uring_files_update_failure(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct io io_good, io_bad;
+	struct bcache *cache;
+	uint8_t *bad_data;
+	int bad_fd, bad_di;
+
+	if (!f->e)
+		return;
+
+	cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
+	T_ASSERT(cache);
+
+	if (posix_memalign((void **) &bad_data, PAGE_SIZE, SECTOR_SIZE * BLOCK_SIZE_SECTORS))
+		test_fail("posix_memalign failed");
+
+	T_ASSERT((bad_fd = dup(f->fd)) >= 0);
+	T_ASSERT((bad_di = bcache_set_fd(bad_fd)) >= 0);
+	T_ASSERT((f->di = bcache_set_fd(f->fd)) > bad_di);
+	T_ASSERT(!close(bad_fd));
+
+	_io_init(&io_bad);
+	_io_init(&io_good);
+	T_ASSERT(f->e->issue(f->e, DIR_READ, bad_di, 0, BLOCK_SIZE_SECTORS, bad_data, &io_bad));
+	T_ASSERT(f->e->issue(f->e, DIR_READ, f->di, 0, BLOCK_SIZE_SECTORS, f->data, &io_good));
+	while (!io_bad.completed || !io_good.completed)
+		T_ASSERT(f->e->wait(f->e, _complete_io));
+
+	T_ASSERT(io_bad.error);
+	T_ASSERT(!io_good.error);
+	_check_buffer(f->data, 123, SECTOR_SIZE * BLOCK_SIZE_SECTORS);
+
+	memset(f->data, 0, SECTOR_SIZE * BLOCK_SIZE_SECTORS);
+	_io_init(&io_good);
+	T_ASSERT(f->e->issue(f->e, DIR_READ, f->di, 0, BLOCK_SIZE_SECTORS, f->data, &io_good));
+	T_ASSERT(f->e->wait(f->e, _complete_io));
+	T_ASSERT(io_good.completed);
+	T_ASSERT(!io_good.error);
+	_check_buffer(f->data, 123, SECTOR_SIZE * BLOCK_SIZE_SECTORS);
+
+	bcache_clear_fd(bad_di);
+	bcache_clear_fd(f->di);
+	free(bad_data);
+
+	bcache_destroy(cache);
+	f->e = NULL;   // already destroyed
+}
+
 /*
  * Test that _async_destroy() skips io_destroy() after fork().
  *
@@ -337,6 +430,102 @@ static void _test_wait_eintr(void *fixture)
 
 //----------------------------------------------------------------
 
+/*
+ * Compare the engines on a label_scan() like load: one block read from
+ * each of many files, all prefetched before any is waited for.  Only
+ * sanity checks the data; the numbers are printed for comparison.
+ */
+#define BENCH_FILES 64
+#define BENCH_ROUNDS 16
+#define BENCH_BLOCK_SECTORS 256	/* same as BCACHE_BLOCK_SIZE_IN_SECTORS */
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	(void) gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void _bench_engine(const char *name, struct io_engine *e, int *fds)
+{
+	struct bcache *cache;
+	struct block *b;
+	int di[BENCH_FILES];
+	double start, elapsed;
+	unsigned r, i;
+
+	if (!e) {
+		fprintf(stderr, "  %-8s not available\n", name);
+		return;
+	}
+
+	T_ASSERT(cache = bcache_create(BENCH_BLOCK_SECTORS, BENCH_FILES, e));
+
+	for (i = 0; i < BENCH_FILES; i++)
+		T_ASSERT((di[i] = bcache_set_fd(fds[i])) >= 0);
+
+	start = _now();
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		for (i = 0; i < BENCH_FILES; i++)
+			bcache_prefetch(cache, di[i], 0);
+
+		for (i = 0; i < BENCH_FILES; i++) {
+			T_ASSERT(bcache_get(cache, di[i], 0, 0, &b));
+			T_ASSERT_EQUAL(((uint8_t *) b->data)[0], (uint8_t) i);
+			bcache_put(b);
+		}
+
+		for (i = 0; i < BENCH_FILES; i++)
+			T_ASSERT(bcache_invalidate_di(cache, di[i]));
+	}
+	elapsed = _now() - start;
+
+	fprintf(stderr, "  %-8s %u reads, %.0f submissions/sec, scan %.1f us\n",
+		name, BENCH_FILES * BENCH_ROUNDS,
+		BENCH_FILES * BENCH_ROUNDS / (elapsed > 0 ? elapsed : 1e-6),
+		elapsed * 1000000.0 / BENCH_ROUNDS);
+
+	for (i = 0; i < BENCH_FILES; i++)
+		bcache_clear_fd(di[i]);
+
+	bcache_destroy(cache);
+}
+
+static void _test_engine_comparison(void *fixture)
+{
+	size_t len = BENCH_BLOCK_SECTORS << SECTOR_SHIFT;
+	char fname[BENCH_FILES][64];
+	int fds[BENCH_FILES];
+	uint8_t *buf;
+	unsigned i;
+
+	T_ASSERT(buf = malloc(len));
+
+	for (i = 0; i < BENCH_FILES; i++) {
+		snprintf(fname[i], sizeof(fname[i]), "unit-test-XXXXXX");
+		/* coverity[secure_temp] don't care */
+		T_ASSERT((fds[i] = mkstemp(fname[i])) >= 0);
+		memset(buf, i, len);
+		T_ASSERT(write(fds[i], buf, len) == (ssize_t) len);
+	}
+
+	fprintf(stderr, "\n");
+	_bench_engine("async", create_async_io_engine(), fds);
+	_bench_engine("sync", create_sync_io_engine(), fds);
+	_bench_engine("io_uring", create_io_uring_engine(), fds);
+
+	for (i = 0; i < BENCH_FILES; i++) {
+		(void) close(fds[i]);
+		(void) unlink(fname[i]);
+	}
+
+	free(buf);
+}
+
+//----------------------------------------------------------------
+
 #define T(path, desc, fn) register_test(ts, "/base/device/bcache/io-engine/" path, desc, fn)
 
 static struct test_suite *_tests(void)
@@ -353,6 +542,27 @@ static struct test_suite *_tests(void)
 	T("bcache-write-bytes", "test the utility fns", _test_write_bytes);
 	T("destroy-after-fork", "io_destroy skipped in child after fork", _test_destroy_after_fork);
 	T("wait-eintr", "io_getevents interrupted by signal", _test_wait_eintr);
+	T("engine-comparison", "scan timings for async, sync and io_uring", _test_engine_comparison);
+
+	return ts;
+}
+
+#undef T
+#define T(path, desc, fn) register_test(ts, "/base/device/bcache/io-engine-uring/" path, desc, fn)
+
+static struct test_suite *_uring_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init_uring, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("read", "read sanity check", _test_read);
+	T("write", "write sanity check", _test_write);
+	T("bcache-write-bytes", "test the utility fns", _test_write_bytes);
+	T("files-update-failure", "queued ios use plain fds after a failed file update",
+	  _test_uring_files_update_failure);
 
 	return ts;
 }
@@ -360,4 +570,5 @@ static struct test_suite *_tests(void)
 void io_engine_tests(struct dm_list *all_tests)
 {
 	dm_list_add(all_tests, &_tests()->list);
+	dm_list_add(all_tests, &_uring_tests()->list);
 }
@@ -18,6 +18,8 @@
 
 #include "matcher_data.h"
 
+#include <sys/time.h>
+
 static void *_mem_init(void)
 {
 	struct dm_pool *mem = dm_pool_create("bitset test", 1024);
@@ -51,10 +53,10 @@ static void test_fingerprints(void *fixture)
 	struct dm_regex *scanner;
 
 	scanner = make_scanner(mem, dev_patterns);
-	T_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0x7f556c09);
+	T_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0x2a48175a);
 
 	scanner = make_scanner(mem, random_patterns);
-	T_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0x9f11076c);
+	T_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0xc3e8a602);
 }
 
 static void test_matching(void *fixture)
@@ -109,6 +111,164 @@ static void test_kabi_query(void *fixture)
 	}
 }
 
+/*
+ * ".*a.........." needs a dfa state for every combination of the last
+ * eleven characters being 'a' or not, too many to build up front.
+ */
+static void test_lazy_states(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_regex *scanner;
+	const char *patterns[] = { "^x", "a..........$" };
+	const char *strs[] = { "xxxxxxxxxxxxxxxxxxxxxxxxxxxx",
+			       "xxxxxxxxxxxxxxxxxaxxxxxxxxxx",
+			       "aaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+			       "bbbbbbbbbbbbbbbbbbbbbbbbbbbb",
+			       "aaaaaaaaaaaaaaaaaaaaaaaaaaab",
+			       "aaaaaaaaaaaaaaaaabbbbbbbbbbb",
+			       "aaaaaaaaaaaaaaaaaabbbbbbbbbb" };
+	int expected[] = { 0, 1, 1, -1, 1, -1, 1 };
+	int results[DM_ARRAY_SIZE(strs)];
+	unsigned i;
+
+	scanner = dm_regex_create(mem, patterns, DM_ARRAY_SIZE(patterns));
+	T_ASSERT(scanner != NULL);
+
+	for (i = 0; i < DM_ARRAY_SIZE(strs); i++)
+		T_ASSERT_EQUAL(dm_regex_match(scanner, strs[i]), expected[i]);
+
+	dm_regex_match_many(scanner, strs, DM_ARRAY_SIZE(strs), results);
+	for (i = 0; i < DM_ARRAY_SIZE(strs); i++)
+		T_ASSERT_EQUAL(results[i], expected[i]);
+}
+
+//----------------------------------------------------------------
+
+/*
+ * Throughput of matching a filter like config against the device
+ * aliases of a large SAN host.  Only the counts are checked, the
+ * numbers are printed for comparison.
+ */
+#define BENCH_ALIASES 50000
+#define BENCH_ROUNDS 10
+
+/* In the order the regex filter passes them: last filter entry first. */
+static const char * const _bench_patterns[] = {
+	".*",
+	"^/dev/sd.*",
+	"^/dev/disk/by-id/nvme-.*",
+	"^/dev/disk/by-id/dm-uuid-mpath-3600.*",
+	"^/dev/mapper/mpath[a-z]+$",
+	"^/dev/md/.*",
+};
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	(void) gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static char **_bench_aliases(struct dm_pool *mem)
+{
+	char **aliases;
+	char buf[128];
+	unsigned i, n;
+
+	T_ASSERT(aliases = dm_pool_alloc(mem, sizeof(*aliases) * BENCH_ALIASES));
+
+	for (i = 0; i < BENCH_ALIASES; i++) {
+		n = i / 10;
+		switch (i % 10) {
+		case 0:
+			snprintf(buf, sizeof(buf), "/dev/sd%c%c", 'a' + n % 26, 'a' + n / 26 % 26);
+			break;
+		case 1:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-id/scsi-3600508b1001c%08x", n);
+			break;
+		case 2:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-id/wwn-0x600508b1001c%08x", n);
+			break;
+		case 3:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-path/pci-0000:%02x:00.0-fc-0x5006016%07x-lun-%u",
+				 n % 256, n, n % 64);
+			break;
+		case 4:
+			snprintf(buf, sizeof(buf), "/dev/dm-%u", n);
+			break;
+		case 5:
+			snprintf(buf, sizeof(buf), "/dev/mapper/mpath%c%c", 'a' + n % 26, 'a' + n / 26 % 26);
+			break;
+		case 6:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-id/dm-uuid-mpath-3600508b1001c%08x", n);
+			break;
+		case 7:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-id/dm-name-mpath%c%c", 'a' + n % 26, 'a' + n / 26 % 26);
+			break;
+		case 8:
+			snprintf(buf, sizeof(buf), "/dev/nvme%un%u", n % 64, n / 64 + 1);
+			break;
+		default:
+			snprintf(buf, sizeof(buf), "/dev/disk/by-id/nvme-eui.%016x", n);
+		}
+		T_ASSERT(aliases[i] = dm_pool_strdup(mem, buf));
+	}
+
+	return aliases;
+}
+
+static void test_throughput(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_regex *scanner;
+	char **aliases = _bench_aliases(mem);
+	unsigned counts[DM_ARRAY_SIZE(_bench_patterns)] = { 0 };
+	int *results;
+	double start, elapsed;
+	unsigned i, r;
+	int m;
+
+	scanner = dm_regex_create(mem, _bench_patterns, DM_ARRAY_SIZE(_bench_patterns));
+	T_ASSERT(scanner != NULL);
+
+	start = _now();
+	for (r = 0; r < BENCH_ROUNDS; r++)
+		for (i = 0; i < BENCH_ALIASES; i++) {
+			m = dm_regex_match(scanner, aliases[i]);
+			T_ASSERT(m >= 0);
+			if (!r)
+				counts[m]++;
+		}
+	elapsed = _now() - start;
+
+	fprintf(stderr, "\n  dm_regex_match %.0f aliases/sec\n",
+		BENCH_ALIASES * BENCH_ROUNDS / (elapsed > 0 ? elapsed : 1e-6));
+
+	T_ASSERT(results = dm_pool_alloc(mem, sizeof(*results) * BENCH_ALIASES));
+
+	start = _now();
+	for (r = 0; r < BENCH_ROUNDS; r++)
+		dm_regex_match_many(scanner, (const char * const *) aliases,
+				    BENCH_ALIASES, results);
+	elapsed = _now() - start;
+
+	fprintf(stderr, "  dm_regex_match_many %.0f aliases/sec\n",
+		BENCH_ALIASES * BENCH_ROUNDS / (elapsed > 0 ? elapsed : 1e-6));
+
+	for (i = 0; i < BENCH_ALIASES; i++)
+		T_ASSERT_EQUAL(results[i], dm_regex_match(scanner, aliases[i]));
+
+	/* by-id scsi and wwn, by-path, dm-N, dm-name and nvme */
+	T_ASSERT_EQUAL(counts[0], BENCH_ALIASES / 10 * 6);
+	T_ASSERT_EQUAL(counts[1], BENCH_ALIASES / 10);
+	T_ASSERT_EQUAL(counts[2], BENCH_ALIASES / 10);
+	T_ASSERT_EQUAL(counts[3], BENCH_ALIASES / 10);
+	T_ASSERT_EQUAL(counts[4], BENCH_ALIASES / 10);
+	T_ASSERT_EQUAL(counts[5], 0);
+}
+
 #define T(path, desc, fn) register_test(ts, "/base/regex/" path, desc, fn)
 
 void regex_tests(struct dm_list *all_tests)
@@ -122,6 +282,8 @@ void regex_tests(struct dm_list *all_tests)
 	T("fingerprints", "not sure", test_fingerprints);
 	T("matching", "test the matcher with a variety of regexes", test_matching);
 	T("kabi-query", "test the matcher with some specific patterns", test_kabi_query);
+	T("lazy-states", "match with a dfa too big to calculate up front", test_lazy_states);
+	T("throughput", "match the aliases of a large host against a filter", test_throughput);
 
 	dm_list_add(all_tests, &ts->list);
 }
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/format_text/metadata_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEXT_CHECKSUM 0x12345678
+#define TEXT_SIZE 4096
+
+static const char *_metadata =
+	"vg0 {\n"
+	"id = \"yada-yada\"\n"
+	"seqno = 15\n"
+	"status = [\"RESIZEABLE\", \"READ\", \"WRITE\"]\n"
+	"flags = []\n"
+	"extent_size = 8192\n"
+	"max_lv = 0\n"
+	"physical_volumes {\n"
+	"pv0 {\n"
+	"id = \"abcd-efgh\"\n"
+	"device = \"/dev/sda\"\n"
+	"dev_size = 2097152\n"
+	"pe_start = 2048\n"
+	"}\n"
+	"pv1 {\n"
+	"id = \"bbcd-efgh\"\n"
+	"device = \"/dev/sdb\"\n"
+	"tags = [\"a\", \"b\\\"c\"]\n"
+	"}\n"
+	"}\n"
+	"logical_volumes {\n"
+	"lv0 {\n"
+	"segment1 {\n"
+	"stripes = [\"pv0\", 0, \"pv1\", 0]\n"
+	"ratio = 1.5\n"
+	"}\n"
+	"}\n"
+	"}\n"
+	"}\n"
+	"contents = \"Text Format Volume Group\"\n"
+	"empty = \"\"\n"
+	"version = 1\n";
+
+struct fixture {
+	char path[64];
+};
+
+static void *_fix_init(void)
+{
+	struct fixture *f = malloc(sizeof(*f));
+	int fd;
+
+	T_ASSERT(f);
+	snprintf(f->path, sizeof(f->path), "unit-test-XXXXXX");
+	/* coverity[secure_temp] don't care */
+	T_ASSERT((fd = mkstemp(f->path)) >= 0);
+	(void) close(fd);
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	(void) unlink(f->path);
+	free(f);
+}
+
+static int _append_line(const char *line, void *baton)
+{
+	char **out = baton;
+	char *s;
+
+	T_ASSERT(dm_asprintf(&s, "%s%s\n", *out ? : "", line) >= 0);
+	free(*out);
+	*out = s;
+
+	return 1;
+}
+
+static char *_tree_text(struct dm_config_tree *cft)
+{
+	char *out = NULL;
+
+	T_ASSERT(dm_config_write_node(cft->root, _append_line, &out));
+	T_ASSERT(out);
+
+	return out;
+}
+
+static struct dm_config_tree *_parse(void)
+{
+	struct dm_config_tree *cft;
+
+	T_ASSERT(cft = dm_config_create());
+	T_ASSERT(dm_config_parse_without_dup_node_check(cft, _metadata, _metadata + strlen(_metadata)));
+
+	return cft;
+}
+
+static void _write(struct fixture *f)
+{
+	struct dm_config_tree *cft = _parse();
+
+	T_ASSERT(metadata_cache_write_file(cft, f->path, TEXT_CHECKSUM, TEXT_SIZE));
+	dm_config_destroy(cft);
+}
+
+static int _read(struct fixture *f, uint32_t checksum, uint64_t size)
+{
+	struct dm_config_tree *cft;
+	int r;
+
+	T_ASSERT(cft = dm_config_create());
+	r = metadata_cache_read_file(cft, f->path, checksum, size);
+	if (!r)
+		T_ASSERT(!cft->root);
+	dm_config_destroy(cft);
+
+	return r;
+}
+
+//----------------------------------------------------------------
+
+static void _test_round_trip(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dm_config_tree *ref = _parse(), *cft;
+	char *ref_text, *text;
+
+	_write(f);
+
+	T_ASSERT(cft = dm_config_create());
+	T_ASSERT(metadata_cache_read_file(cft, f->path, TEXT_CHECKSUM, TEXT_SIZE));
+
+	ref_text = _tree_text(ref);
+	text = _tree_text(cft);
+	T_ASSERT(!strcmp(ref_text, text));
+
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "vg0/physical_volumes/pv1/device", ""), "/dev/sdb"));
+	T_ASSERT_EQUAL(dm_config_find_int(cft->root, "vg0/seqno", 0), 15);
+	T_ASSERT(dm_config_find_node(cft->root, "vg0/physical_volumes")->parent ==
+		 dm_config_find_node(cft->root, "vg0"));
+
+	free(ref_text);
+	free(text);
+	dm_config_destroy(ref);
+	dm_config_destroy(cft);
+}
+
+static void _test_stale(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_write(f);
+
+	T_ASSERT(!_read(f, TEXT_CHECKSUM + 1, TEXT_SIZE));
+	T_ASSERT(!_read(f, TEXT_CHECKSUM, TEXT_SIZE + 1));
+	T_ASSERT(_read(f, TEXT_CHECKSUM, TEXT_SIZE));
+}
+
+static void _test_corrupt(void *fixture)
+{
+	struct fixture *f = fixture;
+	off_t size, off;
+	char c;
+	int fd;
+
+	_write(f);
+
+	T_ASSERT((fd = open(f->path, O_RDWR)) >= 0);
+	T_ASSERT((size = lseek(fd, 0, SEEK_END)) > 0);
+
+	/* Flip a byte in the header, the records and the strings. */
+	for (off = 8; off < size; off += size / 3) {
+		T_ASSERT(pread(fd, &c, 1, off) == 1);
+		c ^= 0x40;
+		T_ASSERT(pwrite(fd, &c, 1, off) == 1);
+		T_ASSERT(!_read(f, TEXT_CHECKSUM, TEXT_SIZE));
+		c ^= 0x40;
+		T_ASSERT(pwrite(fd, &c, 1, off) == 1);
+		T_ASSERT(_read(f, TEXT_CHECKSUM, TEXT_SIZE));
+	}
+
+	/* Truncated */
+	T_ASSERT(!ftruncate(fd, size - 1));
+	T_ASSERT(!_read(f, TEXT_CHECKSUM, TEXT_SIZE));
+	T_ASSERT(!ftruncate(fd, 0));
+	T_ASSERT(!_read(f, TEXT_CHECKSUM, TEXT_SIZE));
+
+	(void) close(fd);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/metadata-cache/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("round-trip", "a saved tree reads back the same", _test_round_trip);
+	T("stale", "a file saved from other text is not used", _test_stale);
+	T("corrupt", "damaged files are rejected", _test_corrupt);
+
+	return ts;
+}
+
+void metadata_cache_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
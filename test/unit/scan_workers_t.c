@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "base/memory/zalloc.h"
+#include "lib/format_text/layout.h"
+#include "lib/label/label.h"
+#include "lib/label/scan_workers.h"
+#include "lib/misc/crc.h"
+#include "lib/mm/xlate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define PV_BLOCK_SIZE (128 * 1024)
+#define PV_MDA_START 4096
+#define PV_MDA_SIZE (1024 * 1024)
+
+#define MAX_PVS 64
+
+struct fake_pv {
+	char fname[64];
+	int fd;
+	char *block;
+	uint32_t checksum;
+	uint64_t size;
+};
+
+struct fixture {
+	struct fake_pv pvs[MAX_PVS];
+	struct scan_prepare_job jobs[MAX_PVS];
+	unsigned count;
+};
+
+static void *_fix_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+
+	T_ASSERT(f);
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	unsigned i;
+
+	scan_prepared_metadata_clear();
+
+	for (i = 0; i < f->count; i++) {
+		(void) close(f->pvs[i].fd);
+		(void) unlink(f->pvs[i].fname);
+		free(f->pvs[i].block);
+	}
+
+	free(f);
+}
+
+/* VG metadata text with nr_lvs LVs so the text size can be varied. */
+static char *_vg_text(unsigned vg, unsigned nr_lvs)
+{
+	size_t len = 1024 + nr_lvs * 256;
+	char *text, *p;
+	unsigned i;
+
+	T_ASSERT(text = malloc(len));
+
+	p = text + sprintf(text,
+			   "vg%u {\n"
+			   "id = \"%032u\"\n"
+			   "seqno = 1\n"
+			   "format = \"lvm2\"\n"
+			   "status = [\"RESIZEABLE\", \"READ\", \"WRITE\"]\n"
+			   "extent_size = 8192\n"
+			   "physical_volumes {\n"
+			   "pv0 {\n"
+			   "id = \"%032u\"\n"
+			   "device = \"/dev/sdx\"\n"
+			   "dev_size = 2097152\n"
+			   "pe_start = 2048\n"
+			   "pe_count = 255\n"
+			   "}\n"
+			   "}\n"
+			   "logical_volumes {\n",
+			   vg, vg, vg);
+
+	for (i = 0; i < nr_lvs; i++)
+		p += sprintf(p,
+			     "lv%u {\n"
+			     "id = \"%032u\"\n"
+			     "status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+			     "segment_count = 1\n"
+			     "segment1 {\n"
+			     "start_extent = 0\n"
+			     "extent_count = 1\n"
+			     "type = \"striped\"\n"
+			     "stripe_count = 1\n"
+			     "stripes = [\"pv0\", %u]\n"
+			     "}\n"
+			     "}\n",
+			     i, i, i);
+
+	sprintf(p, "}\n}\ncontents = \"Text Format Volume Group\"\nversion = 1\n");
+
+	return text;
+}
+
+/*
+ * Write a PV with one metadata area holding text at text_offset
+ * within the metadata area, wrapping around the end of the area.
+ */
+static void _add_pv(struct fixture *f, const char *text, uint64_t text_offset, int bad_checksum)
+{
+	struct fake_pv *pv = f->pvs + f->count;
+	struct label_header *lh;
+	struct pv_header *pvh;
+	struct mda_header *mdah;
+	uint64_t size = strlen(text);
+	uint64_t wrap = 0;
+	char *img;
+
+	T_ASSERT(f->count < MAX_PVS);
+	T_ASSERT(img = zalloc(PV_MDA_START + PV_MDA_SIZE));
+
+	lh = (struct label_header *) (img + LABEL_SIZE);
+	memcpy(lh->id, LABEL_ID, sizeof(lh->id));
+	lh->sector_xl = htole64(1);
+	lh->offset_xl = htole32(sizeof(*lh));
+	memcpy(lh->type, LVM2_LABEL, sizeof(lh->type));
+
+	pvh = (struct pv_header *) ((char *) lh + sizeof(*lh));
+	memset(pvh->pv_uuid, 'p', ID_LEN);
+	pvh->disk_areas_xl[0].offset = htole64(PV_MDA_START + PV_MDA_SIZE);
+	pvh->disk_areas_xl[0].size = 0;
+	/* [1] terminates data areas */
+	pvh->disk_areas_xl[2].offset = htole64(PV_MDA_START);
+	pvh->disk_areas_xl[2].size = htole64(PV_MDA_SIZE);
+	/* [3] terminates metadata areas */
+
+	if (text_offset + size > PV_MDA_SIZE)
+		wrap = text_offset + size - PV_MDA_SIZE;
+
+	memcpy(img + PV_MDA_START + text_offset, text, size - wrap);
+	memcpy(img + PV_MDA_START + MDA_HEADER_SIZE, text + size - wrap, wrap);
+
+	mdah = (struct mda_header *) (img + PV_MDA_START);
+	memcpy(mdah->magic, FMTT_MAGIC, sizeof(mdah->magic));
+	mdah->version = htole32(FMTT_VERSION);
+	mdah->start = htole64(PV_MDA_START);
+	mdah->size = htole64(PV_MDA_SIZE);
+	mdah->raw_locns[0].offset = htole64(text_offset);
+	mdah->raw_locns[0].size = htole64(size);
+	pv->checksum = calc_crc(INITIAL_CRC, (const uint8_t *) text, size);
+	pv->size = size;
+	mdah->raw_locns[0].checksum = htole32(pv->checksum + (bad_checksum ? 1 : 0));
+	mdah->checksum_xl = htole32(calc_crc(INITIAL_CRC, (const uint8_t *) mdah->magic,
+					     MDA_HEADER_SIZE - sizeof(mdah->checksum_xl)));
+
+	snprintf(pv->fname, sizeof(pv->fname), "unit-test-XXXXXX");
+	/* coverity[secure_temp] don't care */
+	T_ASSERT((pv->fd = mkstemp(pv->fname)) >= 0);
+	T_ASSERT(write(pv->fd, img, PV_MDA_START + PV_MDA_SIZE) == PV_MDA_START + PV_MDA_SIZE);
+
+	T_ASSERT(pv->block = malloc(PV_BLOCK_SIZE));
+	memcpy(pv->block, img, PV_BLOCK_SIZE);
+	free(img);
+
+	f->jobs[f->count].fd = pv->fd;
+	f->jobs[f->count].block = pv->block;
+	f->jobs[f->count].block_size = PV_BLOCK_SIZE;
+	f->count++;
+}
+
+static const char *_prepared_vgname(struct fake_pv *pv)
+{
+	const struct dm_config_tree *cft;
+	const struct dm_config_node *cn;
+
+	if (!(cft = scan_prepared_metadata(pv->checksum, pv->size)))
+		return NULL;
+
+	for (cn = cft->root; cn && cn->v; cn = cn->sib)
+		;
+
+	return cn ? cn->key : NULL;
+}
+
+//----------------------------------------------------------------
+
+static void _test_shared_metadata(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *text1 = _vg_text(1, 4);
+	char *text2 = _vg_text(2, 8);
+	unsigned i;
+
+	/* Four PVs in each of two VGs */
+	for (i = 0; i < 8; i++)
+		_add_pv(f, (i & 1) ? text2 : text1, 512 + i * 4096, 0);
+
+	/* Each text is parsed once. */
+	T_ASSERT_EQUAL(scan_prepare_metadata(f->jobs, f->count, 4), 2);
+
+	T_ASSERT(!strcmp(_prepared_vgname(f->pvs + 0), "vg1"));
+	T_ASSERT(!strcmp(_prepared_vgname(f->pvs + 1), "vg2"));
+	T_ASSERT(!scan_prepared_metadata(f->pvs[0].checksum + 1, f->pvs[0].size));
+
+	scan_prepared_metadata_clear();
+	T_ASSERT(!scan_prepared_metadata(f->pvs[0].checksum, f->pvs[0].size));
+
+	free(text1);
+	free(text2);
+}
+
+static void _test_bad_checksum(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *text = _vg_text(3, 2);
+
+	_add_pv(f, text, 512, 1);
+
+	T_ASSERT_EQUAL(scan_prepare_metadata(f->jobs, f->count, 2), 0);
+	T_ASSERT(!_prepared_vgname(f->pvs));
+
+	free(text);
+}
+
+static void _test_wrapped_text(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *text = _vg_text(4, 16);
+
+	_add_pv(f, text, PV_MDA_SIZE - 1000, 0);
+
+	T_ASSERT_EQUAL(scan_prepare_metadata(f->jobs, f->count, 2), 1);
+	T_ASSERT(!strcmp(_prepared_vgname(f->pvs), "vg4"));
+
+	free(text);
+}
+
+static void _test_not_a_pv(void *fixture)
+{
+	struct fixture *f = fixture;
+	char *text = _vg_text(5, 1);
+
+	_add_pv(f, text, 512, 0);
+	memset(f->pvs[0].block + LABEL_SIZE, 0, LABEL_SIZE);
+
+	T_ASSERT_EQUAL(scan_prepare_metadata(f->jobs, f->count, 2), 0);
+
+	free(text);
+}
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	(void) gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Timings for parsing the metadata of MAX_PVS VGs with 1 to 8 workers.
+ * The files are in the page cache, so this measures the cpu side of
+ * the scan.
+ */
+static void _test_worker_scaling(void *fixture)
+{
+	struct fixture *f = fixture;
+	static const unsigned workers[] = { 1, 2, 4, 8 };
+	double start, elapsed, base = 0;
+	char *text;
+	unsigned i;
+
+	for (i = 0; i < MAX_PVS; i++) {
+		text = _vg_text(100 + i, 1000);
+		_add_pv(f, text, 512, 0);
+		free(text);
+	}
+
+	fprintf(stderr, "\n");
+	for (i = 0; i < DM_ARRAY_SIZE(workers); i++) {
+		start = _now();
+		T_ASSERT_EQUAL(scan_prepare_metadata(f->jobs, f->count, workers[i]), MAX_PVS);
+		elapsed = _now() - start;
+		scan_prepared_metadata_clear();
+
+		if (!i)
+			base = elapsed;
+
+		fprintf(stderr, "  %u workers: %u VGs of %llu KiB in %.1f ms, speedup %.2f\n",
+			workers[i], MAX_PVS, (unsigned long long) f->pvs[0].size / 1024,
+			elapsed * 1000.0, base / (elapsed > 0 ? elapsed : 1e-6));
+	}
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/scan-workers/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("shared-metadata", "PVs in the same VG share one parse", _test_shared_metadata);
+	T("bad-checksum", "text not matching the mda_header checksum is not used", _test_bad_checksum);
+	T("wrapped-text", "text wrapping around the end of the mda", _test_wrapped_text);
+	T("not-a-pv", "devices without a label are skipped", _test_not_a_pv);
+	T("worker-scaling", "parse timings for 1 to 8 workers", _test_worker_scaling);
+
+	return ts;
+}
+
+void scan_workers_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
@@ -24,18 +24,25 @@ void bcache_tests(struct dm_list *all_tests);
 void bcache_utils_tests(struct dm_list *all_tests);
 void bitset_tests(struct dm_list *all_tests);
 void config_tests(struct dm_list *all_tests);
+void crc_tests(struct dm_list *all_tests);
 void daemon_stray_tests(struct dm_list *all_tests);
+void dev_sysfs_tests(struct dm_list *all_tests);
 void dm_list_tests(struct dm_list *all_tests);
 void dm_hash_tests(struct dm_list *all_tests);
 void dm_status_tests(struct dm_list *all_tests);
+void import_stream_tests(struct dm_list *all_tests);
 void io_engine_tests(struct dm_list *all_tests);
+void metadata_cache_tests(struct dm_list *all_tests);
 void metadata_security_tests(struct dm_list *all_tests);
 void percent_tests(struct dm_list *all_tests);
 void radix_tree_tests(struct dm_list *all_tests);
 void regex_tests(struct dm_list *all_tests);
+void scan_workers_tests(struct dm_list *all_tests);
 void string_tests(struct dm_list *all_tests);
 void vdo_tests(struct dm_list *all_tests);
 void vdo_stats_tests(struct dm_list *all_tests);
+void vg_index_tests(struct dm_list *all_tests);
+void vg_write_tests(struct dm_list *all_tests);
 
 // ... and call it in here.
 static inline void register_all_tests(struct dm_list *all_tests)
@@ -44,18 +51,25 @@ static inline void register_all_tests(struct dm_list *all_tests)
 	bcache_utils_tests(all_tests);
 	bitset_tests(all_tests);
 	config_tests(all_tests);
+	crc_tests(all_tests);
 	daemon_stray_tests(all_tests);
+	dev_sysfs_tests(all_tests);
 	dm_list_tests(all_tests);
 	dm_hash_tests(all_tests);
 	dm_status_tests(all_tests);
+	import_stream_tests(all_tests);
 	io_engine_tests(all_tests);
+	metadata_cache_tests(all_tests);
 	metadata_security_tests(all_tests);
 	percent_tests(all_tests);
 	radix_tree_tests(all_tests);
 	regex_tests(all_tests);
+	scan_workers_tests(all_tests);
 	string_tests(all_tests);
 	vdo_tests(all_tests);
 	vdo_stats_tests(all_tests);
+	vg_index_tests(all_tests);
+	vg_write_tests(all_tests);
 }
 
 //-----------------------------------------------------------------
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "base/memory/zalloc.h"
+#include "lib/misc/lib.h"
+#include "lib/metadata/metadata.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The LV and PV uuid indexes of a VG must follow PVs and LVs moved by
+ * vgsplit and vgmerge, and uuids changed in place by pvchange -u.
+ * The moves below are done the way the tools do them.
+ */
+
+#define NR_PVS 4
+#define NR_LVS 4
+
+struct fixture {
+	struct format_handler ops;
+	struct format_type fmt;
+	struct format_instance fid;
+	struct format_instance orphan_fid;
+	struct volume_group *orphan_vg;
+	struct volume_group *vg1;
+	struct volume_group *vg2;
+	struct pv_list *pvl[NR_PVS];
+	struct logical_volume *lv[NR_LVS];
+};
+
+static void _destroy_instance(struct format_instance *fid)
+{
+	fid->ref_count--;
+}
+
+static void _set_id(struct id *id, char c)
+{
+	memset(id->uuid, c, ID_LEN);
+}
+
+static struct volume_group *_vg(struct fixture *f, const char *name, char c)
+{
+	struct volume_group *vg;
+
+	T_ASSERT(vg = alloc_vg("vg_index_t", NULL, name));
+	_set_id(&vg->id, c);
+	vg->fid = (vg == f->orphan_vg) ? &f->orphan_fid : &f->fid;
+
+	return vg;
+}
+
+static struct pv_list *_add_pv(struct volume_group *vg, char c)
+{
+	struct pv_list *pvl;
+
+	T_ASSERT(pvl = dm_pool_zalloc(vg->vgmem, sizeof(*pvl)));
+	T_ASSERT(pvl->pv = dm_pool_zalloc(vg->vgmem, sizeof(*pvl->pv)));
+	_set_id(&pvl->pv->id, c);
+	add_pvl_to_vgs(vg, pvl);
+
+	return pvl;
+}
+
+/* Like lv_create_empty(): linked first, uuid and name set after. */
+static struct logical_volume *_add_lv(struct volume_group *vg, const char *name, char c)
+{
+	struct logical_volume *lv;
+	const char *lv_name;
+
+	T_ASSERT(lv = dm_pool_zalloc(vg->vgmem, sizeof(*lv)));
+	T_ASSERT(lv_name = dm_pool_strdup(vg->vgmem, name));
+	dm_list_init(&lv->segments);
+	T_ASSERT(link_lv_to_vg(vg, lv));
+	lv->lvid.id[0] = vg->id;
+	_set_id(&lv->lvid.id[1], c);
+	T_ASSERT(lv_set_name(lv, lv_name));
+
+	return lv;
+}
+
+static void *_fix_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+	char name[8];
+	unsigned i;
+
+	T_ASSERT(f);
+	f->ops.destroy_instance = _destroy_instance;
+	f->fmt.ops = &f->ops;
+	f->fid.fmt = &f->fmt;
+	f->orphan_fid.fmt = &f->fmt;
+
+	T_ASSERT(f->orphan_vg = alloc_vg("vg_index_t", NULL, "#orphans"));
+	f->orphan_vg->fid = &f->orphan_fid;
+	f->fmt.orphan_vg = f->orphan_vg;
+
+	f->vg1 = _vg(f, "vg1", '1');
+	f->vg2 = _vg(f, "vg2", '2');
+
+	for (i = 0; i < NR_PVS; i++)
+		f->pvl[i] = _add_pv(f->vg1, 'a' + i);
+
+	for (i = 0; i < NR_LVS; i++) {
+		snprintf(name, sizeof(name), "lv%u", i);
+		f->lv[i] = _add_lv(f->vg1, name, 'A' + i);
+	}
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	f->vg1->fid = f->vg2->fid = f->orphan_vg->fid = NULL;
+	free_orphan_vg(f->vg1);
+	free_orphan_vg(f->vg2);
+	free_orphan_vg(f->orphan_vg);
+	free(f);
+}
+
+static struct logical_volume *_lookup_lv(struct volume_group *vg, struct logical_volume *lv)
+{
+	union lvid lvid = lv->lvid;
+
+	lvid.id[0] = vg->id;
+
+	return find_lv_in_vg_by_lvid(vg, &lvid);
+}
+
+static struct pv_list *_lookup_pv(struct volume_group *vg, struct pv_list *pvl)
+{
+	return find_pv_in_vg_by_uuid(vg, &pvl->pv->id);
+}
+
+/* Every PV and LV is found in the VG holding it, and only there. */
+static void _check_lookups(struct fixture *f)
+{
+	struct volume_group *vg, *other;
+	unsigned i;
+
+	for (i = 0; i < NR_PVS; i++) {
+		vg = f->pvl[i]->pv->vg;
+		other = (vg == f->vg1) ? f->vg2 : f->vg1;
+		T_ASSERT(_lookup_pv(vg, f->pvl[i]) == f->pvl[i]);
+		T_ASSERT(pv_is_in_vg(vg, f->pvl[i]->pv));
+		T_ASSERT(!_lookup_pv(other, f->pvl[i]));
+		T_ASSERT(!pv_is_in_vg(other, f->pvl[i]->pv));
+	}
+
+	for (i = 0; i < NR_LVS; i++) {
+		vg = f->lv[i]->vg;
+		other = (vg == f->vg1) ? f->vg2 : f->vg1;
+		T_ASSERT(_lookup_lv(vg, f->lv[i]) == f->lv[i]);
+		T_ASSERT(!_lookup_lv(other, f->lv[i]));
+		T_ASSERT(find_lv(vg, f->lv[i]->name) == f->lv[i]);
+		T_ASSERT(!find_lv(other, f->lv[i]->name));
+	}
+}
+
+static void _test_build(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_check_lookups(f);
+	T_ASSERT(f->vg1->lv_uuids);
+	T_ASSERT(f->vg1->pv_uuids);
+
+	/* Added after the index was built. */
+	f->pvl[0] = _add_pv(f->vg1, 'z');
+	f->lv[0] = _add_lv(f->vg1, "new", 'Z');
+	_check_lookups(f);
+}
+
+/* As _move_pv() and _move_one_lv() in vgsplit. */
+static void _test_split(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dm_list *lvh;
+	unsigned i;
+
+	_check_lookups(f);
+	(void) vg_lv_uuids(f->vg2);
+	(void) vg_pv_uuids(f->vg2);
+
+	for (i = 0; i < NR_PVS; i += 2) {
+		del_pvl_from_vgs(f->vg1, f->pvl[i]);
+		add_pvl_to_vgs(f->vg2, f->pvl[i]);
+		_check_lookups(f);
+	}
+
+	for (i = 0; i < NR_LVS; i += 2) {
+		lvh = &f->lv[i]->lvl.list;
+		dm_list_move(&f->vg2->lvs, lvh);
+		T_ASSERT(lv_set_vg(f->lv[i], f->vg2));
+		f->lv[i]->lvid.id[0] = f->vg2->id;
+		_check_lookups(f);
+	}
+
+	T_ASSERT_EQUAL(f->vg1->pv_count, NR_PVS / 2);
+	T_ASSERT_EQUAL(f->vg2->pv_count, NR_PVS / 2);
+}
+
+/* As vgmerge. */
+static void _test_merge(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct pv_list *pvl, *tpvl;
+	struct lv_list *lvl;
+	unsigned i;
+
+	/* Start from a split VG, with indexes built for both VGs. */
+	_test_split(f);
+
+	dm_list_iterate_items_safe(pvl, tpvl, &f->vg2->pvs) {
+		del_pvl_from_vgs(f->vg2, pvl);
+		add_pvl_to_vgs(f->vg1, pvl);
+	}
+
+	dm_list_iterate_items(lvl, &f->vg2->lvs) {
+		T_ASSERT(lv_set_vg(lvl->lv, f->vg1));
+		lvl->lv->lvid.id[0] = lvl->lv->vg->id;
+	}
+
+	while (!dm_list_empty(&f->vg2->lvs))
+		dm_list_move(&f->vg1->lvs, f->vg2->lvs.n);
+
+	_check_lookups(f);
+
+	for (i = 0; i < NR_PVS; i++)
+		T_ASSERT(f->pvl[i]->pv->vg == f->vg1);
+	T_ASSERT(dm_list_empty(&f->vg2->pvs));
+}
+
+/* As pvchange -u. */
+static void _test_pv_uuid_change(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct id old_id;
+
+	_check_lookups(f);
+
+	old_id = f->pvl[1]->pv->id;
+	_set_id(&f->pvl[1]->pv->id, 'y');
+	vg_drop_uuid_index(f->vg1);
+
+	T_ASSERT(!find_pv_in_vg_by_uuid(f->vg1, &old_id));
+	_check_lookups(f);
+}
+
+static void _test_duplicate(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct pv_list *pvl;
+
+	/* A duplicate uuid drops the index and lookups use the lists. */
+	pvl = _add_pv(f->vg1, 'a');
+	T_ASSERT(!f->vg1->pv_uuids);
+	T_ASSERT(!vg_pv_uuids(f->vg1));
+	T_ASSERT(_lookup_pv(f->vg1, pvl) == f->pvl[0]);
+
+	del_pvl_from_vgs(f->vg1, pvl);
+	_check_lookups(f);
+	T_ASSERT(f->vg1->pv_uuids);
+}
+
+#define T(path, desc, fn) register_test(ts, "/metadata/vg_index/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("build", "lookups find PVs and LVs added before and after indexing", _test_build);
+	T("split", "lookups follow PVs and LVs moved by vgsplit", _test_split);
+	T("merge", "lookups follow PVs and LVs moved by vgmerge", _test_merge);
+	T("pv-uuid-change", "lookups use a PV uuid changed by pvchange -u", _test_pv_uuid_change);
+	T("duplicate", "duplicate PV uuids fall back to the list", _test_duplicate);
+
+	return ts;
+}
+
+void vg_index_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2026 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "base/memory/zalloc.h"
+#include "lib/misc/lib.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/cache/lvmcache.h"
+#include "lib/label/label.h"
+#include "lib/log/lvm-logging.h"
+#include "lib/metadata/metadata.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/*
+ * vg_write() and vg_commit() queue the writes of each step for all mdas
+ * in bcache and issue them together.  These tests fail the writes to one
+ * of two devices and check what is left on disk.
+ *
+ * The mdas use a minimal format: a text block holding the seqno, and a
+ * header block holding the committed and precommitted seqnos, written
+ * the way the text format writes its text and mda_header.  Devices are
+ * files, and writes fail with EFBIG beyond RLIMIT_FSIZE, so an area is
+ * made to fail by placing it beyond the limit set around a call.
+ */
+
+#define NR_DEVS 2
+#define DEV_SIZE (2 * 1024 * 1024)
+#define LIMIT (512 * 1024)
+#define GOOD_OFFSET(n) ((1 + (n)) * 128 * 1024)
+#define BAD_OFFSET(n) (LIMIT + (1 + (n)) * 128 * 1024)
+#define OLD_SEQNO 1
+#define NEW_SEQNO 2
+
+struct fake_header {
+	uint32_t committed;
+	uint32_t precommitted;
+};
+
+struct fake_mda {
+	struct metadata_area mda;
+	struct device dev;
+	struct dm_str_list alias;
+	char path[32];
+	uint64_t text_offset;
+	uint64_t header_offset;
+	uint32_t committed;
+	unsigned commits;
+	unsigned reverts;
+	int fail_commit;
+};
+
+struct fixture {
+	struct cmd_context cmd;
+	struct format_handler ops;
+	struct format_type fmt;
+	struct format_instance fid;
+	struct metadata_area_ops mda_ops;
+	struct fake_mda fm[NR_DEVS];
+	struct volume_group *vg;
+};
+
+static int _write_block(struct metadata_area *mda, uint64_t offset, const void *data, size_t len)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+	char buf[512] = { 0 };
+
+	memcpy(buf, data, len);
+
+	return dev_write_bytes(&fm->dev, offset, sizeof(buf), buf);
+}
+
+static int _write_header(struct metadata_area *mda, uint32_t committed, uint32_t precommitted)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+	struct fake_header h = { .committed = committed, .precommitted = precommitted };
+
+	return _write_block(mda, fm->header_offset, &h, sizeof(h));
+}
+
+static int _fake_vg_write(struct format_instance *fid, struct volume_group *vg,
+			  struct metadata_area *mda)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+
+	return _write_block(mda, fm->text_offset, &vg->seqno, sizeof(vg->seqno));
+}
+
+static int _fake_vg_precommit(struct format_instance *fid, struct volume_group *vg,
+			      struct metadata_area *mda)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+
+	return _write_header(mda, fm->committed, vg->seqno);
+}
+
+static int _fake_vg_commit(struct format_instance *fid, struct volume_group *vg,
+			   struct metadata_area *mda)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+
+	fm->commits++;
+
+	/* The header write is still queued and fails or not on its own. */
+	return _write_header(mda, vg->seqno, 0) && !fm->fail_commit;
+}
+
+static int _fake_vg_revert(struct format_instance *fid, struct volume_group *vg,
+			   struct metadata_area *mda)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+
+	fm->reverts++;
+
+	return _write_header(mda, fm->committed, 0);
+}
+
+static struct device *_fake_mda_get_device(struct metadata_area *mda)
+{
+	struct fake_mda *fm = mda->metadata_locn;
+
+	return &fm->dev;
+}
+
+static unsigned _dirty_warnings;
+
+static void _count_dirty_warnings(int level, const char *file, int line,
+				  int dm_errno_or_class, const char *message)
+{
+	if (strstr(message, "still dirty"))
+		_dirty_warnings++;
+}
+
+static void _destroy_instance(struct format_instance *fid)
+{
+	fid->ref_count--;
+}
+
+static void _set_limit(rlim_t limit)
+{
+	struct rlimit rl;
+
+	T_ASSERT(!getrlimit(RLIMIT_FSIZE, &rl));
+	rl.rlim_cur = limit;
+	T_ASSERT(!setrlimit(RLIMIT_FSIZE, &rl));
+}
+
+static void _set_offsets(struct fixture *f, unsigned i, uint64_t text_offset, uint64_t header_offset)
+{
+	struct fake_header h = { .committed = OLD_SEQNO };
+	char buf[512] = { 0 };
+	int fd;
+
+	f->fm[i].text_offset = text_offset;
+	f->fm[i].header_offset = header_offset;
+
+	/* The header starts out committed at OLD_SEQNO. */
+	memcpy(buf, &h, sizeof(h));
+	T_ASSERT((fd = open(f->fm[i].path, O_WRONLY)) >= 0);
+	T_ASSERT(pwrite(fd, buf, sizeof(buf), header_offset) == sizeof(buf));
+	T_ASSERT(!close(fd));
+}
+
+static struct fake_header _read_header(struct fixture *f, unsigned i)
+{
+	struct fake_header h;
+	int fd;
+
+	T_ASSERT((fd = open(f->fm[i].path, O_RDONLY)) >= 0);
+	T_ASSERT(pread(fd, &h, sizeof(h), f->fm[i].header_offset) == sizeof(h));
+	T_ASSERT(!close(fd));
+
+	return h;
+}
+
+static void *_fix_init(void)
+{
+	static int _lvmcache_ready;
+	struct fixture *f = zalloc(sizeof(*f));
+	struct fake_mda *fm;
+	unsigned i;
+	int fd;
+
+	T_ASSERT(f);
+
+	(void) signal(SIGXFSZ, SIG_IGN);
+
+	if (!_lvmcache_ready) {
+		T_ASSERT(lvmcache_init(&f->cmd));
+		_lvmcache_ready = 1;
+	}
+
+	T_ASSERT(label_scan_setup_bcache());
+
+	f->mda_ops.vg_write = _fake_vg_write;
+	f->mda_ops.vg_precommit = _fake_vg_precommit;
+	f->mda_ops.vg_commit = _fake_vg_commit;
+	f->mda_ops.vg_revert = _fake_vg_revert;
+	f->mda_ops.mda_get_device = _fake_mda_get_device;
+
+	f->ops.destroy_instance = _destroy_instance;
+	f->fmt.ops = &f->ops;
+	f->fid.fmt = &f->fmt;
+	dm_list_init(&f->fid.metadata_areas_in_use);
+	dm_list_init(&f->fid.metadata_areas_ignored);
+
+	T_ASSERT(f->vg = alloc_vg("vg_write_t", &f->cmd, "vg_write_t"));
+	f->vg->fid = &f->fid;
+	f->vg->seqno = OLD_SEQNO;
+
+	for (i = 0; i < NR_DEVS; i++) {
+		fm = &f->fm[i];
+		snprintf(fm->path, sizeof(fm->path), "unit-test-XXXXXX");
+		/* coverity[secure_temp] don't care */
+		T_ASSERT((fd = mkstemp(fm->path)) >= 0);
+		T_ASSERT(!ftruncate(fd, DEV_SIZE));
+		T_ASSERT(!close(fd));
+
+		dev_init(&fm->dev);
+		fm->alias.str = fm->path;
+		dm_list_add(&fm->dev.aliases, &fm->alias.list);
+
+		fm->mda.ops = &f->mda_ops;
+		fm->mda.metadata_locn = fm;
+		fm->committed = OLD_SEQNO;
+		dm_list_add(&f->fid.metadata_areas_in_use, &fm->mda.list);
+
+		_set_offsets(f, i, GOOD_OFFSET(0), GOOD_OFFSET(1));
+	}
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	unsigned i;
+
+	for (i = 0; i < NR_DEVS; i++) {
+		label_scan_invalidate(&f->fm[i].dev);
+		(void) unlink(f->fm[i].path);
+	}
+
+	f->vg->fid = NULL;
+	free_orphan_vg(f->vg);
+	free(f);
+}
+
+static int _vg_write(struct fixture *f)
+{
+	int r;
+
+	_set_limit(LIMIT);
+	r = vg_write(f->vg);
+	_set_limit(RLIM_INFINITY);
+
+	return r;
+}
+
+static int _vg_commit(struct fixture *f)
+{
+	int r;
+
+	_set_limit(LIMIT);
+	r = vg_commit(f->vg);
+	_set_limit(RLIM_INFINITY);
+
+	return r;
+}
+
+static void _check_header(struct fixture *f, unsigned i, uint32_t committed, uint32_t precommitted)
+{
+	struct fake_header h = _read_header(f, i);
+
+	T_ASSERT_EQUAL(h.committed, committed);
+	T_ASSERT_EQUAL(h.precommitted, precommitted);
+}
+
+static void _test_commit(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	T_ASSERT(_vg_write(f));
+	_check_header(f, 0, OLD_SEQNO, NEW_SEQNO);
+	_check_header(f, 1, OLD_SEQNO, NEW_SEQNO);
+
+	T_ASSERT(_vg_commit(f));
+	_check_header(f, 0, NEW_SEQNO, 0);
+	_check_header(f, 1, NEW_SEQNO, 0);
+}
+
+/* The text of one device fails: headers on both keep the old commit. */
+static void _test_write_error(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 1, BAD_OFFSET(0), GOOD_OFFSET(1));
+
+	T_ASSERT(!_vg_write(f));
+	_check_header(f, 0, OLD_SEQNO, 0);
+	_check_header(f, 1, OLD_SEQNO, 0);
+
+	/* Only the device that was written is reverted. */
+	T_ASSERT_EQUAL(f->fm[0].reverts, 1);
+	T_ASSERT_EQUAL(f->fm[1].reverts, 0);
+	T_ASSERT_EQUAL(f->fm[0].commits + f->fm[1].commits, 0);
+}
+
+/* The precommit of one device fails: the other one is reverted. */
+static void _test_precommit_error(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 1, GOOD_OFFSET(0), BAD_OFFSET(1));
+
+	T_ASSERT(!_vg_write(f));
+	_check_header(f, 0, OLD_SEQNO, 0);
+	_check_header(f, 1, OLD_SEQNO, 0);
+
+	T_ASSERT_EQUAL(f->fm[0].reverts, 1);
+	T_ASSERT_EQUAL(f->fm[0].commits + f->fm[1].commits, 0);
+}
+
+/* The commit of one device fails: the VG is committed on the other. */
+static void _test_commit_error_one(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 1, GOOD_OFFSET(0), BAD_OFFSET(1));
+
+	T_ASSERT(vg_write(f->vg));
+	T_ASSERT(_vg_commit(f));
+	_check_header(f, 0, NEW_SEQNO, 0);
+	_check_header(f, 1, OLD_SEQNO, NEW_SEQNO);
+}
+
+/* The commits of all devices fail: vg_commit fails. */
+static void _test_commit_error_all(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 0, GOOD_OFFSET(0), BAD_OFFSET(1));
+	_set_offsets(f, 1, GOOD_OFFSET(0), BAD_OFFSET(1));
+
+	T_ASSERT(vg_write(f->vg));
+	T_ASSERT(!_vg_commit(f));
+	_check_header(f, 0, OLD_SEQNO, NEW_SEQNO);
+	_check_header(f, 1, OLD_SEQNO, NEW_SEQNO);
+}
+
+/*
+ * The commit of one device returns failure and its queued write fails
+ * too: it is counted as failed once, and the VG is committed on the other.
+ */
+static void _test_commit_error_twice(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 0, GOOD_OFFSET(0), BAD_OFFSET(1));
+	f->fm[0].fail_commit = 1;
+
+	T_ASSERT(vg_write(f->vg));
+	T_ASSERT(_vg_commit(f));
+	_check_header(f, 0, OLD_SEQNO, NEW_SEQNO);
+	_check_header(f, 1, NEW_SEQNO, 0);
+}
+
+/* The blocks of failed writes are dropped without warnings. */
+static void _test_error_quiet(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_set_offsets(f, 1, BAD_OFFSET(0), GOOD_OFFSET(1));
+
+	_dirty_warnings = 0;
+	init_log_fn(_count_dirty_warnings);
+	T_ASSERT(!_vg_write(f));
+	init_log_fn(NULL);
+
+	T_ASSERT_EQUAL(_dirty_warnings, 0);
+	T_ASSERT(!(f->fm[1].dev.flags & DEV_IN_BCACHE));
+}
+
+#define T(path, desc, fn) register_test(ts, "/metadata/vg_write/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("commit", "vg_write and vg_commit write all devices", _test_commit);
+	T("write-error", "failed text write leaves the old metadata committed", _test_write_error);
+	T("precommit-error", "failed precommit leaves the old metadata committed", _test_precommit_error);
+	T("commit-error-one", "failed commit on one device commits the others", _test_commit_error_one);
+	T("commit-error-all", "failed commit on all devices fails vg_commit", _test_commit_error_all);
+	T("commit-error-twice", "mda failing both commit and write is counted once", _test_commit_error_twice);
+	T("error-quiet", "failed writes are dropped from bcache without warnings", _test_error_quiet);
+
+	return ts;
+}
+
+void vg_write_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
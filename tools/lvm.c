@@ -227,6 +227,7 @@ int lvm_shell(struct cmd_context *cmd, struct cmdline_context *cmdline)
 	_cmdline = cmdline;
 
 	cmd->is_interactive = 1;
+	cmd->is_long_lived = 1;
 
 	if (!report_format_init(cmd))
 		return_ECMD_FAILED;
@@ -33,6 +33,8 @@ void *cmdlib_lvm2_init(unsigned static_compile, unsigned threaded)
 	if (!(cmd = init_lvm(1, 1, threaded)))
 		return NULL;
 
+	cmd->is_long_lived = 1;
+
 	if (!lvm_register_commands(cmd, NULL)) {
 		lvm_fin(cmd);
 		return NULL;
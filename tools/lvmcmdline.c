@@ -18,6 +18,8 @@
 #include "lvm2cmdline.h"
 #include "lib/label/label.h"
 #include "lib/device/device_id.h"
+#include "lib/device/dev-sysfs.h"
+#include "lib/filters/filter.h"
 #include "lvm-version.h"
 #include "lib/locking/lvmlockd.h"
 #include "lib/datastruct/str_list.h"
@@ -3338,6 +3340,9 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 	lvmcache_destroy(cmd, 1, 1);
 	label_scan_destroy(cmd);
 	devices_file_exit(cmd);
+	if (cmd->filter)
+		persistent_filter_dump(cmd, cmd->filter);
+	sysfs_cache_destroy();
 
 	if ((config_string_cft = remove_config_tree_by_source(cmd, CONFIG_STRING)))
 		dm_config_destroy(config_string_cft);
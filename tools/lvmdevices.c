@@ -165,6 +165,7 @@ static void _print_check(struct cmd_context *cmd)
 		log_debug("Failed to read the devices file.");
 	dm_list_splice(&use_old, &cmd->use_devices);
 	dm_list_init(&cmd->use_devices);
+	du_index_invalidate(cmd);
 
 	/*
 	 * Check if system identifier is changed.
@@ -554,6 +555,7 @@ restart4:
 
 	dm_list_splice(&cmd->use_devices, &use_new);
 	dm_list_splice(&cmd->use_devices, &done_new);
+	du_index_invalidate(cmd);
 	free_dus(&use_old);
 	free_dus(&done_old);
 }
@@ -730,8 +732,10 @@ int lvmdevices(struct cmd_context *cmd, int argc, char **argv)
 
 			update_needed = 1;
 
-			if (update_set)
+			if (update_set) {
 				dm_list_del(&du->list);
+				du_index_invalidate(cmd);
+			}
 
 			if (!(mpath_dev = dev_cache_get_by_devt(cmd, mpath_devno)))
 				continue;
@@ -781,6 +785,7 @@ int lvmdevices(struct cmd_context *cmd, int argc, char **argv)
 						_part_str(du));
 					dm_list_del(&du->list);
 					free_du(du);
+					du_index_invalidate(cmd);
 					update_needed = 1;
 				}
 			}
@@ -1004,6 +1009,7 @@ int lvmdevices(struct cmd_context *cmd, int argc, char **argv)
  dev_del:
 		dm_list_del(&du->list);
 		free_du(du);
+		du_index_invalidate(cmd);
 		if (!device_ids_write(cmd)) {
 			log_error(failed_to_write_devices_file_msg);
 			goto_bad;
@@ -1061,6 +1067,7 @@ int lvmdevices(struct cmd_context *cmd, int argc, char **argv)
 
 		dm_list_del(&du->list);
 		free_du(du);
+		du_index_invalidate(cmd);
 		if (!device_ids_write(cmd)) {
 			log_error(failed_to_write_devices_file_msg);
 			goto_bad;
@@ -1086,6 +1093,7 @@ int lvmdevices(struct cmd_context *cmd, int argc, char **argv)
 		}
 
 		dm_list_del(&du->list);
+		du_index_invalidate(cmd);
 
 		if ((du2 = get_du_for_pvid(cmd, pvid))) {
 			log_error("Multiple devices file entries for PVID %s (%s %s), remove by device name.",
@@ -156,6 +156,8 @@ static int _pvchange_single(struct cmd_context *cmd, struct volume_group *vg,
 				  pv_name);
 			goto bad;
 		}
+		if (vg)
+			vg_drop_uuid_index(vg);
 		if (!id_write_format(&pv->id, uuid, sizeof(uuid)))
 			goto_bad;
 		log_verbose("Changing uuid of %s to %s.", pv_name, uuid);
@@ -192,6 +194,7 @@ static int _pvchange_single(struct cmd_context *cmd, struct volume_group *vg,
 		free(du->pvid);
 		if (!(du->pvid = strdup_pvid(pvid)))
 			log_error("Failed to set pvid for devices file.");
+		du_index_invalidate(cmd);
 		if (!device_ids_write(cmd))
 			log_warn("Failed to update devices file.");
 	}
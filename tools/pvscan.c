@@ -220,55 +220,6 @@ out:
 	return ret;
 }
 
-/*
- * When a device goes offline we only know its major:minor, not its PVID.
- * Since the dev isn't around, we can't read it to get its PVID, so we have to
- * read the PVID files to find the one containing this major:minor and remove
- * that one. This means that the PVID files need to contain the devno's they
- * were created from.
- */
-
-static void _online_pvid_file_remove_devno(unsigned major, unsigned minor)
-{
-	char path[PATH_MAX];
-	char file_vgname[NAME_LEN];
-	DIR *dir;
-	struct dirent *de;
-	unsigned file_major, file_minor;
-
-	log_debug("Remove pv online devno %u:%u", major, minor);
-
-	if (!(dir = opendir(PVS_ONLINE_DIR)))
-		return;
-
-	while ((de = readdir(dir))) {
-		if (de->d_name[0] == '.')
-			continue;
-
-		memset(path, 0, sizeof(path));
-		snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, de->d_name);
-
-		file_major = 0;
-		file_minor = 0;
-		memset(file_vgname, 0, sizeof(file_vgname));
-
-		online_pvid_file_read(path, &file_major, &file_minor, file_vgname, NULL);
-
-		if ((file_major == major) && (file_minor == minor)) {
-			log_debug("Unlink pv online %s", path);
-			if (unlink(path) && (errno != ENOENT))
-				log_sys_debug("unlink", path);
-
-			if (file_vgname[0]) {
-				online_vg_file_remove(file_vgname);
-				online_lookup_file_remove(file_vgname);
-			}
-		}
-	}
-	if (closedir(dir))
-		log_sys_debug("closedir", PVS_ONLINE_DIR);
-}
-
 static void _online_files_remove(const char *dirpath)
 {
 	char path[PATH_MAX];
@@ -471,6 +422,22 @@ static void _count_pvid_files(struct volume_group *vg, int *pvs_online, int *pvs
 {
 	char pvid[ID_LEN + 1] __attribute__((aligned(8))) = { 0 };
 	struct pv_list *pvl;
+	unsigned online, nameless;
+	unsigned pv_count = dm_list_size(&vg->pvs);
+
+	/*
+	 * The online table counts the online PVs of each VG, so a VG that
+	 * is not complete yet is found without looking for each of its PVs.
+	 * Only a count that could make the VG complete is checked per PV.
+	 * (PVs without metadata are online without a VG name.)
+	 */
+	if (online_vg_count(vg->name, &online, &nameless) &&
+	    !nameless && (online < pv_count)) {
+		log_debug("Online table has %u of %u PVs for VG %s.", online, pv_count, vg->name);
+		*pvs_online = online;
+		*pvs_offline = pv_count - online;
+		return;
+	}
 
 	*pvs_online = 0;
 	*pvs_offline = 0;
@@ -541,7 +508,6 @@ static int _pvscan_aa_single(struct cmd_context *cmd, const char *vg_name,
 static int _get_devs_from_saved_vg(struct cmd_context *cmd, const char *vgname,
 				   struct dm_list *devs)
 {
-	char path[PATH_MAX];
 	char file_vgname[NAME_LEN];
 	char file_devname[NAME_LEN];
 	char pvid[ID_LEN + 1] __attribute__((aligned(8))) = { 0 };
@@ -567,15 +533,12 @@ static int _get_devs_from_saved_vg(struct cmd_context *cmd, const char *vgname,
 	dm_list_iterate_items(pvl, &vg->pvs) {
 		memcpy(pvid, &pvl->pv->id.uuid, ID_LEN);
 
-		memset(path, 0, sizeof(path));
-		snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid);
-
 		file_major = 0;
 		file_minor = 0;
 		memset(file_vgname, 0, sizeof(file_vgname));
 		memset(file_devname, 0, sizeof(file_devname));
 
-		online_pvid_file_read(path, &file_major, &file_minor, file_vgname, file_devname);
+		online_pvid_get(pvid, &file_major, &file_minor, file_vgname, file_devname);
 
 		if (file_vgname[0] && strcmp(vgname, file_vgname)) {
 			log_error_pvscan(cmd, "Wrong VG found for %d:%d PVID %s: %s vs %s",
@@ -950,7 +913,6 @@ static int _get_args_devs(struct cmd_context *cmd, struct dm_list *pvscan_args,
 
 static void _set_pv_devices_online(struct cmd_context *cmd, struct volume_group *vg)
 {
-	char path[PATH_MAX];
 	char file_vgname[NAME_LEN];
 	char file_devname[NAME_LEN];
 	char pvid[ID_LEN+1] = { 0 };
@@ -975,15 +937,12 @@ static void _set_pv_devices_online(struct cmd_context *cmd, struct volume_group
 			continue;
 		}
 
-		memset(path, 0, sizeof(path));
-		snprintf(path, sizeof(path), "%s/%s", PVS_ONLINE_DIR, pvid);
-
 		major = 0;
 		minor = 0;
 		memset(file_vgname, 0, sizeof(file_vgname));
 		memset(file_devname, 0, sizeof(file_devname));
 
-		online_pvid_file_read(path, &major, &minor, file_vgname, file_devname);
+		online_pvid_get(pvid, &major, &minor, file_vgname, file_devname);
 
 		if (file_vgname[0] && strcmp(vg->name, file_vgname)) {
 			log_warn("WARNING: VG %s PV %s wrong vgname in online file %s",
@@ -1008,8 +967,14 @@ static void _set_pv_devices_online(struct cmd_context *cmd, struct volume_group
 	}
 }
 
+/*
+ * When udev_vgnames is set, the udev output for the devices is not printed
+ * here, and the names of the VGs completed and claimed by this pvscan are
+ * added to udev_vgnames instead.
+ */
 static int _online_devs(struct cmd_context *cmd, int do_all, struct dm_list *pvscan_devs,
-			int *pv_count, struct dm_list *complete_vgnames)
+			int *pv_count, struct dm_list *complete_vgnames,
+			struct dm_list *udev_vgnames)
 {
 	struct device_list *devl, *devl2;
 	struct device *dev;
@@ -1260,12 +1225,15 @@ static int _online_devs(struct cmd_context *cmd, int do_all, struct dm_list *pvs
 					 * Run pvscan from udev rule using --udevoutput to
 					 * enable this printf, and suppress all log output
 					 */
-					if (arg_is_set(cmd, udevoutput_ARG))
+					if (udev_vgnames) {
+						if (!str_list_add(cmd->mem, udev_vgnames, dm_pool_strdup(cmd->mem, vgname)))
+							stack;
+					} else if (arg_is_set(cmd, udevoutput_ARG))
 						printf("LVM_VG_NAME_COMPLETE='%s'\n", vgname);
 					else
 						log_print("VG %s complete", vgname);
 				}
-			} else {
+			} else if (!udev_vgnames) {
 				if (arg_is_set(cmd, udevoutput_ARG))
 					printf("LVM_VG_NAME_INCOMPLETE='%s'\n", vgname);
 				else
@@ -1358,6 +1326,7 @@ static int _pvscan_cache_all(struct cmd_context *cmd, int argc, char **argv,
 	dm_list_init(&pvscan_devs);
 
 	_online_files_remove(PVS_ONLINE_DIR);
+	online_table_clear();
 	_online_files_remove(VGS_ONLINE_DIR);
 	_online_files_remove(PVS_LOOKUP_DIR);
 
@@ -1405,16 +1374,19 @@ static int _pvscan_cache_all(struct cmd_context *cmd, int argc, char **argv,
 	}
 	dev_iter_destroy(iter);
 
-	_online_devs(cmd, 1, &pvscan_devs, &pv_count, complete_vgnames);
+	_online_devs(cmd, 1, &pvscan_devs, &pv_count, complete_vgnames, NULL);
 
 	return 1;
 }
 
 static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
-			      struct dm_list *complete_vgnames)
+			      struct dm_list *complete_vgnames,
+			      struct dm_list *udev_vgnames)
 {
 	struct dm_list pvscan_args; /* struct pvscan_arg */
 	struct dm_list pvscan_devs; /* struct device_list */
+	struct dm_list pv_devs;     /* struct device_list */
+	struct dm_list failed_devs; /* struct device_list */
 	struct pvscan_arg *arg;
 	struct device_list *devl, *devl2;
 	int relax_deviceid_filter = 0;
@@ -1423,6 +1395,8 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 
 	dm_list_init(&pvscan_args);
 	dm_list_init(&pvscan_devs);
+	dm_list_init(&pv_devs);
+	dm_list_init(&failed_devs);
 
 	cmd->expect_missing_vg_device = 1;
 
@@ -1457,7 +1431,7 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 	dm_list_iterate_items(arg, &pvscan_args) {
 		if (arg->dev || !arg->devno)
 			continue;
-		_online_pvid_file_remove_devno(MAJOR(arg->devno), MINOR(arg->devno));
+		online_pvid_file_remove_devno(MAJOR(arg->devno), MINOR(arg->devno));
 	}
 
 	/*
@@ -1580,22 +1554,23 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 
 	label_scan_setup_bcache();
 
-	dm_list_iterate_items_safe(devl, devl2, &pvscan_devs) {
-		int has_pvid;
+	/*
+	 * The reads are submitted together, which matters when pvscans for
+	 * many devs have been coalesced.
+	 */
+	(void) label_read_pvids(&pvscan_devs, &pv_devs, &failed_devs);
 
-		if (!label_read_pvid(devl->dev, &has_pvid)) {
-			log_print_pvscan(cmd, "%s cannot read label.", dev_name(devl->dev));
-			dm_list_del(&devl->list);
-			continue;
-		}
+	dm_list_iterate_items(devl, &failed_devs)
+		log_print_pvscan(cmd, "%s cannot read label.", dev_name(devl->dev));
 
-		if (!has_pvid) {
-			/* Not an lvm device */
-			log_print_pvscan(cmd, "%s not an lvm device.", dev_name(devl->dev));
-			dm_list_del(&devl->list);
-			continue;
-		}
+	/* Not lvm devices */
+	dm_list_iterate_items(devl, &pvscan_devs)
+		log_print_pvscan(cmd, "%s not an lvm device.", dev_name(devl->dev));
 
+	dm_list_init(&pvscan_devs);
+	dm_list_splice(&pvscan_devs, &pv_devs);
+
+	dm_list_iterate_items_safe(devl, devl2, &pvscan_devs) {
 		/*
 		 * filter-deviceid is not being used because of unstable devnames,
 		 * so in place of that check if the pvid is in the devices file.
@@ -1634,7 +1609,7 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 	 */
 	label_scan_devs_cached(cmd, NULL, &pvscan_devs);
 
-	ret = _online_devs(cmd, 0, &pvscan_devs, &pv_count, complete_vgnames);
+	ret = _online_devs(cmd, 0, &pvscan_devs, &pv_count, complete_vgnames, udev_vgnames);
 
 	/*
 	 * When a new PV appears, the system runs pvscan --cache dev.
@@ -1651,6 +1626,136 @@ static int _pvscan_cache_args(struct cmd_context *cmd, int argc, char **argv,
 	return ret;
 }
 
+/*
+ * Coalesce this pvscan with other pvscan --cache -aay commands, or the
+ * pvscans run by the lvm udev rule, run for devices appearing at the
+ * same time (see online_queue_add).  Returns 1
+ * with *taken set when another pvscan took the device args of this one.
+ * Otherwise, argc/argv are extended with the device args of the pvscans
+ * that this one took.
+ */
+static int _pvscan_coalesce(struct cmd_context *cmd, int window_ms,
+			    int *argc, char ***argv, int *taken)
+{
+	char path[PATH_MAX];
+	struct arg_value_group_list *current_group;
+	struct dm_list own_args, queued_args, new_args;
+	struct dm_str_list *sl;
+	char **new_argv;
+	char *str;
+	int major = -1, minor = -1;
+	int queued, i;
+	int fd;
+
+	dm_list_init(&own_args);
+	dm_list_init(&queued_args);
+	dm_list_init(&new_args);
+
+	for (i = 0; i < *argc; i++)
+		if (!str_list_add_no_dup_check(cmd->mem, &own_args, (*argv)[i]))
+			return_0;
+
+	dm_list_iterate_items(current_group, &cmd->arg_value_groups) {
+		major = grouped_arg_int_value(current_group->arg_values, major_ARG, major);
+		minor = grouped_arg_int_value(current_group->arg_values, minor_ARG, minor);
+
+		if (major < 0 || minor < 0)
+			continue;
+
+		if (!(str = dm_pool_alloc(cmd->mem, 32)) ||
+		    (dm_snprintf(str, 32, "%d:%d", major, minor) < 0) ||
+		    !str_list_add_no_dup_check(cmd->mem, &own_args, str))
+			return_0;
+	}
+
+	if (dm_list_empty(&own_args))
+		return 1;
+
+	/* Without the queue, scan the devices of this pvscan alone. */
+	if (!online_queue_add(cmd, &own_args, path, sizeof(path)))
+		return 1;
+
+	if ((fd = online_queue_lock(cmd)) < 0) {
+		if (unlink(path) && (errno == ENOENT)) {
+			/* Taken by a pvscan that got the lock. */
+			*taken = 1;
+		}
+		return 1;
+	}
+
+	if (unlink(path)) {
+		if (errno == ENOENT) {
+			log_print_pvscan(cmd, "Devices taken by another pvscan for autoactivation.");
+			*taken = 1;
+		} else
+			log_sys_debug("unlink", path);
+		online_queue_unlock(fd);
+		return 1;
+	}
+
+	log_debug("Waiting %d ms for pvscans to coalesce.", window_ms);
+	if (usleep((useconds_t) window_ms * 1000))
+		stack;
+
+	queued = online_queue_take(cmd, &queued_args);
+
+	online_queue_unlock(fd);
+
+	if (!queued)
+		return 1;
+
+	/* The same device is often reported by several uevents. */
+	dm_list_iterate_items(sl, &queued_args) {
+		if (str_list_match_item(&own_args, sl->str))
+			continue;
+		if (!str_list_add(cmd->mem, &new_args, sl->str))
+			return_0;
+	}
+
+	log_print_pvscan(cmd, "Coalesced %d pvscans with %d devices for autoactivation.",
+			 queued, dm_list_size(&new_args));
+
+	if (!(new_argv = dm_pool_alloc(cmd->mem, (*argc + dm_list_size(&new_args)) * sizeof(char *))))
+		return_0;
+
+	for (i = 0; i < *argc; i++)
+		new_argv[i] = (*argv)[i];
+
+	dm_list_iterate_items(sl, &new_args)
+		new_argv[i++] = (char *) sl->str;
+
+	*argc = i;
+	*argv = new_argv;
+
+	return 1;
+}
+
+/*
+ * A coalesced pvscan run by the udev rule reports all the VGs it completed
+ * to udev at once.  The first is named by LVM_VG_NAME_COMPLETE as for a
+ * single device, and the others are listed in LVM_VG_NAMES_COALESCED, which
+ * the udev rule passes to the same vgchange.  A pvscan whose devices were
+ * taken prints nothing.
+ */
+static void _print_udev_vgnames(struct dm_list *udev_vgnames)
+{
+	struct dm_str_list *sl;
+	int count = 0;
+
+	dm_list_iterate_items(sl, udev_vgnames) {
+		if (!count)
+			printf("LVM_VG_NAME_COMPLETE='%s'\n", sl->str);
+		else if (count == 1)
+			printf("LVM_VG_NAMES_COALESCED='%s", sl->str);
+		else
+			printf(" %s", sl->str);
+		count++;
+	}
+
+	if (count > 1)
+		printf("'\n");
+}
+
 static int _get_autoactivation(struct cmd_context *cmd, int event_activation, int *skip_command)
 {
 	const char *aa_str;
@@ -1677,14 +1782,20 @@ int pvscan_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 {
 	struct pvscan_aa_params pp = { 0 };
 	struct dm_list complete_vgnames;
+	struct dm_list udev_vgnames;
+	struct dm_list *coalesced_udev_vgnames = NULL;
 	int do_activate = arg_is_set(cmd, activate_ARG);
+	int do_udev_coalesce;
 	int event_activation;
 	int skip_command = 0;
 	int devno_args = 0;
+	int coalesce_ms;
+	int taken = 0;
 	int do_all;
 	int ret;
 
 	dm_list_init(&complete_vgnames);
+	dm_list_init(&udev_vgnames);
 
 	cmd->check_devs_used = 0;
 
@@ -1756,8 +1867,37 @@ int pvscan_cache_cmd(struct cmd_context *cmd, int argc, char **argv)
 		if (skip_command)
 			return ECMD_PROCESSED;
 
-		if (!_pvscan_cache_args(cmd, argc, argv, &complete_vgnames))
+		/*
+		 * The pvscan run by the lvm udev rule only reports complete
+		 * VGs, each claimed once by --vgonline, so it is coalesced
+		 * and reports the VGs completed by all the devices it took.
+		 * Other output from --listvg/--listlvs is about the devices
+		 * of this pvscan, so those can not be coalesced.
+		 */
+		coalesce_ms = find_config_tree_int(cmd, global_event_activation_coalesce_CFG, NULL);
+
+		do_udev_coalesce = arg_is_set(cmd, udevoutput_ARG) &&
+				   arg_is_set(cmd, checkcomplete_ARG) &&
+				   arg_is_set(cmd, vgonline_ARG) &&
+				   !arg_is_set(cmd, listlvs_ARG);
+
+		if ((coalesce_ms > 0) && !do_udev_coalesce &&
+		    (arg_is_set(cmd, listvg_ARG) || arg_is_set(cmd, listlvs_ARG)))
+			log_debug("Not coalescing pvscan with --listvg or --listlvs.");
+		else if ((do_activate || do_udev_coalesce) && (coalesce_ms > 0)) {
+			if (!_pvscan_coalesce(cmd, coalesce_ms, &argc, &argv, &taken))
+				return_ECMD_FAILED;
+			if (taken)
+				return ECMD_PROCESSED;
+			if (do_udev_coalesce)
+				coalesced_udev_vgnames = &udev_vgnames;
+		}
+
+		if (!_pvscan_cache_args(cmd, argc, argv, &complete_vgnames, coalesced_udev_vgnames))
 			return ECMD_FAILED;
+
+		if (coalesced_udev_vgnames)
+			_print_udev_vgnames(coalesced_udev_vgnames);
 	}
 
 	if (!do_activate)
@@ -100,6 +100,9 @@ static int _do_info_and_status(struct cmd_context *cmd,
 	if (lv_is_historical(lv_seg->lv))
 		return 1;
 
+	if ((do_info || do_status) && !lv_status_prefetch(cmd, lv_seg->lv->vg))
+		stack;
+
 	if (do_status) {
 		if (!(status->seg_status.mem = dm_pool_create("reporter_pool", 1024)))
 			return_0;
@@ -1218,6 +1221,8 @@ static int _do_report(struct cmd_context *cmd, struct processing_handle *handle,
 		dm_report_output(report_handle);
 
 out:
+	lv_status_prefetch_release();
+
 	if (report_handle) {
 		if (report_in_group && !dm_report_group_pop(cmd->cmd_report.report_group))
 			stack;
@@ -17,6 +17,7 @@
 #include "lib/device/device_id.h"
 #include "lib/device/persist.h"
 #include "lib/label/hints.h"
+#include "lib/mm/memlock.h"
 
 struct vgchange_params {
 	int lock_start_count;
@@ -83,47 +84,94 @@ static int _poll_lvs_in_vg(struct cmd_context *cmd,
 	return count;
 }
 
-static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
-			       activation_change_t activate)
+/* Returns the LV to activate or deactivate for lv, or NULL to skip it. */
+static struct logical_volume *_lv_to_change(struct cmd_context *cmd, struct logical_volume *lv,
+					    activation_change_t activate)
 {
-	struct lv_list *lvl;
-	struct logical_volume *lv;
-	int count = 0, expected_count = 0, r = 1;
+	if (!lv_is_visible(lv) && (!cmd->process_component_lvs || !lv_is_component(lv)))
+		return NULL;
 
-	sigint_allow();
-	dm_list_iterate_items(lvl, &vg->lvs) {
-		if (sigint_caught())
-			return_0;
+	/* If LV is sparse, activate origin instead */
+	if (lv_is_cow(lv) && lv_is_virtual_origin(origin_from_cow(lv)))
+		lv = origin_from_cow(lv);
 
-		lv = lvl->lv;
+	/* Only request activation of snapshot origin devices */
+	if (lv_is_snapshot(lv) || lv_is_cow(lv))
+		return NULL;
 
-		if (!lv_is_visible(lv) && (!cmd->process_component_lvs || !lv_is_component(lv)))
-			continue;
+	/* Only request activation of mirror LV */
+	if (lv_is_mirror_image(lv) || lv_is_mirror_log(lv))
+		return NULL;
 
-		/* If LV is sparse, activate origin instead */
-		if (lv_is_cow(lv) && lv_is_virtual_origin(origin_from_cow(lv)))
-			lv = origin_from_cow(lv);
+	if (lv_is_vdo_pool(lv))
+		return NULL;
 
-		/* Only request activation of snapshot origin devices */
-		if (lv_is_snapshot(lv) || lv_is_cow(lv))
-			continue;
+	if (lv_activation_skip(lv, activate, arg_count(cmd, ignoreactivationskip_ARG)))
+		return NULL;
 
-		/* Only request activation of mirror LV */
-		if (lv_is_mirror_image(lv) || lv_is_mirror_log(lv))
-			continue;
+	if ((activate == CHANGE_AAY) &&
+	    !lv_passes_auto_activation_filter(cmd, lv))
+		return NULL;
 
-		if (lv_is_vdo_pool(lv))
-			continue;
+	/* vg NOAUTOACTIVATE flag was already checked */
+	if ((activate == CHANGE_AAY) && (lv->status & LV_NOAUTOACTIVATE))
+		return NULL;
 
-		if (lv_activation_skip(lv, activate, arg_count(cmd, ignoreactivationskip_ARG)))
-			continue;
+	return lv;
+}
+
+/*
+ * Lock the LVs to activate in a sanlock VG together, rather than
+ * one lease at a time as each LV is activated.
+ */
+static void _lock_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
+			    activation_change_t activate)
+{
+	struct dm_list lvs;
+	struct lv_list *lvl, *lvl_new;
+	struct logical_volume *lv;
+	const char *mode = NULL;
+
+	if (!vg_is_sanlock(vg))
+		return;
+
+	if (activate == CHANGE_ASY)
+		mode = "sh";
+	if (activate == CHANGE_AEY)
+		mode = "ex";
 
-		if ((activate == CHANGE_AAY) &&
-		    !lv_passes_auto_activation_filter(cmd, lv))
+	dm_list_init(&lvs);
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!(lv = _lv_to_change(cmd, lvl->lv, activate)))
 			continue;
+		if (!(lvl_new = dm_pool_alloc(cmd->mem, sizeof(*lvl_new))))
+			return;
+		lvl_new->lv = lv;
+		dm_list_add(&lvs, &lvl_new->list);
+	}
+
+	lockd_lv_batch(cmd, vg, &lvs, mode);
+}
+
+static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
+			       activation_change_t activate)
+{
+	struct lv_list *lvl;
+	struct logical_volume *lv;
+	int count = 0, expected_count = 0, r = 1;
 
-		/* vg NOAUTOACTIVATE flag was already checked */
-		if ((activate == CHANGE_AAY) && (lv->status & LV_NOAUTOACTIVATE))
+	if (is_change_activating(activate))
+		_lock_lvs_in_vg(cmd, vg, activate);
+
+	sigint_allow();
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (sigint_caught()) {
+			lockd_lv_batch_done(cmd, vg);
+			return_0;
+		}
+
+		if (!(lv = _lv_to_change(cmd, lvl->lv, activate)))
 			continue;
 
 		expected_count++;
@@ -139,6 +187,8 @@ static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 
 	sigint_restore();
 
+	lockd_lv_batch_done(cmd, vg);
+
 	if (expected_count)
 		log_verbose("%sctivated %d logical volumes in volume group %s.",
 			    is_change_activating(activate) ? "A" : "Dea",
@@ -156,8 +206,15 @@ static int _activate_lvs_in_vg(struct cmd_context *cmd, struct volume_group *vg,
 		r = 0;
 	}
 
-	/* Wait until devices are available */
-	sync_local_dev_names(vg->cmd);
+	/*
+	 * Wait until devices are available.  With udev_sync_batch, devices
+	 * activated in further VGs join the same udev transaction and the
+	 * command waits once, after the last VG.
+	 */
+	if (!is_change_activating(activate) || !cmd->udev_sync_batch)
+		sync_local_dev_names(vg->cmd);
+	else
+		memlock_unlock(vg->cmd);
 
 	return r;
 }
@@ -1218,6 +1275,9 @@ int vgchange(struct cmd_context *cmd, int argc, char **argv)
 
 	ret = process_each_vg(cmd, argc, argv, vgname, NULL, flags, 0, handle, &_vgchange_single);
 
+	/* Wait for devices activated with udev_sync_batch */
+	sync_local_dev_names(cmd);
+
 	destroy_processing_handle(cmd, handle);
 	return ret;
 }
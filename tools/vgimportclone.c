@@ -143,6 +143,9 @@ static int _update_vg(struct cmd_context *cmd, struct volume_group *vg,
 		dm_list_add(&vg->pv_write_list, &new_pvl->list);
 	}
 
+	/* PV uuids changed */
+	vg_drop_uuid_index(vg);
+
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		memcpy(&lvl->lv->lvid, &vg->id, sizeof(vg->id));
 		lvl->lv->lock_args = NULL;
@@ -14,6 +14,7 @@
  */
 
 #include "tools.h"
+#include "lib/format_text/metadata_cache.h"
 
 static struct volume_group *_vgmerge_vg_read(struct cmd_context *cmd,
 					     const char *vg_name)
@@ -224,6 +225,7 @@ static int _vgmerge_single(struct cmd_context *cmd, const char *vg_name_to,
 
 	/* FIXME Remove /dev/vgfrom */
 
+	metadata_cache_remove(vg_from->name);
 	backup(vg_to);
 	log_print_unless_silent("Volume group \"%s\" successfully merged into \"%s\"",
 				vg_from->name, vg_to->name);
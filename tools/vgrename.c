@@ -15,6 +15,7 @@
 
 #include "tools.h"
 #include "lib/device/persist.h"
+#include "lib/format_text/metadata_cache.h"
 
 struct vgrename_params {
 	const char *vg_name_old;
@@ -152,6 +153,9 @@ static int _vgrename_single(struct cmd_context *cmd, const char *vg_name,
 	if (!backup_remove(cmd, vg_name))
 		stack;
 
+	metadata_cache_remove(vg_name);
+	metadata_cache_remove(vp->vg_name_new);
+
 	unlock_vg(cmd, vg, vp->vg_name_new);
 	vp->unlock_new_name = 0;
 